@@ -0,0 +1,28 @@
+# - Find LZ4
+# Find the LZ4 compression library
+# This module defines
+# LZ4_INCLUDE_DIR, where to find lz4.h
+# LZ4_LIBRARIES, the libraries needed to use LZ4
+# LZ4_FOUND, whether LZ4 was found
+
+FIND_PACKAGE(PkgConfig QUIET)
+PKG_CHECK_MODULES(PC_LZ4 QUIET liblz4)
+
+FIND_PATH(LZ4_INCLUDE_DIR NAMES lz4.h
+    HINTS
+        ${PC_LZ4_INCLUDEDIR}
+        ${PC_LZ4_INCLUDE_DIRS}
+        ${CMAKE_INSTALL_INCLUDEDIR}
+)
+
+FIND_LIBRARY(LZ4_LIBRARIES NAMES lz4
+    HINTS
+        ${PC_LZ4_LIBDIR}
+        ${PC_LZ4_LIBRARY_DIRS}
+)
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4
+    REQUIRED_VARS LZ4_INCLUDE_DIR LZ4_LIBRARIES)
+
+MARK_AS_ADVANCED(LZ4_INCLUDE_DIR LZ4_LIBRARIES)
@@ -0,0 +1,23 @@
+-- Script to migate from db version 31 to 32.
+
+-- Per-day playback rollups for charts, trending and playtime
+CREATE TABLE IF NOT EXISTS playback_stats_daily (
+    day INTEGER NOT NULL,
+    source INTEGER NOT NULL DEFAULT 0,
+    track INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,
+    artist INTEGER NOT NULL REFERENCES artist(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,
+    plays INTEGER NOT NULL DEFAULT 0,
+    secs_played INTEGER NOT NULL DEFAULT 0,
+    PRIMARY KEY (day, source, track)
+);
+
+CREATE INDEX playback_stats_daily_track ON playback_stats_daily(track, day);
+CREATE INDEX playback_stats_daily_artist ON playback_stats_daily(artist, day);
+CREATE INDEX playback_stats_daily_source ON playback_stats_daily(source, day);
+
+INSERT INTO playback_stats_daily(day, source, track, artist, plays, secs_played)
+    SELECT playback_log.playtime / 86400, IFNULL(playback_log.source, 0), playback_log.track, track.artist, COUNT(*), SUM(playback_log.secs_played)
+    FROM playback_log JOIN track ON track.id = playback_log.track
+    GROUP BY playback_log.playtime / 86400, IFNULL(playback_log.source, 0), playback_log.track;
+
+UPDATE settings SET v = '32' WHERE k == 'schema_version';
@@ -26,6 +26,7 @@
 #include "resolvers/Resolver.h"
 #include "utils/Json.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 
 // Assumptions: QxtWebRequestEvent instance is called event and result is true on success
 #define JSON_REPLY( result, message ) jsonReply( event, Q_FUNC_INFO, message, !result )
@@ -135,6 +136,36 @@ Api_v1_5::playback( QxtWebRequestEvent* event, const QString& command )
 }
 
 
+void
+Api_v1_5::metrics( QxtWebRequestEvent* event, const QString& format )
+{
+    QByteArray body;
+    QByteArray contentType;
+    if ( format == "prometheus" )
+    {
+        body = Tomahawk::Metrics::instance()->toPrometheus();
+        contentType = "text/plain; version=0.0.4";
+    }
+    else if ( format.isEmpty() || format == "json" )
+    {
+        bool ok;
+        body = TomahawkUtils::toJson( Tomahawk::Metrics::instance()->toVariant(), &ok );
+        Q_ASSERT( ok );
+        contentType = "application/json";
+    }
+    else
+    {
+        m_service->sendJsonError( event, "No such metrics format." );
+        return;
+    }
+
+    QxtWebPageEvent * e = new QxtWebPageEvent( event->sessionID, event->requestID, body );
+    e->headers.insert( "Access-Control-Allow-Origin", "*" );
+    e->contentType = contentType;
+    m_service->postEvent( e );
+}
+
+
 void
 Api_v1_5::jsonReply( QxtWebRequestEvent* event, const char* funcInfo, const QString& errorMessage, bool isError )
 {
@@ -45,6 +45,14 @@ public slots:
      */
     void playback( QxtWebRequestEvent* event, const QString& command );
 
+    /**
+     * Runtime metrics (latencies, queue depths, throughput, cache hit rates).
+     *
+     * Served as JSON by default, /api/1.5/metrics/prometheus returns the
+     * Prometheus text format instead.
+     */
+    void metrics( QxtWebRequestEvent* event, const QString& format = QString() );
+
 protected:
     void jsonReply( QxtWebRequestEvent* event, const char* funcInfo, const QString& errorMessage, bool isError );
 
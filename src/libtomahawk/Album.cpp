@@ -22,6 +22,8 @@
 #include "database/Database.h"
 #include "database/DatabaseImpl.h"
 #include "database/IdThreadWorker.h"
+#include "utils/ConcurrentWeakHash.h"
+#include "utils/CoverCache.h"
 #include "utils/TomahawkUtilsGui.h"
 #include "utils/Logger.h"
 
@@ -31,31 +33,46 @@
 #include "Query.h"
 #include "Source.h"
 
-#include <QReadWriteLock>
-#include <QPixmapCache>
-
 using namespace Tomahawk;
 
-QHash< QString, album_wptr > Album::s_albumsByName = QHash< QString, album_wptr >();
-QHash< unsigned int, album_wptr > Album::s_albumsById = QHash< unsigned int, album_wptr >();
+static Tomahawk::Utils::ConcurrentWeakHash< QPair< InternedString, InternedString >, Album > s_albumsByName;
+static Tomahawk::Utils::ConcurrentWeakHash< unsigned int, Album > s_albumsById;
 
-static QMutex s_nameCacheMutex;
-static QReadWriteLock s_idMutex;
+static Tomahawk::Utils::StripedMutex s_idMutex;
 
 
 Album::~Album()
 {
     Q_D( Album );
     d->ownRef.clear();
-
-    delete d->cover;
 }
 
 
-inline QString
+/// Interns the key, only for new entries. Lookups use findAlbumCacheKey().
+inline QPair< InternedString, InternedString >
 albumCacheKey( const Tomahawk::artist_ptr& artist, const QString& albumName )
 {
-    return QString( "%1\t\t%2" ).arg( artist->name().toLower() ).arg( albumName.toLower() );
+    return qMakePair( InternedString( artist->name().toLower() ), InternedString( albumName.toLower() ) );
+}
+
+
+/// Like albumCacheKey(), without interning anything. Needs an InternedString::Lookup.
+static bool
+findAlbumCacheKey( const Tomahawk::artist_ptr& artist, const QString& albumName, QPair< InternedString, InternedString >* key )
+{
+    return InternedString::find( artist->name().toLower(), &key->first ) && InternedString::find( albumName.toLower(), &key->second );
+}
+
+
+static album_ptr
+cachedAlbum( const Tomahawk::artist_ptr& artist, const QString& albumName )
+{
+    InternedString::Lookup lookup;
+    QPair< InternedString, InternedString > key;
+    if ( !findAlbumCacheKey( artist, albumName, &key ) )
+        return album_ptr();
+
+    return s_albumsByName.value( key );
 }
 
 
@@ -65,57 +82,42 @@ Album::get( const Tomahawk::artist_ptr& artist, const QString& name, bool autoCr
     if ( !Database::instance() || !Database::instance()->impl() )
         return album_ptr();
 
-    QMutexLocker lock( &s_nameCacheMutex );
-    const QString key = albumCacheKey( artist, name );
-    if ( s_albumsByName.contains( key ) )
-    {
-        album_wptr album = s_albumsByName.value( key );
-        if ( album )
-            return album.toStrongRef();
-    }
+    album_ptr cached = cachedAlbum( artist, name );
+    if ( cached )
+        return cached;
 
     album_ptr album = album_ptr( new Album( name, artist ), &Album::deleteLater );
     album->setWeakRef( album.toWeakRef() );
-    album->loadId( autoCreate );
-    s_albumsByName.insert( key, album );
 
-    return album;
+    // Another thread created the same one meanwhile, ours gets dropped
+    const album_ptr stored = s_albumsByName.insert( albumCacheKey( artist, name ), album );
+    if ( stored == album )
+        album->loadId( autoCreate );
+
+    return stored;
 }
 
 
 album_ptr
 Album::get( unsigned int id, const QString& name, const Tomahawk::artist_ptr& artist )
 {
-    s_idMutex.lockForRead();
-    if ( s_albumsById.contains( id ) )
-    {
-        album_wptr album = s_albumsById.value( id );
-        s_idMutex.unlock();
+    album_ptr cached = s_albumsById.value( id );
+    if ( cached )
+        return cached;
 
-        if ( album )
-            return album;
-    }
-    s_idMutex.unlock();
-
-    QMutexLocker lock( &s_nameCacheMutex );
-    const QString key = albumCacheKey( artist, name );
-    if ( s_albumsByName.contains( key ) )
-    {
-        album_wptr album = s_albumsByName.value( key );
-        if ( album )
-            return album;
-    }
+    cached = cachedAlbum( artist, name );
+    if ( cached )
+        return cached;
 
     album_ptr a = album_ptr( new Album( id, name, artist ), &Album::deleteLater );
     a->setWeakRef( a.toWeakRef() );
-    s_albumsByName.insert( key, a );
+
+    const album_ptr stored = s_albumsByName.insert( albumCacheKey( artist, name ), a );
+    if ( stored != a )
+        return stored;
 
     if ( id > 0 )
-    {
-        s_idMutex.lockForWrite();
         s_albumsById.insert( id, a );
-        s_idMutex.unlock();
-    }
 
     return a;
 }
@@ -125,7 +127,7 @@ Album::Album( unsigned int id, const QString& name, const Tomahawk::artist_ptr&
     : d_ptr( new AlbumPrivate( this, id, name, artist ) )
 {
     Q_D( Album );
-    d->sortname = DatabaseImpl::sortname( name );
+    d->sortname = InternedString( DatabaseImpl::sortname( name ) );
 }
 
 
@@ -133,7 +135,7 @@ Album::Album( const QString& name, const Tomahawk::artist_ptr& artist )
     : d_ptr( new AlbumPrivate( this, name, artist ) )
 {
     Q_D( Album );
-    d->sortname = DatabaseImpl::sortname( name );
+    d->sortname = InternedString( DatabaseImpl::sortname( name ) );
 }
 
 
@@ -141,23 +143,16 @@ void
 Album::deleteLater()
 {
     Q_D( Album );
-    QMutexLocker lock( &s_nameCacheMutex );
 
-    const QString key = albumCacheKey( d->artist, d->name );
-    if ( s_albumsByName.contains( key ) )
     {
-        s_albumsByName.remove( key );
+        InternedString::Lookup lookup;
+        QPair< InternedString, InternedString > key;
+        if ( findAlbumCacheKey( d->artist, name(), &key ) )
+            s_albumsByName.removeExpired( key );
     }
 
     if ( d->id > 0 )
-    {
-        s_idMutex.lockForWrite();
-        if ( s_albumsById.contains( d->id ) )
-        {
-            s_albumsById.remove( d->id );
-        }
-        s_idMutex.unlock();
-    }
+        s_albumsById.removeExpired( d->id );
 
     QObject::deleteLater();
 }
@@ -199,23 +194,24 @@ unsigned int
 Album::id() const
 {
     Q_D( const Album );
-    s_idMutex.lockForRead();
+    QMutex* mutex = s_idMutex.mutex( this );
+    mutex->lock();
     const bool waiting = d->waitingForId;
     unsigned int finalId = d->id;
-    s_idMutex.unlock();
+    mutex->unlock();
 
     if ( waiting )
     {
         finalId = d->idFuture.result();
 
-        s_idMutex.lockForWrite();
+        mutex->lock();
         d->id = finalId;
         d->waitingForId = false;
+        mutex->unlock();
 
-        if ( d->id > 0 )
-            s_albumsById.insert( d->id, d->ownRef.toStrongRef() );
-
-        s_idMutex.unlock();
+        const album_ptr self = d->ownRef.toStrongRef();
+        if ( finalId > 0 && self )
+            s_albumsById.insert( finalId, self );
     }
 
     return finalId;
@@ -226,7 +222,7 @@ QString
 Album::name() const
 {
     Q_D( const Album );
-    return d->name;
+    return d->name.toString();
 }
 
 
@@ -234,7 +230,7 @@ QString
 Album::sortname() const
 {
     Q_D( const Album );
-    return d->sortname;
+    return d->sortname.toString();
 }
 
 
@@ -255,7 +251,7 @@ Album::cover( const QSize& size, bool forceLoad ) const
 
         Tomahawk::InfoSystem::InfoStringHash trackInfo;
         trackInfo["artist"] = d->artist->name();
-        trackInfo["album"] = d->name;
+        trackInfo["album"] = d->name.toString();
 
         Tomahawk::InfoSystem::InfoRequestData requestData;
         requestData.caller = infoid();
@@ -276,35 +272,25 @@ Album::cover( const QSize& size, bool forceLoad ) const
         d->coverLoading = true;
     }
 
-    if ( !d->cover && !d->coverBuffer.isEmpty() )
-    {
-        QPixmap cover;
-        cover.loadFromData( d->coverBuffer );
-        d->coverBuffer.clear();
+    return CoverCache::instance()->pixmap( infoid(), d->coverBuffer, size, const_cast< Album* >( this ), "coverChanged" );
+}
 
-        d->cover = new QPixmap( TomahawkUtils::squareCenterPixmap( cover ) );
-    }
 
-    if ( d->cover && !d->cover->isNull() && !size.isEmpty() )
-    {
-        const QString cacheKey = QString( "%1_%2_%3" ).arg( infoid() ).arg( size.width() ).arg( size.height() );
-        QPixmap cover;
+bool
+Album::hasCover() const
+{
+    Q_D( const Album );
+    return !d->coverBuffer.isEmpty();
+}
 
-        if ( !QPixmapCache::find( cacheKey, &cover ) )
-        {
-            cover = d->cover->scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
-            QPixmapCache::insert( cacheKey, cover );
-            return cover;
-        }
-        return cover;
-    }
 
-    if ( d->cover )
-        return *d->cover;
-    else
-        return QPixmap();
+bool
+Album::coverFailed( const QSize& size ) const
+{
+    return hasCover() && CoverCache::instance()->hasFailed( infoid(), size );
 }
 
+
 bool
 Album::coverLoaded() const
 {
@@ -334,6 +320,7 @@ Album::infoSystemInfo( const Tomahawk::InfoSystem::InfoRequestData& requestData,
         if ( ba.length() )
         {
             d->coverBuffer = ba;
+            CoverCache::instance()->remove( infoid() );
         }
 
         d->coverLoaded = true;
@@ -60,6 +60,9 @@ public:
     artist_ptr artist() const;
     QPixmap cover( const QSize& size, bool forceLoad = true ) const;
     bool coverLoaded() const;
+    bool hasCover() const;
+    /// Whether our cover art turned out to be undecodable at @p size.
+    bool coverFailed( const QSize& size ) const;
 
     QList<Tomahawk::query_ptr> tracks( ModelMode mode = Mixed, const Tomahawk::collection_ptr& collection = Tomahawk::collection_ptr() );
     Tomahawk::playlistinterface_ptr playlistInterface( ModelMode mode, const Tomahawk::collection_ptr& collection = Tomahawk::collection_ptr() );
@@ -92,9 +95,6 @@ private:
     QString infoid() const;
     void setIdFuture( QFuture<unsigned int> future );
 
-    static QHash< QString, album_wptr > s_albumsByName;
-    static QHash< unsigned int, album_wptr > s_albumsById;
-
     friend class IdThreadWorker;
 };
 
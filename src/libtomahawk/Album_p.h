@@ -23,6 +23,7 @@
 #define ALBUM_P_H
 
 #include "Album.h"
+#include "utils/InternedString.h"
 
 namespace Tomahawk
 {
@@ -38,7 +39,6 @@ public:
         , artist( _artist )
         , coverLoaded( false )
         , coverLoading( false )
-        , cover( 0 )
     {
     }
 
@@ -51,7 +51,6 @@ public:
         , artist( _artist )
         , coverLoaded( false )
         , coverLoading( false )
-        , cover( 0 )
     {
     }
 
@@ -62,8 +61,8 @@ private:
     mutable bool waitingForId;
     mutable QFuture<unsigned int> idFuture;
     mutable unsigned int id;
-    QString name;
-    QString sortname;
+    InternedString name;
+    InternedString sortname;
 
     artist_ptr artist;
 
@@ -72,7 +71,6 @@ private:
     mutable QString uuid;
 
     mutable QByteArray coverBuffer;
-    mutable QPixmap* cover;
 
     QHash< Tomahawk::ModelMode, QHash< Tomahawk::collection_ptr, Tomahawk::playlistinterface_ptr > > playlistInterface;
 
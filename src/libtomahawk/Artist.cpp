@@ -27,6 +27,8 @@
 #include "database/DatabaseCommand_ArtistStats.h"
 #include "database/DatabaseCommand_TrackStats.h"
 #include "database/IdThreadWorker.h"
+#include "utils/ConcurrentWeakHash.h"
+#include "utils/CoverCache.h"
 #include "utils/TomahawkUtilsGui.h"
 #include "utils/Logger.h"
 
@@ -34,25 +36,32 @@
 #include "PlaylistEntry.h"
 #include "Source.h"
 
-#include <QReadWriteLock>
-#include <QPixmapCache>
-
 using namespace Tomahawk;
 
-QHash< QString, artist_wptr > Artist::s_artistsByName = QHash< QString, artist_wptr >();
-QHash< unsigned int, artist_wptr > Artist::s_artistsById = QHash< unsigned int, artist_wptr >();
+static Tomahawk::Utils::ConcurrentWeakHash< InternedString, Artist > s_artistsByName;
+static Tomahawk::Utils::ConcurrentWeakHash< unsigned int, Artist > s_artistsById;
 
-static QMutex s_nameCacheMutex;
-static QReadWriteLock s_idMutex;
-static QMutex s_memberMutex;
+static Tomahawk::Utils::StripedMutex s_idMutex;
+static Tomahawk::Utils::StripedMutex s_memberMutex;
+
+
+// Lookups don't intern anything, only artists we create do
+static artist_ptr
+cachedArtist( const QString& key )
+{
+    InternedString::Lookup lookup;
+    InternedString interned;
+    if ( !InternedString::find( key, &interned ) )
+        return artist_ptr();
+
+    return s_artistsByName.value( interned );
+}
 
 
 Artist::~Artist()
 {
-    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Deleting artist:" << m_name;
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Deleting artist:" << name();
     m_ownRef.clear();
-
-    delete m_cover;
 }
 
 
@@ -62,24 +71,23 @@ Artist::get( const QString& name, bool autoCreate )
     if ( name.isEmpty() )
         return artist_ptr();
 
-    QMutexLocker lock( &s_nameCacheMutex );
     const QString key = name.toLower();
-    if ( s_artistsByName.contains( key ) )
-    {
-        artist_wptr artist = s_artistsByName.value( key );
-        if ( artist )
-            return artist.toStrongRef();
-    }
+    artist_ptr cached = cachedArtist( key );
+    if ( cached )
+        return cached;
 
     if ( !Database::instance() || !Database::instance()->impl() )
         return artist_ptr();
 
     artist_ptr artist = artist_ptr( new Artist( name ), &Artist::deleteLater );
     artist->setWeakRef( artist.toWeakRef() );
-    artist->loadId( autoCreate );
-    s_artistsByName.insert( key, artist );
 
-    return artist;
+    // Another thread created the same one meanwhile, ours gets dropped
+    const artist_ptr stored = s_artistsByName.insert( InternedString( key ), artist );
+    if ( stored == artist )
+        artist->loadId( autoCreate );
+
+    return stored;
 }
 
 
@@ -88,36 +96,24 @@ Artist::get( unsigned int id, const QString& name )
 {
     Q_ASSERT( id > 0 );
 
-    s_idMutex.lockForRead();
-    if ( s_artistsById.contains( id ) )
-    {
-        artist_wptr artist = s_artistsById.value( id );
-        s_idMutex.unlock();
-
-        if ( !artist.isNull() )
-            return artist;
-    }
-    s_idMutex.unlock();
+    artist_ptr cached = s_artistsById.value( id );
+    if ( cached )
+        return cached;
 
-    QMutexLocker lock( &s_nameCacheMutex );
     const QString key = name.toLower();
-    if ( s_artistsByName.contains( key ) )
-    {
-        artist_wptr artist = s_artistsByName.value( key );
-        if ( !artist.isNull() )
-            return artist;
-    }
+    cached = cachedArtist( key );
+    if ( cached )
+        return cached;
 
     artist_ptr a = artist_ptr( new Artist( id, name ), &Artist::deleteLater );
     a->setWeakRef( a.toWeakRef() );
-    s_artistsByName.insert( key, a );
+
+    const artist_ptr stored = s_artistsByName.insert( InternedString( key ), a );
+    if ( stored != a )
+        return stored;
 
     if ( id > 0 )
-    {
-        s_idMutex.lockForWrite();
         s_artistsById.insert( id, a );
-        s_idMutex.unlock();
-    }
 
     return a;
 }
@@ -135,10 +131,9 @@ Artist::Artist( unsigned int id, const QString& name )
     , m_infoJobs( 0 )
     , m_chartPosition( 0 )
     , m_chartCount( 0 )
-    , m_cover( 0 )
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Creating artist:" << id << name;
-    m_sortname = DatabaseImpl::sortname( name, true );
+    m_sortname = InternedString( DatabaseImpl::sortname( name, true ) );
 }
 
 
@@ -154,33 +149,24 @@ Artist::Artist( const QString& name )
     , m_infoJobs( 0 )
     , m_chartPosition( 0 )
     , m_chartCount( 0 )
-    , m_cover( 0 )
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Creating artist:" << name;
-    m_sortname = DatabaseImpl::sortname( name, true );
+    m_sortname = InternedString( DatabaseImpl::sortname( name, true ) );
 }
 
 
 void
 Artist::deleteLater()
 {
-    QMutexLocker lock( &s_nameCacheMutex );
-
-    const QString key = m_name.toLower();
-    if ( s_artistsByName.contains( key ) )
     {
-        s_artistsByName.remove( key );
+        InternedString::Lookup lookup;
+        InternedString key;
+        if ( InternedString::find( name().toLower(), &key ) )
+            s_artistsByName.removeExpired( key );
     }
 
     if ( m_id > 0 )
-    {
-        s_idMutex.lockForWrite();
-        if ( s_artistsById.contains( m_id ) )
-        {
-            s_artistsById.remove( m_id );
-        }
-        s_idMutex.unlock();
-    }
+        s_artistsById.removeExpired( m_id );
 
     QObject::deleteLater();
 }
@@ -329,9 +315,10 @@ Artist::setIdFuture( QFuture<unsigned int> future )
 unsigned int
 Artist::id() const
 {
-    s_idMutex.lockForRead();
+    QMutex* mutex = s_idMutex.mutex( this );
+    mutex->lock();
     const bool waiting = m_waitingForFuture;
-    s_idMutex.unlock();
+    mutex->unlock();
 
     if ( waiting )
     {
@@ -342,14 +329,14 @@ Artist::id() const
 
 //        qDebug() << Q_FUNC_INFO << "Got loaded artist:" << m_name << finalid;
 
-        s_idMutex.lockForWrite();
+        mutex->lock();
         m_id = finalid;
         m_waitingForFuture = false;
+        mutex->unlock();
 
-        if ( m_id > 0 )
-            s_artistsById.insert( m_id, m_ownRef.toStrongRef() );
-
-        s_idMutex.unlock();
+        const artist_ptr self = m_ownRef.toStrongRef();
+        if ( finalid > 0 && self )
+            s_artistsById.insert( finalid, self );
     }
 
     return m_id;
@@ -425,7 +412,7 @@ void
 Artist::setPlaybackHistory( const QList< Tomahawk::PlaybackLog >& playbackData )
 {
     {
-        QMutexLocker locker( &s_memberMutex );
+        QMutexLocker locker( s_memberMutex.mutex( this ) );
         m_playbackHistory = playbackData;
     }
 
@@ -436,7 +423,7 @@ Artist::setPlaybackHistory( const QList< Tomahawk::PlaybackLog >& playbackData )
 unsigned int
 Artist::playbackCount( const source_ptr& source ) const
 {
-    QMutexLocker locker( &s_memberMutex );
+    QMutexLocker locker( s_memberMutex.mutex( this ) );
 
     unsigned int count = 0;
     foreach ( const PlaybackLog& log, m_playbackHistory )
@@ -518,6 +505,7 @@ Artist::infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData requestData, QVari
                 if ( ba.length() )
                 {
                     m_coverBuffer = ba;
+                    CoverCache::instance()->remove( infoid() );
                 }
 
                 m_coverLoaded = true;
@@ -616,33 +604,7 @@ Artist::cover( const QSize& size, bool forceLoad ) const
         m_coverLoading = true;
     }
 
-    if ( !m_cover && !m_coverBuffer.isEmpty() )
-    {
-        QPixmap cover;
-        cover.loadFromData( m_coverBuffer );
-        m_coverBuffer.clear();
-
-        m_cover = new QPixmap( TomahawkUtils::squareCenterPixmap( cover ) );
-    }
-
-    if ( m_cover && !m_cover->isNull() && !size.isEmpty() )
-    {
-        const QString cacheKey = QString( "%1_%2_%3" ).arg( infoid() ).arg( size.width() ).arg( size.height() );
-        QPixmap cover;
-
-        if ( !QPixmapCache::find( cacheKey, &cover ) )
-        {
-            cover = m_cover->scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
-            QPixmapCache::insert( cacheKey, cover );
-            return cover;
-        }
-        return cover;
-    }
-
-    if ( m_cover )
-        return *m_cover;
-    else
-        return QPixmap();
+    return CoverCache::instance()->pixmap( infoid(), m_coverBuffer, size, const_cast< Artist* >( this ), "coverChanged" );
 }
 
 
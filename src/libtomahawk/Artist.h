@@ -27,6 +27,7 @@
 #include "Typedefs.h"
 #include "DllMacro.h"
 #include "Query.h"
+#include "utils/InternedString.h"
 
 namespace Tomahawk
 {
@@ -46,8 +47,8 @@ public:
     virtual ~Artist();
 
     unsigned int id() const;
-    QString name() const { return m_name; }
-    QString sortname() const { return m_sortname; }
+    QString name() const { return m_name.toString(); }
+    QString sortname() const { return m_sortname.toString(); }
 
     QList<album_ptr> albums( ModelMode mode = Mixed, const Tomahawk::collection_ptr& collection = Tomahawk::collection_ptr() ) const;
     QList<artist_ptr> similarArtists() const;
@@ -67,6 +68,7 @@ public:
 
     QPixmap cover( const QSize& size, bool forceLoad = true ) const;
     bool coverLoaded() const { return m_coverLoaded; }
+    bool hasCover() const { return !m_coverBuffer.isEmpty(); }
 
     Tomahawk::playlistinterface_ptr playlistInterface();
 
@@ -106,8 +108,8 @@ private:
     mutable QFuture<unsigned int> m_idFuture;
     mutable unsigned int m_id;
 
-    QString m_name;
-    QString m_sortname;
+    InternedString m_name;
+    InternedString m_sortname;
 
     bool m_coverLoaded;
     mutable bool m_coverLoading;
@@ -128,15 +130,11 @@ private:
     unsigned int m_chartCount;
 
     mutable QByteArray m_coverBuffer;
-    mutable QPixmap* m_cover;
 
     QHash< Tomahawk::ModelMode, QHash< Tomahawk::collection_ptr, Tomahawk::playlistinterface_ptr > > m_playlistInterface;
 
     QWeakPointer< Tomahawk::Artist > m_ownRef;
 
-    static QHash< QString, artist_wptr > s_artistsByName;
-    static QHash< unsigned int, artist_wptr > s_artistsById;
-
     friend class IdThreadWorker;
 };
 
@@ -295,6 +295,8 @@ Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool tempora
                 d->temporaryQueryTimer.start();
             }
         }
+
+        d->queueDepth->set( d->queries_pending.count() );
     }
 
     shuntNext();
@@ -353,6 +355,29 @@ Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
     if ( q.isNull() )
         return;
 
+    // Empty reports don't tell us who sent them, that's most likely the resolver we asked last
+    Resolver* resolver = q->currentResolver();
+    if ( !results.isEmpty() && !results.first().isNull() && !results.first()->resolvedBy().isNull() )
+        resolver = results.first()->resolvedBy().data();
+
+    if ( resolver )
+    {
+        QMutexLocker lock( &d->mut );
+        QMap< QID, QHash< Resolver*, qint64 > >::iterator it = d->dispatched.find( qid );
+        if ( it != d->dispatched.end() && it->contains( resolver ) )
+        {
+            const qint64 latency = d->clock.elapsed() - it->take( resolver );
+            const QString name = resolver->name();
+            Histogram* histogram = d->resolverLatency.value( name );
+            if ( !histogram )
+            {
+                histogram = Metrics::instance()->histogram( "pipeline_resolver_latency_ms", "resolver", name );
+                d->resolverLatency.insert( name, histogram );
+            }
+            histogram->record( latency );
+        }
+    }
+
     QList< result_ptr > cleanResults;
     QList< result_ptr > httpResults;
     foreach ( const result_ptr& r, results )
@@ -523,6 +548,7 @@ Pipeline::shuntNext()
         */
         q = d->queries_pending.takeFirst();
         q->setCurrentResolver( 0 );
+        d->queueDepth->set( d->queries_pending.count() );
     }
 
     setQIDState( q, rc );
@@ -539,6 +565,19 @@ Pipeline::timeoutShunt( const query_ptr& q )
     // are we still waiting for a timeout?
     if ( d->qidsTimeout.contains( q->id() ) )
     {
+        if ( q->currentResolver() )
+        {
+            const QString name = q->currentResolver()->name();
+            QMutexLocker lock( &d->mut );
+            Counter* counter = d->resolverTimeouts.value( name );
+            if ( !counter )
+            {
+                counter = Metrics::instance()->counter( "pipeline_resolver_timeouts_total", "resolver", name );
+                d->resolverTimeouts.insert( name, counter );
+            }
+            counter->add();
+        }
+
         decQIDState( q );
     }
 }
@@ -560,6 +599,10 @@ Pipeline::shunt( const query_ptr& q )
         tLog( LOGVERBOSE ) << "Dispatching to resolver" << r->name() << q->toString() << q->solved() << q->id();
 
         q->setCurrentResolver( r );
+        {
+            QMutexLocker lock( &d->mut );
+            d->dispatched[ q->id() ].insert( r, d->clock.elapsed() );
+        }
         r->resolve( q );
         emit resolving( q );
 
@@ -617,12 +660,15 @@ Pipeline::setQIDState( const Tomahawk::query_ptr& query, int state )
     if ( state > 0 )
     {
         d->qidsState.insert( query->id(), state );
+        d->activeQueries->set( d->qidsState.count() );
 
         new FuncTimeout( 0, boost::bind( &Pipeline::shunt, this, query ), this );
     }
     else
     {
         d->qidsState.remove( query->id() );
+        d->dispatched.remove( query->id() );
+        d->activeQueries->set( d->qidsState.count() );
         query->onResolvingFinished();
 
         if ( !d->queries_temporary.contains( query ) )
@@ -645,6 +691,7 @@ Pipeline::incQIDState( const Tomahawk::query_ptr& query )
         state = d->qidsState.value( query->id() ) + 1;
     }
     d->qidsState.insert( query->id(), state );
+    d->activeQueries->set( d->qidsState.count() );
 
     return state;
 }
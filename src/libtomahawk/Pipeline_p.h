@@ -22,7 +22,10 @@
 #define PIPELINE_P_H
 
 #include "Pipeline.h"
+#include "utils/Metrics.h"
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QMutex>
 #include <QTimer>
 
@@ -35,7 +38,10 @@ public:
     PipelinePrivate( Pipeline* q )
         : q_ptr( q )
         , running( false )
+        , queueDepth( Metrics::instance()->gauge( "pipeline_queue_depth" ) )
+        , activeQueries( Metrics::instance()->gauge( "pipeline_active_queries" ) )
     {
+        clock.start();
     }
 
     Pipeline* q_ptr;
@@ -61,6 +67,15 @@ private:
     bool running;
     QTimer temporaryQueryTimer;
 
+    // when each query was handed to each of its resolvers, in ms on clock
+    QMap< QID, QHash< Resolver*, qint64 > > dispatched;
+    QElapsedTimer clock;
+    Gauge* queueDepth;
+    Gauge* activeQueries;
+    // per resolver name, guarded by mut
+    QHash< QString, Histogram* > resolverLatency;
+    QHash< QString, Counter* > resolverTimeouts;
+
     static Pipeline* s_instance;
 };
 
@@ -26,6 +26,7 @@
 #include "filemetadata/MetadataEditor.h"
 #include "resolvers/ExternalResolverGui.h"
 #include "resolvers/Resolver.h"
+#include "utils/ConcurrentWeakHash.h"
 #include "utils/TomahawkUtilsGui.h"
 #include "utils/Logger.h"
 
@@ -37,8 +38,7 @@
 
 using namespace Tomahawk;
 
-static QHash< QString, result_wptr > s_results;
-static QMutex s_mutex;
+static Tomahawk::Utils::ConcurrentWeakHash< QString, Result > s_results;
 
 typedef QMap< QString, QPixmap > SourceIconCache;
 Q_GLOBAL_STATIC( SourceIconCache, sourceIconCache );
@@ -63,24 +63,20 @@ Result::get( const QString& url )
         return result_ptr();
     }
 
-    QMutexLocker lock( &s_mutex );
-    if ( s_results.contains( url ) )
-    {
-        return s_results.value( url );
-    }
+    result_ptr cached = s_results.value( url );
+    if ( cached )
+        return cached;
 
+    // If another thread beats us to it, ours gets dropped in favour of theirs
     result_ptr r = result_ptr( new Result( url ), &Result::deleteLater );
-    s_results.insert( url, r );
-
-    return r;
+    return s_results.insert( url, r );
 }
 
 
 bool
 Result::isCached( const QString& url )
 {
-    QMutexLocker lock( &s_mutex );
-    return ( s_results.contains( url ) );
+    return s_results.contains( url );
 }
 
 
@@ -107,12 +103,7 @@ Result::~Result()
 void
 Result::deleteLater()
 {
-    QMutexLocker lock( &s_mutex );
-
-    if ( s_results.contains( m_url ) )
-    {
-        s_results.remove( m_url );
-    }
+    s_results.removeExpired( m_url );
 
     QObject::deleteLater();
 }
@@ -205,6 +205,8 @@ SourceList::get( const QString& username, const QString& friendlyName, bool auto
         {
             Q_ASSERT( !friendlyName.isEmpty() );
             source = source_ptr( new Source( -1, username ) );
+            // ControlConnections ask for their Source from a network thread
+            source->moveToThread( thread() );
             source->setDbFriendlyName( friendlyName );
             add( source );
         }
@@ -876,6 +876,48 @@ TomahawkSettings::setVolume( unsigned int volume )
 }
 
 
+qint64
+TomahawkSettings::streamCacheSize() const
+{
+    return value( "audio/streamCacheSize", Q_INT64_C( 134217728 ) ).toLongLong();
+}
+
+
+void
+TomahawkSettings::setStreamCacheSize( qint64 bytes )
+{
+    setValue( "audio/streamCacheSize", bytes );
+}
+
+
+int
+TomahawkSettings::streamCachePolicy() const
+{
+    return value( "audio/streamCachePolicy", 0 ).toInt();
+}
+
+
+void
+TomahawkSettings::setStreamCachePolicy( int policy )
+{
+    setValue( "audio/streamCachePolicy", policy );
+}
+
+
+int
+TomahawkSettings::prefetchLeadTime() const
+{
+    return value( "audio/prefetchLeadTime", 20 ).toInt();
+}
+
+
+void
+TomahawkSettings::setPrefetchLeadTime( int seconds )
+{
+    setValue( "audio/prefetchLeadTime", seconds );
+}
+
+
 QString
 TomahawkSettings::proxyHost() const
 {
@@ -98,6 +98,13 @@ public:
     unsigned int volume() const;
     void setVolume( unsigned int volume );
 
+    qint64 streamCacheSize() const; /// in bytes, 0 disables the cache
+    void setStreamCacheSize( qint64 bytes );
+    int streamCachePolicy() const; /// a StreamCache::EvictionPolicy
+    void setStreamCachePolicy( int policy );
+    int prefetchLeadTime() const; /// seconds before the end of a track, 0 disables prefetching
+    void setPrefetchLeadTime( int seconds );
+
     /// Playlist stuff
     QByteArray playlistColumnSizes( const QString& playlistid ) const;
     void setPlaylistColumnSizes( const QString& playlistid, const QByteArray& state );
@@ -27,6 +27,7 @@
 #include "database/DatabaseCommand_LogPlayback.h"
 #include "database/DatabaseCommand_ModifyInboxEntry.h"
 #include "resolvers/Resolver.h"
+#include "utils/ConcurrentWeakHash.h"
 #include "utils/Logger.h"
 
 #include "Album.h"
@@ -41,33 +42,19 @@
 
 using namespace Tomahawk;
 
-QHash< QString, track_wptr > Track::s_tracksByName = QHash< QString, track_wptr >();
+static Tomahawk::Utils::ConcurrentWeakHash< TrackCacheKey, Track > s_tracksByName;
 
-static QMutex s_nameCacheMutex;
 
-
-inline QString
-cacheKey( const QString& artist, const QString& track, const QString& album, int duration, const QString& composer, unsigned int albumpos, unsigned int discnumber )
+// Lookups don't intern anything, only tracks we create do
+static track_ptr
+cachedTrack( const QString& artist, const QString& track, const QString& album, int duration, const QString& composer, unsigned int albumpos, unsigned int discnumber )
 {
-    const QString durationStr = QString::number( duration );
-    const QString albumposStr = QString::number( albumpos );
-    const QString discnumberStr = QString::number( discnumber );
-    QString str;
-    // Preallocate space so that we will only call malloc once.
-    // With Qt5 we can possibly revert back to just "+" these strings.
-    // The "+" implementation in Qt4 differs slighty depending on compile
-    // options which could drastically reduce the performance.
-    str.reserve( artist.size() + track.size() + album.size()
-                 + composer.size() + durationStr.size()
-                 + albumposStr.size() + discnumberStr.size() );
-    str += artist;
-    str += track;
-    str += album;
-    str += composer;
-    str += durationStr;
-    str += albumposStr;
-    str += discnumberStr;
-    return str;
+    InternedString::Lookup lookup;
+    TrackCacheKey key;
+    if ( !TrackCacheKey::find( artist, track, album, duration, composer, albumpos, discnumber, &key ) )
+        return track_ptr();
+
+    return s_tracksByName.value( key );
 }
 
 
@@ -81,40 +68,29 @@ Track::get( const QString& artist, const QString& track, const QString& album, i
         return track_ptr();
     }
 
-    QMutexLocker lock( &s_nameCacheMutex );
-    const QString key = cacheKey( artist, track, album, duration, composer, albumpos, discnumber );
-    if ( s_tracksByName.contains( key ) )
-    {
-        track_wptr track = s_tracksByName.value( key );
-        if ( track )
-            return track.toStrongRef();
-    }
+    track_ptr cached = cachedTrack( artist, track, album, duration, composer, albumpos, discnumber );
+    if ( cached )
+        return cached;
 
+    // If another thread beats us to it, ours gets dropped in favour of theirs
     track_ptr t = track_ptr( new Track( artist, track, album, duration, composer, albumpos, discnumber ), &Track::deleteLater );
     t->setWeakRef( t.toWeakRef() );
-    s_tracksByName.insert( key, t );
 
-    return t;
+    return s_tracksByName.insert( TrackCacheKey( artist, track, album, duration, composer, albumpos, discnumber ), t );
 }
 
 
 track_ptr
 Track::get( unsigned int id, const QString& artist, const QString& track, const QString& album, int duration, const QString& composer, unsigned int albumpos, unsigned int discnumber )
 {
-    QMutexLocker lock( &s_nameCacheMutex );
-    const QString key = cacheKey( artist, track, album, duration, composer, albumpos, discnumber );
-    if ( s_tracksByName.contains( key ) )
-    {
-        track_wptr track = s_tracksByName.value( key );
-        if ( track )
-            return track;
-    }
+    track_ptr cached = cachedTrack( artist, track, album, duration, composer, albumpos, discnumber );
+    if ( cached )
+        return cached;
 
     track_ptr t = track_ptr( new Track( id, artist, track, album, duration, composer, albumpos, discnumber ), &Track::deleteLater );
     t->setWeakRef( t.toWeakRef() );
-    s_tracksByName.insert( key, t );
 
-    return t;
+    return s_tracksByName.insert( TrackCacheKey( artist, track, album, duration, composer, albumpos, discnumber ), t );
 }
 
 
@@ -163,7 +139,7 @@ Track::setAlbum( const QString& album )
     Q_D( Track );
 
     d->albumPtr = album_ptr();
-    d->album = album;
+    d->album = InternedString( album );
     updateSortNames();
 
     emit updated();
@@ -230,12 +206,13 @@ void
 Track::deleteLater()
 {
     Q_D( Track );
-    QMutexLocker lock( &s_nameCacheMutex );
 
-    const QString key = cacheKey( artist(), track(), d->album, d->duration, d->composer, d->albumpos, d->discnumber );
-    if ( s_tracksByName.contains( key ) )
+    // Our album may have changed since we got cached, leave other tracks' entries alone
     {
-        s_tracksByName.remove( key );
+        InternedString::Lookup lookup;
+        TrackCacheKey key;
+        if ( TrackCacheKey::find( artist(), track(), album(), d->duration, composer(), d->albumpos, d->discnumber, &key ) )
+            s_tracksByName.removeExpired( key );
     }
 
     QObject::deleteLater();
@@ -333,8 +310,8 @@ void
 Track::updateSortNames()
 {
     Q_D( Track );
-    d->composerSortname = DatabaseImpl::sortname( d->composer, true );
-    d->albumSortname = DatabaseImpl::sortname( d->album );
+    d->composerSortname = InternedString( DatabaseImpl::sortname( composer(), true ) );
+    d->albumSortname = InternedString( DatabaseImpl::sortname( album() ) );
 }
 
 
@@ -408,7 +385,7 @@ const QString&
 Track::composerSortname() const
 {
     Q_D( const Track );
-    return d->composerSortname;
+    return d->composerSortname.toString();
 }
 
 
@@ -416,7 +393,7 @@ const QString&
 Track::albumSortname() const
 {
     Q_D( const Track );
-    return d->albumSortname;
+    return d->albumSortname.toString();
 }
 
 
@@ -646,11 +623,12 @@ Track::composerPtr() const
 QPixmap
 Track::cover( const QSize& size, bool forceLoad ) const
 {
-    albumPtr()->cover( size, forceLoad );
+    const QPixmap albumCover = albumPtr()->cover( size, forceLoad );
     if ( albumPtr()->coverLoaded() )
     {
-        if ( !albumPtr()->cover( size ).isNull() )
-            return albumPtr()->cover( size );
+        // The album cover may still be getting scaled, don't fall back to the artist in the meantime
+        if ( albumPtr()->hasCover() && ( !albumCover.isNull() || !albumPtr()->coverFailed( size ) ) )
+            return albumCover;
 
         return artistPtr()->cover( size, forceLoad );
     }
@@ -666,7 +644,7 @@ Track::coverLoaded() const
     if ( d->albumPtr.isNull() )
         return false;
 
-    if ( d->albumPtr->coverLoaded() && !d->albumPtr->cover( QSize( 0, 0 ) ).isNull() )
+    if ( d->albumPtr->coverLoaded() && d->albumPtr->hasCover() )
         return true;
 
     return d->artistPtr->coverLoaded();
@@ -709,7 +687,7 @@ QString
 Track::composer() const
 {
     Q_D( const Track );
-    return d->composer;
+    return d->composer.toString();
 }
 
 
@@ -717,7 +695,7 @@ QString
 Track::album() const
 {
     Q_D( const Track );
-    return d->album;
+    return d->album.toString();
 }
 
 
@@ -150,8 +150,6 @@ private:
     void updateSortNames();
 
     void setAllSocialActions( const QList< SocialAction >& socialActions );
-
-    static QHash< QString, track_wptr > s_tracksByName;
 };
 
 } // namespace Tomahawk
@@ -20,7 +20,6 @@
 #include "TrackData.h"
 
 #include <QtAlgorithms>
-#include <QReadWriteLock>
 
 #include "audio/AudioEngine.h"
 #include "collection/Collection.h"
@@ -35,6 +34,7 @@
 #include "database/DatabaseCommand_TrackStats.h"
 #include "database/IdThreadWorker.h"
 #include "resolvers/Resolver.h"
+#include "utils/ConcurrentWeakHash.h"
 #include "utils/Logger.h"
 
 #include "Album.h"
@@ -43,56 +43,61 @@
 
 using namespace Tomahawk;
 
-QHash< QString, trackdata_wptr > TrackData::s_trackDatasByName = QHash< QString, trackdata_wptr >();
-QHash< unsigned int, trackdata_wptr > TrackData::s_trackDatasById = QHash< unsigned int, trackdata_wptr >();
+static Tomahawk::Utils::ConcurrentWeakHash< QPair< InternedString, InternedString >, TrackData > s_trackDatasByName;
+static Tomahawk::Utils::ConcurrentWeakHash< unsigned int, TrackData > s_trackDatasById;
 
-static QMutex s_datanameCacheMutex;
-static QMutex s_memberMutex;
-static QReadWriteLock s_dataidMutex;
+static Tomahawk::Utils::StripedMutex s_memberMutex;
+static Tomahawk::Utils::StripedMutex s_dataidMutex;
 
-inline QString
-cacheKey( const QString& artist, const QString& track )
+/// Takes sortnames, interns them. Only for new entries, lookups use findCacheKey().
+inline QPair< InternedString, InternedString >
+cacheKey( const QString& artistSortname, const QString& trackSortname )
 {
-    QString str;
-    QTextStream stream( &str );
-    stream << DatabaseImpl::sortname( artist ) << "\t" << DatabaseImpl::sortname( track );
-    return str;
+    return qMakePair( InternedString( artistSortname ), InternedString( trackSortname ) );
+}
+
+
+/// Like cacheKey(), without interning anything. Needs an InternedString::Lookup.
+static bool
+findCacheKey( const QString& artistSortname, const QString& trackSortname, QPair< InternedString, InternedString >* key )
+{
+    return InternedString::find( artistSortname, &key->first ) && InternedString::find( trackSortname, &key->second );
 }
 
 
 trackdata_ptr
 TrackData::get( unsigned int id, const QString& artist, const QString& track )
 {
-    s_dataidMutex.lockForRead();
-    if ( s_trackDatasById.contains( id ) )
+    if ( id > 0 )
     {
-        trackdata_wptr track = s_trackDatasById.value( id );
-        s_dataidMutex.unlock();
-
-        if ( track )
-            return track;
+        trackdata_ptr cached = s_trackDatasById.value( id );
+        if ( cached )
+            return cached;
     }
-    s_dataidMutex.unlock();
 
-    QMutexLocker lock( &s_datanameCacheMutex );
-    const QString key = cacheKey( artist, track );
-    if ( s_trackDatasByName.contains( key ) )
+    const QString artistSortname = DatabaseImpl::sortname( artist );
+    const QString trackSortname = DatabaseImpl::sortname( track );
     {
-        trackdata_wptr track = s_trackDatasByName.value( key );
-        if ( track )
-            return track;
+        InternedString::Lookup lookup;
+        QPair< InternedString, InternedString > key;
+        if ( findCacheKey( artistSortname, trackSortname, &key ) )
+        {
+            trackdata_ptr cached = s_trackDatasByName.value( key );
+            if ( cached )
+                return cached;
+        }
     }
 
     trackdata_ptr t = trackdata_ptr( new TrackData( id, artist, track ), &TrackData::deleteLater );
     t->setWeakRef( t.toWeakRef() );
-    s_trackDatasByName.insert( key, t );
+
+    // Another thread created the same one meanwhile, ours gets dropped
+    const trackdata_ptr stored = s_trackDatasByName.insert( cacheKey( artistSortname, trackSortname ), t );
+    if ( stored != t )
+        return stored;
 
     if ( id > 0 )
-    {
-        s_dataidMutex.lockForWrite();
         s_trackDatasById.insert( id, t );
-        s_dataidMutex.unlock();
-    }
     else
         t->loadId( false );
 
@@ -122,30 +127,22 @@ TrackData::TrackData( unsigned int id, const QString& artist, const QString& tra
 
 TrackData::~TrackData()
 {
-    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << m_artist << m_track;
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << artist() << track();
 }
 
 
 void
 TrackData::deleteLater()
 {
-    QMutexLocker lock( &s_datanameCacheMutex );
-
-    const QString key = cacheKey( m_artist, m_track );
-    if ( s_trackDatasByName.contains( key ) )
     {
-        s_trackDatasByName.remove( key );
+        InternedString::Lookup lookup;
+        QPair< InternedString, InternedString > key;
+        if ( findCacheKey( DatabaseImpl::sortname( artist() ), DatabaseImpl::sortname( track() ), &key ) )
+            s_trackDatasByName.removeExpired( key );
     }
 
     if ( m_trackId > 0 )
-    {
-        s_dataidMutex.lockForWrite();
-        if ( s_trackDatasById.contains( m_trackId ) )
-        {
-            s_trackDatasById.remove( m_trackId );
-        }
-        s_dataidMutex.unlock();
-    }
+        s_trackDatasById.removeExpired( m_trackId );
 
     QObject::deleteLater();
 }
@@ -154,8 +151,8 @@ TrackData::deleteLater()
 void
 TrackData::updateSortNames()
 {
-    m_artistSortname = DatabaseImpl::sortname( m_artist, true );
-    m_trackSortname = DatabaseImpl::sortname( m_track );
+    m_artistSortname = InternedString( DatabaseImpl::sortname( artist(), true ) );
+    m_trackSortname = InternedString( DatabaseImpl::sortname( track() ) );
 }
 
 
@@ -164,15 +161,15 @@ TrackData::toString() const
 {
     return QString( "TrackData(%1, %2 - %3)" )
               .arg( m_trackId )
-              .arg( m_artist )
-              .arg( m_track );
+              .arg( artist() )
+              .arg( track() );
 }
 
 
 query_ptr
 TrackData::toQuery()
 {
-    return Tomahawk::Query::get( m_artist, m_track, "" );
+    return Tomahawk::Query::get( artist(), track(), "" );
 }
 
 
@@ -194,25 +191,24 @@ TrackData::setIdFuture( QFuture<unsigned int> future )
 unsigned int
 TrackData::trackId() const
 {
-    s_dataidMutex.lockForRead();
+    QMutex* mutex = s_dataidMutex.mutex( this );
+    mutex->lock();
     const bool waiting = m_waitingForId;
     unsigned int finalId = m_trackId;
-    s_dataidMutex.unlock();
+    mutex->unlock();
 
     if ( waiting )
     {
         finalId = m_idFuture.result();
 
-        s_dataidMutex.lockForWrite();
+        mutex->lock();
         m_trackId = finalId;
         m_waitingForId = false;
+        mutex->unlock();
 
-        if ( m_trackId > 0 )
-        {
-            s_trackDatasById.insert( m_trackId, m_ownRef.toStrongRef() );
-        }
-
-        s_dataidMutex.unlock();
+        const trackdata_ptr self = m_ownRef.toStrongRef();
+        if ( finalId > 0 && self )
+            s_trackDatasById.insert( finalId, self );
     }
 
     return finalId;
@@ -261,7 +257,7 @@ void
 TrackData::setAllSocialActions( const QList< SocialAction >& socialActions )
 {
     {
-        QMutexLocker locker( &s_memberMutex );
+        QMutexLocker locker( s_memberMutex.mutex( this ) );
         m_allSocialActions = socialActions;
         parseSocialActions();
     }
@@ -273,7 +269,7 @@ TrackData::setAllSocialActions( const QList< SocialAction >& socialActions )
 QList< SocialAction >
 TrackData::allSocialActions() const
 {
-    QMutexLocker locker( &s_memberMutex );
+    QMutexLocker locker( s_memberMutex.mutex( this ) );
     return m_allSocialActions;
 }
 
@@ -281,7 +277,7 @@ TrackData::allSocialActions() const
 QList< Tomahawk::SocialAction >
 TrackData::socialActions( const QString& actionName, const QVariant& value, bool filterDupeSourceNames )
 {
-    QMutexLocker locker( &s_memberMutex );
+    QMutexLocker locker( s_memberMutex.mutex( this ) );
 
     QList< Tomahawk::SocialAction > filtered;
     foreach ( const Tomahawk::SocialAction& sa, m_allSocialActions )
@@ -351,7 +347,7 @@ TrackData::parseSocialActions()
 bool
 TrackData::loved()
 {
-    QMutexLocker locker( &s_memberMutex );
+    QMutexLocker locker( s_memberMutex.mutex( this ) );
 
     if ( m_socialActionsLoaded )
     {
@@ -402,7 +398,7 @@ TrackData::loadStats()
 QList< Tomahawk::PlaybackLog >
 TrackData::playbackHistory( const Tomahawk::source_ptr& source ) const
 {
-    QMutexLocker locker( &s_memberMutex );
+    QMutexLocker locker( s_memberMutex.mutex( this ) );
 
     QList< Tomahawk::PlaybackLog > history;
     foreach ( const PlaybackLog& log, m_playbackHistory )
@@ -421,7 +417,7 @@ void
 TrackData::setPlaybackHistory( const QList< Tomahawk::PlaybackLog >& playbackData )
 {
     {
-        QMutexLocker locker( &s_memberMutex );
+        QMutexLocker locker( s_memberMutex.mutex( this ) );
         m_playbackHistory = playbackData;
     }
     emit statsLoaded();
@@ -431,7 +427,7 @@ TrackData::setPlaybackHistory( const QList< Tomahawk::PlaybackLog >& playbackDat
 unsigned int
 TrackData::playbackCount( const source_ptr& source )
 {
-    QMutexLocker locker( &s_memberMutex );
+    QMutexLocker locker( s_memberMutex.mutex( this ) );
 
     unsigned int count = 0;
     foreach ( const PlaybackLog& log, m_playbackHistory )
@@ -25,6 +25,7 @@
 #include <QVariant>
 
 #include "infosystem/InfoSystem.h"
+#include "utils/InternedString.h"
 #include "DllMacro.h"
 #include "PlaybackLog.h"
 #include "SocialAction.h"
@@ -55,14 +56,14 @@ public:
     QString toString() const;
     Tomahawk::query_ptr toQuery();
 
-    const QString& artistSortname() const { return m_artistSortname; }
-    const QString& trackSortname() const { return m_trackSortname; }
+    const QString& artistSortname() const { return m_artistSortname.toString(); }
+    const QString& trackSortname() const { return m_trackSortname.toString(); }
 
     QWeakPointer< Tomahawk::TrackData > weakRef() { return m_ownRef; }
     void setWeakRef( QWeakPointer< Tomahawk::TrackData > weakRef ) { m_ownRef = weakRef; }
 
-    QString artist() const { return m_artist; }
-    QString track() const { return m_track; }
+    QString artist() const { return m_artist.toString(); }
+    QString track() const { return m_track.toString(); }
 
     int year() const { return m_year; }
 
@@ -119,10 +120,10 @@ private:
     void parseSocialActions();
     void updateSortNames();
 
-    QString m_artist;
-    QString m_track;
-    QString m_artistSortname;
-    QString m_trackSortname;
+    InternedString m_artist;
+    InternedString m_track;
+    InternedString m_artistSortname;
+    InternedString m_trackSortname;
 
     int m_year;
 
@@ -153,9 +154,6 @@ private:
 
     QWeakPointer< Tomahawk::TrackData > m_ownRef;
 
-    static QHash< QString, trackdata_wptr > s_trackDatasByName;
-    static QHash< unsigned int, trackdata_wptr > s_trackDatasById;
-
     friend class IdThreadWorker;
     friend class DatabaseCommand_LogPlayback;
     friend class DatabaseCommand_PlaybackHistory;
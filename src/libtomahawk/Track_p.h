@@ -23,9 +23,70 @@
 #define TRACK_P_H
 
 #include "Track.h"
+#include "utils/InternedString.h"
 
 namespace Tomahawk {
 
+/// Identifies a Track in the global cache, comparing it is a handful of pointer and integer compares.
+struct TrackCacheKey
+{
+    TrackCacheKey()
+        : duration( 0 )
+        , albumpos( 0 )
+        , discnumber( 0 )
+    {
+    }
+
+    TrackCacheKey( const QString& _artist, const QString& _track, const QString& _album, int _duration, const QString& _composer, unsigned int _albumpos, unsigned int _discnumber )
+        : artist( _artist )
+        , track( _track )
+        , album( _album )
+        , composer( _composer )
+        , duration( _duration )
+        , albumpos( _albumpos )
+        , discnumber( _discnumber )
+    {
+    }
+
+    /// Like the constructor, without interning anything. See InternedString::find().
+    static bool find( const QString& artist, const QString& track, const QString& album, int duration, const QString& composer, unsigned int albumpos, unsigned int discnumber, TrackCacheKey* key )
+    {
+        key->duration = duration;
+        key->albumpos = albumpos;
+        key->discnumber = discnumber;
+
+        return InternedString::find( artist, &key->artist ) && InternedString::find( track, &key->track ) &&
+               InternedString::find( album, &key->album ) && InternedString::find( composer, &key->composer );
+    }
+
+    bool operator==( const TrackCacheKey& other ) const
+    {
+        return artist == other.artist && track == other.track && album == other.album && composer == other.composer &&
+               duration == other.duration && albumpos == other.albumpos && discnumber == other.discnumber;
+    }
+
+    InternedString artist;
+    InternedString track;
+    InternedString album;
+    InternedString composer;
+    int duration;
+    uint albumpos;
+    uint discnumber;
+};
+
+
+inline uint qHash( const TrackCacheKey& key )
+{
+    uint h = key.artist.hash();
+    h = h * 31 + key.track.hash();
+    h = h * 31 + key.album.hash();
+    h = h * 31 + key.composer.hash();
+    h = h * 31 + (uint)key.duration;
+    h = h * 31 + key.albumpos;
+    return h * 31 + key.discnumber;
+}
+
+
 class TrackPrivate
 {
 public:
@@ -43,10 +104,10 @@ public:
     Q_DECLARE_PUBLIC( Track )
 
 private:
-    QString composer;
-    QString album;
-    QString composerSortname;
-    QString albumSortname;
+    InternedString composer;
+    InternedString album;
+    InternedString composerSortname;
+    InternedString albumSortname;
 
     int duration;
     uint albumpos;
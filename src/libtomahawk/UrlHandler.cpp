@@ -21,10 +21,13 @@
 
 #include "UrlHandler_p.h"
 
+#include "network/BufferIoDevice.h"
 #include "utils/NetworkAccessManager.h"
+#include "utils/StreamCache.h"
 #include "Result.h"
 
 #include <QFile>
+#include <QNetworkReply>
 
 #include <boost/bind.hpp>
 
@@ -91,11 +94,49 @@ getIODeviceForUrl( const Tomahawk::result_ptr& result, const QString& url,
         return;
     }
 
+    if ( !result.isNull() && proto != "file" && StreamCache::instance()->isEnabled() )
+    {
+        const QString key = StreamCache::key( result, url );
+        sp = StreamCache::instance()->open( key );
+        if ( !sp.isNull() )
+        {
+            tDebug() << Q_FUNC_INFO << "Serving from stream cache:" << url;
+            callback( url, sp );
+            return;
+        }
+
+        iofactories.value( proto )( result, url, boost::bind( cachingIODeviceCallback, key, callback, _1, _2 ) );
+        return;
+    }
+
     // JSResolverHelper::customIODeviceFactory is async!
     iofactories.value( proto )( result, url, callback );
 }
 
 
+void
+cachingIODeviceCallback( const QString& key, boost::function< void ( const QString, QSharedPointer< QIODevice > ) > callback,
+                         const QString& url, QSharedPointer< QIODevice >& io )
+{
+    if ( BufferIODevice* device = qobject_cast< BufferIODevice* >( io.data() ) )
+    {
+        // Peers can resume where an earlier transfer stopped
+        const QByteArray partial = StreamCache::instance()->partial( key );
+        if ( !partial.isEmpty() )
+            device->prefill( partial );
+
+        device->setCacheKey( key );
+    }
+    else if ( QNetworkReply* reply = qobject_cast< QNetworkReply* >( io.data() ) )
+    {
+        // Picked up by QNR_IODeviceStream, which buffers the whole reply
+        reply->setProperty( "streamCacheKey", key );
+    }
+
+    callback( url, io );
+}
+
+
 void
 localFileIODeviceFactory( const Tomahawk::result_ptr&, const QString& url,
                                    boost::function< void ( const QString&, QSharedPointer< QIODevice >& ) > callback )
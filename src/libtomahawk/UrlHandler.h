@@ -45,6 +45,8 @@ namespace UrlHandler
     DLLEXPORT void registerIODeviceFactory( const QString& proto, IODeviceFactoryFunc fac );
     DLLEXPORT void localFileIODeviceFactory( const Tomahawk::result_ptr& result, const QString& url,
                                              boost::function< void ( const QString&, QSharedPointer< QIODevice >& ) > callback );
+    DLLEXPORT void cachingIODeviceCallback( const QString& key, boost::function< void ( const QString, QSharedPointer< QIODevice > ) > callback,
+                                            const QString& url, QSharedPointer< QIODevice >& io );
     DLLEXPORT void httpIODeviceFactory( const Tomahawk::result_ptr& result, const QString& url,
                                        boost::function< void ( const QString&, QSharedPointer< QIODevice >& ) > callback );
 } // namespace UrlHandler
@@ -31,6 +31,7 @@
 #include "playlist/PlaylistView.h"
 #include "playlist/PlayableProxyModel.h"
 #include "playlist/PlayableModel.h"
+#include "playlist/CollectionTracksModel.h"
 #include "playlist/ColumnView.h"
 #include "playlist/TreeView.h"
 #include "playlist/TreeWidget.h"
@@ -294,7 +295,7 @@ ViewManager::show( const Tomahawk::collection_ptr& collection )
 
         view->columnView()->proxyModel()->setStyle( PlayableProxyModel::Collection );
         TreeModel* model = new TreeModel();
-        PlayableModel* flatModel = new PlayableModel();
+        CollectionTracksModel* flatModel = new CollectionTracksModel();
         PlayableModel* albumModel = new PlayableModel();
 
         view->setTreeModel( model );
@@ -302,7 +303,7 @@ ViewManager::show( const Tomahawk::collection_ptr& collection )
         view->setAlbumModel( albumModel );
 
         model->addCollection( collection );
-        flatModel->appendTracks( collection );
+        flatModel->setCollection( collection );
         albumModel->appendAlbums( collection );
 
         setPage( view );
@@ -364,6 +364,7 @@ AudioEngine::stop( AudioErrorCode errorCode )
     if ( d->mediaObject->state() != Phonon::StoppedState )
         d->mediaObject->stop();
 
+    cancelPrefetch();
     emit stopped();
 
     if ( !d->playlist.isNull() )
@@ -688,6 +689,10 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
         return;
     }
 
+    // The user picked something else than what we expected to play next
+    if ( result != d->prefetchResult )
+        cancelPrefetch();
+
     setCurrentTrack( result );
 
     if ( !TomahawkUtils::isLocalResult( d->currentTrack->url() ) && !TomahawkUtils::isHttpResult( d->currentTrack->url() )
@@ -706,8 +711,31 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
 void
 AudioEngine::performLoadIODevice( const result_ptr& result, const QString& url )
 {
+    Q_D( AudioEngine );
     tDebug( LOGEXTRA ) << Q_FUNC_INFO << ( result.isNull() ? QString() : url );
 
+    if ( !result.isNull() && result == d->prefetchResult )
+    {
+        if ( d->prefetchReady )
+        {
+            tDebug() << Q_FUNC_INFO << "Using prefetched IO device for" << url;
+            const QString prefetchUrl = d->prefetchUrl;
+            QSharedPointer< QIODevice > io = d->prefetchIO;
+            d->prefetchResult.clear();
+            d->prefetchIO.clear();
+            d->prefetchReady = false;
+
+            performLoadTrack( result, prefetchUrl, io );
+        }
+        else
+        {
+            // Still opening, onPrefetchReady takes it from here
+            d->prefetchHandover = true;
+        }
+
+        return;
+    }
+
     if ( !TomahawkUtils::isLocalResult( url ) && !TomahawkUtils::isHttpResult( url )
          && !TomahawkUtils::isRtmpResult( url ) )
     {
@@ -872,6 +900,118 @@ AudioEngine::loadPreviousTrack()
 }
 
 
+Tomahawk::result_ptr
+AudioEngine::upcomingResult() const
+{
+    Q_D( const AudioEngine );
+
+    // Mirrors loadNextTrack(), without advancing anything
+    if ( d->stopAfterTrack && d->currentTrack && d->stopAfterTrack->track()->equals( d->currentTrack->track() ) )
+        return Tomahawk::result_ptr();
+
+    if ( d->queue && d->queue->trackCount() )
+    {
+        query_ptr query = d->queue->tracks().first();
+        if ( query && query->numResults() )
+            return query->results().first();
+    }
+
+    // Shuffled interfaces cache their next pick, so this is what we'll get later on
+    if ( !d->playlist.isNull() )
+        return d->playlist.data()->nextResult();
+
+    return Tomahawk::result_ptr();
+}
+
+
+void
+AudioEngine::prefetchNextTrack()
+{
+    Q_D( AudioEngine );
+    d->prefetchCheckedFor = d->currentTrack;
+
+    const Tomahawk::result_ptr result = upcomingResult();
+    if ( result.isNull() || result == d->currentTrack || result == d->prefetchResult )
+        return;
+
+    // Phonon opens these itself
+    const QString url = result->url();
+    if ( TomahawkUtils::isLocalResult( url ) || TomahawkUtils::isHttpResult( url ) || TomahawkUtils::isRtmpResult( url ) )
+        return;
+
+    tDebug() << Q_FUNC_INFO << "Prefetching" << url;
+    d->prefetchResult = result;
+    d->prefetchReady = false;
+    d->prefetchHandover = false;
+
+    boost::function< void ( const QString, QSharedPointer< QIODevice > ) > callback =
+            boost::bind( &AudioEngine::onPrefetchReady, this, result, _1, _2 );
+    Tomahawk::UrlHandler::getIODeviceForUrl( result, url, callback );
+}
+
+
+void
+AudioEngine::onPrefetchReady( const Tomahawk::result_ptr result, const QString url, QSharedPointer< QIODevice > io )
+{
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( this, "onPrefetchReady", Qt::QueuedConnection,
+                                   Q_ARG( const Tomahawk::result_ptr, result ),
+                                   Q_ARG( const QString, url ),
+                                   Q_ARG( QSharedPointer< QIODevice >, io )
+                                   );
+        return;
+    }
+
+    Q_D( AudioEngine );
+    if ( d->prefetchResult != result )
+    {
+        // Cancelled in the meantime
+        if ( io )
+            io->close();
+        return;
+    }
+
+    if ( d->prefetchHandover )
+    {
+        d->prefetchResult.clear();
+        d->prefetchHandover = false;
+
+        performLoadTrack( result, url, io );
+        return;
+    }
+
+    // The device keeps buffering until we hand it over
+    d->prefetchIO = io;
+    d->prefetchUrl = url;
+    d->prefetchReady = true;
+}
+
+
+void
+AudioEngine::cancelPrefetch()
+{
+    Q_D( AudioEngine );
+
+    // Allow looking for something else to prefetch
+    d->prefetchCheckedFor.clear();
+
+    if ( d->prefetchResult.isNull() )
+        return;
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << d->prefetchResult->url();
+
+    if ( d->prefetchIO )
+        d->prefetchIO->close();
+
+    d->prefetchResult.clear();
+    d->prefetchIO.clear();
+    d->prefetchUrl.clear();
+    d->prefetchReady = false;
+    d->prefetchHandover = false;
+}
+
+
 void
 AudioEngine::loadNextTrack()
 {
@@ -936,19 +1076,19 @@ AudioEngine::play( const QUrl& url )
     tDebug() << Q_FUNC_INFO << url;
 
     result_ptr result = Result::get( url.toString() );
-    const QVariantMap tags = MusicScanner::readTags( QFileInfo( url.toLocalFile() ) ).toMap();
+    const ScannedFile tags = MusicScanner::readTags( QFileInfo( url.toLocalFile() ) );
 
     track_ptr t;
-    if ( !tags.isEmpty() )
+    if ( !tags.isNull() )
     {
-        t = Track::get( tags["artist"].toString(), tags["track"].toString(), tags["album"].toString(),
-                        tags["duration"].toInt(), tags["composer"].toString(),
-                        tags["albumpos"].toUInt(), tags["discnumber"].toUInt() );
+        t = Track::get( tags.artist, tags.track, tags.album,
+                        tags.duration, tags.composer,
+                        tags.albumpos, tags.discnumber );
 
-        result->setSize( tags["size"].toUInt() );
-        result->setBitrate( tags["bitrate"].toUInt() );
-        result->setModificationTime( tags["mtime"].toUInt() );
-        result->setMimetype( tags["mimetype"].toString() );
+        result->setSize( tags.size );
+        result->setBitrate( tags.bitrate );
+        result->setModificationTime( tags.mtime );
+        result->setMimetype( tags.mimetype );
     }
     else
     {
@@ -1134,6 +1274,14 @@ AudioEngine::timerTriggered( qint64 time )
             {
                 emit timerPercentage( ( (double) d->timeElapsed / (double) d->currentTrack->track()->duration() ) * 100.0 );
             }
+
+            const int leadTime = TomahawkSettings::instance()->prefetchLeadTime();
+            if ( leadTime > 0 && d->prefetchCheckedFor != d->currentTrack &&
+                 d->currentTrack->track()->duration() > 0 &&
+                 (int)d->currentTrack->track()->duration() - (int)d->timeElapsed <= leadTime )
+            {
+                prefetchNextTrack();
+            }
         }
     }
 }
@@ -1148,14 +1296,17 @@ AudioEngine::setQueue( const playlistinterface_ptr& queue )
     {
         disconnect( d->queue.data(), SIGNAL( previousTrackAvailable( bool ) ), this, SIGNAL( controlStateChanged() ) );
         disconnect( d->queue.data(), SIGNAL( nextTrackAvailable( bool ) ), this, SIGNAL( controlStateChanged() ) );
+        disconnect( d->queue.data(), SIGNAL( itemCountChanged( unsigned int ) ), this, SLOT( cancelPrefetch() ) );
     }
 
     d->queue = queue;
+    cancelPrefetch();
 
     if ( d->queue )
     {
         connect( d->queue.data(), SIGNAL( previousTrackAvailable( bool ) ), SIGNAL( controlStateChanged() ) );
         connect( d->queue.data(), SIGNAL( nextTrackAvailable( bool ) ), SIGNAL( controlStateChanged() ) );
+        connect( d->queue.data(), SIGNAL( itemCountChanged( unsigned int ) ), SLOT( cancelPrefetch() ) );
     }
 }
 
@@ -1176,6 +1327,7 @@ AudioEngine::setPlaylist( Tomahawk::playlistinterface_ptr playlist )
             disconnect( d->playlist.data(), SIGNAL( nextTrackAvailable( bool ) ) );
             disconnect( d->playlist.data(), SIGNAL( shuffleModeChanged( bool ) ) );
             disconnect( d->playlist.data(), SIGNAL( repeatModeChanged( Tomahawk::PlaylistModes::RepeatMode ) ) );
+            disconnect( d->playlist.data(), SIGNAL( itemCountChanged( unsigned int ) ), this, SLOT( cancelPrefetch() ) );
         }
 
         d->playlist.data()->reset();
@@ -1190,6 +1342,7 @@ AudioEngine::setPlaylist( Tomahawk::playlistinterface_ptr playlist )
 
     d->playlist = playlist;
     d->stopAfterTrack.clear();
+    cancelPrefetch();
 
     if ( !d->playlist.isNull() )
     {
@@ -1201,6 +1354,11 @@ AudioEngine::setPlaylist( Tomahawk::playlistinterface_ptr playlist )
         connect( d->playlist.data(), SIGNAL( shuffleModeChanged( bool ) ), SIGNAL( shuffleModeChanged( bool ) ) );
         connect( d->playlist.data(), SIGNAL( repeatModeChanged( Tomahawk::PlaylistModes::RepeatMode ) ), SIGNAL( repeatModeChanged( Tomahawk::PlaylistModes::RepeatMode ) ) );
 
+        // Whatever we prefetched might not come next anymore
+        connect( d->playlist.data(), SIGNAL( itemCountChanged( unsigned int ) ), SLOT( cancelPrefetch() ) );
+        connect( d->playlist.data(), SIGNAL( shuffleModeChanged( bool ) ), SLOT( cancelPrefetch() ) );
+        connect( d->playlist.data(), SIGNAL( repeatModeChanged( Tomahawk::PlaylistModes::RepeatMode ) ), SLOT( cancelPrefetch() ) );
+
         emit shuffleModeChanged( d->playlist.data()->shuffled() );
         emit repeatModeChanged( d->playlist.data()->repeatMode() );
     }
@@ -1241,6 +1399,7 @@ AudioEngine::setStopAfterTrack( const query_ptr& query )
     if ( d->stopAfterTrack != query )
     {
         d->stopAfterTrack = query;
+        cancelPrefetch();
         emit stopAfterTrackChanged();
     }
 }
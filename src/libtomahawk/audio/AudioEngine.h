@@ -186,6 +186,10 @@ private slots:
     void loadPreviousTrack();
     void loadNextTrack();
 
+    void prefetchNextTrack();
+    void onPrefetchReady( const Tomahawk::result_ptr result, const QString url, QSharedPointer< QIODevice > io );
+    void cancelPrefetch();
+
     void onAboutToFinish();
     void onVolumeChanged( qreal volume );
     void timerTriggered( qint64 time );
@@ -199,6 +203,7 @@ private slots:
 
 private:
     void setState( AudioState state );
+    Tomahawk::result_ptr upcomingResult() const;
     void setCurrentTrackPlaylist( const Tomahawk::playlistinterface_ptr& playlist );
 
     void initEqualizer();
@@ -23,6 +23,8 @@ public:
         : q_ptr ( q )
         , underrunCount( 0 )
         , underrunNotified( false )
+        , prefetchReady( false )
+        , prefetchHandover( false )
     {
     }
     AudioEngine* q_ptr;
@@ -67,5 +69,15 @@ private:
 
     QTemporaryFile* coverTempFile;
 
+    // The next track's IO device, opened ahead of time
+    Tomahawk::result_ptr prefetchResult;
+    QSharedPointer< QIODevice > prefetchIO;
+    QString prefetchUrl;
+    bool prefetchReady;
+    // The current track is waiting for the prefetch to finish opening
+    bool prefetchHandover;
+    // Track for which we already looked for something to prefetch
+    Tomahawk::result_ptr prefetchCheckedFor;
+
     static AudioEngine* s_instance;
 };
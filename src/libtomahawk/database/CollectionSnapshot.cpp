@@ -0,0 +1,537 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CollectionSnapshot.h"
+
+#include "collection/Collection.h"
+#include "Album.h"
+#include "Artist.h"
+#include "Query.h"
+#include "Result.h"
+#include "Source.h"
+#include "Track.h"
+
+#include <QCoreApplication>
+
+#include <limits.h>
+
+using namespace Tomahawk;
+
+
+namespace
+{
+    template< typename T >
+    void
+    compact( QVector< T >& column, const QVector< int >& rows )
+    {
+        QVector< T > compacted;
+        compacted.reserve( rows.count() );
+        foreach ( int row, rows )
+            compacted << column.at( row );
+
+        column = compacted;
+    }
+
+
+    /// Orders artist or album rows by sortname
+    class SortnameLessThan
+    {
+    public:
+        SortnameLessThan( const QVector< QString >& strings, const QVector< int >& sortnames, const QVector< unsigned int >& ids )
+            : m_strings( strings ), m_sortnames( sortnames ), m_ids( ids )
+        {}
+
+        bool operator()( int a, int b ) const
+        {
+            const int c = QString::compare( m_strings.at( m_sortnames.at( a ) ), m_strings.at( m_sortnames.at( b ) ) );
+            if ( c != 0 )
+                return c < 0;
+
+            return m_ids.at( a ) < m_ids.at( b );
+        }
+
+    private:
+        const QVector< QString >& m_strings;
+        const QVector< int >& m_sortnames;
+        const QVector< unsigned int >& m_ids;
+    };
+
+
+    /// Orders file rows by the given group (artist or album) rank, then by album, disc and position
+    class FileLessThan
+    {
+    public:
+        FileLessThan( const QVector< int >& groupRanks, const QVector< int >& albumRanks,
+                      const QVector< unsigned int >& discnumbers, const QVector< unsigned int >& albumpos,
+                      const QVector< unsigned int >& ids )
+            : m_groupRanks( groupRanks ), m_albumRanks( albumRanks )
+            , m_discnumbers( discnumbers ), m_albumpos( albumpos ), m_ids( ids )
+        {}
+
+        bool operator()( int a, int b ) const
+        {
+            if ( m_groupRanks.at( a ) != m_groupRanks.at( b ) )
+                return m_groupRanks.at( a ) < m_groupRanks.at( b );
+            if ( m_albumRanks.at( a ) != m_albumRanks.at( b ) )
+                return m_albumRanks.at( a ) < m_albumRanks.at( b );
+            if ( m_discnumbers.at( a ) != m_discnumbers.at( b ) )
+                return m_discnumbers.at( a ) < m_discnumbers.at( b );
+            if ( m_albumpos.at( a ) != m_albumpos.at( b ) )
+                return m_albumpos.at( a ) < m_albumpos.at( b );
+
+            return m_ids.at( a ) < m_ids.at( b );
+        }
+
+    private:
+        const QVector< int >& m_groupRanks;
+        const QVector< int >& m_albumRanks;
+        const QVector< unsigned int >& m_discnumbers;
+        const QVector< unsigned int >& m_albumpos;
+        const QVector< unsigned int >& m_ids;
+    };
+
+
+    QVector< int >
+    ranks( const QVector< int >& order )
+    {
+        QVector< int > r( order.count() );
+        for ( int i = 0; i < order.count(); i++ )
+            r[ order.at( i ) ] = i;
+
+        return r;
+    }
+
+
+    /// Sorts @p rows and records where each group starts and ends in there.
+    void
+    group( QVector< int >& rows, const FileLessThan& lessThan, const QVector< int >& groups, int groupCount,
+           QVector< int >& begin, QVector< int >& end )
+    {
+        qSort( rows.begin(), rows.end(), lessThan );
+
+        begin.fill( 0, groupCount );
+        end.fill( 0, groupCount );
+        for ( int i = 0; i < rows.count(); i++ )
+        {
+            const int g = groups.at( rows.at( i ) );
+            if ( i == 0 || groups.at( rows.at( i - 1 ) ) != g )
+                begin[ g ] = i;
+            end[ g ] = i + 1;
+        }
+    }
+}
+
+
+CollectionSnapshot::CollectionSnapshot()
+{
+    m_strings << QString();
+    m_stringIds.insert( QString(), 0 );
+}
+
+
+int
+CollectionSnapshot::intern( const QString& str )
+{
+    QHash< QString, int >::const_iterator it = m_stringIds.constFind( str );
+    if ( it != m_stringIds.constEnd() )
+        return it.value();
+
+    const int id = m_strings.count();
+    m_strings << str;
+    m_stringIds.insert( str, id );
+    return id;
+}
+
+
+int
+CollectionSnapshot::artistRow( unsigned int id, const QString& name, const QString& sortname )
+{
+    QHash< unsigned int, int >::const_iterator it = m_artistRows.constFind( id );
+    if ( it != m_artistRows.constEnd() )
+        return it.value();
+
+    const int row = m_artistIds.count();
+    m_artistIds << id;
+    m_artistNames << intern( name );
+    m_artistSortnames << intern( sortname );
+    m_artistRows.insert( id, row );
+    return row;
+}
+
+
+int
+CollectionSnapshot::albumRow( const File& file )
+{
+    if ( file.albumId == 0 )
+        return -1;
+
+    QHash< unsigned int, int >::const_iterator it = m_albumRows.constFind( file.albumId );
+    if ( it != m_albumRows.constEnd() )
+        return it.value();
+
+    const int row = m_albumIds.count();
+    m_albumIds << file.albumId;
+    m_albumNames << intern( file.album );
+    m_albumSortnames << intern( file.albumSortname );
+    m_albumArtists << ( file.albumArtistId ? artistRow( file.albumArtistId, file.albumArtist, file.albumArtistSortname ) : -1 );
+    m_albumRows.insert( file.albumId, row );
+    return row;
+}
+
+
+void
+CollectionSnapshot::addFile( const File& file )
+{
+    const int artist = artistRow( file.artistId, file.artist, file.artistSortname );
+    const int album = albumRow( file );
+
+    int row = m_fileRows.value( file.id, -1 );
+    if ( row < 0 )
+    {
+        m_fileRows.insert( file.id, m_fileIds.count() );
+
+        m_fileIds << file.id;
+        m_urls << file.url;
+        m_sizes << file.size;
+        m_durations << file.duration;
+        m_bitrates << file.bitrate;
+        m_mtimes << file.mtime;
+        m_mimetypes << intern( file.mimetype );
+        m_discnumbers << file.discnumber;
+        m_albumpos << file.albumpos;
+        m_trackIds << file.trackId;
+        m_trackNames << intern( file.track );
+        m_composers << intern( file.composer );
+        m_fileArtists << artist;
+        m_fileAlbums << album;
+        return;
+    }
+
+    // Already known, e.g. a delta that overlaps with the initial load
+    m_urls[ row ] = file.url;
+    m_sizes[ row ] = file.size;
+    m_durations[ row ] = file.duration;
+    m_bitrates[ row ] = file.bitrate;
+    m_mtimes[ row ] = file.mtime;
+    m_mimetypes[ row ] = intern( file.mimetype );
+    m_discnumbers[ row ] = file.discnumber;
+    m_albumpos[ row ] = file.albumpos;
+    m_trackIds[ row ] = file.trackId;
+    m_trackNames[ row ] = intern( file.track );
+    m_composers[ row ] = intern( file.composer );
+    m_fileArtists[ row ] = artist;
+    m_fileAlbums[ row ] = album;
+}
+
+
+void
+CollectionSnapshot::merge( const CollectionSnapshot& other )
+{
+    for ( int row = 0; row < other.m_fileIds.count(); row++ )
+    {
+        File file;
+        file.id = other.m_fileIds.at( row );
+        file.url = other.m_urls.at( row );
+        file.size = other.m_sizes.at( row );
+        file.duration = other.m_durations.at( row );
+        file.bitrate = other.m_bitrates.at( row );
+        file.mtime = other.m_mtimes.at( row );
+        file.mimetype = other.m_strings.at( other.m_mimetypes.at( row ) );
+        file.discnumber = other.m_discnumbers.at( row );
+        file.albumpos = other.m_albumpos.at( row );
+        file.trackId = other.m_trackIds.at( row );
+        file.track = other.m_strings.at( other.m_trackNames.at( row ) );
+        file.composer = other.m_strings.at( other.m_composers.at( row ) );
+
+        const int artist = other.m_fileArtists.at( row );
+        file.artistId = other.m_artistIds.at( artist );
+        file.artist = other.m_strings.at( other.m_artistNames.at( artist ) );
+        file.artistSortname = other.m_strings.at( other.m_artistSortnames.at( artist ) );
+
+        const int album = other.m_fileAlbums.at( row );
+        if ( album >= 0 )
+        {
+            file.albumId = other.m_albumIds.at( album );
+            file.album = other.m_strings.at( other.m_albumNames.at( album ) );
+            file.albumSortname = other.m_strings.at( other.m_albumSortnames.at( album ) );
+
+            const int albumArtist = other.m_albumArtists.at( album );
+            if ( albumArtist >= 0 )
+            {
+                file.albumArtistId = other.m_artistIds.at( albumArtist );
+                file.albumArtist = other.m_strings.at( other.m_artistNames.at( albumArtist ) );
+                file.albumArtistSortname = other.m_strings.at( other.m_artistSortnames.at( albumArtist ) );
+            }
+        }
+
+        addFile( file );
+    }
+}
+
+
+void
+CollectionSnapshot::removeFiles( const QList< unsigned int >& fileIds )
+{
+    QVector< bool > removed( m_fileIds.count(), false );
+    bool any = false;
+    foreach ( unsigned int id, fileIds )
+    {
+        const int row = m_fileRows.value( id, -1 );
+        if ( row >= 0 )
+        {
+            removed[ row ] = true;
+            any = true;
+        }
+    }
+
+    if ( !any )
+        return;
+
+    QVector< int > rows;
+    rows.reserve( m_fileIds.count() );
+    for ( int row = 0; row < m_fileIds.count(); row++ )
+    {
+        if ( !removed.at( row ) )
+            rows << row;
+    }
+
+    compact( m_fileIds, rows );
+    compact( m_urls, rows );
+    compact( m_sizes, rows );
+    compact( m_durations, rows );
+    compact( m_bitrates, rows );
+    compact( m_mtimes, rows );
+    compact( m_mimetypes, rows );
+    compact( m_discnumbers, rows );
+    compact( m_albumpos, rows );
+    compact( m_trackIds, rows );
+    compact( m_trackNames, rows );
+    compact( m_composers, rows );
+    compact( m_fileArtists, rows );
+    compact( m_fileAlbums, rows );
+
+    // Artists, albums and strings no file refers to any longer stay around,
+    // they are only listed as long as they have files
+    m_fileRows.clear();
+    m_fileRows.reserve( m_fileIds.count() );
+    for ( int row = 0; row < m_fileIds.count(); row++ )
+        m_fileRows.insert( m_fileIds.at( row ), row );
+}
+
+
+void
+CollectionSnapshot::finalize()
+{
+    m_artistOrder.resize( m_artistIds.count() );
+    for ( int i = 0; i < m_artistOrder.count(); i++ )
+        m_artistOrder[ i ] = i;
+    qSort( m_artistOrder.begin(), m_artistOrder.end(), SortnameLessThan( m_strings, m_artistSortnames, m_artistIds ) );
+
+    m_albumOrder.resize( m_albumIds.count() );
+    for ( int i = 0; i < m_albumOrder.count(); i++ )
+        m_albumOrder[ i ] = i;
+    qSort( m_albumOrder.begin(), m_albumOrder.end(), SortnameLessThan( m_strings, m_albumSortnames, m_albumIds ) );
+
+    // Rank of every file's artist and album, files without an album go last
+    const QVector< int > artistRanks = ranks( m_artistOrder );
+    const QVector< int > albumRanks = ranks( m_albumOrder );
+    QVector< int > fileArtistRanks( m_fileIds.count() );
+    QVector< int > fileAlbumRanks( m_fileIds.count() );
+    for ( int row = 0; row < m_fileIds.count(); row++ )
+    {
+        fileArtistRanks[ row ] = artistRanks.at( m_fileArtists.at( row ) );
+        fileAlbumRanks[ row ] = m_fileAlbums.at( row ) >= 0 ? albumRanks.at( m_fileAlbums.at( row ) ) : INT_MAX;
+    }
+
+    m_byArtist.resize( m_fileIds.count() );
+    for ( int row = 0; row < m_fileIds.count(); row++ )
+        m_byArtist[ row ] = row;
+    group( m_byArtist, FileLessThan( fileArtistRanks, fileAlbumRanks, m_discnumbers, m_albumpos, m_fileIds ),
+           m_fileArtists, m_artistIds.count(), m_artistBegin, m_artistEnd );
+
+    m_byAlbum.clear();
+    m_byAlbum.reserve( m_fileIds.count() );
+    for ( int row = 0; row < m_fileIds.count(); row++ )
+    {
+        if ( m_fileAlbums.at( row ) >= 0 )
+            m_byAlbum << row;
+    }
+    group( m_byAlbum, FileLessThan( fileAlbumRanks, fileAlbumRanks, m_discnumbers, m_albumpos, m_fileIds ),
+           m_fileAlbums, m_albumIds.count(), m_albumBegin, m_albumEnd );
+}
+
+
+bool
+CollectionSnapshot::matches( int row, const QStringList& terms ) const
+{
+    const QString& artist = m_strings.at( m_artistNames.at( m_fileArtists.at( row ) ) );
+    const QString& album = m_fileAlbums.at( row ) >= 0 ? m_strings.at( m_albumNames.at( m_fileAlbums.at( row ) ) ) : m_strings.at( 0 );
+    const QString& track = m_strings.at( m_trackNames.at( row ) );
+
+    foreach ( const QString& term, terms )
+    {
+        if ( !artist.contains( term, Qt::CaseInsensitive ) &&
+             !album.contains( term, Qt::CaseInsensitive ) &&
+             !track.contains( term, Qt::CaseInsensitive ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+QList< artist_ptr >
+CollectionSnapshot::artists( const QString& filter ) const
+{
+    const QStringList terms = filter.split( " ", QString::SkipEmptyParts );
+
+    QList< artist_ptr > artists;
+    foreach ( int artist, m_artistOrder )
+    {
+        bool found = false;
+        for ( int i = m_artistBegin.at( artist ); i < m_artistEnd.at( artist ) && !found; i++ )
+            found = terms.isEmpty() || matches( m_byArtist.at( i ), terms );
+
+        if ( found )
+            artists << Artist::get( m_artistIds.at( artist ), m_strings.at( m_artistNames.at( artist ) ) );
+    }
+
+    return artists;
+}
+
+
+QList< album_ptr >
+CollectionSnapshot::albums( const artist_ptr& artist, const QString& filter ) const
+{
+    const QStringList terms = filter.split( " ", QString::SkipEmptyParts );
+    QList< album_ptr > albums;
+
+    if ( artist.isNull() )
+    {
+        // Like DatabaseCommand_AllAlbums, files without an album don't show up here
+        foreach ( int album, m_albumOrder )
+        {
+            bool found = false;
+            for ( int i = m_albumBegin.at( album ); i < m_albumEnd.at( album ) && !found; i++ )
+                found = terms.isEmpty() || matches( m_byAlbum.at( i ), terms );
+
+            if ( !found )
+                continue;
+
+            const int albumArtist = m_albumArtists.at( album );
+            // album.artist is NOT NULL, but don't trust a half-synced database
+            const artist_ptr a = albumArtist >= 0 ? Artist::get( m_artistIds.at( albumArtist ), m_strings.at( m_artistNames.at( albumArtist ) ) )
+                                                  : artist_ptr();
+            albums << Album::get( m_albumIds.at( album ), m_strings.at( m_albumNames.at( album ) ), a );
+        }
+
+        return albums;
+    }
+
+    const int row = m_artistRows.value( artist->id(), -1 );
+    if ( row < 0 )
+        return albums;
+
+    // Files of an artist are grouped by album
+    int last = -2;
+    for ( int i = m_artistBegin.at( row ); i < m_artistEnd.at( row ); i++ )
+    {
+        const int file = m_byArtist.at( i );
+        const int album = m_fileAlbums.at( file );
+        if ( album == last || ( !terms.isEmpty() && !matches( file, terms ) ) )
+            continue;
+
+        last = album;
+        if ( album >= 0 )
+            albums << Album::get( m_albumIds.at( album ), m_strings.at( m_albumNames.at( album ) ), artist );
+        else
+            albums << Album::get( 0, QCoreApplication::translate( "Tomahawk::DatabaseCommand_AllAlbums", "Unknown" ), artist );
+    }
+
+    return albums;
+}
+
+
+QList< query_ptr >
+CollectionSnapshot::tracks( const album_ptr& album, const collection_ptr& collection ) const
+{
+    QList< query_ptr > tracks;
+
+    if ( album.isNull() )
+    {
+        foreach ( int row, m_byArtist )
+            tracks << query( row, collection, false );
+    }
+    else if ( album->id() == 0 )
+    {
+        // The artist's files without an album, sorted last
+        const int artist = album->artist().isNull() ? -1 : m_artistRows.value( album->artist()->id(), -1 );
+        if ( artist >= 0 )
+        {
+            for ( int i = m_artistBegin.at( artist ); i < m_artistEnd.at( artist ); i++ )
+            {
+                if ( m_fileAlbums.at( m_byArtist.at( i ) ) < 0 )
+                    tracks << query( m_byArtist.at( i ), collection, true );
+            }
+        }
+    }
+    else
+    {
+        const int row = m_albumRows.value( album->id(), -1 );
+        if ( row >= 0 )
+        {
+            for ( int i = m_albumBegin.at( row ); i < m_albumEnd.at( row ); i++ )
+                tracks << query( m_byAlbum.at( i ), collection, true );
+        }
+    }
+
+    return tracks;
+}
+
+
+query_ptr
+CollectionSnapshot::query( int row, const collection_ptr& collection, bool loadAttributes ) const
+{
+    // Same as what DatabaseCommand_AllTracks creates for a file
+    QString url = m_urls.at( row );
+    if ( !collection.isNull() && !collection->source()->isLocal() )
+        url = QString( "servent://%1\t%2" ).arg( collection->source()->nodeId() ).arg( url );
+
+    const int album = m_fileAlbums.at( row );
+    track_ptr t = Track::get( m_trackIds.at( row ),
+                              m_strings.at( m_artistNames.at( m_fileArtists.at( row ) ) ),
+                              m_strings.at( m_trackNames.at( row ) ),
+                              album >= 0 ? m_strings.at( m_albumNames.at( album ) ) : QString(),
+                              m_durations.at( row ),
+                              m_strings.at( m_composers.at( row ) ),
+                              m_albumpos.at( row ),
+                              m_discnumbers.at( row ) );
+    if ( loadAttributes )
+        t->loadAttributes();
+
+    result_ptr result = Result::get( url );
+    result->setTrack( t );
+    result->setSize( m_sizes.at( row ) );
+    result->setBitrate( m_bitrates.at( row ) );
+    result->setModificationTime( m_mtimes.at( row ) );
+    result->setMimetype( m_strings.at( m_mimetypes.at( row ) ) );
+    result->setScore( 1.0f );
+    result->setCollection( collection, false );
+
+    return Query::getFixed( t, result );
+}
@@ -0,0 +1,161 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_COLLECTIONSNAPSHOT_H
+#define TOMAHAWK_COLLECTIONSNAPSHOT_H
+
+#include "Typedefs.h"
+#include "DllMacro.h"
+
+#include <QHash>
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+namespace Tomahawk
+{
+
+/**
+ * In-memory copy of a DatabaseCollection, to browse it without touching the database.
+ *
+ * The data is stored column by column: names are interned in a single string
+ * table, artists, albums and files are arrays of ids into it. On top of that
+ * the file rows are kept sorted by artist / album / position, so the
+ * artists, albums and tracks of a collection can be listed with a scan over
+ * a range of integers.
+ *
+ * A snapshot gets filled by DatabaseCommand_LoadCollectionSnapshot, either
+ * with the whole collection or with the files added by a single AddFiles.
+ * After changing it, call finalize() before querying it. It isn't thread-safe,
+ * DatabaseCollection only uses it from its own thread.
+ */
+class DLLEXPORT CollectionSnapshot
+{
+public:
+    /// A single file, as loaded from the database
+    struct File
+    {
+        File()
+            : id( 0 ), size( 0 ), duration( 0 ), bitrate( 0 ), mtime( 0 )
+            , discnumber( 0 ), albumpos( 0 ), trackId( 0 ), artistId( 0 ), albumId( 0 ), albumArtistId( 0 )
+        {}
+
+        unsigned int id;
+        QString url;
+        unsigned int size;
+        unsigned int duration;
+        unsigned int bitrate;
+        unsigned int mtime;
+        QString mimetype;
+        unsigned int discnumber;
+        unsigned int albumpos;
+        unsigned int trackId;
+        QString track;
+        QString composer;
+        unsigned int artistId;
+        QString artist;
+        QString artistSortname;
+        unsigned int albumId; // 0 if the file has no album
+        QString album;
+        QString albumSortname;
+        unsigned int albumArtistId;
+        QString albumArtist;
+        QString albumArtistSortname;
+    };
+
+    CollectionSnapshot();
+
+    int fileCount() const { return m_fileIds.count(); }
+    bool contains( unsigned int fileId ) const { return m_fileRows.contains( fileId ); }
+
+    /// Adds @p file, replacing the file with the same id if there is one already.
+    void addFile( const File& file );
+    /// Adds all files of @p other, e.g. a delta loaded after an AddFiles.
+    void merge( const CollectionSnapshot& other );
+    void removeFiles( const QList< unsigned int >& fileIds );
+
+    /// Sorts the files, needs to be called after changing the snapshot.
+    void finalize();
+
+    /// Artists with at least one file, optionally only those with a file matching every word of @p filter.
+    QList< Tomahawk::artist_ptr > artists( const QString& filter = QString() ) const;
+    /// Albums of files by @p artist, or all albums of the collection if @p artist is null.
+    QList< Tomahawk::album_ptr > albums( const Tomahawk::artist_ptr& artist, const QString& filter = QString() ) const;
+    /// Tracks of @p album in album order, or all tracks of the collection if @p album is null.
+    QList< Tomahawk::query_ptr > tracks( const Tomahawk::album_ptr& album, const Tomahawk::collection_ptr& collection ) const;
+
+private:
+    int intern( const QString& str );
+    int artistRow( unsigned int id, const QString& name, const QString& sortname );
+    int albumRow( const File& file );
+    bool matches( int row, const QStringList& terms ) const;
+    Tomahawk::query_ptr query( int row, const Tomahawk::collection_ptr& collection, bool loadAttributes ) const;
+
+    // Index 0 is the empty string
+    QVector< QString > m_strings;
+    QHash< QString, int > m_stringIds;
+
+    // Artist rows: every artist a file or an album refers to
+    QVector< unsigned int > m_artistIds;
+    QVector< int > m_artistNames;
+    QVector< int > m_artistSortnames;
+    QHash< unsigned int, int > m_artistRows;
+
+    // Album rows
+    QVector< unsigned int > m_albumIds;
+    QVector< int > m_albumNames;
+    QVector< int > m_albumSortnames;
+    QVector< int > m_albumArtists;
+    QHash< unsigned int, int > m_albumRows;
+
+    // File rows
+    QVector< unsigned int > m_fileIds;
+    QVector< QString > m_urls;
+    QVector< unsigned int > m_sizes;
+    QVector< unsigned int > m_durations;
+    QVector< unsigned int > m_bitrates;
+    QVector< unsigned int > m_mtimes;
+    QVector< int > m_mimetypes;
+    QVector< unsigned int > m_discnumbers;
+    QVector< unsigned int > m_albumpos;
+    QVector< unsigned int > m_trackIds;
+    QVector< int > m_trackNames;
+    QVector< int > m_composers;
+    QVector< int > m_fileArtists;
+    QVector< int > m_fileAlbums; // -1 for files without an album
+    QHash< unsigned int, int > m_fileRows;
+
+    // Built by finalize(): artist / album rows sorted by sortname
+    QVector< int > m_artistOrder;
+    QVector< int > m_albumOrder;
+    // File rows by artist, album, disc and position, and where each artist starts / ends in there
+    QVector< int > m_byArtist;
+    QVector< int > m_artistBegin;
+    QVector< int > m_artistEnd;
+    // File rows by album, disc and position
+    QVector< int > m_byAlbum;
+    QVector< int > m_albumBegin;
+    QVector< int > m_albumEnd;
+};
+
+typedef QSharedPointer< CollectionSnapshot > collectionsnapshot_ptr;
+
+}
+
+Q_DECLARE_METATYPE( Tomahawk::collectionsnapshot_ptr )
+
+#endif // TOMAHAWK_COLLECTIONSNAPSHOT_H
@@ -23,6 +23,7 @@
 #include "utils/Logger.h"
 
 #include "DatabaseCommand.h"
+#include "DatabaseCommandLoggable.h"
 #include "DatabaseImpl.h"
 #include "DatabaseWorker.h"
 #include "IdThreadWorker.h"
@@ -91,6 +92,7 @@ Database::Database( const QString& dbname, QObject* parent )
     , m_ready( false )
     , m_impl( new DatabaseImpl( dbname ) )
     , m_workerRW( new DatabaseWorkerThread( this, true ) )
+    , m_workQueue( new DatabaseWorkQueue() )
     , m_idWorker( new IdThreadWorker( this ) )
 {
     s_instance = this;
@@ -126,7 +128,7 @@ Database::Database( const QString& dbname, QObject* parent )
 
     while ( m_workerThreads.count() < m_maxConcurrentThreads )
     {
-        QPointer< DatabaseWorkerThread > workerThread( new DatabaseWorkerThread( this, false ) );
+        QPointer< DatabaseWorkerThread > workerThread( new DatabaseWorkerThread( this, false, m_workQueue ) );
         Q_ASSERT( workerThread );
         workerThread.data()->start();
         m_workerThreads << workerThread;
@@ -170,8 +172,13 @@ Database::~Database()
         }
     }
     m_workerThreads.clear();
+    delete m_workQueue;
 
-    qDeleteAll( m_implHash.values() );
+    // Our slot in the thread storage may get recycled by the next Database
+    if ( m_threadImpl.hasLocalData() )
+        m_threadImpl.setLocalData( 0 );
+
+    qDeleteAll( m_impls );
     delete m_impl;
 
 }
@@ -201,6 +208,8 @@ Database::enqueue( const QList< Tomahawk::dbcmd_ptr >& lc )
         {
             factory->notifyCreated( cmd );
         }
+
+        cmd->markAsQueued();
     }
 
     tDebug( LOGVERBOSE ) << "Enqueueing" << lc.count() << "commands to rw thread";
@@ -225,6 +234,7 @@ Database::enqueue( const Tomahawk::dbcmd_ptr& lc )
         factory->notifyCreated( lc );
     }
 
+    lc->markAsQueued();
     if ( lc->doesMutates() )
     {
         tDebug( LOGVERBOSE ) << "Enqueueing command to rw thread:" << lc->commandname();
@@ -233,29 +243,9 @@ Database::enqueue( const Tomahawk::dbcmd_ptr& lc )
     }
     else
     {
-        // find thread for commandname with lowest amount of outstanding jobs and enqueue job
-        int busyThreads = 0;
-        QPointer< DatabaseWorkerThread > workerThread;
-        QPointer< DatabaseWorker > happyWorker;
-        for ( int i = 0; i < m_workerThreads.count(); i++ )
-        {
-            workerThread = m_workerThreads.at( i );
-
-            if ( workerThread && workerThread.data()->worker() && !workerThread.data()->worker().data()->busy() )
-            {
-                happyWorker = workerThread.data()->worker();
-                break;
-            }
-            busyThreads++;
-
-            if ( ( !happyWorker && workerThread && workerThread.data()->worker() ) ||
-                 ( workerThread && workerThread.data()->worker() && workerThread.data()->worker().data()->outstandingJobs() < happyWorker.data()->outstandingJobs() ) )
-                happyWorker = workerThread.data()->worker();
-        }
-
-        tDebug( LOGVERBOSE ) << "Enqueueing command to thread:" << happyWorker << busyThreads << lc->commandname();
-        Q_ASSERT( happyWorker );
-        happyWorker.data()->enqueue( lc );
+        // Any idle read-only worker picks it up, by priority
+        tDebug( LOGVERBOSE ) << "Enqueueing command to ro queue:" << lc->commandname() << lc->priority();
+        m_workQueue->enqueue( lc );
     }
 }
 
@@ -263,17 +253,20 @@ Database::enqueue( const Tomahawk::dbcmd_ptr& lc )
 DatabaseImpl*
 Database::impl()
 {
+    // Called by every command, so once a thread has its connection this must not lock
+    ThreadImpl* local = m_threadImpl.localData();
+    if ( local )
+        return local->impl;
+
     QMutexLocker lock( &m_mutex );
 
-    QThread* thread = QThread::currentThread();
-    if ( !m_implHash.contains( thread ) )
-    {
-        tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Creating database impl for thread" << QThread::currentThread();
-        DatabaseImpl* impl = m_impl->clone();
-        m_implHash.insert( thread, impl );
-    }
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Creating database impl for thread" << QThread::currentThread();
+    local = new ThreadImpl;
+    local->impl = m_impl->clone();
+    m_impls << local->impl;
+    m_threadImpl.setLocalData( local );
 
-    return m_implHash.value( thread );
+    return local->impl;
 }
 
 
@@ -345,14 +338,26 @@ Database::createCommandInstance( const QString& commandName )
 dbcmd_ptr
 Database::createCommandInstance(const QVariant& op, const source_ptr& source)
 {
-    const QString commandName = op.toMap().value( "command" ).toString();
+    const QVariantMap map = op.toMap();
+    const QString commandName = map.value( "command" ).toString();
+
+    const int version = map.value( "v", DatabaseCommandLoggable::FormatVersion ).toInt();
+    if ( version > DatabaseCommandLoggable::FormatVersion )
+    {
+        tLog() << "Ignoring op" << commandName << "with unsupported format version" << version;
+        return dbcmd_ptr();
+    }
 
     dbcmd_ptr command = createCommandInstance( commandName );
     if ( command.isNull() )
         return command;
 
     command->setSource( source );
-    TomahawkUtils::qvariant2qobject( op.toMap(), command.data() );
+    if ( DatabaseCommandLoggable* loggable = qobject_cast< DatabaseCommandLoggable* >( command.data() ) )
+        loggable->deserialize( map );
+    else
+        TomahawkUtils::qvariant2qobject( map, command.data() );
+
     return command;
 }
 
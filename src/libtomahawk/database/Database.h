@@ -24,7 +24,9 @@
 #include "DllMacro.h"
 #include "Typedefs.h"
 
+#include <QHash>
 #include <QMutex>
+#include <QThreadStorage>
 #include <QVariant>
 
 
@@ -35,6 +37,7 @@ class DatabaseImpl;
 class DatabaseCommand;
 class DatabaseWorkerThread;
 class DatabaseWorker;
+class DatabaseWorkQueue;
 class IdThreadWorker;
 
 class DLLEXPORT DatabaseCommandFactory : public QObject
@@ -125,13 +128,21 @@ private:
     DatabaseImpl* m_impl;
     QPointer< DatabaseWorkerThread > m_workerRW;
     QList< QPointer< DatabaseWorkerThread > > m_workerThreads;
+    DatabaseWorkQueue* m_workQueue;
     IdThreadWorker* m_idWorker;
     int m_maxConcurrentThreads;
 
     QHash< QString, DatabaseCommandFactory* > m_commandFactories;
     QHash< QString, QString> m_commandNameClassNameMapping;
 
-    QHash< QThread*, DatabaseImpl* > m_implHash;
+    // Per-thread connections. The thread-local pointer makes impl() lock-free,
+    // m_impls owns them and is only touched when a thread connects first.
+    struct ThreadImpl
+    {
+        DatabaseImpl* impl;
+    };
+    QThreadStorage< ThreadImpl* > m_threadImpl;
+    QList< DatabaseImpl* > m_impls;
     QMutex m_mutex;
 
     static Database* s_instance;
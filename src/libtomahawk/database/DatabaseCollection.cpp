@@ -26,9 +26,11 @@
 #include "database/DatabaseCommand_AllTracks.h"
 #include "database/DatabaseCommand_AddFiles.h"
 #include "database/DatabaseCommand_DeleteFiles.h"
+#include "database/DatabaseCommand_LoadCollectionSnapshot.h"
 #include "database/DatabaseCommand_LoadAllPlaylists.h"
 #include "database/DatabaseCommand_LoadAllAutoPlaylists.h"
 #include "database/DatabaseCommand_LoadAllStations.h"
+#include "database/SnapshotRequests.h"
 #include "utils/Logger.h"
 
 #include "PlaylistEntry.h"
@@ -38,7 +40,13 @@ using namespace Tomahawk;
 
 DatabaseCollection::DatabaseCollection( const source_ptr& src, QObject* parent )
     : Collection( src, QString( "dbcollection:%1" ).arg( src->nodeId() ), parent )
+    , m_snapshotEnabled( !src->isLocal() )
+    , m_snapshotLoading( false )
+    , m_snapshotLoadingAll( false )
 {
+    connect( src.data(), SIGNAL( synced() ), SLOT( loadSnapshot() ) );
+    connect( this, SIGNAL( tracksAdded( QList<unsigned int> ) ), SLOT( onTracksAdded( QList<unsigned int> ) ) );
+    connect( this, SIGNAL( tracksRemoved( QList<unsigned int> ) ), SLOT( onTracksRemoved( QList<unsigned int> ) ) );
 }
 
 
@@ -142,6 +150,10 @@ DatabaseCollection::requestArtists()
     if ( thisCollection->name() != this->name() )
         return 0;
 
+    if ( m_snapshot )
+        return new SnapshotArtistsRequest( m_snapshot );
+
+    loadSnapshot();
     Tomahawk::ArtistsRequest* cmd = new DatabaseCommand_AllArtists( thisCollection );
 
     return cmd;
@@ -156,6 +168,10 @@ DatabaseCollection::requestAlbums( const Tomahawk::artist_ptr& artist )
     if ( thisCollection->name() != this->name() )
         return 0;
 
+    if ( m_snapshot )
+        return new SnapshotAlbumsRequest( m_snapshot, artist );
+
+    loadSnapshot();
     Tomahawk::AlbumsRequest* cmd = new DatabaseCommand_AllAlbums( thisCollection, artist );
 
     return cmd;
@@ -170,6 +186,10 @@ DatabaseCollection::requestTracks( const Tomahawk::album_ptr& album )
     if ( thisCollection->name() != this->name() )
         return 0;
 
+    if ( m_snapshot )
+        return new SnapshotTracksRequest( m_snapshot, thisCollection, album );
+
+    loadSnapshot();
     DatabaseCommand_AllTracks* cmd = new DatabaseCommand_AllTracks( thisCollection );
 
     if ( album )
@@ -189,6 +209,124 @@ DatabaseCollection::trackCount() const
 }
 
 
+void
+DatabaseCollection::setSnapshotEnabled( bool enabled )
+{
+    m_snapshotEnabled = enabled;
+    if ( !enabled )
+    {
+        m_snapshot.clear();
+        m_snapshotDeltas.clear();
+    }
+}
+
+
+void
+DatabaseCollection::loadSnapshot()
+{
+    if ( !m_snapshotEnabled || m_snapshot || m_snapshotLoading )
+        return;
+
+    m_snapshotLoading = true;
+    m_snapshotLoadingAll = true;
+    m_snapshotDeltas.clear();
+
+    DatabaseCommand_LoadCollectionSnapshot* cmd = new DatabaseCommand_LoadCollectionSnapshot( source() );
+    connect( cmd, SIGNAL( done( Tomahawk::collectionsnapshot_ptr ) ),
+                    SLOT( onSnapshotLoaded( Tomahawk::collectionsnapshot_ptr ) ) );
+
+    Database::instance()->enqueue( Tomahawk::dbcmd_ptr( cmd ) );
+}
+
+
+void
+DatabaseCollection::onSnapshotLoaded( const Tomahawk::collectionsnapshot_ptr& snapshot )
+{
+    const bool all = m_snapshotLoadingAll;
+    m_snapshotLoading = false;
+    m_snapshotLoadingAll = false;
+
+    if ( !m_snapshotEnabled )
+        return;
+
+    if ( all )
+    {
+        tDebug() << Q_FUNC_INFO << "Loaded snapshot of" << name() << "with" << snapshot->fileCount() << "files";
+        m_snapshot = snapshot;
+    }
+    else if ( m_snapshot )
+    {
+        m_snapshot->merge( *snapshot.data() );
+        m_snapshot->finalize();
+    }
+    else
+    {
+        // Disabled and enabled again while a delta was loading
+        loadSnapshot();
+        return;
+    }
+
+    applySnapshotDeltas();
+}
+
+
+void
+DatabaseCollection::onTracksAdded( const QList<unsigned int>& fileids )
+{
+    if ( !m_snapshot && !m_snapshotLoading )
+        return;
+
+    SnapshotDelta delta;
+    delta.added = true;
+    delta.fileids = fileids;
+    m_snapshotDeltas << delta;
+
+    applySnapshotDeltas();
+}
+
+
+void
+DatabaseCollection::onTracksRemoved( const QList<unsigned int>& fileids )
+{
+    if ( !m_snapshot && !m_snapshotLoading )
+        return;
+
+    SnapshotDelta delta;
+    delta.added = false;
+    delta.fileids = fileids;
+    m_snapshotDeltas << delta;
+
+    applySnapshotDeltas();
+}
+
+
+void
+DatabaseCollection::applySnapshotDeltas()
+{
+    // Deltas are applied in commit order: a removal must not overtake
+    // the load of files added before it
+    while ( m_snapshot && !m_snapshotLoading && !m_snapshotDeltas.isEmpty() )
+    {
+        const SnapshotDelta delta = m_snapshotDeltas.takeFirst();
+        if ( delta.added )
+        {
+            m_snapshotLoading = true;
+
+            DatabaseCommand_LoadCollectionSnapshot* cmd = new DatabaseCommand_LoadCollectionSnapshot( source(), delta.fileids );
+            connect( cmd, SIGNAL( done( Tomahawk::collectionsnapshot_ptr ) ),
+                            SLOT( onSnapshotLoaded( Tomahawk::collectionsnapshot_ptr ) ) );
+
+            Database::instance()->enqueue( Tomahawk::dbcmd_ptr( cmd ) );
+        }
+        else
+        {
+            m_snapshot->removeFiles( delta.fileids );
+            m_snapshot->finalize();
+        }
+    }
+}
+
+
 void
 DatabaseCollection::autoPlaylistCreated( const source_ptr& source, const QVariantList& data )
 {
@@ -22,6 +22,7 @@
 #define DATABASECOLLECTION_H
 
 #include "collection/Collection.h"
+#include "database/CollectionSnapshot.h"
 #include "DllMacro.h"
 #include "Source.h"
 #include "Typedefs.h"
@@ -59,6 +60,15 @@ public:
 
     virtual int trackCount() const;
 
+    /**
+     * Answer artist, album and track requests from a CollectionSnapshot instead
+     * of the database. The snapshot gets loaded after the source synced (or on
+     * the first request) and follows the AddFiles / DeleteFiles applied to the
+     * collection afterwards. Enabled by default for remote collections.
+     */
+    void setSnapshotEnabled( bool enabled );
+    bool snapshotEnabled() const { return m_snapshotEnabled; }
+
 public slots:
     virtual void addTracks( const QList<QVariant>& newitems );
     virtual void removeTracks( const QDir& dir );
@@ -66,6 +76,27 @@ public slots:
 private slots:
     void stationCreated( const Tomahawk::source_ptr& source, const QVariantList& data );
     void autoPlaylistCreated( const Tomahawk::source_ptr& source, const QVariantList& data );
+
+    void loadSnapshot();
+    void onSnapshotLoaded( const Tomahawk::collectionsnapshot_ptr& snapshot );
+    void onTracksAdded( const QList<unsigned int>& fileids );
+    void onTracksRemoved( const QList<unsigned int>& fileids );
+
+private:
+    struct SnapshotDelta
+    {
+        bool added;
+        QList< unsigned int > fileids;
+    };
+
+    void applySnapshotDeltas();
+
+    bool m_snapshotEnabled;
+    // Only one load is in flight at a time, deltas arriving meanwhile wait in m_snapshotDeltas
+    bool m_snapshotLoading;
+    bool m_snapshotLoadingAll;
+    Tomahawk::collectionsnapshot_ptr m_snapshot;
+    QList< SnapshotDelta > m_snapshotDeltas;
 };
 
 }
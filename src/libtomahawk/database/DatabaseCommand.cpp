@@ -65,13 +65,43 @@ void
 DatabaseCommand::_exec( DatabaseImpl* lib )
 {
     Q_D( DatabaseCommand );
+    d->queueTime = d->queueTimer.isValid() ? d->queueTimer.elapsed() : 0;
     d->state = RUNNING;
     emitRunning();
+
+    QElapsedTimer timer;
+    timer.start();
     exec( lib );
+    d->execTime = timer.elapsed();
+
     d->state = FINISHED;
 }
 
 
+void
+DatabaseCommand::markAsQueued()
+{
+    Q_D( DatabaseCommand );
+    d->queueTimer.start();
+}
+
+
+qint64
+DatabaseCommand::queueTime() const
+{
+    Q_D( const DatabaseCommand );
+    return d->queueTime;
+}
+
+
+qint64
+DatabaseCommand::execTime() const
+{
+    Q_D( const DatabaseCommand );
+    return d->execTime;
+}
+
+
 void
 DatabaseCommand::setSource( const Tomahawk::source_ptr& s )
 {
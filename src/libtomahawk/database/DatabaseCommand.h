@@ -45,6 +45,14 @@ public:
         FINISHED = 2
     };
 
+    /// Read-only commands with a higher priority overtake queued ones with a lower priority.
+    enum Priority {
+        InteractivePriority = 0, // somebody is waiting for the result, e.g. resolving or loading a playlist
+        NormalPriority = 1,
+        BackgroundPriority = 2,  // statistics, charts, syncing
+        PriorityCount
+    };
+
     explicit DatabaseCommand( QObject* parent = 0 );
     explicit DatabaseCommand( const Tomahawk::source_ptr& src, QObject* parent = 0 );
 
@@ -54,6 +62,7 @@ public:
 
     virtual QString commandname() const { return "DatabaseCommand"; }
     virtual bool doesMutates() const { return true; }
+    virtual Priority priority() const { return NormalPriority; }
     State state() const;
 
     // if i make this pure virtual, i get compile errors in qmetatype.h.
@@ -85,6 +94,12 @@ public:
     void emitCommitted();
     void emitRunning();
 
+    /// Called when the command gets enqueued, for the queue time metrics.
+    void markAsQueued();
+    /// Time in ms the command waited for a worker, and spent in exec().
+    qint64 queueTime() const;
+    qint64 execTime() const;
+
     QWeakPointer< Tomahawk::DatabaseCommand > weakRef() const;
     void setWeakRef( QWeakPointer< Tomahawk::DatabaseCommand > weakRef );
 
@@ -19,3 +19,57 @@
 #include "DatabaseCommandLoggable.h"
 
 #include "utils/Logger.h"
+#include "utils/Json.h"
+#include "utils/JsonWriter.h"
+
+using namespace Tomahawk;
+
+
+QByteArray
+DatabaseCommandLoggable::serialize() const
+{
+    TomahawkUtils::JsonWriter writer;
+    writer.beginObject();
+    writer.write( "command", commandname() );
+    writer.write( "guid", guid() );
+    serializeFields( writer );
+    writer.endObject();
+
+    return writer.data();
+}
+
+
+void
+DatabaseCommandLoggable::deserialize( const QVariantMap& op )
+{
+    if ( op.contains( "guid" ) )
+        setGuid( op.value( "guid" ).toString() );
+
+    deserializeFields( op );
+}
+
+
+void
+DatabaseCommandLoggable::serializeFields( TomahawkUtils::JsonWriter& writer ) const
+{
+    const QVariantMap map = TomahawkUtils::qobject2qvariant( this );
+    for ( QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it )
+    {
+        if ( it.key() == "command" || it.key() == "guid" )
+            continue;
+
+        writer.write( it.key().toLatin1().constData(), it.value() );
+    }
+}
+
+
+void
+DatabaseCommandLoggable::deserializeFields( const QVariantMap& op )
+{
+    QVariantMap fields = op;
+    fields.remove( "command" );
+    fields.remove( "guid" );
+    fields.remove( "v" );
+
+    TomahawkUtils::qvariant2qobject( fields, this );
+}
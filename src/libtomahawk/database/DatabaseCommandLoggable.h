@@ -22,6 +22,13 @@
 #include "database/DatabaseCommand.h"
 #include "DllMacro.h"
 
+#include <QVariantMap>
+
+namespace TomahawkUtils
+{
+    class JsonWriter;
+}
+
 /// A Database Command that will be added to the oplog and sent over the network
 /// so peers can sync up and changes to our collection in their cached copy.
 namespace Tomahawk
@@ -43,6 +50,27 @@ public:
     {}
 
     virtual bool loggable() const { return true; }
+
+    /**
+     * Version of the op format written by serialize(). Version 1 is the format
+     * of the old Q_PROPERTY based serialization and isn't marked explicitly, so
+     * the oplog and older peers stay compatible. Newer versions carry a "v" key.
+     */
+    static const int FormatVersion = 1;
+
+    /// JSON representation of this command, as stored in the oplog and sent to peers.
+    QByteArray serialize() const;
+    /// Restores this command from an op created by serialize().
+    void deserialize( const QVariantMap& op );
+
+protected:
+    /**
+     * Write / read the command specific fields. The defaults go through the
+     * command's Q_PROPERTYs, commands with large or frequent ops should
+     * override both to avoid the reflection and intermediate QVariant trees.
+     */
+    virtual void serializeFields( TomahawkUtils::JsonWriter& writer ) const;
+    virtual void deserializeFields( const QVariantMap& op );
 };
 
 }
@@ -39,16 +39,21 @@ using namespace Tomahawk;
 QVariantList
 DatabaseCommand_AddFiles::files() const
 {
-    QVariantList list;
-    foreach ( const QVariant& v, m_files )
-    {
-        // replace url with the id, we don't leak file paths over the network.
-        QVariantMap m = v.toMap();
-        m.remove( "url" );
-        m.insert( "url", QString::number( m.value( "id" ).toInt() ) );
-        list.append( m );
-    }
-    return list;
+    return m_files.toVariantList( true );
+}
+
+
+void
+DatabaseCommand_AddFiles::serializeFields( TomahawkUtils::JsonWriter& writer ) const
+{
+    m_files.write( writer, "files" );
+}
+
+
+void
+DatabaseCommand_AddFiles::deserializeFields( const QVariantMap& op )
+{
+    m_files = ScannedFileBatch::fromVariantList( op.value( "files" ).toList() );
 }
 
 
@@ -86,30 +91,26 @@ DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
 
     int added = 0;
     QVariant srcid = source()->isLocal() ? QVariant( QVariant::Int ) : source()->id();
-    qDebug() << "Adding" << m_files.length() << "files to db for source" << srcid;
+    qDebug() << "Adding" << m_files.count() << "files to db for source" << srcid;
 
-    QList<QVariant>::iterator it;
-    for ( it = m_files.begin(); it != m_files.end(); ++it )
+    for ( int i = 0; i < m_files.count(); i++ )
     {
-        QVariant& v = *it;
-        QVariantMap m = v.toMap();
-
         int fileid = 0, artistid = 0, albumid = 0, trackid = 0, composerid = 0;
 
-        QString url      = m.value( "url" ).toString();
-        int mtime        = m.value( "mtime" ).toInt();
-        uint size        = m.value( "size" ).toUInt();
-        QString hash     = m.value( "hash" ).toString();
-        QString mimetype = m.value( "mimetype" ).toString();
-        uint duration    = m.value( "duration" ).toUInt();
-        uint bitrate     = m.value( "bitrate" ).toUInt();
-        QString artist   = m.value( "artist" ).toString();
-        QString album    = m.value( "album" ).toString();
-        QString track    = m.value( "track" ).toString();
-        uint albumpos    = m.value( "albumpos" ).toUInt();
-        QString composer = m.value( "composer" ).toString();
-        uint discnumber  = m.value( "discnumber" ).toUInt();
-        int year         = m.value( "year" ).toInt();
+        const QString& url      = m_files.urls.at( i );
+        const uint mtime        = m_files.mtimes.at( i );
+        const uint size         = m_files.sizes.at( i );
+        const QString& hash     = m_files.hashes.at( i );
+        const QString& mimetype = m_files.mimetypes.at( i );
+        const uint duration     = m_files.durations.at( i );
+        const uint bitrate      = m_files.bitrates.at( i );
+        const QString& artist   = m_files.artists.at( i );
+        const QString& album    = m_files.albums.at( i );
+        const QString& track    = m_files.tracks.at( i );
+        const uint albumpos     = m_files.albumpos.at( i );
+        const QString& composer = m_files.composers.at( i );
+        const uint discnumber   = m_files.discnumbers.at( i );
+        const int year          = m_files.years.at( i );
 
         query_file.bindValue( 0, srcid );
         query_file.bindValue( 1, url );
@@ -126,9 +127,8 @@ DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
 
         // get internal IDs for art/alb/trk
         fileid = query_file.lastInsertId().toInt();
-        m.insert( "id", fileid );
-        // this is the qvariant(map) the remote will get
-        v = m;
+        // this is the id the remote will get instead of the url
+        m_files.ids[ i ] = fileid;
 
         artistid = dbi->artistId( artist, true );
         if ( artistid < 1 )
@@ -167,5 +167,7 @@ DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
     qDebug() << "Inserted" << added << "tracks to database";
     tDebug() << "Committing" << added << "tracks...";
 
-    emit done( m_files, source()->dbCollection() );
+    // Only build the variant form if anyone is actually interested in it
+    if ( receivers( SIGNAL( done( QList<QVariant>, Tomahawk::collection_ptr ) ) ) > 0 )
+        emit done( m_files.toVariantList(), source()->dbCollection() );
 }
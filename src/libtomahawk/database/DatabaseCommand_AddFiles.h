@@ -23,6 +23,7 @@
 #include <QVariantMap>
 
 #include "database/DatabaseCommandLoggable.h"
+#include "database/ScannedFile.h"
 #include "Typedefs.h"
 #include "Query.h"
 
@@ -42,6 +43,12 @@ public:
     {}
 
     explicit DatabaseCommand_AddFiles( const QList<QVariant>& files, const Tomahawk::source_ptr& source, QObject* parent = 0 )
+        : DatabaseCommandLoggable( parent ), m_files( ScannedFileBatch::fromVariantList( files ) )
+    {
+        setSource( source );
+    }
+
+    explicit DatabaseCommand_AddFiles( const ScannedFileBatch& files, const Tomahawk::source_ptr& source, QObject* parent = 0 )
         : DatabaseCommandLoggable( parent ), m_files( files )
     {
         setSource( source );
@@ -54,14 +61,18 @@ public:
     virtual void postCommitHook();
 
     QVariantList files() const;
-    void setFiles( const QVariantList& f ) { m_files = f; }
+    void setFiles( const QVariantList& f ) { m_files = ScannedFileBatch::fromVariantList( f ); }
 
 signals:
     void done( const QList<QVariant>&, const Tomahawk::collection_ptr& );
     void notify( const QList<unsigned int>& ids );
 
+protected:
+    virtual void serializeFields( TomahawkUtils::JsonWriter& writer ) const;
+    virtual void deserializeFields( const QVariantMap& op );
+
 private:
-    QVariantList m_files;
+    ScannedFileBatch m_files;
     QList<unsigned int> m_ids;
 };
 
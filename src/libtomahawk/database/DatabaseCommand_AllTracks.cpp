@@ -39,25 +39,55 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
     TomahawkSqlQuery query = dbi->newquery();
     QList<Tomahawk::query_ptr> ql;
 
-    QString m_orderToken, sourceToken;
+    // Nullable columns are coalesced, paging compares against them
+    QStringList sortKeys;
     switch ( m_sortOrder )
     {
-        case 0:
+        case None:
             break;
 
         case Album:
-            m_orderToken = "album.name, file_join.discnumber, file_join.albumpos";
+            sortKeys << "COALESCE(album.sortname, '')" << "COALESCE(file_join.discnumber, 0)" << "COALESCE(file_join.albumpos, 0)";
             break;
 
         case ModificationTime:
-            m_orderToken = "file.mtime";
+            sortKeys << "file.mtime";
             break;
 
         case AlbumPosition:
-            m_orderToken = "file_join.discnumber, file_join.albumpos";
+            sortKeys << "COALESCE(file_join.discnumber, 0)" << "COALESCE(file_join.albumpos, 0)";
+            break;
+
+        case Artist:
+            sortKeys << "artist.sortname" << "COALESCE(album.sortname, '')" << "COALESCE(file_join.discnumber, 0)" << "COALESCE(file_join.albumpos, 0)";
+            break;
+
+        case Track:
+            sortKeys << "track.sortname";
+            break;
+
+        case Composer:
+            sortKeys << "COALESCE(composer.sortname, '')" << "COALESCE(album.sortname, '')" << "COALESCE(file_join.discnumber, 0)" << "COALESCE(file_join.albumpos, 0)";
+            break;
+
+        case Duration:
+            sortKeys << "file.duration";
+            break;
+
+        case Bitrate:
+            sortKeys << "file.bitrate";
+            break;
+
+        case FileSize:
+            sortKeys << "file.size";
             break;
     }
 
+    // Pages continue after the last row's sort key, so the key has to be unique
+    if ( m_paged )
+        sortKeys << "file.id";
+
+    QString sourceToken;
     if ( !m_collection.isNull() )
         sourceToken = QString( "AND file.source %1" ).arg( m_collection->source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( m_collection->source()->id() ) );
 
@@ -73,10 +103,52 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
             albumToken = QString( "AND album.id = %1" ).arg( m_album->id() );
     }
 
+    QVariantList bindValues;
+
+    QString filterToken;
+    foreach ( QString term, DatabaseImpl::sortname( m_filter ).split( " ", QString::SkipEmptyParts ) )
+    {
+        term.replace( "\\", "\\\\" ).replace( "%", "\\%" ).replace( "_", "\\_" );
+        term = "%" + term + "%";
+
+        filterToken += "AND (artist.sortname LIKE ? ESCAPE '\\' "
+                       "OR COALESCE(album.sortname, '') LIKE ? ESCAPE '\\' "
+                       "OR track.sortname LIKE ? ESCAPE '\\') ";
+        bindValues << term << term << term;
+    }
+
+    // Keyset paging: (k1 > v1) OR (k1 = v1 AND k2 > v2) OR ...
+    QString pageToken;
+    if ( m_paged && m_pageStart.count() == sortKeys.count() )
+    {
+        QStringList alternatives;
+        for ( int i = 0; i < sortKeys.count(); i++ )
+        {
+            QStringList terms;
+            for ( int j = 0; j < i; j++ )
+            {
+                terms << QString( "%1 = ?" ).arg( sortKeys.at( j ) );
+                bindValues << m_pageStart.at( j );
+            }
+
+            terms << QString( "%1 %2 ?" ).arg( sortKeys.at( i ) ).arg( m_sortDescending ? "<" : ">" );
+            bindValues << m_pageStart.at( i );
+
+            alternatives << QString( "(%1)" ).arg( terms.join( " AND " ) );
+        }
+
+        pageToken = QString( "AND (%1)" ).arg( alternatives.join( " OR " ) );
+    }
+
+    QString orderToken;
+    if ( !sortKeys.isEmpty() )
+        orderToken = QString( "ORDER BY %1" ).arg( sortKeys.join( m_sortDescending ? " DESC, " : ", " ) + ( m_sortDescending ? " DESC" : "" ) );
+
     QString sql = QString(
             "SELECT file.id, artist.name, album.name, track.name, composer.name, file.size, "   //0
                    "file.duration, file.bitrate, file.url, file.source, file.mtime, "           //6
                    "file.mimetype, file_join.discnumber, file_join.albumpos, track.id "       //11
+                   "%1 "                                                                      //15, sort keys
             "FROM file, artist, track, file_join "
             "LEFT OUTER JOIN album "
             "ON file_join.album = album.id "
@@ -85,25 +157,41 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
             "WHERE file.id = file_join.file "
             "AND file_join.artist = artist.id "
             "AND file_join.track = track.id "
-            "%1 "
-            "%2 %3 "
-            "%4 %5 %6"
-            ).arg( sourceToken )
+            "%2 "
+            "%3 %4 "
+            "%5 %6 "
+            "%7 %8"
+            ).arg( m_paged && !sortKeys.isEmpty() ? ", " + sortKeys.join( ", " ) : QString() )
+             .arg( sourceToken )
              .arg( !m_artist ? QString() : QString( "AND artist.id = %1" ).arg( m_artist->id() ) )
              .arg( !m_album ? QString() : albumToken )
-             .arg( m_sortOrder > 0 ? QString( "ORDER BY %1" ).arg( m_orderToken ) : QString() )
-             .arg( m_sortDescending ? "DESC" : QString() )
+             .arg( filterToken )
+             .arg( pageToken )
+             .arg( orderToken )
              .arg( m_amount > 0 ? QString( "LIMIT 0, %1" ).arg( m_amount ) : QString() );
 
     query.prepare( sql );
+    foreach ( const QVariant& value, bindValues )
+        query.addBindValue( value );
     query.exec();
 
+    unsigned int rows = 0;
+    QVariantList lastRowKeys;
+
     // Small cache to keep already created source objects.
     // This saves some mutex locking.
     std::map<uint, Tomahawk::source_ptr> sourceCache;
 
     while( query.next() )
     {
+        rows++;
+        if ( m_paged )
+        {
+            lastRowKeys.clear();
+            for ( int i = 0; i < sortKeys.count(); i++ )
+                lastRowKeys << query.value( 15 + i );
+        }
+
         QString artist = query.value( 1 ).toString();
         QString album = query.value( 2 ).toString();
         QString track = query.value( 3 ).toString();
@@ -161,6 +249,12 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
     emit tracks( ql, data() );
     emit tracks( ql );
     emit done( m_collection );
+
+    if ( m_paged )
+    {
+        // A short page was the last one
+        emit page( ql, m_amount > 0 && rows == m_amount ? lastRowKeys : QVariantList(), data() );
+    }
 }
 
 }
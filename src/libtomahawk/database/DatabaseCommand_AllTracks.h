@@ -44,7 +44,13 @@ public:
         None = 0,
         Album = 1,
         ModificationTime = 2,
-        AlbumPosition = 3
+        AlbumPosition = 3,
+        Artist = 4,
+        Track = 5,
+        Composer = 6,
+        Duration = 7,
+        Bitrate = 8,
+        FileSize = 9
     };
 
     explicit DatabaseCommand_AllTracks( const Tomahawk::collection_ptr& collection = Tomahawk::collection_ptr(), QObject* parent = 0 )
@@ -55,6 +61,7 @@ public:
         , m_amount( 0 )
         , m_sortOrder( DatabaseCommand_AllTracks::None )
         , m_sortDescending( false )
+        , m_paged( false )
     {}
 
     virtual void exec( DatabaseImpl* );
@@ -71,11 +78,23 @@ public:
     void setSortOrder( DatabaseCommand_AllTracks::SortOrder order ) { m_sortOrder = order; }
     void setSortDescending( bool descending ) { m_sortDescending = descending; }
 
+    /// Only returns tracks whose artist, album or track name contain every word of @p filter.
+    void setFilter( const QString& filter ) { m_filter = filter; }
+
+    /**
+     * Turns on keyset paging: loads at most limit() tracks following the row
+     * @p start, as reported by the previous page() signal (empty for the first page).
+     */
+    void setPageStart( const QVariantList& start ) { m_pageStart = start; m_paged = true; }
+
 signals:
     void tracks( const QList<Tomahawk::query_ptr>&, const QVariant& data );
     void tracks( const QList<Tomahawk::query_ptr>& );
     void done( const Tomahawk::collection_ptr& );
 
+    /// Emitted in paged mode. @p nextPageStart is empty if this was the last page.
+    void page( const QList<Tomahawk::query_ptr>& tracks, const QVariantList& nextPageStart, const QVariant& data );
+
 private:
     Tomahawk::collection_ptr m_collection;
 
@@ -85,6 +104,10 @@ private:
     unsigned int m_amount;
     DatabaseCommand_AllTracks::SortOrder m_sortOrder;
     bool m_sortDescending;
+
+    QString m_filter;
+    QVariantList m_pageStart;
+    bool m_paged;
 };
 
 }
@@ -41,6 +41,7 @@ public:
 
     virtual void exec( DatabaseImpl* lib );
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return InteractivePriority; }
 
 signals:
     // if auth is invalid name is empty
@@ -25,6 +25,7 @@
 #include "database/Database.h"
 #include "database/DatabaseImpl.h"
 #include "network/Servent.h"
+#include "utils/JsonWriter.h"
 #include "utils/Logger.h"
 #include "utils/TomahawkUtils.h"
 
@@ -36,6 +37,26 @@
 using namespace Tomahawk;
 
 
+void
+DatabaseCommand_DeleteFiles::serializeFields( TomahawkUtils::JsonWriter& writer ) const
+{
+    writer.write( "deleteAll", m_deleteAll );
+
+    writer.beginArray( "ids" );
+    foreach ( const QVariant& id, m_ids )
+        writer.append( id );
+    writer.endArray();
+}
+
+
+void
+DatabaseCommand_DeleteFiles::deserializeFields( const QVariantMap& op )
+{
+    m_deleteAll = op.value( "deleteAll" ).toBool();
+    m_ids = op.value( "ids" ).toList();
+}
+
+
 // After changing a collection, we need to tell other bits of the system:
 void
 DatabaseCommand_DeleteFiles::postCommitHook()
@@ -80,6 +80,10 @@ signals:
     void done( const QList<unsigned int>&, const Tomahawk::collection_ptr& );
     void notify( const QList<unsigned int>& ids );
 
+protected:
+    virtual void serializeFields( TomahawkUtils::JsonWriter& writer ) const;
+    virtual void deserializeFields( const QVariantMap& op );
+
 private:
     QDir m_dir;
     QVariantList m_ids;
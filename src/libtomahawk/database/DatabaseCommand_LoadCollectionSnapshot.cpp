@@ -0,0 +1,124 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseCommand_LoadCollectionSnapshot.h"
+
+#include "DatabaseImpl.h"
+#include "Source.h"
+#include "TomahawkSqlQuery.h"
+#include "utils/Logger.h"
+
+#include <QTime>
+
+// File ids are inlined into the query in chunks of this size
+#define FILE_CHUNK_SIZE 500
+
+using namespace Tomahawk;
+
+
+DatabaseCommand_LoadCollectionSnapshot::DatabaseCommand_LoadCollectionSnapshot( const source_ptr& source, const QList< unsigned int >& fileIds, QObject* parent )
+    : DatabaseCommand( source, parent )
+    , m_fileIds( fileIds )
+{
+    qRegisterMetaType< Tomahawk::collectionsnapshot_ptr >( "Tomahawk::collectionsnapshot_ptr" );
+}
+
+
+void
+DatabaseCommand_LoadCollectionSnapshot::exec( DatabaseImpl* dbi )
+{
+    QTime t;
+    t.start();
+
+    collectionsnapshot_ptr snapshot( new CollectionSnapshot() );
+
+    if ( m_fileIds.isEmpty() )
+    {
+        load( dbi, snapshot.data(), QString() );
+    }
+    else
+    {
+        for ( int offset = 0; offset < m_fileIds.count(); offset += FILE_CHUNK_SIZE )
+        {
+            QStringList ids;
+            for ( int i = offset; i < qMin( offset + FILE_CHUNK_SIZE, m_fileIds.count() ); i++ )
+                ids << QString::number( m_fileIds.at( i ) );
+
+            load( dbi, snapshot.data(), QString( "AND file.id IN (%1)" ).arg( ids.join( "," ) ) );
+        }
+    }
+
+    snapshot->finalize();
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Loaded" << snapshot->fileCount() << "files of source" << source()->id() << "in" << t.elapsed() << "ms";
+    emit done( snapshot );
+}
+
+
+void
+DatabaseCommand_LoadCollectionSnapshot::load( DatabaseImpl* dbi, CollectionSnapshot* snapshot, const QString& idToken )
+{
+    TomahawkSqlQuery query = dbi->newquery();
+    query.prepare( QString(
+            "SELECT file.id, file.url, file.size, file.duration, file.bitrate, file.mtime, file.mimetype, "  //0
+                   "file_join.discnumber, file_join.albumpos, track.id, track.name, composer.name, "         //7
+                   "artist.id, artist.name, artist.sortname, "                                               //12
+                   "album.id, album.name, album.sortname, "                                                  //15
+                   "albumartist.id, albumartist.name, albumartist.sortname "                                 //18
+            "FROM file, artist, track, file_join "
+            "LEFT OUTER JOIN album "
+            "ON file_join.album = album.id "
+            "LEFT OUTER JOIN artist AS albumartist "
+            "ON album.artist = albumartist.id "
+            "LEFT OUTER JOIN artist AS composer "
+            "ON file_join.composer = composer.id "
+            "WHERE file.id = file_join.file "
+            "AND file_join.artist = artist.id "
+            "AND file_join.track = track.id "
+            "AND file.source %1 "
+            "%2" )
+            .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) )
+            .arg( idToken ) );
+    query.exec();
+
+    CollectionSnapshot::File file;
+    while ( query.next() )
+    {
+        file.id = query.value( 0 ).toUInt();
+        file.url = query.value( 1 ).toString();
+        file.size = query.value( 2 ).toUInt();
+        file.duration = query.value( 3 ).toUInt();
+        file.bitrate = query.value( 4 ).toUInt();
+        file.mtime = query.value( 5 ).toUInt();
+        file.mimetype = query.value( 6 ).toString();
+        file.discnumber = query.value( 7 ).toUInt();
+        file.albumpos = query.value( 8 ).toUInt();
+        file.trackId = query.value( 9 ).toUInt();
+        file.track = query.value( 10 ).toString();
+        file.composer = query.value( 11 ).toString();
+        file.artistId = query.value( 12 ).toUInt();
+        file.artist = query.value( 13 ).toString();
+        file.artistSortname = query.value( 14 ).toString();
+        file.albumId = query.value( 15 ).toUInt();
+        file.album = query.value( 16 ).toString();
+        file.albumSortname = query.value( 17 ).toString();
+        file.albumArtistId = query.value( 18 ).toUInt();
+        file.albumArtist = query.value( 19 ).toString();
+        file.albumArtistSortname = query.value( 20 ).toString();
+
+        snapshot->addFile( file );
+    }
+}
@@ -0,0 +1,58 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASECOMMAND_LOADCOLLECTIONSNAPSHOT_H
+#define DATABASECOMMAND_LOADCOLLECTIONSNAPSHOT_H
+
+#include "DatabaseCommand.h"
+#include "CollectionSnapshot.h"
+#include "Typedefs.h"
+
+#include "DllMacro.h"
+
+namespace Tomahawk
+{
+
+/**
+ * Loads the files of a source's collection into a CollectionSnapshot, either
+ * all of them or just the given file ids (e.g. the ones an AddFiles added).
+ */
+class DLLEXPORT DatabaseCommand_LoadCollectionSnapshot : public DatabaseCommand
+{
+Q_OBJECT
+public:
+    explicit DatabaseCommand_LoadCollectionSnapshot( const Tomahawk::source_ptr& source,
+                                                     const QList< unsigned int >& fileIds = QList< unsigned int >(),
+                                                     QObject* parent = 0 );
+
+    virtual void exec( DatabaseImpl* );
+    virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return BackgroundPriority; }
+    virtual QString commandname() const { return "loadcollectionsnapshot"; }
+
+signals:
+    /// The snapshot is finalized already.
+    void done( const Tomahawk::collectionsnapshot_ptr& snapshot );
+
+private:
+    void load( DatabaseImpl* dbi, CollectionSnapshot* snapshot, const QString& idToken );
+
+    QList< unsigned int > m_fileIds;
+};
+
+}
+
+#endif // DATABASECOMMAND_LOADCOLLECTIONSNAPSHOT_H
@@ -46,6 +46,7 @@ public:
 
     virtual void exec( DatabaseImpl* );
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return InteractivePriority; }
     virtual QString commandname() const { return "loadfiles"; }
 
 signals:
@@ -41,6 +41,7 @@ public:
 
     virtual void exec( DatabaseImpl* db );
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return BackgroundPriority; }
     virtual QString commandname() const { return "loadops"; }
 
 signals:
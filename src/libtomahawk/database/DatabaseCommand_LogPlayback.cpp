@@ -22,6 +22,7 @@
 #include "collection/Collection.h"
 #include "database/Database.h"
 #include "network/Servent.h"
+#include "utils/JsonWriter.h"
 #include "utils/Logger.h"
 
 #include "DatabaseImpl.h"
@@ -33,10 +34,35 @@
 #define STARTED_THRESHOLD 600   // Don't advertise tracks older than X seconds as currently playing
 #define FINISHED_THRESHOLD 10   // Don't store tracks played less than X seconds in the playback log
 #define SUBMISSION_THRESHOLD 20 // Don't broadcast playback logs when a track was played less than X seconds
+#define SECS_PER_DAY 86400
 
 using namespace Tomahawk;
 
 
+void
+DatabaseCommand_LogPlayback::serializeFields( TomahawkUtils::JsonWriter& writer ) const
+{
+    writer.write( "action", (int)m_action );
+    writer.write( "artist", m_artist );
+    writer.write( "playtime", m_playtime );
+    writer.write( "secsPlayed", m_secsPlayed );
+    writer.write( "track", m_track );
+    writer.write( "trackDuration", m_trackDuration );
+}
+
+
+void
+DatabaseCommand_LogPlayback::deserializeFields( const QVariantMap& op )
+{
+    m_action = (Action)op.value( "action" ).toInt();
+    m_artist = op.value( "artist" ).toString();
+    m_playtime = op.value( "playtime" ).toUInt();
+    m_secsPlayed = op.value( "secsPlayed" ).toUInt();
+    m_track = op.value( "track" ).toString();
+    m_trackDuration = op.value( "trackDuration" ).toUInt();
+}
+
+
 void
 DatabaseCommand_LogPlayback::postCommitHook()
 {
@@ -120,6 +146,26 @@ DatabaseCommand_LogPlayback::exec( DatabaseImpl* dbi )
     query.bindValue( 3, m_secsPlayed );
 
     query.exec();
+
+    // Keep the daily rollups in sync, charts and trending read from those.
+    // This also runs when replaying a peer's oplog.
+    const uint day = m_playtime / SECS_PER_DAY;
+    const int rollupSource = srcid.isNull() ? 0 : srcid.toInt();
+
+    query.prepare( "INSERT OR IGNORE INTO playback_stats_daily(day, source, track, artist, plays, secs_played) VALUES (?, ?, ?, ?, 0, 0)" );
+    query.bindValue( 0, day );
+    query.bindValue( 1, rollupSource );
+    query.bindValue( 2, trkid );
+    query.bindValue( 3, artid );
+    query.exec();
+
+    query.prepare( "UPDATE playback_stats_daily SET plays = plays + 1, secs_played = secs_played + ? "
+                   "WHERE day = ? AND source = ? AND track = ?" );
+    query.bindValue( 0, m_secsPlayed );
+    query.bindValue( 1, day );
+    query.bindValue( 2, rollupSource );
+    query.bindValue( 3, trkid );
+    query.exec();
 }
 
 
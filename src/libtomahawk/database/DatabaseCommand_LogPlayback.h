@@ -96,6 +96,10 @@ signals:
     void trackPlaying( const Tomahawk::track_ptr& track, unsigned int duration );
     void trackPlayed( const Tomahawk::track_ptr& track, const Tomahawk::PlaybackLog& log );
 
+protected:
+    virtual void serializeFields( TomahawkUtils::JsonWriter& writer ) const;
+    virtual void deserializeFields( const QVariantMap& op );
+
 private:
     QString m_artist;
     QString m_track;
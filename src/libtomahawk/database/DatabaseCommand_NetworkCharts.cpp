@@ -62,17 +62,18 @@ DatabaseCommand_NetworkCharts::exec( DatabaseImpl * dbi )
     QString timespan;
     if ( m_from.isValid() && m_to.isValid() )
     {
+        // The rollups are per day (UTC)
         timespan = QString(
-                    " AND playback_log.playtime >= %1 AND playback_log.playtime <= %2 "
-                    ).arg( m_from.toTime_t() ).arg( m_to.toTime_t() );
+                    " AND playback_stats_daily.day >= %1 AND playback_stats_daily.day <= %2 "
+                    ).arg( m_from.toTime_t() / 86400 ).arg( m_to.toTime_t() / 86400 );
     }
 
     QString sql = QString(
-                "SELECT COUNT(*) as counter, track.name, artist.name "
-                " FROM playback_log, track, artist "
-                " WHERE track.id = playback_log.track AND artist.id = track.artist "
-                " AND playback_log.source IS NOT NULL %1 " // exclude self
-                " GROUP BY playback_log.track "
+                "SELECT SUM(plays) as counter, track.name, artist.name "
+                " FROM playback_stats_daily, track, artist "
+                " WHERE track.id = playback_stats_daily.track AND artist.id = playback_stats_daily.artist "
+                " AND playback_stats_daily.source != 0 %1 " // exclude self
+                " GROUP BY playback_stats_daily.track "
                 " ORDER BY counter DESC "
                 " %2"
                 ).arg( timespan ).arg( limit );
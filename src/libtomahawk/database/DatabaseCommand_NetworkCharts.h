@@ -42,6 +42,7 @@ public:
     virtual void exec( DatabaseImpl* );
 
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return BackgroundPriority; }
     virtual QString commandname() const { return "networkcharts"; }
 
     void setLimit( unsigned int amount ) { m_amount = amount; }
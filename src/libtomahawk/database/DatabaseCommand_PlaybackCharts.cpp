@@ -51,15 +51,14 @@ DatabaseCommand_PlaybackCharts::exec( DatabaseImpl* dbi )
     QString sourceToken;
 
     if ( source() )
-        sourceToken = QString( "AND playback_log.source %1" ).arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) );
+        sourceToken = QString( "AND playback_stats_daily.source = %1" ).arg( source()->isLocal() ? 0 : source()->id() );
 
     QString sql = QString(
-            "SELECT artist.id, artist.name, COUNT(*) AS counter "
-            "FROM playback_log, artist, track "
-            "WHERE playback_log.track = track.id "
-            "AND artist.id = track.artist "
+            "SELECT artist.id, artist.name, SUM(plays) AS counter "
+            "FROM playback_stats_daily, artist "
+            "WHERE artist.id = playback_stats_daily.artist "
             "%1 "
-            "GROUP BY artist.id "
+            "GROUP BY playback_stats_daily.artist "
             "ORDER BY counter DESC "
             "%2"
             ).arg( sourceToken )
@@ -43,6 +43,7 @@ public:
     virtual void exec( DatabaseImpl* );
 
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return BackgroundPriority; }
     virtual QString commandname() const { return "playbackcharts"; }
 
     void setLimit( unsigned int amount ) { m_amount = amount; }
@@ -27,9 +27,53 @@
 #include "SourceList.h"
 #include "Track.h"
 
+// Candidate track ids are bound in chunks of this size (padded with 0, which is
+// never a valid id), so the same cached statement serves every resolve
+#define TRACK_CHUNK_SIZE 32
+
 using namespace Tomahawk;
 
 
+static QString
+filesSql()
+{
+    QStringList placeholders;
+    for ( int i = 0; i < TRACK_CHUNK_SIZE; i++ )
+        placeholders << "?";
+
+    return QString( "SELECT "
+                    "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
+                    "file_join.artist, file_join.album, file_join.track, "  //7
+                    "file_join.composer, file_join.discnumber, "            //10
+                    "artist.name as artname, "                              //12
+                    "album.name as albname, "                               //13
+                    "track.name as trkname, "                               //14
+                    "composer.name as cmpname, "                            //15
+                    "file.source, "                                         //16
+                    "file_join.albumpos, "                                  //17
+                    "artist.id as artid, "                                  //18
+                    "album.id as albid, "                                   //19
+                    "composer.id as cmpid "                                 //20
+                    "FROM file, file_join, artist, track "
+                    "LEFT JOIN album ON album.id = file_join.album "
+                    "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
+                    "WHERE "
+                    "artist.id = file_join.artist AND "
+                    "track.id = file_join.track AND "
+                    "file.id = file_join.file AND "
+                    "file_join.track IN (%1)" )
+           .arg( placeholders.join( "," ) );
+}
+
+
+static void
+bindTrackIds( TomahawkSqlQuery& query, const QList< QPair<int, float> >& tracks, int offset )
+{
+    for ( int i = 0; i < TRACK_CHUNK_SIZE; i++ )
+        query.addBindValue( offset + i < tracks.count() ? tracks.at( offset + i ).first : 0 );
+}
+
+
 DatabaseCommand_Resolve::DatabaseCommand_Resolve( const query_ptr& query )
     : DatabaseCommand()
     , m_query( query )
@@ -90,72 +134,46 @@ DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
     }
 
     // STEP 2
-    TomahawkSqlQuery files_query = lib->newquery();
-
-    QStringList trksl;
-    for ( int k = 0; k < tracks.count(); k++ )
-        trksl.append( QString::number( tracks.at( k ).first ) );
-
-    QString trksToken = QString( "file_join.track IN (%1)" ).arg( trksl.join( "," ) );
-
-    QString sql = QString( "SELECT "
-                            "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
-                            "file_join.artist, file_join.album, file_join.track, "  //7
-                            "file_join.composer, file_join.discnumber, "            //10
-                            "artist.name as artname, "                              //12
-                            "album.name as albname, "                               //13
-                            "track.name as trkname, "                               //14
-                            "composer.name as cmpname, "                            //15
-                            "file.source, "                                         //16
-                            "file_join.albumpos, "                                  //17
-                            "artist.id as artid, "                                  //18
-                            "album.id as albid, "                                   //19
-                            "composer.id as cmpid "                                 //20
-                            "FROM file, file_join, artist, track "
-                            "LEFT JOIN album ON album.id = file_join.album "
-                            "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
-                            "WHERE "
-                            "artist.id = file_join.artist AND "
-                            "track.id = file_join.track AND "
-                            "file.id = file_join.file AND "
-                            "(%1)" )
-         .arg( trksToken );
-
-    files_query.prepare( sql );
-    files_query.exec();
-
-    while ( files_query.next() )
+    const QString sql = filesSql();
+    for ( int offset = 0; offset < tracks.count(); offset += TRACK_CHUNK_SIZE )
     {
-        QString url = files_query.value( 0 ).toString();
-        source_ptr s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
-        if ( !s )
-        {
-            tDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
-            continue;
-        }
-        if ( !s->isLocal() )
-            url = QString( "servent://%1\t%2" ).arg( s->nodeId() ).arg( url );
+        TomahawkSqlQuery files_query = lib->preparedQuery( sql );
+        bindTrackIds( files_query, tracks, offset );
+        files_query.exec();
 
-        Tomahawk::result_ptr result = Tomahawk::Result::get( url );
-        if ( result->isValid() )
+        while ( files_query.next() )
         {
-            tDebug( LOGVERBOSE ) << "Result already cached:" << result->toString();
-            res << result;
-            continue;
-        }
+            QString url = files_query.value( 0 ).toString();
+            source_ptr s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
+            if ( !s )
+            {
+                tDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
+                continue;
+            }
+            if ( !s->isLocal() )
+                url = QString( "servent://%1\t%2" ).arg( s->nodeId() ).arg( url );
+
+            Tomahawk::result_ptr result = Tomahawk::Result::get( url );
+            if ( result->isValid() )
+            {
+                tDebug( LOGVERBOSE ) << "Result already cached:" << result->toString();
+                res << result;
+                continue;
+            }
 
-        track_ptr track = Track::get( files_query.value( 9 ).toUInt(), files_query.value( 12 ).toString(), files_query.value( 14 ).toString(), files_query.value( 13 ).toString(), files_query.value( 5 ).toUInt(), files_query.value( 15 ).toString(), files_query.value( 17 ).toUInt(), files_query.value( 11 ).toUInt() );
-        track->loadAttributes();
-        result->setTrack( track );
+            track_ptr track = Track::get( files_query.value( 9 ).toUInt(), files_query.value( 12 ).toString(), files_query.value( 14 ).toString(), files_query.value( 13 ).toString(), files_query.value( 5 ).toUInt(), files_query.value( 15 ).toString(), files_query.value( 17 ).toUInt(), files_query.value( 11 ).toUInt() );
+            track->loadAttributes();
+            result->setTrack( track );
 
-        result->setModificationTime( files_query.value( 1 ).toUInt() );
-        result->setSize( files_query.value( 2 ).toUInt() );
-        result->setMimetype( files_query.value( 4 ).toString() );
-        result->setBitrate( files_query.value( 6 ).toUInt() );
-        result->setRID( uuid() );
-        result->setCollection( s->dbCollection() );
+            result->setModificationTime( files_query.value( 1 ).toUInt() );
+            result->setSize( files_query.value( 2 ).toUInt() );
+            result->setMimetype( files_query.value( 4 ).toString() );
+            result->setBitrate( files_query.value( 6 ).toUInt() );
+            result->setRID( uuid() );
+            result->setCollection( s->dbCollection() );
 
-        res << result;
+            res << result;
+        }
     }
 
     emit results( m_query->id(), res );
@@ -174,10 +192,8 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
 
     foreach ( const scorepair_t& albumPair, albumPairs )
     {
-        TomahawkSqlQuery query = lib->newquery();
-
-        QString sql = QString( "SELECT album.name, artist.id, artist.name FROM album, artist WHERE artist.id = album.artist AND album.id = %1" ).arg( albumPair.first );
-        query.prepare( sql );
+        TomahawkSqlQuery query = lib->preparedQuery( "SELECT album.name, artist.id, artist.name FROM album, artist WHERE artist.id = album.artist AND album.id = ?" );
+        query.addBindValue( albumPair.first );
         query.exec();
 
         QList<Tomahawk::album_ptr> albumList;
@@ -199,81 +215,56 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
     }
 
     // STEP 2
-    TomahawkSqlQuery files_query = lib->newquery();
-
-    QStringList trksl;
-    for ( int k = 0; k < trackPairs.count(); k++ )
-        trksl.append( QString::number( trackPairs.at( k ).first ) );
-
-    QString trksToken = QString( "file_join.track IN (%1)" ).arg( trksl.join( "," ) );
-    QString sql = QString( "SELECT "
-                            "url, mtime, size, md5, mimetype, duration, bitrate, "  //0
-                            "file_join.artist, file_join.album, file_join.track, "  //7
-                            "file_join.composer, file_join.discnumber, "            //10
-                            "artist.name as artname, "                              //12
-                            "album.name as albname, "                               //13
-                            "track.name as trkname, "                               //14
-                            "composer.name as cmpname, "                            //15
-                            "file.source, "                                         //16
-                            "file_join.albumpos, "                                  //17
-                            "artist.id as artid, "                                  //18
-                            "album.id as albid, "                                   //19
-                            "composer.id as cmpid "                                 //20
-                            "FROM file, file_join, artist, track "
-                            "LEFT JOIN album ON album.id = file_join.album "
-                            "LEFT JOIN artist AS composer ON composer.id = file_join.composer "
-                            "WHERE "
-                            "artist.id = file_join.artist AND "
-                            "track.id = file_join.track AND "
-                            "file.id = file_join.file AND "
-                            "%1" )
-                        .arg( trksl.length() > 0 ? trksToken : QString( "0" ) );
-
-    files_query.prepare( sql );
-    files_query.exec();
-
-    while ( files_query.next() )
+    const QString sql = filesSql();
+    for ( int offset = 0; offset < trackPairs.count(); offset += TRACK_CHUNK_SIZE )
     {
-        QString url = files_query.value( 0 ).toString();
-        source_ptr s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
-        if ( !s )
-        {
-            tDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
-            continue;
-        }
-        if ( !s->isLocal() )
-            url = QString( "servent://%1\t%2" ).arg( s->nodeId() ).arg( url );
+        TomahawkSqlQuery files_query = lib->preparedQuery( sql );
+        bindTrackIds( files_query, trackPairs, offset );
+        files_query.exec();
 
-        bool cached = Tomahawk::Result::isCached( url );
-        Tomahawk::result_ptr result = Tomahawk::Result::get( url );
-        if ( cached )
+        while ( files_query.next() )
         {
-            qDebug() << "Result already cached:" << result->toString();
-            res << result;
-            continue;
-        }
+            QString url = files_query.value( 0 ).toString();
+            source_ptr s = SourceList::instance()->get( files_query.value( 16 ).toUInt() );
+            if ( !s )
+            {
+                tDebug() << "Could not find source" << files_query.value( 16 ).toUInt();
+                continue;
+            }
+            if ( !s->isLocal() )
+                url = QString( "servent://%1\t%2" ).arg( s->nodeId() ).arg( url );
 
-        track_ptr track = Track::get( files_query.value( 9 ).toUInt(), files_query.value( 12 ).toString(), files_query.value( 14 ).toString(), files_query.value( 13 ).toString(), files_query.value( 5 ).toUInt(), files_query.value( 15 ).toString(), files_query.value( 17 ).toUInt(), files_query.value( 11 ).toUInt() );
-        track->loadAttributes();
-        result->setTrack( track );
+            bool cached = Tomahawk::Result::isCached( url );
+            Tomahawk::result_ptr result = Tomahawk::Result::get( url );
+            if ( cached )
+            {
+                qDebug() << "Result already cached:" << result->toString();
+                res << result;
+                continue;
+            }
 
-        result->setModificationTime( files_query.value( 1 ).toUInt() );
-        result->setSize( files_query.value( 2 ).toUInt() );
-        result->setMimetype( files_query.value( 4 ).toString() );
-        result->setBitrate( files_query.value( 6 ).toUInt() );
-        result->setRID( uuid() );
-        result->setCollection( s->dbCollection() );
+            track_ptr track = Track::get( files_query.value( 9 ).toUInt(), files_query.value( 12 ).toString(), files_query.value( 14 ).toString(), files_query.value( 13 ).toString(), files_query.value( 5 ).toUInt(), files_query.value( 15 ).toString(), files_query.value( 17 ).toUInt(), files_query.value( 11 ).toUInt() );
+            track->loadAttributes();
+            result->setTrack( track );
 
-        for ( int k = 0; k < trackPairs.count(); k++ )
-        {
-            if ( trackPairs.at( k ).first == (int)track->trackId() )
+            result->setModificationTime( files_query.value( 1 ).toUInt() );
+            result->setSize( files_query.value( 2 ).toUInt() );
+            result->setMimetype( files_query.value( 4 ).toString() );
+            result->setBitrate( files_query.value( 6 ).toUInt() );
+            result->setRID( uuid() );
+            result->setCollection( s->dbCollection() );
+
+            for ( int k = 0; k < trackPairs.count(); k++ )
             {
-                result->setScore( trackPairs.at( k ).second );
-                break;
+                if ( trackPairs.at( k ).first == (int)track->trackId() )
+                {
+                    result->setScore( trackPairs.at( k ).second );
+                    break;
+                }
             }
-        }
 
-        res << result;
+            res << result;
+        }
     }
 
     emit results( m_query->id(), res );
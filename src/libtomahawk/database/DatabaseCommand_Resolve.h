@@ -41,6 +41,7 @@ public:
 
     virtual QString commandname() const { return "dbresolve"; }
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return InteractivePriority; }
 
     virtual void exec( DatabaseImpl *lib );
 
@@ -50,9 +50,8 @@ DatabaseCommand_TrendingTracks::exec( DatabaseImpl* dbi )
         limit = QString( "LIMIT 0, %1" ).arg( d->amount );
     }
 
-    QDateTime now = QDateTime::currentDateTime();
-    QDateTime _1WeekAgo = now.addDays( -7 );
-    QDateTime _2WeeksAgo = now.addDays( -14 );
+    // The rollups are per day (UTC)
+    const uint today = QDateTime::currentDateTimeUtc().toTime_t() / 86400;
 
     uint peersLastWeek = 1; // Use a default of 1 to be able to do certain mathematical computations without Div-by-0 Errors.
     {
@@ -61,10 +60,10 @@ DatabaseCommand_TrendingTracks::exec( DatabaseImpl* dbi )
 
         QString peersLastWeekSql = QString(
                     " SELECT COUNT(DISTINCT source ) "
-                    " FROM playback_log "
-                    " WHERE playback_log.source IS NOT NULL " // exclude self
-                    " AND playback_log.playtime >= %1 "
-                    ).arg( _1WeekAgo.toTime_t() );
+                    " FROM playback_stats_daily "
+                    " WHERE playback_stats_daily.source != 0 " // exclude self
+                    " AND playback_stats_daily.day > %1 "
+                    ).arg( today - 7 );
         TomahawkSqlQuery query = dbi->newquery();
         query.prepare( peersLastWeekSql );
         query.exec();
@@ -76,15 +75,15 @@ DatabaseCommand_TrendingTracks::exec( DatabaseImpl* dbi )
 
 
     QString timespanSql = QString(
-                " SELECT COUNT(*) as counter, track "
-                " FROM playback_log "
-                " WHERE playback_log.source IS NOT NULL " // exclude self
-                " AND playback_log.playtime >= %1 AND playback_log.playtime <= %2 "
-                " GROUP BY playback_log.track "
+                " SELECT SUM(plays) as counter, track "
+                " FROM playback_stats_daily "
+                " WHERE playback_stats_daily.source != 0 " // exclude self
+                " AND playback_stats_daily.day > %1 AND playback_stats_daily.day <= %2 "
+                " GROUP BY playback_stats_daily.track "
                 " HAVING counter > 0 "
                 );
-    QString lastWeekSql = timespanSql.arg( _1WeekAgo.toTime_t() ).arg( now.toTime_t() );
-    QString _1BeforeLastWeekSql = timespanSql.arg( _2WeeksAgo.toTime_t() ).arg( _1WeekAgo.toTime_t() );
+    QString lastWeekSql = timespanSql.arg( today - 7 ).arg( today );
+    QString _1BeforeLastWeekSql = timespanSql.arg( today - 14 ).arg( today - 7 );
     QString formula = QString(
                 " (  lastweek.counter /  weekbefore.counter ) "
                 " * "
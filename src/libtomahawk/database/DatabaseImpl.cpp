@@ -48,7 +48,14 @@
 */
 #include "Schema.sql.h"
 
-#define CURRENT_SCHEMA_VERSION 31
+#define CURRENT_SCHEMA_VERSION 32
+
+// Storage profile, see init() and setupStorage()
+#define DB_CACHE_SIZE_KB 8192                 // page cache per connection
+#define DB_MMAP_SIZE ( 64 * 1024 * 1024 )
+#define WAL_AUTOCHECKPOINT_PAGES 4000         // we checkpoint when idle, this is only a backstop
+#define INCREMENTAL_VACUUM_PAGES 512          // max pages freed per maintenance run
+#define STATEMENT_CACHE_SIZE 64               // prepared statements kept per connection
 
 Tomahawk::DatabaseImpl::DatabaseImpl( const QString& dbname )
 {
@@ -79,9 +86,9 @@ Tomahawk::DatabaseImpl::DatabaseImpl( const QString& dbname )
     }
 
     tLog() << "Database ID:" << m_dbid;
+    query.finish(); // VACUUM refuses to run with statements in progress
     init();
-    query.exec( "PRAGMA auto_vacuum = FULL" );
-    query.exec( "PRAGMA synchronous = NORMAL" );
+    setupStorage();
 
     tDebug( LOGVERBOSE ) << "Tweaked db pragmas:" << t.elapsed();
 
@@ -112,11 +119,81 @@ void
 Tomahawk::DatabaseImpl::init()
 {
     m_lastartid = m_lastalbid = m_lasttrkid = 0;
+    m_statements.setMaxCost( STATEMENT_CACHE_SIZE );
 
     TomahawkSqlQuery query = newquery();
 
      // make sqlite behave how we want:
     query.exec( "PRAGMA foreign_keys = ON" );
+
+    // These are per connection. synchronous = NORMAL is safe in WAL mode, a
+    // crash can only lose the last transactions, never corrupt the database.
+    query.exec( "PRAGMA synchronous = NORMAL" );
+    query.exec( QString( "PRAGMA cache_size = -%1" ).arg( DB_CACHE_SIZE_KB ) );
+    // Every connection maps the file on its own, 32-bit processes can't spare the address space
+    if ( sizeof( void* ) > 4 )
+        query.exec( QString( "PRAGMA mmap_size = %1" ).arg( DB_MMAP_SIZE ) );
+}
+
+
+void
+Tomahawk::DatabaseImpl::setupStorage()
+{
+    TomahawkSqlQuery query = newquery();
+
+    // With a WAL, readers don't block the writer and vice versa. The journal
+    // mode is persistent, so this only has to convert existing databases once.
+    query.exec( "PRAGMA journal_mode = WAL" );
+    if ( query.next() && query.value( 0 ).toString().toLower() != "wal" )
+        tLog() << "Could not switch database to WAL mode, using" << query.value( 0 ).toString();
+
+    query.exec( QString( "PRAGMA wal_autocheckpoint = %1" ).arg( WAL_AUTOCHECKPOINT_PAGES ) );
+
+    // Free pages are given back in the background (see maintenance()) instead
+    // of shuffling pages around on every delete, as auto_vacuum = FULL does.
+    query.exec( "PRAGMA auto_vacuum" );
+    const int autoVacuum = query.next() ? query.value( 0 ).toInt() : 0;
+    if ( autoVacuum != 2 /* INCREMENTAL */ )
+    {
+        query.exec( "PRAGMA auto_vacuum = INCREMENTAL" );
+
+        // Switching from FULL is free, a database without auto_vacuum has to be rebuilt once
+        if ( autoVacuum == 0 )
+        {
+            tLog() << "Enabling incremental vacuum for database, this may take a while...";
+            emit schemaUpdateStarted();
+
+            QTime t;
+            t.start();
+            if ( !query.exec( "VACUUM" ) )
+                tLog() << "Failed to vacuum database, staying without auto_vacuum";
+
+            tLog() << "Vacuumed database in" << t.elapsed() << "ms";
+            emit schemaUpdateDone();
+        }
+    }
+}
+
+
+void
+Tomahawk::DatabaseImpl::maintenance()
+{
+    TomahawkSqlQuery query = newquery();
+
+    // Move the WAL content into the database while nobody is writing, so it
+    // doesn't grow and readers don't have to search through it.
+    query.exec( "PRAGMA wal_checkpoint(PASSIVE)" );
+
+    query.exec( "PRAGMA freelist_count" );
+    const int freePages = query.next() ? query.value( 0 ).toInt() : 0;
+    if ( freePages > 0 )
+    {
+        tDebug( LOGVERBOSE ) << "Releasing free database pages:" << qMin( freePages, INCREMENTAL_VACUUM_PAGES ) << "of" << freePages;
+
+        // The pragma only frees pages while it is being stepped, so drain it
+        query.exec( QString( "PRAGMA incremental_vacuum(%1)" ).arg( INCREMENTAL_VACUUM_PAGES ) );
+        while ( query.next() );
+    }
 }
 
 
@@ -124,6 +201,8 @@ Tomahawk::DatabaseImpl::~DatabaseImpl()
 {
     tDebug() << "Shutting down database connection.";
 
+    m_statements.clear();
+
 /*
 #ifdef TOMAHAWK_QUERY_ANALYZE
     TomahawkSqlQuery q = newquery();
@@ -156,6 +235,41 @@ Tomahawk::DatabaseImpl::database()
 }
 
 
+TomahawkSqlQuery
+Tomahawk::DatabaseImpl::preparedQuery( const QString& sql )
+{
+    TomahawkSqlQuery* query = m_statements.object( sql );
+    if ( query )
+    {
+        // The previous user may not have fetched all rows
+        query->finish();
+    }
+    else
+    {
+        query = new TomahawkSqlQuery( m_db );
+        query->setForwardOnly( true );
+        query->prepare( sql );
+        m_statements.insert( sql, query );
+    }
+
+    m_activeStatements << sql;
+    return *query;
+}
+
+
+void
+Tomahawk::DatabaseImpl::finishQueries()
+{
+    foreach ( const QString& sql, m_activeStatements )
+    {
+        if ( TomahawkSqlQuery* query = m_statements.object( sql ) )
+            query->finish();
+    }
+
+    m_activeStatements.clear();
+}
+
+
 Tomahawk::DatabaseImpl*
 Tomahawk::DatabaseImpl::clone() const
 {
@@ -286,17 +400,17 @@ Tomahawk::result_ptr
 Tomahawk::DatabaseImpl::file( int fid )
 {
     Tomahawk::result_ptr r;
-    TomahawkSqlQuery query = newquery();
-    query.exec( QString( "SELECT url, mtime, size, md5, mimetype, duration, bitrate, "
-                         "file_join.artist, file_join.album, file_join.track, file_join.composer, "
-                         "(select name from artist where id = file_join.artist) as artname, "
-                         "(select name from album  where id = file_join.album)  as albname, "
-                         "(select name from track  where id = file_join.track)  as trkname, "
-                         "(select name from artist where id = file_join.composer) as cmpname, "
-                         "source "
-                         "FROM file, file_join "
-                         "WHERE file.id = file_join.file AND file.id = %1" )
-                .arg( fid ) );
+    TomahawkSqlQuery query = preparedQuery( "SELECT url, mtime, size, md5, mimetype, duration, bitrate, "
+                                            "file_join.artist, file_join.album, file_join.track, file_join.composer, "
+                                            "(select name from artist where id = file_join.artist) as artname, "
+                                            "(select name from album  where id = file_join.album)  as albname, "
+                                            "(select name from track  where id = file_join.track)  as trkname, "
+                                            "(select name from artist where id = file_join.composer) as cmpname, "
+                                            "source "
+                                            "FROM file, file_join "
+                                            "WHERE file.id = file_join.file AND file.id = ?" );
+    query.addBindValue( fid );
+    query.exec();
 
     if ( query.next() )
     {
@@ -334,14 +448,14 @@ Tomahawk::DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
     int id = 0;
     QString sortname = Tomahawk::DatabaseImpl::sortname( name_orig );
 
-    TomahawkSqlQuery query = newquery();
-    query.prepare( "SELECT id FROM artist WHERE sortname = ?" );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id FROM artist WHERE sortname = ?" );
     query.addBindValue( sortname );
     query.exec();
     if ( query.next() )
     {
         id = query.value( 0 ).toInt();
     }
+    query.finish();
     if ( id )
     {
         m_lastart = name_orig;
@@ -352,7 +466,7 @@ Tomahawk::DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
     if ( autoCreate )
     {
         // not found, insert it.
-        query.prepare( "INSERT INTO artist(id,name,sortname) VALUES(NULL,?,?)" );
+        query = preparedQuery( "INSERT INTO artist(id,name,sortname) VALUES(NULL,?,?)" );
         query.addBindValue( name_orig );
         query.addBindValue( sortname );
         if ( !query.exec() )
@@ -377,8 +491,7 @@ Tomahawk::DatabaseImpl::trackId( int artistid, const QString& name_orig, bool au
     QString sortname = Tomahawk::DatabaseImpl::sortname( name_orig );
     //if( ( id = m_artistcache[sortname] ) ) return id;
 
-    TomahawkSqlQuery query = newquery();
-    query.prepare( "SELECT id FROM track WHERE artist = ? AND sortname = ?" );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id FROM track WHERE artist = ? AND sortname = ?" );
     query.addBindValue( artistid );
     query.addBindValue( sortname );
     query.exec();
@@ -387,6 +500,7 @@ Tomahawk::DatabaseImpl::trackId( int artistid, const QString& name_orig, bool au
     {
         id = query.value( 0 ).toInt();
     }
+    query.finish();
     if ( id )
     {
         //m_trackcache[sortname]=id;
@@ -396,7 +510,7 @@ Tomahawk::DatabaseImpl::trackId( int artistid, const QString& name_orig, bool au
     if ( autoCreate )
     {
         // not found, insert it.
-        query.prepare( "INSERT INTO track(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
+        query = preparedQuery( "INSERT INTO track(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
         query.addBindValue( artistid );
         query.addBindValue( name_orig );
         query.addBindValue( sortname );
@@ -429,8 +543,7 @@ Tomahawk::DatabaseImpl::albumId( int artistid, const QString& name_orig, bool au
     QString sortname = Tomahawk::DatabaseImpl::sortname( name_orig );
     //if( ( id = m_albumcache[sortname] ) ) return id;
 
-    TomahawkSqlQuery query = newquery();
-    query.prepare( "SELECT id FROM album WHERE artist = ? AND sortname = ?" );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id FROM album WHERE artist = ? AND sortname = ?" );
     query.addBindValue( artistid );
     query.addBindValue( sortname );
     query.exec();
@@ -438,6 +551,7 @@ Tomahawk::DatabaseImpl::albumId( int artistid, const QString& name_orig, bool au
     {
         id = query.value( 0 ).toInt();
     }
+    query.finish();
     if ( id )
     {
         m_lastalb = name_orig;
@@ -448,7 +562,7 @@ Tomahawk::DatabaseImpl::albumId( int artistid, const QString& name_orig, bool au
     if ( autoCreate )
     {
         // not found, insert it.
-        query.prepare( "INSERT INTO album(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
+        query = preparedQuery( "INSERT INTO album(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
         query.addBindValue( artistid );
         query.addBindValue( name_orig );
         query.addBindValue( sortname );
@@ -522,10 +636,10 @@ Tomahawk::DatabaseImpl::getTrackFids( int tid )
 {
     QList< int > ret;
 
-    TomahawkSqlQuery query = newquery();
-    query.exec( QString( "SELECT file.id FROM file, file_join "
-                         "WHERE file_join.file=file.id "
-                         "AND file_join.track = %1 ").arg( tid ) );
+    TomahawkSqlQuery query = preparedQuery( "SELECT file.id FROM file, file_join "
+                                            "WHERE file_join.file=file.id "
+                                            "AND file_join.track = ?" );
+    query.addBindValue( tid );
     query.exec();
 
     while( query.next() )
@@ -552,8 +666,9 @@ Tomahawk::DatabaseImpl::sortname( const QString& str, bool replaceArticle )
 QVariantMap
 Tomahawk::DatabaseImpl::artist( int id )
 {
-    TomahawkSqlQuery query = newquery();
-    query.exec( QString( "SELECT id, name, sortname FROM artist WHERE id = %1" ).arg( id ) );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id, name, sortname FROM artist WHERE id = ?" );
+    query.addBindValue( id );
+    query.exec();
 
     QVariantMap m;
     if( !query.next() )
@@ -569,8 +684,9 @@ Tomahawk::DatabaseImpl::artist( int id )
 QVariantMap
 Tomahawk::DatabaseImpl::track( int id )
 {
-    TomahawkSqlQuery query = newquery();
-    query.exec( QString( "SELECT id, artist, name, sortname FROM track WHERE id = %1" ).arg( id ) );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id, artist, name, sortname FROM track WHERE id = ?" );
+    query.addBindValue( id );
+    query.exec();
 
     QVariantMap m;
     if( !query.next() )
@@ -587,8 +703,9 @@ Tomahawk::DatabaseImpl::track( int id )
 QVariantMap
 Tomahawk::DatabaseImpl::album( int id )
 {
-    TomahawkSqlQuery query = newquery();
-    query.exec( QString( "SELECT id, artist, name, sortname FROM album WHERE id = %1" ).arg( id ) );
+    TomahawkSqlQuery query = preparedQuery( "SELECT id, artist, name, sortname FROM album WHERE id = ?" );
+    query.addBindValue( id );
+    query.exec();
 
     QVariantMap m;
     if( !query.next() )
@@ -728,7 +845,8 @@ Tomahawk::DatabaseImpl::openDatabase( const QString& dbname, bool checkSchema )
     {
         QSqlDatabase db = QSqlDatabase::addDatabase( "QSQLITE", connName );
         db.setDatabaseName( dbname );
-        db.setConnectOptions( "QSQLITE_ENABLE_SHARED_CACHE=1" );
+        // No shared cache: it serializes all connections on table locks, which
+        // would defeat WAL's concurrent readers
         if ( !db.open() )
         {
             tLog() << "Failed to open database" << dbname;
@@ -750,6 +868,11 @@ Tomahawk::DatabaseImpl::openDatabase( const QString& dbname, bool checkSchema )
 
         if ( version < 0 || version == CURRENT_SCHEMA_VERSION )
             m_db = db;
+        else
+        {
+            // Make sure the backup copy below contains everything that is still in the WAL
+            QSqlQuery( db ).exec( "PRAGMA wal_checkpoint(FULL)" );
+        }
     }
 
     if ( version > 0 && version != CURRENT_SCHEMA_VERSION )
@@ -780,6 +903,8 @@ Tomahawk::DatabaseImpl::openDatabase( const QString& dbname, bool checkSchema )
     }
     else if ( version < 0 )
     {
+            // Has to be set before the first table is created
+            newquery().exec( "PRAGMA auto_vacuum = INCREMENTAL" );
             schemaUpdated = updateSchema( 0 );
     }
 
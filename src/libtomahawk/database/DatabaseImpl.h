@@ -22,6 +22,7 @@
 #define DATABASEIMPL_H
 
 #include <QObject>
+#include <QCache>
 #include <QList>
 #include <QMutex>
 #include <QPair>
@@ -31,6 +32,7 @@
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QHash>
+#include <QSet>
 #include <QThread>
 
 #include "DllMacro.h"
@@ -60,6 +62,16 @@ public:
     TomahawkSqlQuery newquery();
     QSqlDatabase& database();
 
+    /**
+     * Returns a query for @p sql from this connection's statement cache, so it only
+     * gets parsed the first time. Bind values and exec() it as usual, but don't keep
+     * it around while running the same sql again: all copies share one statement.
+     */
+    TomahawkSqlQuery preparedQuery( const QString& sql );
+
+    /// Resets the statements handed out since the last call, so none of them keeps a read transaction open.
+    void finishQueries();
+
     int artistId( const QString& name_orig, bool autoCreate ); //also for composers!
     int trackId( int artistid, const QString& name_orig, bool autoCreate );
     int albumId( int artistid, const QString& name_orig, bool autoCreate );
@@ -85,6 +97,9 @@ public:
 
     void loadIndex();
 
+    /// Checkpoints the WAL and releases some free pages. Call this on the writing connection when idle.
+    void maintenance();
+
 signals:
     void indexReady();
     void schemaUpdateStarted();
@@ -97,6 +112,7 @@ private:
     void setDatabaseID( const QString& dbid ) { m_dbid = dbid; }
 
     void init();
+    void setupStorage();
     bool openDatabase( const QString& dbname, bool checkSchema = true );
     bool updateSchema( int oldVersion );
     void dumpDatabase();
@@ -105,6 +121,10 @@ private:
     bool m_ready;
     QSqlDatabase m_db;
 
+    // Only used from the thread owning this connection
+    QCache< QString, TomahawkSqlQuery > m_statements;
+    QSet< QString > m_activeStatements;
+
     QString m_lastart, m_lastalb, m_lasttrk;
     int m_lastartid, m_lastalbid, m_lasttrkid;
 
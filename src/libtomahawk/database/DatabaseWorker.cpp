@@ -19,8 +19,9 @@
 
 #include "DatabaseWorker.h"
 
-#include "utils/Json.h"
+#include "network/Msg.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 
 #include "Database.h"
 #include "DatabaseImpl.h"
@@ -37,14 +38,71 @@
     //#define DEBUG_TIMING TRUE
 #endif
 
+// Run database maintenance after the RW worker has been idle for this long
+#define IDLE_MAINTENANCE_INTERVAL 5000
+
 
 namespace Tomahawk
 {
 
-DatabaseWorkerThread::DatabaseWorkerThread( Database* db, bool mutates )
+void
+DatabaseWorkQueue::enqueue( const Tomahawk::dbcmd_ptr& cmd )
+{
+    QMutexLocker lock( &m_mutex );
+    m_commands[ cmd->priority() ] << cmd;
+
+    while ( !m_idleWorkers.isEmpty() )
+    {
+        QPointer< DatabaseWorker > worker = m_idleWorkers.takeFirst();
+        if ( worker )
+        {
+            QMetaObject::invokeMethod( worker.data(), "doWork", Qt::QueuedConnection );
+            break;
+        }
+    }
+}
+
+
+Tomahawk::dbcmd_ptr
+DatabaseWorkQueue::take( DatabaseWorker* worker )
+{
+    QMutexLocker lock( &m_mutex );
+
+    for ( int i = 0; i < DatabaseCommand::PriorityCount; i++ )
+    {
+        if ( !m_commands[ i ].isEmpty() )
+        {
+            m_idleWorkers.removeAll( worker );
+            return m_commands[ i ].takeFirst();
+        }
+    }
+
+    // Checked and registered under the same lock, so no enqueue() can slip through
+    if ( !m_idleWorkers.contains( worker ) )
+        m_idleWorkers << worker;
+
+    return Tomahawk::dbcmd_ptr();
+}
+
+
+int
+DatabaseWorkQueue::count() const
+{
+    QMutexLocker lock( &m_mutex );
+
+    int count = 0;
+    for ( int i = 0; i < DatabaseCommand::PriorityCount; i++ )
+        count += m_commands[ i ].count();
+
+    return count;
+}
+
+
+DatabaseWorkerThread::DatabaseWorkerThread( Database* db, bool mutates, DatabaseWorkQueue* queue )
     : QThread()
     , m_db( db )
     , m_mutates( mutates )
+    , m_queue( queue )
 {
     m_startupMutex.lock();
 }
@@ -54,7 +112,7 @@ void
 DatabaseWorkerThread::run()
 {
     tDebug() << Q_FUNC_INFO << "DatabaseWorkerThread starting...";
-    m_worker = QPointer< DatabaseWorker >( new DatabaseWorker( m_db, m_mutates ) );
+    m_worker = QPointer< DatabaseWorker >( new DatabaseWorker( m_db, m_mutates, m_queue ) );
     m_startupMutex.unlock();
     exec();
     tDebug() << Q_FUNC_INFO << "DatabaseWorkerThread finishing...";
@@ -84,12 +142,26 @@ DatabaseWorkerThread::waitForEventLoopStart()
 }
 
 
-DatabaseWorker::DatabaseWorker( Database* db, bool mutates )
+DatabaseWorker::DatabaseWorker( Database* db, bool mutates, DatabaseWorkQueue* queue )
     : QObject()
     , m_db( db )
     , m_outstanding( 0 )
+    , m_mutates( mutates )
+    , m_idleTimer( 0 )
+    , m_queue( queue )
 {
-    Q_UNUSED( mutates );
+    if ( m_mutates )
+    {
+        m_idleTimer = new QTimer( this );
+        m_idleTimer->setSingleShot( true );
+        m_idleTimer->setInterval( IDLE_MAINTENANCE_INTERVAL );
+        connect( m_idleTimer, SIGNAL( timeout() ), SLOT( onIdle() ) );
+    }
+
+    // Pick up whatever got queued before we were ready, or register as idle
+    if ( m_queue )
+        QTimer::singleShot( 0, this, SLOT( doWork() ) );
+
     tDebug() << Q_FUNC_INFO << "New db connection with name:" << Database::instance()->impl()->database().connectionName() << "on thread" << this->thread();
 }
 
@@ -148,8 +220,21 @@ DatabaseWorker::doWork()
     timer.start();
 #endif
 
+    if ( m_idleTimer )
+        m_idleTimer->stop();
+
     QList< Tomahawk::dbcmd_ptr > cmdGroup;
     Tomahawk::dbcmd_ptr cmd;
+    if ( m_queue )
+    {
+        cmd = m_queue->take( this );
+        if ( cmd.isNull() )
+            return;
+
+        QMutexLocker lock( &m_mut );
+        m_outstanding++;
+    }
+    else
     {
         QMutexLocker lock( &m_mut );
         cmd = m_commands.takeFirst();
@@ -172,6 +257,7 @@ DatabaseWorker::doWork()
             {
                 completed++;
                 cmd->_exec( impl ); // runs actual SQL stuff
+                recordMetrics( cmd );
 
                 if ( cmd->loggable() )
                 {
@@ -194,8 +280,7 @@ DatabaseWorker::doWork()
                         //
                         if ( !cmd->singletonCmd() )
                         {
-                            TomahawkSqlQuery query = impl->newquery();
-                            query.prepare( "UPDATE source SET lastop = ? WHERE id = ?" );
+                            TomahawkSqlQuery query = impl->preparedQuery( "UPDATE source SET lastop = ? WHERE id = ?" );
                             query.addBindValue( cmd->guid() );
                             query.addBindValue( cmd->source()->id() );
 
@@ -224,6 +309,9 @@ DatabaseWorker::doWork()
                     finished = true;
             }
 
+            // Cached statements left mid-result would keep their read snapshot open
+            impl->finishQueries();
+
             if ( cmd->doesMutates() )
             {
                 qDebug() << "Committing" << cmd->commandname() << cmd->guid();
@@ -277,8 +365,41 @@ DatabaseWorker::doWork()
 
     QMutexLocker lock( &m_mut );
     m_outstanding -= completed;
-    if ( m_outstanding > 0 )
+    if ( m_outstanding > 0 || m_queue )
         QTimer::singleShot( 0, this, SLOT( doWork() ) );
+    else if ( m_idleTimer )
+        m_idleTimer->start();
+}
+
+
+void
+DatabaseWorker::onIdle()
+{
+    {
+        QMutexLocker lock( &m_mut );
+        if ( m_outstanding > 0 )
+            return;
+    }
+
+    Database::instance()->impl()->maintenance();
+}
+
+
+void
+DatabaseWorker::recordMetrics( const Tomahawk::dbcmd_ptr& cmd )
+{
+    const QMetaObject* metaObject = cmd->metaObject();
+
+    QHash< const QMetaObject*, QPair< Histogram*, Histogram* > >::const_iterator it = m_commandMetrics.constFind( metaObject );
+    if ( it == m_commandMetrics.constEnd() )
+    {
+        const QString className = QString::fromLatin1( metaObject->className() );
+        it = m_commandMetrics.insert( metaObject, qMakePair( Metrics::instance()->histogram( "database_command_queue_ms", "command", className ),
+                                                             Metrics::instance()->histogram( "database_command_exec_ms", "command", className ) ) );
+    }
+
+    it.value().first->record( cmd->queueTime() );
+    it.value().second->record( cmd->execTime() );
 }
 
 
@@ -286,13 +407,11 @@ DatabaseWorker::doWork()
 void
 DatabaseWorker::logOp( DatabaseCommandLoggable* command )
 {
-    TomahawkSqlQuery oplogquery = Database::instance()->impl()->newquery();
     tLog( LOGVERBOSE ) << "INSERTING INTO OPLOG:" << command->source()->id() << command->guid() << command->commandname();
-    oplogquery.prepare( "INSERT INTO oplog(source, guid, command, singleton, compressed, json) "
-                        "VALUES(?, ?, ?, ?, ?, ?)" );
+    TomahawkSqlQuery oplogquery = Database::instance()->impl()->preparedQuery( "INSERT INTO oplog(source, guid, command, singleton, compressed, json) "
+                                                                               "VALUES(?, ?, ?, ?, ?, ?)" );
 
-    QVariantMap variant = TomahawkUtils::qobject2qvariant( command );
-    QByteArray ba = TomahawkUtils::toJson( variant );
+    QByteArray ba = command->serialize();
 
     bool compressed = false;
     if ( ba.length() >= 512 )
@@ -300,7 +419,8 @@ DatabaseWorker::logOp( DatabaseCommandLoggable* command )
         // We need to compress this in this thread, since inserting into the log
         // has to happen as part of the same transaction as the dbcmd.
         // (we are in a worker thread for RW dbcmds anyway, so it's ok)
-        ba = qCompress( ba, 9 );
+        // Stored and forwarded as-is, so this has to stay zlib for older peers
+        ba = Msg::compress( ba, Msg::COMPRESSED );
         compressed = true;
     }
 
@@ -22,23 +22,56 @@
 #include <QObject>
 #include <QThread>
 #include <QMutex>
+#include <QHash>
 #include <QList>
 #include <QPointer>
 
 #include "DatabaseCommand.h"
+#include "DllMacro.h"
+
+class QTimer;
 
 namespace Tomahawk
 {
 
 class Database;
 class DatabaseCommandLoggable;
+class DatabaseWorker;
+class Histogram;
+
+/**
+ * The queue shared by all read-only DatabaseWorkers.
+ *
+ * Commands aren't assigned to a worker up front: whichever worker is free
+ * takes the next one, so a slow command only ever blocks its own worker.
+ * Commands are taken by priority, then in the order they were enqueued.
+ */
+class DLLEXPORT DatabaseWorkQueue
+{
+public:
+    DatabaseWorkQueue() {}
+
+    /// Queues @p cmd and wakes up an idle worker, if there is one.
+    void enqueue( const Tomahawk::dbcmd_ptr& cmd );
+
+    /// Returns the next command, or a null pointer after registering @p worker as idle.
+    Tomahawk::dbcmd_ptr take( DatabaseWorker* worker );
+
+    int count() const;
+
+private:
+    mutable QMutex m_mutex;
+    QList< Tomahawk::dbcmd_ptr > m_commands[ DatabaseCommand::PriorityCount ];
+    QList< QPointer< DatabaseWorker > > m_idleWorkers;
+};
 
 class DatabaseWorker : public QObject
 {
 Q_OBJECT
 
 public:
-    DatabaseWorker( Database* db, bool mutates );
+    /// Read-only workers take their commands from @p queue.
+    DatabaseWorker( Database* db, bool mutates, DatabaseWorkQueue* queue = 0 );
     ~DatabaseWorker();
 
     bool busy() const { return m_outstanding > 0; }
@@ -50,14 +83,24 @@ public slots:
 
 private slots:
     void doWork();
+    void onIdle();
 
 private:
     void logOp( DatabaseCommandLoggable* command );
+    /// Records queue and exec time of @p cmd in the Metrics registry.
+    void recordMetrics( const Tomahawk::dbcmd_ptr& cmd );
 
     QMutex m_mut;
     Database* m_db;
     QList< Tomahawk::dbcmd_ptr > m_commands;
     int m_outstanding;
+
+    bool m_mutates;
+    QTimer* m_idleTimer;
+    DatabaseWorkQueue* m_queue;
+
+    // Histograms per command class, looked up once
+    QHash< const QMetaObject*, QPair< Histogram*, Histogram* > > m_commandMetrics;
 };
 
 class DatabaseWorkerThread : public QThread
@@ -65,7 +108,7 @@ class DatabaseWorkerThread : public QThread
 Q_OBJECT
 
 public:
-    DatabaseWorkerThread( Database* db, bool mutates );
+    DatabaseWorkerThread( Database* db, bool mutates, DatabaseWorkQueue* queue = 0 );
     ~DatabaseWorkerThread();
 
     QPointer< DatabaseWorker > worker() const;
@@ -84,6 +127,7 @@ private:
     QPointer< DatabaseWorker > m_worker;
     Database* m_db;
     bool m_mutates;
+    DatabaseWorkQueue* m_queue;
 
     /**
      * Locks until we've started the event loop.
@@ -0,0 +1,185 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScannedFile.h"
+
+#include "utils/JsonWriter.h"
+
+using namespace Tomahawk;
+
+
+void
+ScannedFileBatch::reserve( int size )
+{
+    ids.reserve( size );
+    urls.reserve( size );
+    mtimes.reserve( size );
+    sizes.reserve( size );
+    hashes.reserve( size );
+    mimetypes.reserve( size );
+    durations.reserve( size );
+    bitrates.reserve( size );
+    artists.reserve( size );
+    albums.reserve( size );
+    tracks.reserve( size );
+    albumArtists.reserve( size );
+    composers.reserve( size );
+    albumpos.reserve( size );
+    discnumbers.reserve( size );
+    years.reserve( size );
+}
+
+
+void
+ScannedFileBatch::append( const ScannedFile& file )
+{
+    ids << 0;
+    urls << file.url;
+    mtimes << file.mtime;
+    sizes << file.size;
+    hashes << file.hash;
+    mimetypes << file.mimetype;
+    durations << file.duration;
+    bitrates << file.bitrate;
+    artists << file.artist;
+    albums << file.album;
+    tracks << file.track;
+    albumArtists << file.albumArtist;
+    composers << file.composer;
+    albumpos << file.albumpos;
+    discnumbers << file.discnumber;
+    years << file.year;
+}
+
+
+ScannedFile
+ScannedFileBatch::at( int i ) const
+{
+    ScannedFile file;
+    file.url = urls.at( i );
+    file.mtime = mtimes.at( i );
+    file.size = sizes.at( i );
+    file.hash = hashes.at( i );
+    file.mimetype = mimetypes.at( i );
+    file.duration = durations.at( i );
+    file.bitrate = bitrates.at( i );
+    file.artist = artists.at( i );
+    file.album = albums.at( i );
+    file.track = tracks.at( i );
+    file.albumArtist = albumArtists.at( i );
+    file.composer = composers.at( i );
+    file.albumpos = albumpos.at( i );
+    file.discnumber = discnumbers.at( i );
+    file.year = years.at( i );
+
+    return file;
+}
+
+
+QVariantList
+ScannedFileBatch::toVariantList( bool stripUrls ) const
+{
+    QVariantList list;
+    list.reserve( count() );
+
+    for ( int i = 0; i < count(); i++ )
+    {
+        QVariantMap m;
+        m[ "id" ]          = ids.at( i );
+        m[ "url" ]         = stripUrls ? QString::number( ids.at( i ) ) : urls.at( i );
+        m[ "mtime" ]       = mtimes.at( i );
+        m[ "size" ]        = sizes.at( i );
+        m[ "hash" ]        = hashes.at( i );
+        m[ "mimetype" ]    = mimetypes.at( i );
+        m[ "duration" ]    = durations.at( i );
+        m[ "bitrate" ]     = bitrates.at( i );
+        m[ "artist" ]      = artists.at( i );
+        m[ "album" ]       = albums.at( i );
+        m[ "track" ]       = tracks.at( i );
+        m[ "albumartist" ] = albumArtists.at( i );
+        m[ "composer" ]    = composers.at( i );
+        m[ "albumpos" ]    = albumpos.at( i );
+        m[ "discnumber" ]  = discnumbers.at( i );
+        m[ "year" ]        = years.at( i );
+        list << m;
+    }
+
+    return list;
+}
+
+
+ScannedFileBatch
+ScannedFileBatch::fromVariantList( const QVariantList& files )
+{
+    ScannedFileBatch batch;
+    batch.reserve( files.count() );
+
+    foreach ( const QVariant& v, files )
+    {
+        const QVariantMap m = v.toMap();
+
+        ScannedFile file;
+        file.url         = m.value( "url" ).toString();
+        file.mtime       = m.value( "mtime" ).toUInt();
+        file.size        = m.value( "size" ).toUInt();
+        file.hash        = m.value( "hash" ).toString();
+        file.mimetype    = m.value( "mimetype" ).toString();
+        file.duration    = m.value( "duration" ).toUInt();
+        file.bitrate     = m.value( "bitrate" ).toUInt();
+        file.artist      = m.value( "artist" ).toString();
+        file.album       = m.value( "album" ).toString();
+        file.track       = m.value( "track" ).toString();
+        file.albumArtist = m.value( "albumartist" ).toString();
+        file.composer    = m.value( "composer" ).toString();
+        file.albumpos    = m.value( "albumpos" ).toUInt();
+        file.discnumber  = m.value( "discnumber" ).toUInt();
+        file.year        = m.value( "year" ).toInt();
+
+        batch.append( file );
+        batch.ids.last() = m.value( "id" ).toUInt();
+    }
+
+    return batch;
+}
+
+
+void
+ScannedFileBatch::write( TomahawkUtils::JsonWriter& writer, const char* key ) const
+{
+    writer.beginArray( key );
+    for ( int i = 0; i < count(); i++ )
+    {
+        writer.beginObject();
+        writer.write( "album", albums.at( i ) );
+        writer.write( "albumartist", albumArtists.at( i ) );
+        writer.write( "albumpos", albumpos.at( i ) );
+        writer.write( "artist", artists.at( i ) );
+        writer.write( "bitrate", bitrates.at( i ) );
+        writer.write( "composer", composers.at( i ) );
+        writer.write( "discnumber", discnumbers.at( i ) );
+        writer.write( "duration", durations.at( i ) );
+        writer.write( "hash", hashes.at( i ) );
+        writer.write( "id", ids.at( i ) );
+        writer.write( "mimetype", mimetypes.at( i ) );
+        writer.write( "mtime", mtimes.at( i ) );
+        writer.write( "size", sizes.at( i ) );
+        writer.write( "track", tracks.at( i ) );
+        writer.write( "url", QString::number( ids.at( i ) ) );
+        writer.write( "year", years.at( i ) );
+        writer.endObject();
+    }
+    writer.endArray();
+}
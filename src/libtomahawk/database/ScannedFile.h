@@ -0,0 +1,113 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCANNEDFILE_H
+#define SCANNEDFILE_H
+
+#include "DllMacro.h"
+
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+namespace TomahawkUtils
+{
+    class JsonWriter;
+}
+
+namespace Tomahawk
+{
+
+/// Metadata of a single file, as read by the MusicScanner.
+struct DLLEXPORT ScannedFile
+{
+    ScannedFile()
+        : mtime( 0 ), size( 0 ), duration( 0 ), bitrate( 0 )
+        , albumpos( 0 ), discnumber( 0 ), year( 0 )
+    {}
+
+    bool isNull() const { return url.isEmpty(); }
+
+    QString url;
+    unsigned int mtime;
+    unsigned int size;
+    QString hash;
+    QString mimetype;
+    unsigned int duration;
+    unsigned int bitrate;
+    QString artist;
+    QString album;
+    QString track;
+    QString albumArtist;
+    QString composer;
+    unsigned int albumpos;
+    unsigned int discnumber;
+    int year;
+};
+
+
+/**
+ * A batch of scanned files, stored column by column.
+ *
+ * This is what the MusicScanner hands to DatabaseCommand_AddFiles. All columns
+ * are implicitly shared, so a batch can be passed on (and across threads)
+ * without copying the data, as long as the sender drops its own reference.
+ *
+ * The QVariant representation is only needed for the Collection API and for
+ * peers running an older version, see toVariantList() / fromVariantList().
+ */
+class DLLEXPORT ScannedFileBatch
+{
+public:
+    ScannedFileBatch() {}
+
+    int count() const { return urls.count(); }
+    bool isEmpty() const { return urls.isEmpty(); }
+
+    void reserve( int size );
+    void append( const ScannedFile& file );
+    ScannedFile at( int i ) const;
+
+    /// @p stripUrls replaces file urls with the file ids, we don't leak file paths over the network.
+    QVariantList toVariantList( bool stripUrls = false ) const;
+    static ScannedFileBatch fromVariantList( const QVariantList& files );
+
+    /// Writes the batch as the JSON array toVariantList( true ) would result in.
+    void write( TomahawkUtils::JsonWriter& writer, const char* key ) const;
+
+    // File ids, only known once the files were added to the database
+    QVector< unsigned int > ids;
+
+    QVector< QString > urls;
+    QVector< unsigned int > mtimes;
+    QVector< unsigned int > sizes;
+    QVector< QString > hashes;
+    QVector< QString > mimetypes;
+    QVector< unsigned int > durations;
+    QVector< unsigned int > bitrates;
+    QVector< QString > artists;
+    QVector< QString > albums;
+    QVector< QString > tracks;
+    QVector< QString > albumArtists;
+    QVector< QString > composers;
+    QVector< unsigned int > albumpos;
+    QVector< unsigned int > discnumbers;
+    QVector< int > years;
+};
+
+}
+
+#endif // SCANNEDFILE_H
@@ -278,6 +278,22 @@ CREATE INDEX playback_log_source ON playback_log(source);
 CREATE INDEX playback_log_track ON playback_log(track);
 CREATE INDEX playback_log_playtime ON playback_log(playtime);
 
+-- per-day playback counts, maintained alongside playback_log by DatabaseCommand_LogPlayback
+-- source 0 is this machine, day is the playtime in days since the epoch (UTC)
+CREATE TABLE IF NOT EXISTS playback_stats_daily (
+    day INTEGER NOT NULL,
+    source INTEGER NOT NULL DEFAULT 0,
+    track INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,
+    artist INTEGER NOT NULL REFERENCES artist(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,
+    plays INTEGER NOT NULL DEFAULT 0,
+    secs_played INTEGER NOT NULL DEFAULT 0,
+    PRIMARY KEY (day, source, track)
+);
+
+CREATE INDEX playback_stats_daily_track ON playback_stats_daily(track, day);
+CREATE INDEX playback_stats_daily_artist ON playback_stats_daily(artist, day);
+CREATE INDEX playback_stats_daily_source ON playback_stats_daily(source, day);
+
 
 
 -- auth information for http clients
@@ -300,4 +316,4 @@ CREATE TABLE IF NOT EXISTS settings (
     v TEXT NOT NULL DEFAULT ''
 );
 
-INSERT INTO settings(k,v) VALUES('schema_version', '31');
+INSERT INTO settings(k,v) VALUES('schema_version', '32');
@@ -1,5 +1,5 @@
 /*
-    This file was automatically generated from ./Schema.sql on Tue Jul 30 12:51:06 CEST 2013.
+    This file was automatically generated from ./Schema.sql on Mon Oct 19 01:03:08 UTC 2026.
 */
 
 static const char * tomahawk_schema_sql = 
@@ -185,6 +185,18 @@ static const char * tomahawk_schema_sql =
 "CREATE INDEX playback_log_source ON playback_log(source);"
 "CREATE INDEX playback_log_track ON playback_log(track);"
 "CREATE INDEX playback_log_playtime ON playback_log(playtime);"
+"CREATE TABLE IF NOT EXISTS playback_stats_daily ("
+"    day INTEGER NOT NULL,"
+"    source INTEGER NOT NULL DEFAULT 0,"
+"    track INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,"
+"    artist INTEGER NOT NULL REFERENCES artist(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,"
+"    plays INTEGER NOT NULL DEFAULT 0,"
+"    secs_played INTEGER NOT NULL DEFAULT 0,"
+"    PRIMARY KEY (day, source, track)"
+");"
+"CREATE INDEX playback_stats_daily_track ON playback_stats_daily(track, day);"
+"CREATE INDEX playback_stats_daily_artist ON playback_stats_daily(artist, day);"
+"CREATE INDEX playback_stats_daily_source ON playback_stats_daily(source, day);"
 "CREATE TABLE IF NOT EXISTS http_client_auth ("
 "    token TEXT NOT NULL PRIMARY KEY,"
 "    website TEXT NOT NULL,"
@@ -197,7 +209,7 @@ static const char * tomahawk_schema_sql =
 "    k TEXT NOT NULL PRIMARY KEY,"
 "    v TEXT NOT NULL DEFAULT ''"
 ");"
-"INSERT INTO settings(k,v) VALUES('schema_version', '31');"
+"INSERT INTO settings(k,v) VALUES('schema_version', '32');"
     ;
 
 const char * get_tomahawk_sql()
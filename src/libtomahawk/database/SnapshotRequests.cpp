@@ -0,0 +1,98 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SnapshotRequests.h"
+
+#include "Album.h"
+#include "Artist.h"
+#include "Query.h"
+
+using namespace Tomahawk;
+
+
+SnapshotArtistsRequest::SnapshotArtistsRequest( const collectionsnapshot_ptr& snapshot )
+    : QObject()
+    , m_snapshot( snapshot )
+{
+}
+
+
+void
+SnapshotArtistsRequest::enqueue()
+{
+    QMetaObject::invokeMethod( this, "exec", Qt::QueuedConnection );
+}
+
+
+void
+SnapshotArtistsRequest::exec()
+{
+    emit artists( m_snapshot->artists( m_filter ) );
+    emit done();
+
+    deleteLater();
+}
+
+
+SnapshotAlbumsRequest::SnapshotAlbumsRequest( const collectionsnapshot_ptr& snapshot, const artist_ptr& artist )
+    : QObject()
+    , m_snapshot( snapshot )
+    , m_artist( artist )
+{
+}
+
+
+void
+SnapshotAlbumsRequest::enqueue()
+{
+    QMetaObject::invokeMethod( this, "exec", Qt::QueuedConnection );
+}
+
+
+void
+SnapshotAlbumsRequest::exec()
+{
+    emit albums( m_snapshot->albums( m_artist, m_filter ) );
+    emit done();
+
+    deleteLater();
+}
+
+
+SnapshotTracksRequest::SnapshotTracksRequest( const collectionsnapshot_ptr& snapshot, const collection_ptr& collection, const album_ptr& album )
+    : QObject()
+    , m_snapshot( snapshot )
+    , m_collection( collection )
+    , m_album( album )
+{
+}
+
+
+void
+SnapshotTracksRequest::enqueue()
+{
+    QMetaObject::invokeMethod( this, "exec", Qt::QueuedConnection );
+}
+
+
+void
+SnapshotTracksRequest::exec()
+{
+    emit tracks( m_snapshot->tracks( m_album, m_collection ) );
+    emit done( m_collection );
+
+    deleteLater();
+}
@@ -0,0 +1,107 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_SNAPSHOTREQUESTS_H
+#define TOMAHAWK_SNAPSHOTREQUESTS_H
+
+#include "collection/AlbumsRequest.h"
+#include "collection/ArtistsRequest.h"
+#include "collection/TracksRequest.h"
+#include "database/CollectionSnapshot.h"
+#include "Typedefs.h"
+
+#include "DllMacro.h"
+
+#include <QObject>
+
+namespace Tomahawk
+{
+
+/*
+ * Requests answered from a DatabaseCollection's CollectionSnapshot. They
+ * emit their result once control returns to the event loop, as the callers
+ * only connect to them before calling enqueue(), and delete themselves then.
+ */
+
+class DLLEXPORT SnapshotArtistsRequest : public QObject, public Tomahawk::ArtistsRequest
+{
+Q_OBJECT
+public:
+    explicit SnapshotArtistsRequest( const Tomahawk::collectionsnapshot_ptr& snapshot );
+
+    virtual void enqueue();
+    virtual void setFilter( const QString& filter ) { m_filter = filter; }
+
+signals:
+    void artists( const QList< Tomahawk::artist_ptr >& );
+    void done();
+
+private slots:
+    void exec();
+
+private:
+    Tomahawk::collectionsnapshot_ptr m_snapshot;
+    QString m_filter;
+};
+
+
+class DLLEXPORT SnapshotAlbumsRequest : public QObject, public Tomahawk::AlbumsRequest
+{
+Q_OBJECT
+public:
+    SnapshotAlbumsRequest( const Tomahawk::collectionsnapshot_ptr& snapshot, const Tomahawk::artist_ptr& artist );
+
+    virtual void enqueue();
+    virtual void setFilter( const QString& filter ) { m_filter = filter; }
+
+signals:
+    void albums( const QList< Tomahawk::album_ptr >& );
+    void done();
+
+private slots:
+    void exec();
+
+private:
+    Tomahawk::collectionsnapshot_ptr m_snapshot;
+    Tomahawk::artist_ptr m_artist;
+    QString m_filter;
+};
+
+
+class DLLEXPORT SnapshotTracksRequest : public QObject, public Tomahawk::TracksRequest
+{
+Q_OBJECT
+public:
+    SnapshotTracksRequest( const Tomahawk::collectionsnapshot_ptr& snapshot, const Tomahawk::collection_ptr& collection, const Tomahawk::album_ptr& album );
+
+    virtual void enqueue();
+
+signals:
+    void tracks( const QList< Tomahawk::query_ptr >& );
+    void done( const Tomahawk::collection_ptr& );
+
+private slots:
+    void exec();
+
+private:
+    Tomahawk::collectionsnapshot_ptr m_snapshot;
+    Tomahawk::collection_ptr m_collection;
+    Tomahawk::album_ptr m_album;
+};
+
+}
+
+#endif // TOMAHAWK_SNAPSHOTREQUESTS_H
@@ -23,6 +23,7 @@
 #include "database/DatabaseImpl.h"
 #include "utils/TomahawkUtils.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 #include "Source.h"
 
 #include <QCoreApplication>
@@ -33,6 +34,9 @@
 
 #define QUERY_THRESHOLD 60
 
+// Looked up during static initialization, before any query can run
+static Tomahawk::Counter* s_slowQueries = Tomahawk::Metrics::instance()->counter( "database_slow_queries_total" );
+
 
 TomahawkSqlQuery::TomahawkSqlQuery()
     : QSqlQuery()
@@ -115,6 +119,8 @@ TomahawkSqlQuery::exec()
         showError();
 
     int e = t.elapsed();
+    if ( e >= QUERY_THRESHOLD )
+        s_slowQueries->add();
     if ( log || e >= QUERY_THRESHOLD )
         tLog( LOGSQL ) << "TomahawkSqlQuery::exec (" << t.elapsed() << "ms ):" << lastQuery();
 
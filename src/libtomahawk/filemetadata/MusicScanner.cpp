@@ -193,8 +193,8 @@ MusicScanner::scan()
 {
     tDebug( LOGVERBOSE ) << "Num saved file mtimes from last scan:" << m_filemtimes.size();
 
-    connect( this, SIGNAL( batchReady( QVariantList, QVariantList ) ),
-                     SLOT( commitBatch( QVariantList, QVariantList ) ), Qt::DirectConnection );
+    connect( this, SIGNAL( batchReady( Tomahawk::ScannedFileBatch, QVariantList ) ),
+                     SLOT( commitBatch( Tomahawk::ScannedFileBatch, QVariantList ) ), Qt::DirectConnection );
 
     if ( m_scanMode == MusicScanner::FileScan )
     {
@@ -243,12 +243,10 @@ MusicScanner::postOps()
     foreach ( const QString& s, m_skippedFiles )
         tDebug( LOGEXTRA ) << s;
 
-    if ( m_filesToDelete.length() || m_scannedfiles.length() )
+    if ( m_filesToDelete.length() || m_scannedfiles.count() )
     {
         SourceList::instance()->getLocal()->updateIndexWhenSynced();
-        commitBatch( m_scannedfiles, m_filesToDelete );
-        m_scannedfiles.clear();
-        m_filesToDelete.clear();
+        flushBatch();
     }
 
     if ( !m_cmdQueue )
@@ -274,7 +272,23 @@ MusicScanner::cleanup()
 
 
 void
-MusicScanner::commitBatch( const QVariantList& tracks, const QVariantList& deletethese )
+MusicScanner::flushBatch()
+{
+    // Hand the batch over without keeping a reference, so nobody has to detach (copy) it
+    Tomahawk::ScannedFileBatch tracks = m_scannedfiles;
+    QVariantList deletethese = m_filesToDelete;
+    m_scannedfiles = Tomahawk::ScannedFileBatch();
+    m_filesToDelete.clear();
+
+    if ( m_batchsize > 0 )
+        m_scannedfiles.reserve( m_batchsize );
+
+    emit batchReady( tracks, deletethese );
+}
+
+
+void
+MusicScanner::commitBatch( const Tomahawk::ScannedFileBatch& tracks, const QVariantList& deletethese )
 {
     if ( deletethese.length() )
     {
@@ -282,9 +296,9 @@ MusicScanner::commitBatch( const QVariantList& tracks, const QVariantList& delet
         executeCommand( dbcmd_ptr( new DatabaseCommand_DeleteFiles( deletethese, SourceList::instance()->getLocal() ) ) );
     }
 
-    if ( tracks.length() )
+    if ( tracks.count() )
     {
-        tDebug( LOGINFO ) << Q_FUNC_INFO << "adding" << tracks.length() << "tracks";
+        tDebug( LOGINFO ) << Q_FUNC_INFO << "adding" << tracks.count() << "tracks";
         executeCommand( dbcmd_ptr( new DatabaseCommand_AddFiles( tracks, SourceList::instance()->getLocal() ) ) );
     }
 }
@@ -328,28 +342,24 @@ MusicScanner::scanFile( const QFileInfo& fi )
     }
 
     //tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Scanning file:" << fi.canonicalFilePath();
-    QVariant m = readFile( fi );
-    if ( m.toMap().isEmpty() )
+    const ScannedFile file = readFile( fi );
+    if ( file.isNull() )
         return;
 
-    m_scannedfiles << m;
-    if ( m_batchsize != 0 && (quint32)m_scannedfiles.length() >= m_batchsize )
-    {
-        emit batchReady( m_scannedfiles, m_filesToDelete );
-        m_scannedfiles.clear();
-        m_filesToDelete.clear();
-    }
+    m_scannedfiles.append( file );
+    if ( m_batchsize != 0 && (quint32)m_scannedfiles.count() >= m_batchsize )
+        flushBatch();
 }
 
 
-QVariant
+ScannedFile
 MusicScanner::readTags( const QFileInfo& fi )
 {
     tLog( LOGVERBOSE ) << Q_FUNC_INFO << "Parsing tags for file:" << fi.absoluteFilePath();
 
     const QString suffix = fi.suffix().toLower();
     if ( !TomahawkUtils::supportedExtensions().contains( suffix ) )
-        return QVariantMap(); // invalid extension
+        return ScannedFile(); // invalid extension
 
     #ifdef COMPLEX_TAGLIB_FILENAME
         const wchar_t *encodedName = reinterpret_cast< const wchar_t * >( fi.canonicalFilePath().utf16() );
@@ -360,7 +370,7 @@ MusicScanner::readTags( const QFileInfo& fi )
 
     TagLib::FileRef f( encodedName );
     if ( f.isNull() || !f.tag() )
-        return QVariantMap();
+        return ScannedFile();
 
     int bitrate = 0;
     int duration = 0;
@@ -380,36 +390,36 @@ MusicScanner::readTags( const QFileInfo& fi )
         track  = tag->title().trimmed();
     }
     if ( !tag || artist.isEmpty() || track.isEmpty() )
-        return QVariantMap();
+        return ScannedFile();
 
     QString mimetype = TomahawkUtils::extensionToMimetype( suffix );
     QString url( "file://%1" );
 
-    QVariantMap m;
-    m["url"]          = url.arg( fi.canonicalFilePath() );
-    m["mtime"]        = fi.lastModified().toUTC().toTime_t();
-    m["size"]         = (unsigned int)fi.size();
-    m["mimetype"]     = mimetype;
-    m["duration"]     = duration;
-    m["bitrate"]      = bitrate;
-    m["artist"]       = artist;
-    m["album"]        = album;
-    m["track"]        = track;
-    m["albumpos"]     = tag->track();
-    m["year"]         = tag->year();
-    m["albumartist"]  = tag->albumArtist();
-    m["composer"]     = tag->composer();
-    m["discnumber"]   = tag->discNumber();
-    m["hash"]         = ""; // TODO
-
-    return m;
+    ScannedFile file;
+    file.url         = url.arg( fi.canonicalFilePath() );
+    file.mtime       = fi.lastModified().toUTC().toTime_t();
+    file.size        = (unsigned int)fi.size();
+    file.mimetype    = mimetype;
+    file.duration    = duration;
+    file.bitrate     = bitrate;
+    file.artist      = artist;
+    file.album       = album;
+    file.track       = track;
+    file.albumpos    = tag->track();
+    file.year        = tag->year();
+    file.albumArtist = tag->albumArtist();
+    file.composer    = tag->composer();
+    file.discnumber  = tag->discNumber();
+    file.hash        = ""; // TODO
+
+    return file;
 }
 
 
-QVariant
+ScannedFile
 MusicScanner::readFile( const QFileInfo& fi )
 {
-    const QVariant m = readTags( fi );
+    const ScannedFile file = readTags( fi );
 
     if ( m_scanned )
         if ( m_scanned % 3 == 0 )
@@ -417,7 +427,7 @@ MusicScanner::readFile( const QFileInfo& fi )
     if ( m_scanned % 100 == 0 )
         tDebug( LOGINFO ) << "Scan progress:" << m_scanned << fi.canonicalFilePath();
 
-    if ( m.toMap().isEmpty() )
+    if ( file.isNull() )
     {
         m_skippedFiles << fi.canonicalFilePath();
         m_skipped++;
@@ -427,6 +437,6 @@ MusicScanner::readFile( const QFileInfo& fi )
         m_scanned++;
     }
 
-    return m;
+    return file;
 }
 
@@ -22,6 +22,7 @@
 
 #include "database/Database.h"
 #include "database/DatabaseCommand.h"
+#include "database/ScannedFile.h"
 #include "TomahawkSettings.h"
 
 /* taglib */
@@ -102,7 +103,8 @@ public:
     enum ScanMode { DirScan, FileScan };
     enum ScanType { None, Full, Normal, File };
 
-    static QVariant readTags( const QFileInfo& fi );
+    /// Returns a null ScannedFile if @p fi isn't a supported, properly tagged audio file.
+    static Tomahawk::ScannedFile readTags( const QFileInfo& fi );
 
     MusicScanner( MusicScanner::ScanMode scanMode, const QStringList& paths, quint32 bs = 0 );
     ~MusicScanner();
@@ -110,10 +112,10 @@ public:
 signals:
     //void fileScanned( QVariantMap );
     void finished();
-    void batchReady( const QVariantList&, const QVariantList& );
+    void batchReady( const Tomahawk::ScannedFileBatch&, const QVariantList& );
 
 private:
-    QVariant readFile( const QFileInfo& fi );
+    Tomahawk::ScannedFile readFile( const QFileInfo& fi );
     void executeCommand( Tomahawk::dbcmd_ptr cmd );
 
 private slots:
@@ -123,11 +125,12 @@ private slots:
     void startScan();
     void scan();
     void cleanup();
-    void commitBatch( const QVariantList& tracks, const QVariantList& deletethese );
+    void commitBatch( const Tomahawk::ScannedFileBatch& tracks, const QVariantList& deletethese );
     void commandFinished();
 
 private:
     void scanFilePaths();
+    void flushBatch();
 
     MusicScanner::ScanMode m_scanMode;
     QStringList m_paths;
@@ -139,7 +142,7 @@ private:
 
     unsigned int m_cmdQueue;
 
-    QVariantList m_scannedfiles;
+    Tomahawk::ScannedFileBatch m_scannedfiles;
     QVariantList m_filesToDelete;
     quint32 m_batchsize;
 
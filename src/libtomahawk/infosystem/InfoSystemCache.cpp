@@ -23,6 +23,7 @@
 #include "InfoSystemCache.h"
 #include "TomahawkSettings.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 #include "Source.h"
 
 #include <QDir>
@@ -40,6 +41,9 @@ const int InfoSystemCache::s_infosystemCacheVersion = 4;
 InfoSystemCache::InfoSystemCache( QObject* parent )
     : QObject( parent )
     , m_cacheBaseDir( TomahawkSettings::instance()->storageCacheLocation() + "/InfoSystemCache/" )
+    , m_diskHits( Metrics::instance()->counter( "infosystem_cache_hits_total", "source", "disk" ) )
+    , m_memoryHits( Metrics::instance()->counter( "infosystem_cache_hits_total", "source", "memory" ) )
+    , m_misses( Metrics::instance()->counter( "infosystem_cache_misses_total" ) )
 {
     tDebug() << Q_FUNC_INFO;
 
@@ -176,10 +180,12 @@ InfoSystemCache::getCachedInfoSlot( Tomahawk::InfoSystem::InfoStringHash criteri
         QVariant output = cachedSettings.value( "data" );
         m_dataCache.insert( criteriaHashValWithType, new QVariant( output ) );
 
+        m_diskHits->add();
         emit info( requestData, output );
     }
     else
     {
+        m_memoryHits->add();
         emit info( requestData, QVariant( *( m_dataCache[ criteriaHashValWithType ] ) ) );
     }
 }
@@ -188,6 +194,7 @@ InfoSystemCache::getCachedInfoSlot( Tomahawk::InfoSystem::InfoStringHash criteri
 void
 InfoSystemCache::notInCache( QObject *receiver, Tomahawk::InfoSystem::InfoStringHash criteria, Tomahawk::InfoSystem::InfoRequestData requestData )
 {
+    m_misses->add();
     QMetaObject::invokeMethod( receiver, "notInCacheSlot", Q_ARG( Tomahawk::InfoSystem::InfoStringHash, criteria ), Q_ARG( Tomahawk::InfoSystem::InfoRequestData, requestData ) );
 }
 
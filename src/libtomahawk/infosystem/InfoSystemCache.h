@@ -31,6 +31,8 @@
 namespace Tomahawk
 {
 
+class Counter;
+
 namespace InfoSystem
 {
 
@@ -68,6 +70,10 @@ private:
     QHash< InfoType, QHash< QString, QString > > m_fileLocationCache;
     QTimer m_pruneTimer;
     QCache< QString, QVariant > m_dataCache;
+
+    Counter* m_diskHits;
+    Counter* m_memoryHits;
+    Counter* m_misses;
 };
 
 } //namespace InfoSystem
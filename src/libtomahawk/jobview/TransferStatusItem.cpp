@@ -117,6 +117,10 @@ TransferStatusManager::TransferStatusManager( QObject* parent )
 void
 TransferStatusManager::streamRegistered( StreamConnection* sc )
 {
+    // Streams live on a network thread, this one might already be gone again
+    if ( !Servent::instance()->streams().contains( sc ) )
+        return;
+
     JobStatusView::instance()->model()->addJob( new TransferStatusItem( this, sc ) );
 }
 
@@ -21,24 +21,61 @@
 #include "BufferIoDevice_p.h"
 
 #include <QCoreApplication>
+#include <QDir>
 #include <QMutexLocker>
+#include <QTemporaryFile>
 #include <QThread>
 
 #include "utils/Logger.h"
+#include "utils/StreamCache.h"
 
 // Msgs are framed, this is the size each msg we send containing audio data:
 #define BLOCKSIZE 4096
+// Files bigger than this are buffered in a mapped temporary file instead of the heap
+#define SPILL_SIZE ( 64 * 1024 * 1024 )
 
 
 BufferIODevice::BufferIODevice( unsigned int size, QObject* parent )
     : QIODevice( parent )
     , d_ptr( new BufferIODevicePrivate( this, size ) )
 {
+    Q_D( BufferIODevice );
+
+    if ( size > SPILL_SIZE )
+    {
+        QTemporaryFile* file = new QTemporaryFile( QDir::tempPath() + "/tomahawk_stream_XXXXXX", this );
+        if ( file->open() && file->resize( size ) )
+            d->data = reinterpret_cast< char* >( file->map( 0, size ) );
+
+        if ( d->data )
+            d->spillFile = file;
+        else
+        {
+            tLog() << Q_FUNC_INFO << "Could not map temporary file, buffering in memory:" << file->errorString();
+            delete file;
+        }
+    }
+
+    if ( !d->data && size > 0 )
+    {
+        d->memory.resize( size );
+        d->data = d->memory.data();
+    }
+
+    d->blocks.resize( maxBlocks() );
 }
 
 
 BufferIODevice::~BufferIODevice()
 {
+    Q_D( BufferIODevice );
+
+    // Keep what we got so far, so the next transfer can pick up from there
+    storeInCache( true );
+
+    if ( d->spillFile )
+        d->spillFile->unmap( reinterpret_cast< uchar* >( d->data ) );
+
     delete d_ptr;
 }
 
@@ -99,9 +136,17 @@ void
 BufferIODevice::inputComplete( const QString& errmsg )
 {
     Q_D( BufferIODevice );
-    qDebug() << Q_FUNC_INFO;
+    qDebug() << Q_FUNC_INFO << errmsg;
     setErrorString( errmsg );
-    d->size = d->received;
+
+    // Before the size shrinks to what we received, that's not what the track is
+    storeInCache( !errmsg.isEmpty() );
+    {
+        QMutexLocker lock( &d->mut );
+        d->size = d->received;
+        d->blocks.resize( maxBlocks() );
+    }
+
     emit readChannelFinished();
 }
 
@@ -117,13 +162,43 @@ void
 BufferIODevice::addData( int block, const QByteArray& ba )
 {
     Q_D( BufferIODevice );
+    bool duplicate = false;
+    bool skipAhead = false;
     {
         QMutexLocker lock( &d->mut );
 
-        while ( d->buffer.count() <= block )
-            d->buffer << QByteArray();
+        if ( block < 0 || block >= d->blocks.size() )
+        {
+            tDebug() << Q_FUNC_INFO << "Ignoring block out of range:" << block << d->size;
+            return;
+        }
+
+        if ( d->blocks.testBit( block ) )
+        {
+            // We already had this one, e.g. because we re-requested it after a seek,
+            // or because it came from the cache and the sender doesn't know yet
+            duplicate = true;
+            skipAhead = d->prefilled;
+            d->prefilled = false;
+        }
+        else
+        {
+            const qint64 offset = (qint64)block * BLOCKSIZE;
+            const int length = qMin( (qint64)ba.count(), (qint64)d->size - offset );
+            memcpy( d->data + offset, ba.constData(), length );
 
-        d->buffer.replace( block, ba );
+            d->blocks.setBit( block );
+            d->received += length;
+        }
+    }
+
+    if ( duplicate )
+    {
+        const int next = nextEmptyBlock();
+        if ( skipAhead && next >= 0 )
+            emit blockRequest( next );
+
+        return;
     }
 
     // If this was the last block of the transfer, check if we need to fill up gaps
@@ -135,7 +210,6 @@ BufferIODevice::addData( int block, const QByteArray& ba )
         }
     }
 
-    d->received += ba.count();
     emit bytesWritten( ba.count() );
     emit readyRead();
 }
@@ -159,14 +233,23 @@ BufferIODevice::readData( char* data, qint64 maxSize )
     if ( atEnd() )
         return 0;
 
-    QByteArray ba;
-    ba.append( getData( d->pos, maxSize ) );
-    d->pos += ba.count();
+    QMutexLocker lock( &d->mut );
+
+    // Hand out everything up to the next block we don't have yet
+    const qint64 end = qMin( (qint64)d->size, (qint64)d->pos + maxSize );
+    qint64 available = d->pos;
+    int block = blockForPos( d->pos );
+    while ( available < end && block < d->blocks.size() && d->blocks.testBit( block ) )
+        available = (qint64)( ++block ) * BLOCKSIZE;
 
-//    qDebug() << Q_FUNC_INFO << maxSize << ba.count() << 2;
-    memcpy( data, ba.data(), ba.count() );
+    const qint64 length = qMin( available, end ) - d->pos;
+    if ( length <= 0 )
+        return 0;
 
-    return ba.count();
+    memcpy( data, d->data + d->pos, length );
+    d->pos += length;
+
+    return length;
 }
 
 
@@ -214,7 +297,9 @@ BufferIODevice::clear()
     QMutexLocker lock( &d->mut );
 
     d->pos = 0;
-    d->buffer.clear();
+    d->received = 0;
+    d->firstEmpty = 0;
+    d->blocks.fill( false );
 }
 
 
@@ -258,20 +343,16 @@ int
 BufferIODevice::nextEmptyBlock() const
 {
     Q_D( const BufferIODevice );
+    QMutexLocker lock( &d->mut );
 
-    int i = 0;
-    foreach( const QByteArray& ba, d->buffer )
-    {
-        if ( ba.isEmpty() )
-            return i;
+    // Blocks never go missing again, so the scan resumes where it stopped last time
+    while ( d->firstEmpty < d->blocks.size() && d->blocks.testBit( d->firstEmpty ) )
+        d->firstEmpty++;
 
-        i++;
-    }
-
-    if ( i == maxBlocks() )
+    if ( d->firstEmpty >= d->blocks.size() )
         return -1;
 
-    return i;
+    return d->firstEmpty;
 }
 
 
@@ -293,34 +374,76 @@ bool
 BufferIODevice::isBlockEmpty( int block ) const
 {
     Q_D( const BufferIODevice );
-    if ( block >= d->buffer.count() )
+    QMutexLocker lock( &d->mut );
+
+    if ( block < 0 || block >= d->blocks.size() )
         return true;
 
-    return d->buffer.at( block ).isEmpty();
+    return !d->blocks.testBit( block );
 }
 
 
-QByteArray
-BufferIODevice::getData( qint64 pos, qint64 size )
+
+void
+BufferIODevice::setCacheKey( const QString& key, Tomahawk::StreamCache* cache )
 {
     Q_D( BufferIODevice );
-//    qDebug() << Q_FUNC_INFO << pos << size << 1;
-    QByteArray ba;
-    int block = blockForPos( pos );
-    int offset = offsetForPos( pos );
+    QMutexLocker lock( &d->mut );
+    d->cacheKey = key;
+    d->cache = cache;
+}
+
+
+void
+BufferIODevice::storeInCache( bool interrupted )
+{
+    Q_D( BufferIODevice );
+    const int firstEmpty = nextEmptyBlock();
 
     QMutexLocker lock( &d->mut );
-    while( ba.count() < size )
+    if ( d->cacheKey.isEmpty() || d->cached )
+        return;
+
+    d->cached = true;
+    Tomahawk::StreamCache* cache = d->cache ? d->cache : Tomahawk::StreamCache::instance();
+
+    if ( !interrupted && d->expectedSize > 0 && d->received == d->expectedSize )
     {
-        if ( block > maxBlocks() )
-            break;
+        cache->store( d->cacheKey, QByteArray( d->data, d->expectedSize ), true );
+        return;
+    }
+
+    // Only the leading blocks are of use, transfers resume from the first missing one
+    const qint64 leading = ( firstEmpty < 0 ) ? d->expectedSize : (qint64)firstEmpty * BLOCKSIZE;
+    const qint64 length = qMin( leading, (qint64)d->expectedSize );
+    if ( length > 0 )
+        cache->store( d->cacheKey, QByteArray( d->data, length ), false );
+}
 
-        if ( isBlockEmpty( block ) )
-            break;
 
-        ba.append( d->buffer.at( block++ ).mid( offset ) );
+void
+BufferIODevice::prefill( const QByteArray& data )
+{
+    Q_D( BufferIODevice );
+    QMutexLocker lock( &d->mut );
+
+    // Only whole blocks, unless it's the entire file
+    const int length = ( (qint64)data.size() >= (qint64)d->size ) ? d->size : ( data.size() / BLOCKSIZE ) * BLOCKSIZE;
+    if ( length <= 0 )
+        return;
+
+    memcpy( d->data, data.constData(), length );
+
+    const int blocks = ( length + BLOCKSIZE - 1 ) / BLOCKSIZE;
+    for ( int i = 0; i < blocks; i++ )
+    {
+        if ( !d->blocks.testBit( i ) )
+        {
+            d->blocks.setBit( i );
+            d->received += qMin( (int)BLOCKSIZE, length - i * BLOCKSIZE );
+        }
     }
 
-//    qDebug() << Q_FUNC_INFO << pos << size << 2;
-    return ba.left( size );
+    d->prefilled = true;
+    tDebug() << Q_FUNC_INFO << "Prefilled" << blocks << "blocks from cache";
 }
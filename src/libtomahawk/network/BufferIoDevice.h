@@ -22,9 +22,16 @@
 
 #include <QIODevice>
 
+#include "DllMacro.h"
+
 class BufferIODevicePrivate;
 
-class BufferIODevice : public QIODevice
+namespace Tomahawk
+{
+    class StreamCache;
+}
+
+class DLLEXPORT BufferIODevice : public QIODevice
 {
 Q_OBJECT
 
@@ -50,6 +57,19 @@ public:
 
     void inputComplete( const QString& errmsg = "" );
 
+    /**
+     * Stores the data under @p key in @p cache (the global StreamCache by default) once
+     * the transfer is over. Only transfers that delivered every byte are stored as
+     * complete, anything that ended early is kept as a partial the next one resumes.
+     */
+    void setCacheKey( const QString& key, Tomahawk::StreamCache* cache = 0 );
+    /**
+     * Fills in the leading bytes of the file from an earlier, interrupted transfer.
+     * As soon as the sender turns out to be sending blocks we already have, we ask
+     * it to skip ahead to the first missing one.
+     */
+    void prefill( const QByteArray& data );
+
     virtual bool isSequential() const;
 
     static unsigned int blockSize();
@@ -68,7 +88,7 @@ protected:
 private:
     int blockForPos( qint64 pos ) const;
     int offsetForPos( qint64 pos ) const;
-    QByteArray getData( qint64 pos, qint64 size );
+    void storeInCache( bool interrupted );
 
     Q_DECLARE_PRIVATE( BufferIODevice )
     BufferIODevicePrivate* d_ptr;
@@ -22,14 +22,29 @@
 
 #include "BufferIoDevice.h"
 
+#include <QBitArray>
 #include <QMutex>
 
+class QTemporaryFile;
+
+namespace Tomahawk
+{
+    class StreamCache;
+}
+
 class BufferIODevicePrivate
 {
 public:
     BufferIODevicePrivate( BufferIODevice* q, unsigned int size = 0 )
         : q_ptr ( q )
+        , data( 0 )
+        , spillFile( 0 )
+        , firstEmpty( 0 )
+        , prefilled( false )
+        , cached( false )
+        , cache( 0 )
         , size( size )
+        , expectedSize( size )
         , received( 0 )
         , pos( 0 )
 
@@ -39,9 +54,25 @@ public:
     Q_DECLARE_PUBLIC ( BufferIODevice )
 
 private:
-    QList<QByteArray> buffer;
+    // Preallocated for the whole file, blocks are written to their final position
+    char* data;
+    QByteArray memory;
+    QTemporaryFile* spillFile;
+
+    // One bit per block we already received
+    QBitArray blocks;
+    // Every block before this one has been received
+    mutable int firstEmpty;
+
+    QString cacheKey;
+    bool prefilled;
+    bool cached;
+    Tomahawk::StreamCache* cache;
+
     mutable QMutex mut;
     unsigned int size;
+    // What the sender announced, size shrinks to what we got if the transfer ends early
+    unsigned int expectedSize;
     unsigned int received;
     unsigned int pos;
 };
@@ -26,6 +26,7 @@
 #include "network/Msg.h"
 #include "utils/Logger.h"
 #include "utils/Json.h"
+#include "utils/Metrics.h"
 #include "utils/TomahawkUtils.h"
 
 #include "QTcpSocketExtra.h"
@@ -92,7 +93,12 @@ Connection::handleIncomingQueueEmpty()
 void
 Connection::setFirstMessage( const QVariant& m )
 {
-    const QByteArray ba = TomahawkUtils::toJson( m );
+    QVariantMap map = m.toMap();
+    // Old peers simply ignore this, new ones answer with the codecs they support
+    if ( !Msg::supportedCodecs().isEmpty() )
+        map.insert( "codecs", Msg::supportedCodecs() );
+
+    const QByteArray ba = TomahawkUtils::toJson( map );
     //qDebug() << "first msg json len:" << ba.length();
     setFirstMessage( Msg::factory( ba, Msg::JSON ) );
 }
@@ -285,6 +291,9 @@ Connection::bytesReceived() const
 void
 Connection::setMsgProcessorModeOut(quint32 m)
 {
+    if ( d_func()->fastCompression )
+        m |= MsgProcessor::COMPRESS_FAST;
+
     d_func()->msgprocessor_out.setMode( m );
 }
 
@@ -294,6 +303,20 @@ Connection::setMsgProcessorModeIn(quint32 m)
     d_func()->msgprocessor_in.setMode( m );
 }
 
+void
+Connection::setPeerCodecs( const QStringList& codecs )
+{
+    Q_D( Connection );
+
+    d->peerCodecs = codecs;
+    d->fastCompression = codecs.contains( "lz4" ) && Msg::supportedCodecs().contains( "lz4" );
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << id() << "peer codecs:" << codecs << "fast compression:" << d->fastCompression;
+    if ( d->fastCompression )
+        d->msgprocessor_out.setMode( d->msgprocessor_out.mode() | MsgProcessor::COMPRESS_FAST );
+}
+
+
 const QHostAddress
 Connection::peerIpAddress() const
 {
@@ -401,15 +424,32 @@ Connection::doSetup()
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << thread() << d->id;
     /*
         New connections can be created from other thread contexts, such as
-        when AudioEngine calls getIODevice.. - we need to ensure that connections
-        and their associated sockets are running in the same thread as the servent.
+        when AudioEngine calls getIODevice.. - they start out in the servent's
+        thread, which also accepted or connected their socket. Once authed,
+        each connection and its socket move to one of the servent's network
+        threads, so busy peers neither block the GUI nor each other.
 
         HINT: export QT_FATAL_WARNINGS=1 helps to catch these kind of errors.
      */
-    if ( QThread::currentThread() != d->servent->thread() )
+    if ( !d->setup && d->networkThread.isNull() )
     {
-        // Connections should always be in the same thread as the servent.
-        moveToThread( d->servent->thread() );
+        d->networkThread = d->servent->networkThread();
+    }
+
+    if ( !d->setup && QThread::currentThread() != d->networkThread.data() )
+    {
+        // Objects can only be pushed away from the thread they live in,
+        // so hand everything over and continue the setup over there.
+        Q_ASSERT( QThread::currentThread() == thread() );
+        Q_ASSERT( QThread::currentThread() == d->sock->thread() );
+
+        moveToThread( d->networkThread.data() );
+        d->sock->moveToThread( d->networkThread.data() );
+        d->msgprocessor_in.moveToThread( d->networkThread.data() );
+        d->msgprocessor_out.moveToThread( d->networkThread.data() );
+
+        QMetaObject::invokeMethod( this, "doSetup", Qt::QueuedConnection );
+        return;
     }
 
     if ( !d->setup )
@@ -419,14 +459,11 @@ Connection::doSetup()
 
         //stats timer calculates BW used by this connection
         d->statstimer = new QTimer;
-        d->statstimer->moveToThread( this->thread() );
         d->statstimer->setInterval( 1000 );
         connect( d->statstimer, SIGNAL( timeout() ), SLOT( calcStats() ) );
         d->statstimer->start();
         d->statstimer_mark.start();
 
-        d->sock->moveToThread( thread() );
-
         connect( d->sock.data(), SIGNAL( bytesWritten( qint64 ) ),
                                   SLOT( bytesWritten( qint64 ) ), Qt::QueuedConnection );
 
@@ -450,6 +487,14 @@ Connection::doSetup()
         else
         {
             sendMsg( Msg::factory( PROTOVER, Msg::SETUP ) );
+
+            // Only answer peers that announced codecs, older ones don't expect a second SETUP msg
+            if ( !d->peerCodecs.isEmpty() && !Msg::supportedCodecs().isEmpty() )
+            {
+                QVariantMap m;
+                m.insert( "codecs", Msg::supportedCodecs() );
+                sendMsg( Msg::factory( TomahawkUtils::toJson( m ), Msg::JSON | Msg::SETUP ) );
+            }
         }
     }
     else
@@ -614,6 +659,17 @@ Connection::handleReadMsg()
             shutdown( true );
         }
     }
+    else if ( d->ready &&
+              outbound() &&
+              d->msg->is( Msg::SETUP ) &&
+              d->msg->is( Msg::JSON ) )
+    {
+        // The other end answered our codec announcement
+        bool ok;
+        const QVariantMap m = TomahawkUtils::parseJson( d->msg->payload(), &ok ).toMap();
+        if ( ok )
+            setPeerCodecs( m.value( "codecs" ).toStringList() );
+    }
     else
     {
         d->msgprocessor_in.append( d->msg );
@@ -640,6 +696,13 @@ Connection::sendMsg( QVariant j )
 void
 Connection::sendMsg( msg_ptr msg )
 {
+    // The outgoing MsgProcessor and our byte counters are only touched from our own thread
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( this, "sendMsg", Qt::QueuedConnection, Q_ARG( msg_ptr, msg ) );
+        return;
+    }
+
     if ( d_func()->do_shutdown )
     {
         tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "SHUTTING DOWN, NOT SENDING msg flags:"
@@ -694,6 +757,16 @@ Connection::calcStats()
     d->stats_tx_bytes_per_sec = (float)1000 * ( (d->tx_bytes - d->tx_bytes_last) / (float)elapsed );
     d->stats_rx_bytes_per_sec = (float)1000 * ( (d->rx_bytes - d->rx_bytes_last) / (float)elapsed );
 
+    // Accumulated per connection type, so stream throughput can be told apart from control traffic
+    if ( !d->sentBytes )
+    {
+        const QString type = QString::fromLatin1( metaObject()->className() );
+        d->sentBytes = Tomahawk::Metrics::instance()->counter( "network_sent_bytes_total", "connection", type );
+        d->receivedBytes = Tomahawk::Metrics::instance()->counter( "network_received_bytes_total", "connection", type );
+    }
+    d->sentBytes->add( d->tx_bytes - d->tx_bytes_last );
+    d->receivedBytes->add( d->rx_bytes - d->rx_bytes_last );
+
     d->rx_bytes_last = d->rx_bytes;
     d->tx_bytes_last = d->tx_bytes;
 
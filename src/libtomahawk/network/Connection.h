@@ -27,6 +27,7 @@
 #include <QHostAddress>
 #include <QPointer>
 #include <QString>
+#include <QStringList>
 #include <QTcpSocket>
 #include <QVariant>
 
@@ -83,6 +84,13 @@ public:
     void setMsgProcessorModeOut( quint32 m );
     void setMsgProcessorModeIn( quint32 m );
 
+    /**
+     * Fast compression codecs the peer announced it can decode.
+     *
+     * If we support one of them, it is used for all compressed msgs from now on.
+     */
+    void setPeerCodecs( const QStringList& codecs );
+
     const QHostAddress peerIpAddress() const;
 
     QString bareName() const;
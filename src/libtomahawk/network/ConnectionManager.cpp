@@ -19,8 +19,6 @@
 #include "ConnectionManager_p.h"
 
 #include "accounts/Account.h"
-#include "database/Database.h"
-#include "database/DatabaseImpl.h"
 #include "network/Msg.h"
 #include "sip/SipInfo.h"
 #include "sip/SipPlugin.h"
@@ -197,7 +195,7 @@ ConnectionManager::newControlConnection( const Tomahawk::peerinfo_ptr& peerInfo
     QVariantMap m;
     m["conntype"]  = "accept-offer";
     m["key"]       = peerInfo->key();
-    m["nodeid"]    = Tomahawk::Database::instance()->impl()->dbid();
+    m["nodeid"]    = Servent::instance()->dbid();
 
     d->controlConnection = QPointer<ControlConnection>( new ControlConnection( Servent::instance() ) );
     d->controlConnection->setShutdownOnEmptyPeerInfos( false );
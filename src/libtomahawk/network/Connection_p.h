@@ -25,7 +25,10 @@
 
 #include "MsgProcessor.h"
 
+#include <QPointer>
 #include <QReadWriteLock>
+#include <QStringList>
+#include <QThread>
 #include <QTime>
 #include <QTimer>
 
@@ -52,7 +55,10 @@ public:
         , stats_rx_bytes_per_sec( 0 )
         , rx_bytes_last( 0 )
         , tx_bytes_last( 0 )
+        , sentBytes( 0 )
+        , receivedBytes( 0 )
         , aclRequest( 0 )
+        , fastCompression( false )
     {
     }
     Connection* q_ptr;
@@ -60,6 +66,7 @@ public:
 
 private:
     Servent* servent;
+    QPointer<QThread> networkThread;
     QPointer<QTcpSocket> sock;
     QHostAddress peerIpAddress;
     bool do_shutdown;
@@ -86,11 +93,18 @@ private:
     qint64 stats_rx_bytes_per_sec;
     qint64 rx_bytes_last;
     qint64 tx_bytes_last;
+    // looked up on the first calcStats(), once the connection type is final
+    Tomahawk::Counter* sentBytes;
+    Tomahawk::Counter* receivedBytes;
 
     MsgProcessor msgprocessor_in;
     MsgProcessor msgprocessor_out;
 
     Tomahawk::Network::ACL::aclrequest_ptr aclRequest;
+
+    // negotiated during the handshake, see Connection::setPeerCodecs
+    bool fastCompression;
+    QStringList peerCodecs;
 };
 
 
@@ -50,6 +50,8 @@ ControlConnection::ControlConnection( Servent* parent )
 
     this->setMsgProcessorModeIn( MsgProcessor::UNCOMPRESS_ALL | MsgProcessor::PARSE_JSON );
     this->setMsgProcessorModeOut( MsgProcessor::COMPRESS_IF_LARGE );
+
+    d_func()->multiplexer = new StreamMultiplexer( this );
 }
 
 
@@ -67,6 +69,7 @@ ControlConnection::~ControlConnection()
     }
 
     delete d->pingtimer;
+    delete d->multiplexer;
     servent()->unregisterControlConnection( this );
     if ( d->dbsyncconn )
         d->dbsyncconn->deleteLater();
@@ -143,6 +146,12 @@ ControlConnection::setup()
         d->pingtimer->start();
         d->pingtimer_mark.start();
         d->sourceLock.unlock();
+
+        // Older peers just log this as an unhandled msg
+        QVariantMap m;
+        m.insert( "method", "features" );
+        m.insert( "features", StreamMultiplexer::features() );
+        sendMsg( m );
     }
     else
     {
@@ -157,6 +166,14 @@ ControlConnection::setup()
 }
 
 
+StreamMultiplexer*
+ControlConnection::multiplexer() const
+{
+    Q_D( const ControlConnection );
+    return d->multiplexer;
+}
+
+
 // source was synced to DB, set it up properly:
 void
 ControlConnection::registerSource()
@@ -274,6 +291,13 @@ ControlConnection::handleMsg( msg_ptr msg )
         return;
     }
 
+    // Multiplexed stream data is the only non-JSON msg we accept
+    if ( msg->is( Msg::RAW ) && d->multiplexer->isSupported() )
+    {
+        d->multiplexer->handleData( msg );
+        return;
+    }
+
     // if small and not compresed, print it out for debug
     if ( msg->length() < 1024 && !msg->is( Msg::COMPRESSED ) )
     {
@@ -304,13 +328,17 @@ ControlConnection::handleMsg( msg_ptr msg )
             d->dbconnkey = m.value( "key" ).toString() ;
             setupDbSyncConnection();
         }
+        else if ( m.value( "method" ).toString() == "features" )
+        {
+            d->multiplexer->setPeerFeatures( m.value( "features" ).toStringList() );
+        }
         else if ( m.value( "method" ) == "protovercheckfail" )
         {
             qDebug() << "*** Remote peer protocol version mismatch, connection closed";
             shutdown( true );
             return;
         }
-        else
+        else if ( !d->multiplexer->handleControlMsg( m ) )
         {
             tDebug() << id() << "Unhandled msg:" << QString::fromLatin1( msg->payload() );
         }
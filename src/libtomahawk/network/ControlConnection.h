@@ -35,6 +35,7 @@
 class ControlConnectionPrivate;
 class DBSyncConnection;
 class Servent;
+class StreamMultiplexer;
 
 class DLLEXPORT ControlConnection : public Connection
 {
@@ -47,6 +48,9 @@ public:
 
     DBSyncConnection* dbSyncConnection();
 
+    /// Carries file transfers to / from this peer, if it supports it.
+    StreamMultiplexer* multiplexer() const;
+
     Tomahawk::source_ptr source() const;
 
     /**
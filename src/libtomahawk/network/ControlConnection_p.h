@@ -22,6 +22,7 @@
 #define CONTROLCONNECTION_P_H
 
 #include "ControlConnection.h"
+#include "StreamMultiplexer.h"
 
 #include <QReadWriteLock>
 #include <QTime>
@@ -36,6 +37,7 @@ public:
         , registered( false )
         , shutdownOnEmptyPeerInfos( true )
         , pingtimer( 0 )
+        , multiplexer( 0 )
     {
     }
     ControlConnection* q_ptr;
@@ -58,6 +60,8 @@ private:
     QTime pingtimer_mark;
 
     QSet< Tomahawk::peerinfo_ptr > peerInfos;
+
+    StreamMultiplexer* multiplexer;
 };
 
 #endif // CONTROLCONNECTION_P_H
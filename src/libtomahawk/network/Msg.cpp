@@ -20,9 +20,21 @@
 #include "Msg_p.h"
 
 #include "utils/Json.h"
+#include "utils/Logger.h"
+
+#include "config.h"
 
 #include <QtEndian>
 
+#ifdef LZ4_FOUND
+    #include <lz4.h>
+#endif
+
+// zlib's default, level 9 costs lots of CPU for hardly smaller JSON
+#define ZLIB_LEVEL 6
+// refuse to allocate more than this for a single uncompressed payload
+#define MAX_UNCOMPRESSED_SIZE ( 64 * 1024 * 1024 )
+
 Msg::Msg( const QByteArray& ba, char f )
     : d_ptr( new MsgPrivate( this, ba, f ) )
 {
@@ -137,3 +149,72 @@ Msg::flags() const
     Q_D( const Msg );
     return d->flags;
 }
+
+
+QStringList
+Msg::supportedCodecs()
+{
+    QStringList codecs;
+#ifdef LZ4_FOUND
+    codecs << "lz4";
+#endif
+    return codecs;
+}
+
+
+QByteArray
+Msg::compress( const QByteArray& ba, char flags )
+{
+#ifdef LZ4_FOUND
+    if ( flags & LZ4 )
+    {
+        // Prefix with the uncompressed size in big endian, just like qCompress does
+        QByteArray out( sizeof( quint32 ) + LZ4_compressBound( ba.size() ), Qt::Uninitialized );
+        qToBigEndian( (quint32)ba.size(), (uchar*)out.data() );
+
+        const int size = LZ4_compress_default( ba.constData(), out.data() + sizeof( quint32 ),
+                                               ba.size(), out.size() - sizeof( quint32 ) );
+        if ( size <= 0 )
+        {
+            tLog() << Q_FUNC_INFO << "LZ4 compression failed for" << ba.size() << "bytes";
+            return QByteArray();
+        }
+
+        out.resize( sizeof( quint32 ) + size );
+        return out;
+    }
+#endif
+
+    Q_ASSERT( !( flags & LZ4 ) );
+    return qCompress( ba, ZLIB_LEVEL );
+}
+
+
+QByteArray
+Msg::uncompress( const QByteArray& ba, char flags )
+{
+    if ( flags & LZ4 )
+    {
+#ifdef LZ4_FOUND
+        if ( ba.size() < (int)sizeof( quint32 ) )
+            return QByteArray();
+
+        const quint32 length = qFromBigEndian<quint32>( (const uchar*)ba.constData() );
+        if ( length > MAX_UNCOMPRESSED_SIZE )
+            return QByteArray();
+
+        QByteArray out( length, Qt::Uninitialized );
+        const int size = LZ4_decompress_safe( ba.constData() + sizeof( quint32 ), out.data(),
+                                              ba.size() - sizeof( quint32 ), length );
+        if ( size != (int)length )
+            return QByteArray();
+
+        return out;
+#else
+        // We never announce LZ4 without support for it
+        return QByteArray();
+#endif
+    }
+
+    return qUncompress( ba );
+}
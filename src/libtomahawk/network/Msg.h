@@ -25,21 +25,26 @@
 
     Flags indicate if the payload is compressed/json/etc.
 
+    Compressed payloads use zlib, unless the LZ4 flag is set too. LZ4 is only
+    used once the peer announced it can decode it during the handshake.
+
     Use static factory method to create, pass around shared pointers: msp_ptr
 */
 
 #ifndef MSG_H
 #define MSG_H
 
+#include "DllMacro.h"
 #include "Typedefs.h"
 
 #include <QSharedPointer>
+#include <QStringList>
 
 class MsgPrivate;
 class QByteArray;
 class QIODevice;
 
-class Msg
+class DLLEXPORT Msg
 {
     friend class MsgProcessor;
 
@@ -52,7 +57,7 @@ public:
         COMPRESSED = 8,
         DBOP = 16,
         PING = 32,
-        RESERVED_1 = 64,
+        LZ4 = 64, // only valid with COMPRESSED
         SETUP = 128 // used to handshake/auth the connection prior to handing over to Connection subclass
     };
 
@@ -91,6 +96,22 @@ public:
 
     char flags() const;
 
+    /**
+     * Names of the fast compression codecs we can decode, announced to peers.
+     */
+    static QStringList supportedCodecs();
+
+    /**
+     * Compresses @p ba with the codec selected by @p flags (LZ4 or zlib),
+     * returns an empty QByteArray if that failed.
+     */
+    static QByteArray compress( const QByteArray& ba, char flags );
+
+    /**
+     * Reverses compress(), returns an empty QByteArray on corrupt input.
+     */
+    static QByteArray uncompress( const QByteArray& ba, char flags );
+
 private:
     /**
      * Used when constructing Msg you wish to send
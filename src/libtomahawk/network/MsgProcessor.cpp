@@ -22,17 +22,34 @@
 #include "network/Servent.h"
 #include "utils/Json.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 #include "utils/TomahawkUtils.h"
 
+#include <QElapsedTimer>
 #include <QThread>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <qtconcurrentrun.h>
 
+// msgs smaller than this are processed right away if nothing is queued
+#define INLINE_THRESHOLD 256
+// upper bound of msgs handed to a single worker task
+#define MAX_BATCH_SIZE 500
+
 MsgProcessor::MsgProcessor( quint32 mode, quint32 t ) :
-    QObject(), m_mode( mode ), m_threshold( t ), m_totmsgsize( 0 )
+    QObject(), m_mode( mode ), m_threshold( t )
 {
-    moveToThread( Servent::instance()->thread() );
+    m_watcher = new QFutureWatcher<qint64>( this );
+    connect( m_watcher, SIGNAL( finished() ),
+             this, SLOT( processed() ),
+             Qt::QueuedConnection );
+
+    m_inlineCounter = Tomahawk::Metrics::instance()->counter( "msgprocessor_inline_msgs_total" );
+    m_batchTimeHistogram = Tomahawk::Metrics::instance()->histogram( "msgprocessor_batch_ms" );
+    m_batchSizeHistogram = Tomahawk::Metrics::instance()->histogram( "msgprocessor_batch_msgs" );
+
+    if ( Servent::instance() )
+        moveToThread( Servent::instance()->thread() );
 }
 
 
@@ -46,62 +63,94 @@ MsgProcessor::append( msg_ptr msg )
         return;
     }
 
-    m_msgs.append( msg );
-    m_msg_ready.insert( msg.data(), false );
-
-    m_totmsgsize += msg->payload().length();
-
-    if( m_mode & NOTHING )
+    // Only an idle processor may skip the queue, otherwise we'd reorder msgs
+    if ( m_batch.isEmpty() && m_msgs.isEmpty() && processInline( msg ) )
     {
-        //qDebug() << "MsgProcessor::NOTHING";
-        handleProcessedMsg( msg );
+        process( msg, m_mode, m_threshold );
+        m_inlineCounter->add();
+        emit ready( msg );
+        emit empty();
         return;
     }
 
-    QFuture<msg_ptr> fut = QtConcurrent::run(&MsgProcessor::process, msg, m_mode, m_threshold);
-    QFutureWatcher<msg_ptr> * watcher = new QFutureWatcher<msg_ptr>;
-    connect( watcher, SIGNAL( finished() ),
-             this, SLOT( processed() ),
-             Qt::QueuedConnection );
+    m_msgs.append( msg );
 
-    watcher->setFuture( fut );
+    if ( m_batch.isEmpty() )
+        startBatch();
+}
+
+
+bool
+MsgProcessor::processInline( const msg_ptr& msg ) const
+{
+    if ( m_mode == NOTHING )
+        return true;
+
+    // compressing or uncompressing is never cheap enough for the caller's thread
+    if ( ( m_mode & UNCOMPRESS_ALL ) && msg->is( Msg::COMPRESSED ) )
+        return false;
+
+    return msg->length() < INLINE_THRESHOLD && msg->length() <= m_threshold;
 }
 
 
 void
-MsgProcessor::processed()
+MsgProcessor::startBatch()
 {
-    QFutureWatcher<msg_ptr> * watcher = (QFutureWatcher<msg_ptr> *) sender();
-    msg_ptr msg = watcher->result();
-    watcher->deleteLater();
-    handleProcessedMsg( msg );
+    Q_ASSERT( m_batch.isEmpty() );
+
+    if ( m_msgs.count() <= MAX_BATCH_SIZE )
+    {
+        m_batch = m_msgs;
+        m_msgs.clear();
+    }
+    else
+    {
+        m_batch = m_msgs.mid( 0, MAX_BATCH_SIZE );
+        m_msgs = m_msgs.mid( MAX_BATCH_SIZE );
+    }
+
+    m_watcher->setFuture( QtConcurrent::run( &MsgProcessor::processBatch, m_batch, m_mode, m_threshold ) );
 }
 
 
 void
-MsgProcessor::handleProcessedMsg( msg_ptr msg )
+MsgProcessor::processed()
 {
     Q_ASSERT( QThread::currentThread() == thread() );
 
-    m_msg_ready.insert( msg.data(), true );
+    const QList<msg_ptr> batch = m_batch;
+    m_batch.clear();
+
+    m_batchTimeHistogram->record( m_watcher->result() );
+    m_batchSizeHistogram->record( batch.count() );
+
+    // keep the next batch busy while we dispatch this one
+    if ( !m_msgs.isEmpty() )
+        startBatch();
 
-    while( !m_msgs.isEmpty() )
+    foreach ( const msg_ptr& msg, batch )
+        emit ready( msg );
+
+    if ( m_batch.isEmpty() && m_msgs.isEmpty() )
     {
-        if( m_msg_ready.value( m_msgs.first().data() ) )
-        {
-            msg_ptr m = m_msgs.takeFirst();
-            m_msg_ready.remove( m.data() );
-            //qDebug() << Q_FUNC_INFO << "totmsgsize:" << m_totmsgsize;
-            emit ready( m );
-        }
-        else
-        {
-            return;
-        }
+        //qDebug() << Q_FUNC_INFO << "EMPTY, no msgs left.";
+        emit empty();
     }
+}
+
+
+/// This method is run by QtConcurrent:
+qint64
+MsgProcessor::processBatch( const QList< msg_ptr >& msgs, quint32 mode, quint32 threshold )
+{
+    QElapsedTimer timer;
+    timer.start();
 
-    //qDebug() << Q_FUNC_INFO << "EMPTY, no msgs left.";
-    emit empty();
+    foreach ( const msg_ptr& msg, msgs )
+        process( msg, mode, threshold );
+
+    return timer.elapsed();
 }
 
 
@@ -113,9 +162,9 @@ MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold )
     if( (mode & UNCOMPRESS_ALL) && msg->is( Msg::COMPRESSED ) )
     {
 //        qDebug() << "MsgProcessor::UNCOMPRESSING";
-        msg->d_func()->payload = qUncompress( msg->payload() );
+        msg->d_func()->payload = Msg::uncompress( msg->payload(), msg->flags() );
         msg->d_func()->length  = msg->d_func()->payload.length();
-        msg->d_func()->flags ^= Msg::COMPRESSED;
+        msg->d_func()->flags &= ~( Msg::COMPRESSED | Msg::LZ4 );
     }
 
     // parse json payload into qvariant if needed
@@ -130,14 +179,22 @@ MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold )
     }
 
     // compress if needed
+    // RAW msgs carry audio data, which doesn't compress
     if( (mode & COMPRESS_IF_LARGE) &&
-        !msg->is( Msg::COMPRESSED )
+        !msg->is( Msg::COMPRESSED ) && !msg->is( Msg::RAW )
         && msg->length() > threshold )
     {
 //        qDebug() << "MsgProcessor::COMPRESSING";
-        msg->d_func()->payload = qCompress( msg->payload(), 9 );
-        msg->d_func()->length  = msg->d_func()->payload.length();
-        msg->d_func()->flags |= Msg::COMPRESSED;
+        const char codec = ( mode & COMPRESS_FAST ) ? ( Msg::COMPRESSED | Msg::LZ4 ) : Msg::COMPRESSED;
+        const QByteArray compressed = Msg::compress( msg->payload(), codec );
+
+        // Not worth failing the msg over, it just goes out uncompressed
+        if ( !compressed.isEmpty() )
+        {
+            msg->d_func()->payload = compressed;
+            msg->d_func()->length  = compressed.length();
+            msg->d_func()->flags |= codec;
+        }
     }
     return msg;
 }
@@ -23,7 +23,9 @@
     It can be configured to auto-compress, or de-compress msgs for sending
     or receiving.
 
-    It uses QtConcurrent, but preserves msg order.
+    Queued msgs are processed in batches, one QtConcurrent task per batch,
+    so msg order is preserved by simply emitting each batch in order. Small
+    msgs arriving on an idle processor are handled inline.
 
     NOT threadsafe.
 */
@@ -33,9 +35,19 @@
 #include "Typedefs.h"
 #include "Msg.h" // Needed because we have msg_ptr in a slot
 
+#include "DllMacro.h"
+
 #include <QObject>
 
-class MsgProcessor : public QObject
+template <typename T> class QFutureWatcher;
+
+namespace Tomahawk
+{
+    class Counter;
+    class Histogram;
+}
+
+class DLLEXPORT MsgProcessor : public QObject
 {
 Q_OBJECT
 public:
@@ -44,16 +56,20 @@ public:
         NOTHING = 0,
         COMPRESS_IF_LARGE = 1,
         UNCOMPRESS_ALL = 2,
-        PARSE_JSON = 4
+        PARSE_JSON = 4,
+        COMPRESS_FAST = 8 // use LZ4 instead of zlib, peer must support it
     };
 
     explicit MsgProcessor( quint32 mode = NOTHING, quint32 t = 512 );
 
     void setMode( quint32 m ) { m_mode = m ; }
+    quint32 mode() const { return m_mode; }
 
     static msg_ptr process( msg_ptr msg, quint32 mode, quint32 threshold );
+    /// Returns the time in ms it took to process @p msgs.
+    static qint64 processBatch( const QList< msg_ptr >& msgs, quint32 mode, quint32 threshold );
 
-    int length() const { return m_msgs.length(); }
+    int length() const { return m_batch.length() + m_msgs.length(); }
 
 signals:
     void ready( msg_ptr );
@@ -64,13 +80,20 @@ public slots:
     void processed();
 
 private:
-    void handleProcessedMsg( msg_ptr msg );
+    bool processInline( const msg_ptr& msg ) const;
+    void startBatch();
 
     quint32 m_mode;
     quint32 m_threshold;
+    // msgs waiting for the next batch
     QList<msg_ptr> m_msgs;
-    QMap< Msg*, bool> m_msg_ready;
-    unsigned int m_totmsgsize;
+    // msgs currently being processed by a worker
+    QList<msg_ptr> m_batch;
+    QFutureWatcher<qint64>* m_watcher;
+
+    Tomahawk::Counter* m_inlineCounter;
+    Tomahawk::Histogram* m_batchTimeHistogram;
+    Tomahawk::Histogram* m_batchSizeHistogram;
 };
 
 #endif // MSGPROCESSOR_H
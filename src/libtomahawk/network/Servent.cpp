@@ -45,6 +45,7 @@
 #include "Source.h"
 #include "SourceList.h"
 #include "StreamConnection.h"
+#include "StreamMultiplexer.h"
 #include "UrlHandler.h"
 
 #include <QCoreApplication>
@@ -56,6 +57,9 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 
+// upper bound of event-loop threads used for socket I/O
+#define MAX_NETWORK_THREADS 4
+
 #include <boost/bind.hpp>
 
 
@@ -63,6 +67,7 @@ typedef QPair< QList< SipInfo >, Connection* > sipConnectionPair;
 Q_DECLARE_METATYPE( sipConnectionPair )
 Q_DECLARE_METATYPE( QList< SipInfo > )
 Q_DECLARE_METATYPE( Connection* )
+Q_DECLARE_METATYPE( ControlConnection* )
 Q_DECLARE_METATYPE( QTcpSocketExtra* )
 Q_DECLARE_METATYPE( Tomahawk::peerinfo_ptr )
 
@@ -83,9 +88,23 @@ Servent::Servent( QObject* parent )
     : QTcpServer( parent ),
       d_ptr( new ServentPrivate( this ) )
 {
+    Q_D( Servent );
     s_instance = this;
 
-    d_func()->noAuth = qApp->arguments().contains( "--noauth" );
+    qRegisterMetaType< Tomahawk::peerinfo_ptr >( "Tomahawk::peerinfo_ptr" );
+    qRegisterMetaType< ControlConnection* >( "ControlConnection*" );
+
+    d->noAuth = qApp->arguments().contains( "--noauth" );
+
+    const int threadCount = qBound( 1, QThread::idealThreadCount() / 2, MAX_NETWORK_THREADS );
+    for ( int i = 0; i < threadCount; i++ )
+    {
+        QThread* thread = new QThread();
+        thread->setObjectName( QString( "Network thread %1" ).arg( i ) );
+        thread->start();
+        d->networkThreads << QPointer< QThread >( thread );
+    }
+    tDebug() << Q_FUNC_INFO << "Using" << threadCount << "network threads";
 
     setProxy( QNetworkProxy::NoProxy );
 
@@ -98,6 +117,16 @@ Servent::~Servent()
 {
     tDebug() << Q_FUNC_INFO;
 
+    // Stop all socket I/O before tearing down the connections living on those threads
+    foreach ( QPointer< QThread > thread, d_func()->networkThreads )
+    {
+        if ( thread )
+        {
+            thread.data()->quit();
+            thread.data()->wait( 60000 );
+        }
+    }
+
     foreach ( ControlConnection* cc, d_func()->controlconnections )
         delete cc;
 
@@ -108,6 +137,12 @@ Servent::~Servent()
         delete d_func()->portfwd.data();
     }
 
+    foreach ( QPointer< QThread > thread, d_func()->networkThreads )
+    {
+        if ( thread )
+            delete thread.data();
+    }
+
     delete d_ptr;
 }
 
@@ -117,45 +152,53 @@ Servent::startListening( QHostAddress ha, bool upnp, int port, Tomahawk::Network
 {
     Q_D( Servent );
 
-    d->externalAddresses = QList<QHostAddress>();
-    d->port = port;
+    // Still on the caller's thread, which owns the database connection we may use
+    d->dbid = Database::instance()->impl()->dbid();
 
     // Listen on both the selected port and, if not the same, the default port -- the latter sometimes necessary for zeroconf
     // TODO: only listen on both when zeroconf sip is enabled
     // TODO: use a real zeroconf system instead of a simple UDP broadcast?
-    if ( !listen( ha, d->port ) )
+    if ( !listen( ha, port ) )
     {
-        if ( d->port != defaultPort )
+        if ( port != defaultPort )
         {
             if ( !listen( ha, defaultPort ) )
             {
-                tLog() << Q_FUNC_INFO << "Failed to listen on both port" << d->port << "and port" << defaultPort;
+                tLog() << Q_FUNC_INFO << "Failed to listen on both port" << port << "and port" << defaultPort;
                 tLog() << Q_FUNC_INFO << "Error string is:" << errorString();
                 return false;
             }
             else
-                d->port = defaultPort;
+                port = defaultPort;
         }
     }
 
-    d->externalListenAll = false;
+    QList<QHostAddress> externalAddresses;
+    bool externalListenAll = false;
 
     if ( ha == QHostAddress::Any || ha == QHostAddress::AnyIPv6 )
     {
         // We are listening on all available addresses, so we should send a SipInfo for all of them.
-        d->externalAddresses = QNetworkInterface::allAddresses();
-        cleanAddresses( d->externalAddresses );
-        tLog( LOGVERBOSE ) << Q_FUNC_INFO << "Listening to" << d->externalAddresses;
-        d->externalListenAll = true;
+        externalAddresses = QNetworkInterface::allAddresses();
+        cleanAddresses( externalAddresses );
+        tLog( LOGVERBOSE ) << Q_FUNC_INFO << "Listening to" << externalAddresses;
+        externalListenAll = true;
     }
     else if ( ( ha.toString() != "127.0.0.1" ) && ( ha.toString() != "::1" ) && ( ha.toString() != "::7F00:1" ) )
     {
         // We listen only to one specific Address, only announce this.
-        d->externalAddresses.append( ha );
+        externalAddresses.append( ha );
     }
     // If we only accept connections via localhost, we'll announce nothing.
 
-    tLog( LOGVERBOSE ) << Q_FUNC_INFO << "Servent listening on port" << d->port
+    {
+        QMutexLocker locker( &d->addressesMutex );
+        d->port = port;
+        d->externalAddresses = externalAddresses;
+        d->externalListenAll = externalListenAll;
+    }
+
+    tLog( LOGVERBOSE ) << Q_FUNC_INFO << "Servent listening on port" << port
                        << "using address" << ha.toString()
                        << "- servent thread:" << thread()
                        << "- address mode:" << (int)( mode );
@@ -163,7 +206,10 @@ Servent::startListening( QHostAddress ha, bool upnp, int port, Tomahawk::Network
     switch ( mode )
     {
         case Tomahawk::Network::ExternalAddress::Static:
-            d->externalPort = externalPort;
+            {
+                QMutexLocker locker( &d->addressesMutex );
+                d->externalPort = externalPort;
+            }
             if ( autoDetectExternalIp )
             {
                 QNetworkReply* reply = Tomahawk::Utils::nam()->get( QNetworkRequest( QUrl( "http://toma.hk/?stat=1" ) ) );
@@ -172,8 +218,11 @@ Servent::startListening( QHostAddress ha, bool upnp, int port, Tomahawk::Network
             }
             else
             {
-                d->externalHostname = externalHost;
-                d->ready = true;
+                {
+                    QMutexLocker locker( &d->addressesMutex );
+                    d->externalHostname = externalHost;
+                    d->ready = true;
+                }
                 // All setup is made, were done.
                 emit ready();
             }
@@ -181,7 +230,7 @@ Servent::startListening( QHostAddress ha, bool upnp, int port, Tomahawk::Network
 
         case Tomahawk::Network::ExternalAddress::Lan:
             // Nothing has to be done here.
-            d->ready = true;
+            setReady();
             emit ready();
             break;
 
@@ -190,7 +239,7 @@ Servent::startListening( QHostAddress ha, bool upnp, int port, Tomahawk::Network
             {
                 // upnp could be turned off on the cli with --noupnp
                 tLog( LOGVERBOSE ) << Q_FUNC_INFO << "External address mode set to upnp...";
-                d->portfwd = QPointer< PortFwdThread >( new PortFwdThread( d->port ) );
+                d->portfwd = QPointer< PortFwdThread >( new PortFwdThread( port ) );
                 Q_ASSERT( d->portfwd );
                 connect( d->portfwd.data(), SIGNAL( externalAddressDetected( QHostAddress, unsigned int ) ),
                                       SLOT( setExternalAddress( QHostAddress, unsigned int ) ) );
@@ -198,7 +247,7 @@ Servent::startListening( QHostAddress ha, bool upnp, int port, Tomahawk::Network
             }
             else
             {
-                d->ready = true;
+                setReady();
                 emit ready();
             }
             break;
@@ -208,6 +257,10 @@ Servent::startListening( QHostAddress ha, bool upnp, int port, Tomahawk::Network
              this, SLOT( checkACLResult( QString, QString, Tomahawk::ACLStatus::Type ) ),
              Qt::QueuedConnection );
 
+    // Accept connections and run all handshakes on our own event loop from now on
+    if ( thread() != d->networkThreads.first() )
+        moveToThread( d->networkThreads.first() );
+
     return true;
 }
 
@@ -215,22 +268,36 @@ Servent::startListening( QHostAddress ha, bool upnp, int port, Tomahawk::Network
 void
 Servent::setExternalAddress( QHostAddress ha, unsigned int port )
 {
-    if ( isValidExternalIP( ha ) )
+    bool failed;
     {
-        d_func()->externalHostname = ha.toString();
-        d_func()->externalPort = port;
+        QMutexLocker locker( &d_func()->addressesMutex );
+        if ( isValidExternalIP( ha ) )
+        {
+            d_func()->externalHostname = ha.toString();
+            d_func()->externalPort = port;
+        }
+
+        failed = d_func()->externalPort == 0 || !isValidExternalIP( ha );
+        d_func()->ready = true;
     }
 
-    if ( d_func()->externalPort == 0 || !isValidExternalIP( ha ) )
+    if ( failed )
         tLog() << Q_FUNC_INFO << "UPnP failed, no further external address could be acquired!";
     else
         tLog( LOGVERBOSE ) << Q_FUNC_INFO << "UPnP setup successful";
 
-    d_func()->ready = true;
     emit ready();
 }
 
 
+void
+Servent::setReady()
+{
+    QMutexLocker locker( &d_func()->addressesMutex );
+    d_func()->ready = true;
+}
+
+
 QString
 Servent::createConnectionKey( const QString& name, const QString &nodeid, const QString &key, bool onceOnly )
 {
@@ -310,6 +377,7 @@ Servent::isValidExternalIP( const QHostAddress& addr )
 void
 Servent::registerOffer( const QString& key, Connection* conn )
 {
+    QMutexLocker locker( &d_func()->offersMutex );
     d_func()->offers[key] = QPointer<Connection>(conn);
 }
 
@@ -317,7 +385,13 @@ Servent::registerOffer( const QString& key, Connection* conn )
 void
 Servent::registerLazyOffer(const QString &key, const peerinfo_ptr &peerInfo, const QString &nodeid, const int timeout )
 {
-    d_func()->lazyoffers[key] = QPair< peerinfo_ptr, QString >( peerInfo, nodeid );
+    Q_ASSERT( this->thread() == QThread::currentThread() );
+
+    {
+        QMutexLocker locker( &d_func()->offersMutex );
+        d_func()->lazyoffers[key] = QPair< peerinfo_ptr, QString >( peerInfo, nodeid );
+    }
+
     QTimer* timer = new QTimer( this );
     timer->setInterval( timeout );
     timer->setSingleShot( true );
@@ -329,7 +403,10 @@ Servent::registerLazyOffer(const QString &key, const peerinfo_ptr &peerInfo, con
 void
 Servent::deleteLazyOffer( const QString& key )
 {
-    d_func()->lazyoffers.remove( key );
+    {
+        QMutexLocker locker( &d_func()->offersMutex );
+        d_func()->lazyoffers.remove( key );
+    }
 
     // Cleanup.
     QTimer* timer = (QTimer*)sender();
@@ -404,29 +481,32 @@ Servent::getLocalSipInfos( const QString& nodeid, const QString& key )
     Q_D( Servent );
 
     QList<SipInfo> sipInfos = QList<SipInfo>();
-    QList<QHostAddress> addresses = d->externalAddresses;
+    const QList<QHostAddress> addresses = this->addresses();
 
-    if ( d->externalListenAll )
+    int port, externalPort;
+    QString externalHostname;
     {
-        addresses = QNetworkInterface::allAddresses();
-        cleanAddresses( addresses );
+        QMutexLocker locker( &d->addressesMutex );
+        port = d->port;
+        externalPort = d->externalPort;
+        externalHostname = d->externalHostname;
     }
 
     foreach ( QHostAddress ha, addresses )
     {
         SipInfo info = SipInfo();
         info.setHost( ha.toString() );
-        info.setPort( d_func()->port );
+        info.setPort( port );
         info.setKey( key );
         info.setVisible( true );
         info.setNodeId( nodeid );
         sipInfos.append( info );
     }
-    if ( d_func()->externalHostname.length() > 0)
+    if ( externalHostname.length() > 0)
     {
         SipInfo info = SipInfo();
-        info.setHost( d_func()->externalHostname );
-        info.setPort( d_func()->externalPort );
+        info.setHost( externalHostname );
+        info.setPort( externalPort );
         info.setKey( key );
         info.setVisible( true );
         info.setNodeId( nodeid );
@@ -457,6 +537,7 @@ Servent::queueForAclResult( const QString& username, const QSet<peerinfo_ptr>& p
         return;
     }
 
+    QMutexLocker locker( &d_func()->aclQueueMutex );
     if ( !d_func()->queuedForACLResult.contains( username ) )
     {
         d_func()->queuedForACLResult[username] = QMap<QString, QSet<Tomahawk::peerinfo_ptr> >();
@@ -487,6 +568,12 @@ Servent::getSipInfoForOldVersions( const QList<SipInfo>& sipInfos )
 void
 Servent::registerPeer( const Tomahawk::peerinfo_ptr& peerInfo )
 {
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( this, "registerPeer", Qt::QueuedConnection, Q_ARG( Tomahawk::peerinfo_ptr, peerInfo ) );
+        return;
+    }
+
     if ( peerInfo->hasControlConnection() )
     {
         peerInfoDebug( peerInfo ) << "already had control connection, doing nothing: " << peerInfo->controlConnection()->name();
@@ -527,7 +614,7 @@ Servent::registerPeer( const Tomahawk::peerinfo_ptr& peerInfo )
     else
     {
         QString key = uuid();
-        const QString& nodeid = Database::instance()->impl()->dbid();
+        const QString& nodeid = d_func()->dbid;
 
         QList<SipInfo> sipInfos = getLocalSipInfos( nodeid, key );
         // The offer should be removed after some time or we will build up a heap of unused PeerInfos
@@ -676,7 +763,11 @@ Servent::readyRead()
         }
 
         // for zeroconf there might be no offer, that case is handled later
-        ControlConnection* ccMatch = qobject_cast< ControlConnection* >( d_func()->offers.value( key ).data() );
+        ControlConnection* ccMatch = 0;
+        {
+            QMutexLocker offersLocker( &d->offersMutex );
+            ccMatch = qobject_cast< ControlConnection* >( d_func()->offers.value( key ).data() );
+        }
         if ( dupe && ccMatch )
         {
             tLog() << "Duplicate control connection detected, dropping:" << nodeid << conntype;
@@ -755,6 +846,7 @@ Servent::readyRead()
             registerControlConnection( qobject_cast<ControlConnection*>(conn) );
         }
 
+        conn->setPeerCodecs( m.value( "codecs" ).toStringList() );
         handoverSocket( conn, sock.data() );
         return;
     }
@@ -799,7 +891,7 @@ Servent::createParallelConnection( Connection* orig_conn, Connection* new_conn,
         m.insert( "conntype", "request-offer" );
         m.insert( "key", tmpkey );
         m.insert( "offer", key );
-        m.insert( "controlid", Database::instance()->impl()->dbid() );
+        m.insert( "controlid", d_func()->dbid );
 
         if (orig_conn) {
             orig_conn->sendMsg( Msg::factory( TomahawkUtils::toJson( m ), Msg::JSON ) );
@@ -877,22 +969,25 @@ Servent::initiateConnection( const SipInfo& sipInfo, Connection* conn )
     Q_ASSERT( conn );
 
     // Check that we are not connecting to ourselves
-    QList<QHostAddress> addresses = d->externalAddresses;
-
-    if ( d->externalListenAll )
+    QList<QHostAddress> addresses;
+    QString externalHostname;
+    int port;
     {
-        addresses = QNetworkInterface::allAddresses();
+        QMutexLocker locker( &d->addressesMutex );
+        addresses = d->externalListenAll ? QNetworkInterface::allAddresses() : d->externalAddresses;
+        externalHostname = d->externalHostname;
+        port = d->port;
     }
 
     foreach ( QHostAddress ha, addresses )
     {
-        if ( sipInfo.host() == ha.toString() && sipInfo.port() == d_func()->port )
+        if ( sipInfo.host() == ha.toString() && sipInfo.port() == port )
         {
             tLog( LOGVERBOSE ) << Q_FUNC_INFO << "Tomahawk won't try to connect to" << sipInfo.host() << ":" << sipInfo.port() << ": same IP as ourselves.";
             return;
         }
     }
-    if ( sipInfo.host() == d_func()->externalHostname && sipInfo.port() == d_func()->port )
+    if ( sipInfo.host() == externalHostname && sipInfo.port() == port )
     {
         tLog( LOGVERBOSE ) << Q_FUNC_INFO << "Tomahawk won't try to connect to" << sipInfo.host() << ":" << sipInfo.port() << ": same IP as ourselves.";
         return;
@@ -903,7 +998,7 @@ Servent::initiateConnection( const SipInfo& sipInfo, Connection* conn )
         QVariantMap m;
         m["conntype"]  = "accept-offer";
         m["key"]       = sipInfo.key();
-        m["controlid"] = Database::instance()->impl()->dbid();
+        m["controlid"] = d->dbid;
         conn->setFirstMessage( m );
     }
 
@@ -958,18 +1053,23 @@ Servent::socketError( QAbstractSocket::SocketError e )
 void
 Servent::checkACLResult( const QString& nodeid, const QString& username, Tomahawk::ACLStatus::Type peerStatus )
 {
-
-    if ( !d_func()->queuedForACLResult.contains( username ) )
+    QSet<Tomahawk::peerinfo_ptr> peerInfos;
     {
-        return;
-    }
-    if ( !d_func()->queuedForACLResult.value( username ).contains( nodeid ) )
-    {
-        return;
+        QMutexLocker locker( &d_func()->aclQueueMutex );
+        if ( !d_func()->queuedForACLResult.contains( username ) )
+        {
+            return;
+        }
+        if ( !d_func()->queuedForACLResult.value( username ).contains( nodeid ) )
+        {
+            return;
+        }
+
+        // We have a result, so remove from queue
+        peerInfos = d_func()->queuedForACLResult[username].take( nodeid );
     }
 
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << QString( "ACL status for user %1 is" ).arg( username ) << peerStatus;
-    QSet<Tomahawk::peerinfo_ptr> peerInfos = d_func()->queuedForACLResult.value( username ).value( nodeid );
     if ( peerStatus == Tomahawk::ACLStatus::Stream )
     {
         foreach ( Tomahawk::peerinfo_ptr peerInfo, peerInfos )
@@ -978,8 +1078,6 @@ Servent::checkACLResult( const QString& nodeid, const QString& username, Tomahaw
         }
 
     }
-    // We have a result, so remove from queue
-    d_func()->queuedForACLResult[username].remove( nodeid );
 }
 
 
@@ -997,24 +1095,32 @@ Servent::ipDetected()
         if ( !ok )
         {
             tLog() << Q_FUNC_INFO << "Failed parsing ip-autodetection response";
-            d->externalPort = -1;
+            {
+                QMutexLocker locker( &d->addressesMutex );
+                d->externalPort = -1;
+            }
             emit ipDetectionFailed( QNetworkReply::NoError, tr( "Automatically detecting external IP failed: Could not parse JSON response." ) );
         }
         else
         {
             QString externalIP = res.value( "ip" ).toString();
             tLog( LOGVERBOSE ) << Q_FUNC_INFO << "Found external IP:" << externalIP;
+
+            QMutexLocker locker( &d->addressesMutex );
             d->externalHostname = externalIP;
         }
     }
     else
     {
-        d->externalPort = -1;
+        {
+            QMutexLocker locker( &d->addressesMutex );
+            d->externalPort = -1;
+        }
         tLog() << Q_FUNC_INFO << "ip-autodetection returned an error:" << reply->errorString();
         emit ipDetectionFailed( reply->error(), tr( "Automatically detecting external IP failed: %1" ).arg( reply->errorString() ) );
     }
 
-    d->ready = true;
+    setReady();
     emit ready();
 }
 
@@ -1022,21 +1128,38 @@ Servent::ipDetected()
 void
 Servent::reverseOfferRequest( ControlConnection* orig_conn, const QString& theirdbid, const QString& key, const QString& theirkey )
 {
-    Q_ASSERT( this->thread() == QThread::currentThread() );
+    // Called from the network thread of orig_conn, but the connection we claim has to be created on ours
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( this, "reverseOfferRequest", Qt::QueuedConnection,
+                                   Q_ARG( ControlConnection*, orig_conn ), Q_ARG( QString, theirdbid ),
+                                   Q_ARG( QString, key ), Q_ARG( QString, theirkey ) );
+        return;
+    }
+
+    {
+        // It unregisters itself before it goes away
+        QMutexLocker locker( &d_func()->controlconnectionsMutex );
+        if ( !d_func()->controlconnections.contains( orig_conn ) )
+        {
+            tDebug() << "Requesting connection went away, dropping reverse offer for" << key;
+            return;
+        }
+    }
 
     tDebug( LOGVERBOSE ) << "Servent::reverseOfferRequest received for" << key;
     Connection* new_conn = claimOffer( orig_conn, theirdbid, key );
     if ( !new_conn )
     {
         tDebug() << "claimOffer failed, killing requesting connection out of spite";
-        orig_conn->shutdown();
+        QMetaObject::invokeMethod( orig_conn, "shutdown", Qt::QueuedConnection, Q_ARG( bool, false ) );
         return;
     }
 
     QVariantMap m;
     m["conntype"]  = "push-offer";
     m["key"]       = theirkey;
-    m["controlid"] = Database::instance()->impl()->dbid();
+    m["controlid"] = d_func()->dbid;
     new_conn->setFirstMessage( m );
     createParallelConnection( orig_conn, new_conn, theirkey );
 }
@@ -1045,6 +1168,7 @@ Servent::reverseOfferRequest( ControlConnection* orig_conn, const QString& their
 bool
 Servent::visibleExternally() const
 {
+    QMutexLocker locker( &d_func()->addressesMutex );
     return (!d_func()->externalHostname.isNull()) || (d_func()->externalAddresses.length() > 0);
 }
 
@@ -1052,7 +1176,13 @@ Servent::visibleExternally() const
 bool
 Servent::ipv6ConnectivityLikely() const
 {
-    foreach ( QHostAddress ha, d_func()->externalAddresses )
+    QList<QHostAddress> addresses;
+    {
+        QMutexLocker locker( &d_func()->addressesMutex );
+        addresses = d_func()->externalAddresses;
+    }
+
+    foreach ( QHostAddress ha, addresses )
     {
         if ( ha.protocol() == QAbstractSocket::IPv6Protocol && Servent::isValidExternalIP( ha ) )
         {
@@ -1067,6 +1197,7 @@ Servent::ipv6ConnectivityLikely() const
 int
 Servent::port() const
 {
+    QMutexLocker locker( &d_func()->addressesMutex );
     return d_func()->port;
 }
 
@@ -1076,20 +1207,22 @@ Servent::addresses() const
 {
     Q_D( const Servent );
 
-    if ( d->externalListenAll )
     {
-        QList<QHostAddress> addresses( QNetworkInterface::allAddresses() );
-        cleanAddresses( addresses );
-        return addresses;
+        QMutexLocker locker( &d->addressesMutex );
+        if ( !d->externalListenAll )
+            return d->externalAddresses;
     }
 
-    return d->externalAddresses;
+    QList<QHostAddress> addresses( QNetworkInterface::allAddresses() );
+    cleanAddresses( addresses );
+    return addresses;
 }
 
 
 QString
 Servent::additionalAddress() const
 {
+    QMutexLocker locker( &d_func()->addressesMutex );
     return d_func()->externalHostname;
 }
 
@@ -1097,6 +1230,7 @@ Servent::additionalAddress() const
 int
 Servent::additionalPort() const
 {
+    QMutexLocker locker( &d_func()->addressesMutex );
     return d_func()->externalPort;
 }
 
@@ -1121,6 +1255,8 @@ Connection*
 Servent::claimOffer( ControlConnection* cc, const QString &nodeid, const QString &key, const QHostAddress peer )
 {
     Q_D( Servent );
+    // Connections created here are parented to our thread, see reverseOfferRequest()
+    Q_ASSERT( thread() == QThread::currentThread() );
 
     // magic key for stream connections:
     if ( key.startsWith( "FILE_REQUEST_KEY:" ) )
@@ -1182,6 +1318,7 @@ Servent::claimOffer( ControlConnection* cc, const QString &nodeid, const QString
         }
     }
 
+    QMutexLocker locker( &d->offersMutex );
     if ( d->lazyoffers.contains( key ) )
     {
         ControlConnection* conn = new ControlConnection( this );
@@ -1260,6 +1397,14 @@ Servent::remoteIODeviceFactory( const Tomahawk::result_ptr& result, const QStrin
     }
 
     ControlConnection* cc = s->controlConnection();
+    if ( cc->multiplexer()->isSupported() )
+    {
+        // No new connection needed, stream it over the one we already have
+        sp = cc->multiplexer()->openStream( result, fileId );
+        callback( result->url(), sp );
+        return;
+    }
+
     StreamConnection* sc = new StreamConnection( this, cc, fileId, result );
     createParallelConnection( cc, sc, QString( "FILE_REQUEST_KEY:%1" ).arg( fileId ) );
 
@@ -1272,10 +1417,10 @@ Servent::remoteIODeviceFactory( const Tomahawk::result_ptr& result, const QStrin
 void
 Servent::registerStreamConnection( StreamConnection* sc )
 {
+    QMutexLocker lock( &d_func()->ftsession_mut );
     Q_ASSERT( !d_func()->scsessions.contains( sc ) );
     tDebug( LOGVERBOSE ) << "Registering Stream" << d_func()->scsessions.length() + 1;
 
-    QMutexLocker lock( &d_func()->ftsession_mut );
     d_func()->scsessions.append( sc );
 
     printCurrentTransfers();
@@ -1419,6 +1564,7 @@ Servent::connectedToSession( const QString& session )
 unsigned int
 Servent::numConnectedPeers() const
 {
+    QMutexLocker locker( &d_func()->controlconnectionsMutex );
     return d_func()->controlconnections.length();
 }
 
@@ -1426,6 +1572,7 @@ Servent::numConnectedPeers() const
 QList<StreamConnection*>
 Servent::streams() const
 {
+    QMutexLocker lock( &d_func()->ftsession_mut );
     return d_func()->scsessions;
 }
 
@@ -1451,5 +1598,23 @@ Servent::triggerDBSync()
 bool
 Servent::isReady() const
 {
+    QMutexLocker locker( &d_func()->addressesMutex );
     return d_func()->ready;
 }
+
+
+QString
+Servent::dbid() const
+{
+    return d_func()->dbid;
+}
+
+
+QThread*
+Servent::networkThread()
+{
+    Q_D( Servent );
+
+    const uint next = d->nextNetworkThread.fetchAndAddRelaxed( 1 );
+    return d->networkThreads.at( next % d->networkThreads.count() ).data();
+}
@@ -76,6 +76,9 @@ public:
      * @param externalHost manually supplied external hostname (only with mode == Tomahawk::Network::ExternalAddress::Static)
      * @param externalPort manually supplied external port (only with mode == Tomahawk::Network::ExternalAddress::Static)
      * @return True if we could listen on any of the supplied ports.
+     *
+     * Once listening, the Servent moves itself onto its network thread, so
+     * incoming connections are never accepted on the caller's event loop.
      */
     bool startListening( QHostAddress ha, bool upnp, int port,
                          Tomahawk::Network::ExternalAddress::Mode mode,
@@ -98,11 +101,11 @@ public:
                                     boost::function< void ( const QString&, QSharedPointer< QIODevice >& ) > callback );
 
     // you may call this method as often as you like for the same peerInfo, dupe checking is done inside
-    void registerPeer( const Tomahawk::peerinfo_ptr& peerInfo );
+    Q_INVOKABLE void registerPeer( const Tomahawk::peerinfo_ptr& peerInfo );
     void handleSipInfo( const Tomahawk::peerinfo_ptr& peerInfo );
 
     void initiateConnection( const SipInfo& sipInfo, Connection* conn );
-    void reverseOfferRequest( ControlConnection* orig_conn, const QString &theirdbid, const QString& key, const QString& theirkey );
+    Q_INVOKABLE void reverseOfferRequest( ControlConnection* orig_conn, const QString &theirdbid, const QString& key, const QString& theirkey );
 
     bool visibleExternally() const;
 
@@ -142,6 +145,18 @@ public:
 
     bool isReady() const;
 
+    /**
+     * Our database id, safe to call from any thread once we are listening.
+     */
+    QString dbid() const;
+
+    /**
+     * The network thread a new connection should do its socket I/O on.
+     *
+     * Threads are handed out round-robin, so connections are spread evenly.
+     */
+    QThread* networkThread();
+
     QList<SipInfo> getLocalSipInfos(const QString& nodeid, const QString &key);
 
     void queueForAclResult( const QString& username, const QSet<Tomahawk::peerinfo_ptr>& peerInfos );
@@ -194,6 +209,7 @@ private:
 
     void handoverSocket( Connection* conn, QTcpSocketExtra* sock );
     void cleanupSocket( QTcpSocketExtra* sock );
+    void setReady();
     void printCurrentTransfers();
 
     /**
@@ -24,8 +24,11 @@
 
 #include "Servent.h"
 
+#include <QAtomicInt>
 #include <QMutex>
+#include <QPointer>
 #include <QStringList>
+#include <QThread>
 
 #include <boost/function.hpp>
 
@@ -45,15 +48,42 @@ public:
     Q_DECLARE_PUBLIC ( Servent )
 
 private:
+    /**
+     * Event-loop threads running all socket I/O.
+     *
+     * The Servent itself lives on the first one, connections are spread
+     * round-robin over all of them.
+     */
+    QList< QPointer< QThread > > networkThreads;
+    QAtomicInt nextNetworkThread;
+
+    /**
+     * Offers are registered by connections from their own network thread.
+     */
+    QMutex offersMutex;
     QMap< QString, QPointer< Connection > > offers;
     QMap< QString, QPair< Tomahawk::peerinfo_ptr, QString > > lazyoffers;
-    QStringList connectedNodes;
 
     /**
-     * canonical list of authed peers
+     * canonical list of authed peers, and the node ids they belong to
      */
-    QMutex controlconnectionsMutex;
+    mutable QMutex controlconnectionsMutex;
     QList< ControlConnection* > controlconnections;
+    QStringList connectedNodes;
+
+    /**
+     * Our database id, cached when we start listening.
+     *
+     * Connection threads must not call Database::impl(), it opens a database
+     * connection for every thread it is called from.
+     */
+    QString dbid;
+
+    /**
+     * Guards the addresses, ports and ready flag below, they are set up on our thread
+     * and read from the GUI and connection threads.
+     */
+    mutable QMutex addressesMutex;
 
     /**
      * The external port used by all address except those obtained via UPnP or the static configuration option
@@ -88,8 +118,9 @@ private:
 
     // currently active file transfers:
     QList< StreamConnection* > scsessions;
-    QMutex ftsession_mut;
+    mutable QMutex ftsession_mut;
     // username -> nodeid -> PeerInfos
+    QMutex aclQueueMutex;
     QMap<QString, QMap<QString, QSet<Tomahawk::peerinfo_ptr> > > queuedForACLResult;
 
     QPointer< PortFwdThread > portfwd;
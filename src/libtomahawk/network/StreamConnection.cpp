@@ -100,11 +100,9 @@ StreamConnection::~StreamConnection()
         qDebug() << "FTConnection closing before last data msg received, shame.";
         //TODO log the fact that our peer was bad-mannered enough to not finish the upload
 
-        // protected, we could expose it:
-        //m_iodev->setErrorString("FTConnection providing data went away mid-transfer");
-
+        // Not a complete track, it must not end up in the cache as one
         if ( !m_iodev.isNull() )
-            ((BufferIODevice*)m_iodev.data())->inputComplete();
+            ((BufferIODevice*)m_iodev.data())->inputComplete( tr( "FTConnection providing data went away mid-transfer" ) );
     }
 
     Servent::instance()->onStreamFinished( this );
@@ -0,0 +1,532 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StreamMultiplexer.h"
+
+#include "database/Database.h"
+#include "database/DatabaseCommand_LoadFiles.h"
+#include "network/BufferIoDevice.h"
+#include "network/ControlConnection.h"
+#include "utils/Json.h"
+#include "utils/Logger.h"
+
+#include "Result.h"
+#include "UrlHandler.h"
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTimer>
+#include <QtEndian>
+
+// Blocks a sender may have in flight per stream (256KiB with the 4KiB BufferIODevice blocks)
+#define MUX_WINDOW 64
+// Stream id + block number
+#define MUX_HEADER_SIZE 8
+
+using namespace Tomahawk;
+
+
+StreamMultiplexer::StreamMultiplexer( ControlConnection* cc )
+    : QObject( cc )
+    , m_cc( cc )
+    , m_supported( false )
+    , m_nextId( 0 )
+    , m_active( -1 )
+    , m_sendScheduled( false )
+{
+}
+
+
+StreamMultiplexer::~StreamMultiplexer()
+{
+    // Like a StreamConnection going away: let the player have what we got so far
+    QMutexLocker lock( &m_mutex );
+    foreach ( const IncomingStream& stream, m_incoming )
+    {
+        if ( stream.device )
+            stream.device.data()->inputComplete( tr( "Connection to peer closed mid-transfer" ) );
+    }
+}
+
+
+QStringList
+StreamMultiplexer::features()
+{
+    return QStringList() << "mux";
+}
+
+
+bool
+StreamMultiplexer::isSupported() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_supported;
+}
+
+
+void
+StreamMultiplexer::setPeerFeatures( const QStringList& features )
+{
+    QMutexLocker lock( &m_mutex );
+    m_supported = features.contains( "mux" );
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Peer supports multiplexed streams:" << m_supported;
+}
+
+
+QSharedPointer< QIODevice >
+StreamMultiplexer::openStream( const Tomahawk::result_ptr& result, const QString& fid )
+{
+    BufferIODevice* device = new BufferIODevice( result->size() );
+    QSharedPointer< QIODevice > iodev( device, &QObject::deleteLater );
+    iodev->open( QIODevice::ReadWrite );
+
+    int id;
+    {
+        QMutexLocker lock( &m_mutex );
+        id = ++m_nextId;
+
+        IncomingStream stream;
+        stream.device = device;
+        stream.unacked = 0;
+        m_incoming.insert( id, stream );
+        m_deviceIds.insert( device, id );
+    }
+
+    // The device gets filled from our thread, its requests are queued to us from the player's
+    if ( device->thread() != thread() )
+        device->moveToThread( thread() );
+    connect( device, SIGNAL( blockRequest( int ) ), SLOT( onBlockRequest( int ) ) );
+    connect( device, SIGNAL( aboutToClose() ), SLOT( onDeviceClosed() ) );
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Opening stream" << id << "for file" << fid;
+    QMetaObject::invokeMethod( this, "sendOpen", Qt::QueuedConnection, Q_ARG( int, id ), Q_ARG( QString, fid ) );
+
+    return iodev;
+}
+
+
+void
+StreamMultiplexer::sendOpen( int id, const QString& fid )
+{
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( !m_incoming.contains( id ) )
+            return; // Closed before we got to open it
+    }
+
+    QVariantMap args;
+    args.insert( "fid", fid );
+    args.insert( "credit", MUX_WINDOW );
+    sendControl( "stream-open", id, args );
+}
+
+
+bool
+StreamMultiplexer::handleControlMsg( const QVariantMap& m )
+{
+    const QString method = m.value( "method" ).toString();
+    if ( !method.startsWith( "stream-" ) )
+        return false;
+
+    const int id = m.value( "id" ).toInt();
+
+    // Msgs from the receiving side
+    if ( method == "stream-open" )
+    {
+        if ( m_outgoing.contains( id ) )
+        {
+            tLog() << Q_FUNC_INFO << "Peer reused stream id" << id;
+            return true;
+        }
+
+        OutgoingStream stream;
+        stream.size = 0;
+        stream.credit = m.value( "credit" ).toInt();
+        stream.block = 0;
+        m_outgoing.insert( id, stream );
+
+        // The newest stream is what the peer is going to play
+        m_sendOrder.append( id );
+        m_active = id;
+
+        loadFile( id, m.value( "fid" ).toString() );
+    }
+    else if ( method == "stream-seek" )
+    {
+        if ( !m_outgoing.contains( id ) )
+            return true;
+
+        const int block = m.value( "block" ).toInt();
+        OutgoingStream& stream = m_outgoing[ id ];
+        if ( !isValidBlock( stream, block ) )
+        {
+            tLog() << Q_FUNC_INFO << "Peer seeked stream" << id << "to invalid block" << block;
+            failOutgoing( id );
+            return true;
+        }
+
+        stream.block = block;
+        if ( stream.readdev )
+            stream.readdev->seek( (qint64)stream.block * BufferIODevice::blockSize() );
+
+        // Seeking means the user is interacting with this one
+        m_active = id;
+        scheduleSend();
+    }
+    else if ( method == "stream-credit" )
+    {
+        if ( !m_outgoing.contains( id ) )
+            return true;
+
+        m_outgoing[ id ].credit += m.value( "blocks" ).toInt();
+        scheduleSend();
+    }
+    else if ( method == "stream-close" )
+    {
+        m_outgoing.remove( id );
+        m_sendOrder.removeAll( id );
+        if ( m_active == id )
+            m_active = m_sendOrder.isEmpty() ? -1 : m_sendOrder.last();
+    }
+    // Msgs from the sending side
+    else if ( method == "stream-error" )
+    {
+        QPointer< BufferIODevice > device;
+        {
+            QMutexLocker lock( &m_mutex );
+            device = m_incoming.value( id ).device;
+            m_deviceIds.remove( device.data() );
+            m_incoming.remove( id );
+        }
+
+        tLog() << Q_FUNC_INFO << "Peer could not serve stream" << id;
+        if ( device )
+            device.data()->inputComplete( tr( "Peer could not serve the file" ) );
+    }
+    else
+    {
+        tDebug() << Q_FUNC_INFO << "Unknown stream msg:" << method;
+    }
+
+    return true;
+}
+
+
+void
+StreamMultiplexer::handleData( const msg_ptr& msg )
+{
+    const QByteArray payload = msg->payload();
+    if ( payload.length() < MUX_HEADER_SIZE )
+    {
+        tLog() << Q_FUNC_INFO << "Invalid stream data msg";
+        return;
+    }
+
+    const int id = qFromBigEndian< quint32 >( reinterpret_cast< const uchar* >( payload.constData() ) );
+    const int block = qFromBigEndian< quint32 >( reinterpret_cast< const uchar* >( payload.constData() + 4 ) );
+
+    QPointer< BufferIODevice > device;
+    int credit = 0;
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( !m_incoming.contains( id ) )
+            return; // Already closed on our side, the rest was in flight
+
+        IncomingStream& stream = m_incoming[ id ];
+        device = stream.device;
+
+        if ( ++stream.unacked >= MUX_WINDOW / 2 )
+        {
+            credit = stream.unacked;
+            stream.unacked = 0;
+        }
+    }
+
+    if ( !device )
+    {
+        closeIncoming( id );
+        return;
+    }
+
+    device.data()->addData( block, payload.mid( MUX_HEADER_SIZE ) );
+
+    if ( device.data()->nextEmptyBlock() < 0 )
+    {
+        device.data()->inputComplete();
+        closeIncoming( id );
+        return;
+    }
+
+    if ( credit > 0 )
+    {
+        QVariantMap args;
+        args.insert( "blocks", credit );
+        sendControl( "stream-credit", id, args );
+    }
+}
+
+
+void
+StreamMultiplexer::onBlockRequest( int block )
+{
+    int id;
+    {
+        QMutexLocker lock( &m_mutex );
+        id = m_deviceIds.value( sender(), -1 );
+    }
+
+    if ( id < 0 )
+        return;
+
+    QVariantMap args;
+    args.insert( "block", block );
+    sendControl( "stream-seek", id, args );
+}
+
+
+void
+StreamMultiplexer::onDeviceClosed()
+{
+    int id;
+    {
+        QMutexLocker lock( &m_mutex );
+        id = m_deviceIds.value( sender(), -1 );
+    }
+
+    if ( id >= 0 )
+        closeIncoming( id );
+}
+
+
+void
+StreamMultiplexer::closeIncoming( int id )
+{
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( !m_incoming.contains( id ) )
+            return;
+
+        m_deviceIds.remove( m_incoming.value( id ).device.data() );
+        m_incoming.remove( id );
+    }
+
+    sendControl( "stream-close", id );
+}
+
+
+void
+StreamMultiplexer::failOutgoing( int id )
+{
+    m_outgoing.remove( id );
+    m_sendOrder.removeAll( id );
+    if ( m_active == id )
+        m_active = m_sendOrder.isEmpty() ? -1 : m_sendOrder.last();
+
+    sendControl( "stream-error", id );
+}
+
+
+void
+StreamMultiplexer::loadFile( int id, const QString& fid )
+{
+    DatabaseCommand_LoadFiles* cmd = new DatabaseCommand_LoadFiles( fid.toUInt() );
+    m_pendingLoads.insert( cmd, id );
+    connect( cmd, SIGNAL( result( Tomahawk::result_ptr ) ), SLOT( onFileLoaded( Tomahawk::result_ptr ) ) );
+    Database::instance()->enqueue( Tomahawk::dbcmd_ptr( cmd ) );
+}
+
+
+void
+StreamMultiplexer::onFileLoaded( const Tomahawk::result_ptr& result )
+{
+    const int id = m_pendingLoads.take( sender() );
+    if ( !m_outgoing.contains( id ) )
+        return;
+
+    if ( result.isNull() )
+    {
+        tLog() << Q_FUNC_INFO << "Peer requested unknown file for stream" << id;
+        failOutgoing( id );
+        return;
+    }
+
+    m_outgoing[ id ].result = result;
+    m_outgoing[ id ].size = result->size();
+
+    boost::function< void ( const QString, QSharedPointer< QIODevice > ) > callback =
+            boost::bind( &StreamMultiplexer::ioDeviceCallback, QPointer< StreamMultiplexer >( this ), id, _1, _2 );
+    Tomahawk::UrlHandler::getIODeviceForUrl( result, result->url(), callback );
+}
+
+
+void
+StreamMultiplexer::ioDeviceCallback( QPointer< StreamMultiplexer > mux, int id, const QString& url, QSharedPointer< QIODevice > io )
+{
+    Q_UNUSED( url );
+
+    // Resolvers may call us back from any thread
+    if ( mux )
+    {
+        QMetaObject::invokeMethod( mux.data(), "startSending", Qt::QueuedConnection,
+                                   Q_ARG( int, id ), Q_ARG( QSharedPointer< QIODevice >, io ) );
+    }
+}
+
+
+void
+StreamMultiplexer::startSending( int id, QSharedPointer< QIODevice > io )
+{
+    if ( !m_outgoing.contains( id ) )
+        return;
+
+    OutgoingStream& stream = m_outgoing[ id ];
+    if ( io.isNull() )
+    {
+        tLog() << Q_FUNC_INFO << "Couldn't read source of stream" << id;
+        failOutgoing( id );
+        return;
+    }
+
+    stream.readdev = io;
+    if ( stream.size <= 0 && !io->isSequential() )
+        stream.size = io->size();
+
+    // The peer may have seeked before we knew how big the file is
+    if ( !isValidBlock( stream, stream.block ) )
+    {
+        tLog() << Q_FUNC_INFO << "Peer seeked stream" << id << "to invalid block" << stream.block;
+        failOutgoing( id );
+        return;
+    }
+
+    if ( stream.block > 0 )
+        stream.readdev->seek( (qint64)stream.block * BufferIODevice::blockSize() );
+
+    // Streams from the network only become sendable as their data arrives
+    connect( io.data(), SIGNAL( readyRead() ), SLOT( onReadyRead() ) );
+
+    scheduleSend();
+}
+
+
+void
+StreamMultiplexer::onReadyRead()
+{
+    scheduleSend();
+}
+
+
+bool
+StreamMultiplexer::canSend( const OutgoingStream& stream )
+{
+    return stream.readdev && stream.credit > 0 && !stream.readdev->atEnd() && stream.readdev->bytesAvailable() > 0;
+}
+
+
+bool
+StreamMultiplexer::isValidBlock( const OutgoingStream& stream, int block )
+{
+    if ( block < 0 )
+        return false;
+
+    // Sizes we don't know (yet) get checked again in startSending()
+    return block == 0 || stream.size <= 0 || (qint64)block * BufferIODevice::blockSize() < stream.size;
+}
+
+
+int
+StreamMultiplexer::nextSendingStream() const
+{
+    if ( m_outgoing.contains( m_active ) )
+    {
+        if ( canSend( m_outgoing[ m_active ] ) )
+            return m_active;
+    }
+
+    // Background streams, oldest first: they are the ones closest to being played
+    foreach ( int id, m_sendOrder )
+    {
+        if ( canSend( m_outgoing[ id ] ) )
+            return id;
+    }
+
+    return -1;
+}
+
+
+void
+StreamMultiplexer::scheduleSend()
+{
+    if ( m_sendScheduled )
+        return;
+
+    m_sendScheduled = true;
+    QTimer::singleShot( 0, this, SLOT( sendNext() ) );
+}
+
+
+void
+StreamMultiplexer::sendNext()
+{
+    m_sendScheduled = false;
+
+    const int id = nextSendingStream();
+    if ( id < 0 )
+        return;
+
+    OutgoingStream& stream = m_outgoing[ id ];
+    const QByteArray data = stream.readdev->read( BufferIODevice::blockSize() );
+    if ( data.isEmpty() )
+    {
+        // Nothing after all, don't waste credit on it. readyRead brings us back.
+        return;
+    }
+
+    QByteArray ba( MUX_HEADER_SIZE, 0 );
+    qToBigEndian< quint32 >( id, reinterpret_cast< uchar* >( ba.data() ) );
+    qToBigEndian< quint32 >( stream.block, reinterpret_cast< uchar* >( ba.data() + 4 ) );
+    ba.append( data );
+
+    stream.block++;
+    stream.credit--;
+
+    sendMsg( Msg::factory( ba, Msg::RAW ) );
+
+    // Keep the event loop responsive, one block per iteration
+    scheduleSend();
+}
+
+
+void
+StreamMultiplexer::sendControl( const QString& method, int id, const QVariantMap& args )
+{
+    QVariantMap m = args;
+    m.insert( "method", method );
+    m.insert( "id", id );
+
+    sendMsg( Msg::factory( TomahawkUtils::toJson( m ), Msg::JSON ) );
+}
+
+
+void
+StreamMultiplexer::sendMsg( const msg_ptr& msg )
+{
+    m_cc->sendMsg( msg );
+}
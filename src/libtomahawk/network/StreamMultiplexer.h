@@ -0,0 +1,139 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAMMULTIPLEXER_H
+#define STREAMMULTIPLEXER_H
+
+#include "Msg.h"
+#include "Typedefs.h"
+#include "DllMacro.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QVariantMap>
+
+class BufferIODevice;
+class ControlConnection;
+class QIODevice;
+
+/**
+ * Carries file transfers as logical streams over a peer's ControlConnection.
+ *
+ * Without multiplexing every track we play from a peer needs its own offer,
+ * TCP connection and handshake (and a reverse connection if we are behind NAT),
+ * which is paid again on every skip. Peers announcing the "mux" feature instead
+ * exchange stream data over the connection that is already open:
+ *
+ *  - stream-open / stream-seek / stream-credit / stream-close are small JSON
+ *    control msgs, identified by a stream id chosen by the receiving side.
+ *  - Data is sent as RAW msgs: 4 byte stream id, 4 byte block number, block data.
+ *
+ * Each stream has a credit window of blocks the sender may have in flight, so a
+ * single transfer can't flood the connection. The most recently opened (or
+ * seeked) stream is the active one and is always served first, other streams
+ * only get bandwidth while it has no data or credit left.
+ *
+ * Lives in the thread of its ControlConnection, openStream() may be called from
+ * any thread.
+ */
+class DLLEXPORT StreamMultiplexer : public QObject
+{
+Q_OBJECT
+
+public:
+    /// @p cc may only be null in subclasses that implement sendMsg() and loadFile() themselves.
+    explicit StreamMultiplexer( ControlConnection* cc );
+    virtual ~StreamMultiplexer();
+
+    /// Features we announce to our peers.
+    static QStringList features();
+
+    /// Whether the peer announced support for multiplexed streams.
+    bool isSupported() const;
+    void setPeerFeatures( const QStringList& features );
+
+    /// Requests file @p fid from the peer, the returned device gets filled as data arrives.
+    QSharedPointer< QIODevice > openStream( const Tomahawk::result_ptr& result, const QString& fid );
+
+    /// Returns true if @p m was a stream control msg and has been handled.
+    bool handleControlMsg( const QVariantMap& m );
+    void handleData( const msg_ptr& msg );
+
+protected:
+    /// Puts @p msg on the wire, through our ControlConnection by default.
+    virtual void sendMsg( const msg_ptr& msg );
+    /// Looks up the file the peer asked for on stream @p id and passes it to startSending().
+    virtual void loadFile( int id, const QString& fid );
+
+protected slots:
+    /// Starts serving stream @p id from @p io, a null @p io fails the stream.
+    void startSending( int id, QSharedPointer< QIODevice > io );
+
+private slots:
+    void onBlockRequest( int block );
+    void onDeviceClosed();
+    void onFileLoaded( const Tomahawk::result_ptr& result );
+    void sendOpen( int id, const QString& fid );
+    void onReadyRead();
+    void sendNext();
+
+private:
+    struct IncomingStream
+    {
+        QPointer< BufferIODevice > device;
+        int unacked;
+    };
+
+    struct OutgoingStream
+    {
+        Tomahawk::result_ptr result;
+        QSharedPointer< QIODevice > readdev;
+        // 0 until known
+        qint64 size;
+        int credit;
+        int block;
+    };
+
+    static bool canSend( const OutgoingStream& stream );
+    static bool isValidBlock( const OutgoingStream& stream, int block );
+    static void ioDeviceCallback( QPointer< StreamMultiplexer > mux, int id, const QString& url, QSharedPointer< QIODevice > io );
+
+    void sendControl( const QString& method, int id, const QVariantMap& args = QVariantMap() );
+    void closeIncoming( int id );
+    void failOutgoing( int id );
+    void scheduleSend();
+    int nextSendingStream() const;
+
+    ControlConnection* m_cc;
+
+    mutable QMutex m_mutex;
+    bool m_supported;
+    int m_nextId;
+    QHash< int, IncomingStream > m_incoming;
+    QHash< QObject*, int > m_deviceIds;
+
+    // Only touched from our own thread
+    QHash< int, OutgoingStream > m_outgoing;
+    QHash< QObject*, int > m_pendingLoads;
+    QList< int > m_sendOrder;
+    int m_active;
+    bool m_sendScheduled;
+};
+
+#endif // STREAMMULTIPLEXER_H
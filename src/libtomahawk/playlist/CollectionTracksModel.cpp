@@ -0,0 +1,201 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CollectionTracksModel_p.h"
+
+#include "collection/Collection.h"
+#include "database/Database.h"
+#include "database/DatabaseCollection.h"
+#include "database/DatabaseCommand_AllTracks.h"
+#include "utils/Logger.h"
+
+// Rows per page, a few screens worth
+#define PAGE_SIZE 500
+// Load the next page once playback gets this close to the last loaded row
+#define PREFETCH_ROWS 25
+
+using namespace Tomahawk;
+
+
+static DatabaseCommand_AllTracks::SortOrder
+sortOrderForColumn( int column )
+{
+    switch ( column )
+    {
+        case PlayableModel::Track:
+            return DatabaseCommand_AllTracks::Track;
+        case PlayableModel::Composer:
+            return DatabaseCommand_AllTracks::Composer;
+        case PlayableModel::Album:
+            return DatabaseCommand_AllTracks::Album;
+        case PlayableModel::AlbumPos:
+            return DatabaseCommand_AllTracks::AlbumPosition;
+        case PlayableModel::Duration:
+            return DatabaseCommand_AllTracks::Duration;
+        case PlayableModel::Bitrate:
+            return DatabaseCommand_AllTracks::Bitrate;
+        case PlayableModel::Age:
+            return DatabaseCommand_AllTracks::ModificationTime;
+        case PlayableModel::Filesize:
+            return DatabaseCommand_AllTracks::FileSize;
+
+        default:
+            // Not known to the database (year, score, origin...)
+            return DatabaseCommand_AllTracks::Artist;
+    }
+}
+
+
+CollectionTracksModel::CollectionTracksModel( QObject* parent )
+    : PlayableModel( parent, new CollectionTracksModelPrivate( this ) )
+{
+}
+
+
+CollectionTracksModel::~CollectionTracksModel()
+{
+}
+
+
+collection_ptr
+CollectionTracksModel::collection() const
+{
+    Q_D( const CollectionTracksModel );
+    return d->collection;
+}
+
+
+void
+CollectionTracksModel::setCollection( const Tomahawk::collection_ptr& collection )
+{
+    Q_D( CollectionTracksModel );
+    d->collection = collection;
+
+    reload();
+}
+
+
+void
+CollectionTracksModel::setSortOrder( int column, Qt::SortOrder order )
+{
+    Q_D( CollectionTracksModel );
+    if ( sortOrderForColumn( column ) == sortOrderForColumn( d->sortColumn ) && order == d->sortOrder )
+        return;
+
+    d->sortColumn = column;
+    d->sortOrder = order;
+
+    reload();
+}
+
+
+void
+CollectionTracksModel::setFilter( const QString& filter )
+{
+    Q_D( CollectionTracksModel );
+    if ( filter == d->filter )
+        return;
+
+    d->filter = filter;
+
+    reload();
+}
+
+
+void
+CollectionTracksModel::reload()
+{
+    Q_D( CollectionTracksModel );
+
+    d->generation++;
+    d->nextPageStart.clear();
+    d->fetching = false;
+    d->hasMore = !d->collection.isNull();
+
+    clear();
+
+    if ( d->hasMore )
+    {
+        startLoading();
+        fetchMore( QModelIndex() );
+    }
+}
+
+
+bool
+CollectionTracksModel::canFetchMore( const QModelIndex& parent ) const
+{
+    Q_D( const CollectionTracksModel );
+    return !parent.isValid() && d->hasMore && !d->fetching;
+}
+
+
+void
+CollectionTracksModel::fetchMore( const QModelIndex& parent )
+{
+    Q_D( CollectionTracksModel );
+    if ( !canFetchMore( parent ) )
+        return;
+
+    if ( d->collection.objectCast< DatabaseCollection >().isNull() )
+    {
+        d->hasMore = false;
+        insertTracks( d->collection, 0 );
+        return;
+    }
+
+    d->fetching = true;
+
+    DatabaseCommand_AllTracks* cmd = new DatabaseCommand_AllTracks( d->collection );
+    cmd->setSortOrder( sortOrderForColumn( d->sortColumn ) );
+    cmd->setSortDescending( d->sortOrder == Qt::DescendingOrder );
+    cmd->setFilter( d->filter );
+    cmd->setLimit( PAGE_SIZE );
+    cmd->setPageStart( d->nextPageStart );
+    cmd->setData( d->generation );
+
+    connect( cmd, SIGNAL( page( QList<Tomahawk::query_ptr>, QVariantList, QVariant ) ),
+                    SLOT( onPageLoaded( QList<Tomahawk::query_ptr>, QVariantList, QVariant ) ), Qt::QueuedConnection );
+
+    Database::instance()->enqueue( Tomahawk::dbcmd_ptr( cmd ) );
+}
+
+
+void
+CollectionTracksModel::onPageLoaded( const QList<Tomahawk::query_ptr>& tracks, const QVariantList& nextPageStart, const QVariant& data )
+{
+    Q_D( CollectionTracksModel );
+    if ( data.toUInt() != d->generation )
+        return;
+
+    d->fetching = false;
+    d->nextPageStart = nextPageStart;
+    d->hasMore = !nextPageStart.isEmpty();
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Loaded" << tracks.count() << "tracks, more to come:" << d->hasMore;
+    insertQueries( tracks, rowCount( QModelIndex() ) );
+}
+
+
+void
+CollectionTracksModel::setCurrentIndex( const QModelIndex& index )
+{
+    PlayableModel::setCurrentIndex( index );
+
+    // Don't let playback run out of tracks just because nobody scrolled down
+    if ( index.isValid() && index.row() >= rowCount( QModelIndex() ) - PREFETCH_ROWS )
+        fetchMore( QModelIndex() );
+}
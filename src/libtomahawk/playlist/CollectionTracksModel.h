@@ -0,0 +1,64 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef COLLECTIONTRACKSMODEL_H
+#define COLLECTIONTRACKSMODEL_H
+
+#include "PlayableModel.h"
+
+#include "DllMacro.h"
+
+class CollectionTracksModelPrivate;
+
+/**
+ * Flat list of all tracks in a collection, loaded page by page as the view scrolls.
+ *
+ * Big collections would otherwise be loaded (and turned into items) as a whole
+ * before anything shows up. Pages are keyset queries on the database, so sorting
+ * and filtering happen there too and restart from the first page.
+ * Collections that aren't in our database get loaded in one go.
+ */
+class DLLEXPORT CollectionTracksModel : public PlayableModel
+{
+Q_OBJECT
+
+public:
+    explicit CollectionTracksModel( QObject* parent = 0 );
+    virtual ~CollectionTracksModel();
+
+    Tomahawk::collection_ptr collection() const;
+    void setCollection( const Tomahawk::collection_ptr& collection );
+
+    virtual bool canFetchMore( const QModelIndex& parent ) const;
+    virtual void fetchMore( const QModelIndex& parent );
+
+    virtual bool isPaged() const { return true; }
+    virtual void setSortOrder( int column, Qt::SortOrder order );
+    virtual void setFilter( const QString& filter );
+
+public slots:
+    virtual void setCurrentIndex( const QModelIndex& index );
+    void reload();
+
+private slots:
+    void onPageLoaded( const QList<Tomahawk::query_ptr>& tracks, const QVariantList& nextPageStart, const QVariant& data );
+
+private:
+    Q_DECLARE_PRIVATE( CollectionTracksModel )
+};
+
+#endif // COLLECTIONTRACKSMODEL_H
@@ -0,0 +1,55 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef COLLECTIONTRACKSMODEL_P_H
+#define COLLECTIONTRACKSMODEL_P_H
+
+#include "CollectionTracksModel.h"
+#include "PlayableModel_p.h"
+
+#include <QVariant>
+
+class CollectionTracksModelPrivate : public PlayableModelPrivate
+{
+public:
+    CollectionTracksModelPrivate( CollectionTracksModel* q )
+        : PlayableModelPrivate( q, false )
+        , sortColumn( PlayableModel::Artist )
+        , sortOrder( Qt::AscendingOrder )
+        , hasMore( false )
+        , fetching( false )
+        , generation( 0 )
+    {
+    }
+
+    Q_DECLARE_PUBLIC( CollectionTracksModel )
+
+private:
+    Tomahawk::collection_ptr collection;
+
+    int sortColumn;
+    Qt::SortOrder sortOrder;
+    QString filter;
+
+    QVariantList nextPageStart;
+    bool hasMore;
+    bool fetching;
+    // Bumped whenever we start over, so late pages of an old query get dropped
+    uint generation;
+};
+
+#endif // COLLECTIONTRACKSMODEL_P_H
@@ -129,7 +129,7 @@ PlayableItem::init( PlayableItem* parent, int row )
     {
         connect( track.data(), SIGNAL( socialActionsLoaded() ), SIGNAL( dataChanged() ) );
         connect( track.data(), SIGNAL( attributesLoaded() ), SIGNAL( dataChanged() ) );
-        connect( track.data(), SIGNAL( updated() ), SIGNAL( dataChanged() ) );
+        connect( track.data(), SIGNAL( updated() ), SLOT( onTrackUpdated() ) );
     }
 
     if ( parent )
@@ -164,6 +164,15 @@ PlayableItem::onResultsChanged()
 }
 
 
+void
+PlayableItem::onTrackUpdated()
+{
+    m_filterKey.clear();
+
+    emit dataChanged();
+}
+
+
 QString
 PlayableItem::name() const
 {
@@ -221,6 +230,37 @@ PlayableItem::albumName() const
 }
 
 
+const QString&
+PlayableItem::filterKey() const
+{
+    if ( m_filterKey.isNull() )
+    {
+        QStringList fields;
+        if ( m_query )
+        {
+            const track_ptr& track = m_query->track();
+            fields << track->artist() << track->album() << track->track();
+        }
+        else if ( m_album )
+        {
+            fields << m_album->name() << m_album->artist()->name();
+        }
+        else if ( m_artist )
+        {
+            fields << m_artist->name();
+        }
+
+        // Separate the fields with a control character so that a single
+        // filter term can never match across two adjacent names
+        m_filterKey = fields.join( QChar( 0x1f ) ).toLower();
+        if ( m_filterKey.isNull() )
+            m_filterKey = QLatin1String( "" );
+    }
+
+    return m_filterKey;
+}
+
+
 const Tomahawk::result_ptr&
 PlayableItem::result() const
 {
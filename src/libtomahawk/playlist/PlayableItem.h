@@ -66,6 +66,12 @@ public:
     QString artistName() const;
     QString albumName() const;
 
+    /**
+     * Lowercased artist, album and track names this item is matched against
+     * when filtering. Built on first use and cached until the track changes.
+     */
+    const QString& filterKey() const;
+
     QList<PlayableItem*> children;
 
     QPersistentModelIndex index;
@@ -75,6 +81,7 @@ signals:
 
 private slots:
     void onResultsChanged();
+    void onTrackUpdated();
 
 private:
     void init( PlayableItem* parent, int row = -1 );
@@ -91,6 +98,8 @@ private:
     bool m_isPlaying;
 
     Tomahawk::PlaybackLog m_playbackLog;
+
+    mutable QString m_filterKey;
 };
 
 #endif // PLAYABLEITEM_H
@@ -129,6 +129,15 @@ public:
     /// Returns a flat list of all tracks in this model
     QList< Tomahawk::query_ptr > queries() const;
 
+    /**
+     * Paged models only load the rows the view asks for (see fetchMore()) and sort
+     * and filter them in the database. Proxies hand these over instead of doing
+     * them on the loaded rows.
+     */
+    virtual bool isPaged() const { return false; }
+    virtual void setSortOrder( int column, Qt::SortOrder order ) { Q_UNUSED( column ); Q_UNUSED( order ); }
+    virtual void setFilter( const QString& filter ) { Q_UNUSED( filter ); }
+
     void startLoading();
     void finishLoading();
 
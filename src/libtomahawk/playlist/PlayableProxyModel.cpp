@@ -123,6 +123,8 @@ PlayableProxyModel::setSourcePlayableModel( PlayableModel* sourceModel )
         disconnect( m_model, SIGNAL( currentIndexChanged() ), this, SIGNAL( currentIndexChanged() ) );
         disconnect( m_model, SIGNAL( expandRequest( QPersistentModelIndex ) ), this, SLOT( expandRequested( QPersistentModelIndex ) ) );
         disconnect( m_model, SIGNAL( selectRequest( QPersistentModelIndex ) ), this, SLOT( selectRequested( QPersistentModelIndex ) ) );
+        disconnect( m_model, SIGNAL( rowsRemoved( QModelIndex, int, int ) ), this, SLOT( onSourceRowsChanged() ) );
+        disconnect( m_model, SIGNAL( modelReset() ), this, SLOT( onSourceRowsChanged() ) );
     }
 
     m_model = sourceModel;
@@ -136,8 +138,11 @@ PlayableProxyModel::setSourcePlayableModel( PlayableModel* sourceModel )
         connect( m_model, SIGNAL( currentIndexChanged() ), SIGNAL( currentIndexChanged() ) );
         connect( m_model, SIGNAL( expandRequest( QPersistentModelIndex ) ), SLOT( expandRequested( QPersistentModelIndex ) ) );
         connect( m_model, SIGNAL( selectRequest( QPersistentModelIndex ) ), SLOT( selectRequested( QPersistentModelIndex ) ) );
+        connect( m_model, SIGNAL( rowsRemoved( QModelIndex, int, int ) ), SLOT( onSourceRowsChanged() ) );
+        connect( m_model, SIGNAL( modelReset() ), SLOT( onSourceRowsChanged() ) );
     }
 
+    m_filterRejected.clear();
     QSortFilterProxyModel::setSourceModel( m_model );
 }
 
@@ -186,56 +191,41 @@ PlayableProxyModel::filterAcceptsRow( int sourceRow, const QModelIndex& sourcePa
         if ( !m_showOfflineResults && ( r.isNull() || !r->isOnline() ) )
             return false;
 
-        if ( filterRegExp().isEmpty() )
-            return true;
-
-        QStringList sl = filterRegExp().pattern().split( " ", QString::SkipEmptyParts );
-        foreach( QString s, sl )
-        {
-            s = s.toLower();
-            if ( !pi->query()->track()->artist().toLower().contains( s ) &&
-                 !pi->query()->track()->album().toLower().contains( s ) &&
-                 !pi->query()->track()->track().toLower().contains( s ) )
-            {
-                return false;
-            }
-        }
+        return matchesFilterTerms( pi );
     }
 
-    const Tomahawk::album_ptr& al = pi->album();
-    if ( al )
-    {
-        QStringList sl = filterRegExp().pattern().split( " ", QString::SkipEmptyParts );
+    if ( pi->album() || pi->artist() )
+        return matchesFilterTerms( pi );
 
-        bool found = true;
-        foreach( const QString& s, sl )
-        {
-            if ( !al->name().contains( s, Qt::CaseInsensitive ) && !al->artist()->name().contains( s, Qt::CaseInsensitive ) )
-            {
-                found = false;
-            }
-        }
+    return true;
+}
 
-        return found;
-    }
 
-    const Tomahawk::album_ptr& ar = pi->album();
-    if ( ar )
+bool
+PlayableProxyModel::matchesFilterTerms( const PlayableItem* item ) const
+{
+    if ( m_filterTerms.isEmpty() )
+        return true;
+
+    // The new filter is narrower than the previous one, so whatever got rejected
+    // before can't possibly match now
+    if ( m_previouslyRejected.contains( item ) )
     {
-        QStringList sl = filterRegExp().pattern().split( " ", QString::SkipEmptyParts );
+        m_filterRejected.insert( item );
+        return false;
+    }
 
-        bool found = true;
-        foreach( const QString& s, sl )
+    const QString& key = item->filterKey();
+    foreach ( const QString& term, m_filterTerms )
+    {
+        if ( !key.contains( term ) )
         {
-            if ( !ar->name().contains( s, Qt::CaseInsensitive ) && !ar->artist()->name().contains( s, Qt::CaseInsensitive ) )
-            {
-                found = false;
-            }
+            m_filterRejected.insert( item );
+            return false;
         }
-
-        return found;
     }
 
+    m_filterRejected.remove( item );
     return true;
 }
 
@@ -644,14 +634,69 @@ PlayableProxyModel::updateDetailedInfo( const QModelIndex& index )
 }
 
 
+void
+PlayableProxyModel::sort( int column, Qt::SortOrder order )
+{
+    if ( m_model && m_model->isPaged() )
+    {
+        // Sorting the loaded rows would mix up the pages
+        if ( column >= 0 && m_headerStyle.contains( m_style ) && column < m_headerStyle[ m_style ].count() )
+            m_model->setSortOrder( m_headerStyle[ m_style ].at( column ), order );
+
+        QSortFilterProxyModel::sort( -1 );
+        return;
+    }
+
+    QSortFilterProxyModel::sort( column, order );
+}
+
+
 void
 PlayableProxyModel::setFilter( const QString& pattern )
 {
-    if ( pattern != filterRegExp().pattern() )
+    if ( m_model && m_model->isPaged() )
     {
-        setFilterRegExp( pattern );
+        m_model->setFilter( pattern );
         emit filterChanged( pattern );
+        return;
     }
+
+    if ( pattern == filterRegExp().pattern() )
+        return;
+
+    const QStringList terms = pattern.toLower().split( " ", QString::SkipEmptyParts );
+
+    // When every previous term is still contained in one of the new terms (e.g. the
+    // user appended characters), only rows that passed the old filter need the full check
+    bool narrowing = !m_filterTerms.isEmpty();
+    foreach ( const QString& oldTerm, m_filterTerms )
+    {
+        bool contained = false;
+        foreach ( const QString& term, terms )
+        {
+            if ( term.contains( oldTerm ) )
+            {
+                contained = true;
+                break;
+            }
+        }
+
+        if ( !contained )
+        {
+            narrowing = false;
+            break;
+        }
+    }
+
+    m_filterTerms = terms;
+    if ( narrowing )
+        m_previouslyRejected = m_filterRejected;
+    m_filterRejected.clear();
+
+    setFilterRegExp( pattern );
+    m_previouslyRejected.clear();
+
+    emit filterChanged( pattern );
 }
 
 
@@ -689,3 +734,11 @@ PlayableProxyModel::selectRequested( const QPersistentModelIndex& idx )
 {
     emit selectRequest( QPersistentModelIndex( mapFromSource( idx ) ) );
 }
+
+
+void
+PlayableProxyModel::onSourceRowsChanged()
+{
+    // Items may have been deleted, don't keep their (soon to be reused) addresses around
+    m_filterRejected.clear();
+}
@@ -21,6 +21,8 @@
 #define TRACKPROXYMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QSet>
+#include <QStringList>
 
 #include "PlaylistInterface.h"
 #include "playlist/PlayableModel.h"
@@ -84,6 +86,8 @@ public:
     virtual void setFilter( const QString& pattern );
     virtual void updateDetailedInfo( const QModelIndex& index );
 
+    virtual void sort( int column, Qt::SortOrder order = Qt::AscendingOrder );
+
 signals:
     void filterChanged( const QString& filter );
 
@@ -115,8 +119,11 @@ private slots:
     void expandRequested( const QPersistentModelIndex& index );
     void selectRequested( const QPersistentModelIndex& index );
 
+    void onSourceRowsChanged();
+
 private:
     virtual bool lessThan( int column, const Tomahawk::query_ptr& left, const Tomahawk::query_ptr& right ) const;
+    bool matchesFilterTerms( const PlayableItem* item ) const;
 
     PlayableModel* m_model;
 
@@ -125,6 +132,12 @@ private:
     bool m_hideDupeItems;
     int m_maxVisibleItems;
 
+    // Lowercased filter terms, parsed once per filter change
+    QStringList m_filterTerms;
+    // Items whose text did not match the current / previous filter terms
+    mutable QSet< const PlayableItem* > m_filterRejected;
+    QSet< const PlayableItem* > m_previouslyRejected;
+
     QHash< PlayableItemStyle, QList<PlayableModel::Columns> > m_headerStyle;
     PlayableItemStyle m_style;
 };
@@ -0,0 +1,200 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_CONCURRENTWEAKHASH_H
+#define TOMAHAWK_CONCURRENTWEAKHASH_H
+
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+// Must be powers of two
+#define CONCURRENTWEAKHASH_SHARDS 16
+#define STRIPEDMUTEX_STRIPES 16
+
+#define CONCURRENTWEAKHASH_MIN_SWEEP 64
+
+
+// Outside of our namespaces, so our own qHash overloads can't hide Qt's
+template< class Key >
+inline uint
+concurrentWeakHashShard( const Key& key )
+{
+    uint h = qHash( key );
+    h ^= h >> 16;
+    return h & ( CONCURRENTWEAKHASH_SHARDS - 1 );
+}
+
+
+namespace Tomahawk
+{
+
+namespace Utils
+{
+
+/**
+ * Hash of weak pointers, used for the global caches of shared objects (tracks,
+ * artists, albums, results).
+ *
+ * Keys are spread over CONCURRENTWEAKHASH_SHARDS shards, each behind its own
+ * read-write lock, so threads looking up different objects rarely wait for
+ * each other and lookups of the same object only take a read lock.
+ *
+ * Objects normally remove their entry when they get deleted. Entries left
+ * behind anyway (e.g. because the key an object was stored with can't be
+ * recomputed anymore) are swept whenever a shard has doubled in size.
+ */
+template< class Key, class T >
+class ConcurrentWeakHash
+{
+public:
+    ConcurrentWeakHash() {}
+
+    /// The live object stored for @p key, or a null pointer.
+    QSharedPointer< T > value( const Key& key ) const
+    {
+        const Shard& shard = m_shards[ concurrentWeakHashShard( key ) ];
+        QReadLocker lock( &shard.lock );
+        return shard.hash.value( key ).toStrongRef();
+    }
+
+    bool contains( const Key& key ) const
+    {
+        const Shard& shard = m_shards[ concurrentWeakHashShard( key ) ];
+        QReadLocker lock( &shard.lock );
+        return !shard.hash.value( key ).isNull();
+    }
+
+    /**
+     * Stores @p value for @p key, unless a live object is stored for it already.
+     * Returns whichever object is stored for @p key afterwards, so concurrent
+     * callers creating the same object all end up using the same instance.
+     */
+    QSharedPointer< T > insert( const Key& key, const QSharedPointer< T >& value )
+    {
+        Shard& shard = m_shards[ concurrentWeakHashShard( key ) ];
+        QWriteLocker lock( &shard.lock );
+
+        typename QHash< Key, QWeakPointer< T > >::iterator it = shard.hash.find( key );
+        if ( it != shard.hash.end() )
+        {
+            QSharedPointer< T > existing = it.value().toStrongRef();
+            if ( existing )
+                return existing;
+
+            it.value() = value.toWeakRef();
+            return value;
+        }
+
+        if ( shard.hash.count() >= shard.sweepAt )
+            sweep( shard );
+
+        shard.hash.insert( key, value.toWeakRef() );
+        return value;
+    }
+
+    /// Removes the entry for @p key if its object is gone. Call this when deleting an object.
+    void removeExpired( const Key& key )
+    {
+        Shard& shard = m_shards[ concurrentWeakHashShard( key ) ];
+        QWriteLocker lock( &shard.lock );
+
+        typename QHash< Key, QWeakPointer< T > >::iterator it = shard.hash.find( key );
+        if ( it != shard.hash.end() && it.value().isNull() )
+            shard.hash.erase( it );
+    }
+
+    /// Drops all entries whose objects are gone.
+    void sweep()
+    {
+        for ( int i = 0; i < CONCURRENTWEAKHASH_SHARDS; i++ )
+        {
+            QWriteLocker lock( &m_shards[ i ].lock );
+            sweep( m_shards[ i ] );
+        }
+    }
+
+    /// Number of entries, including ones not swept yet.
+    int count() const
+    {
+        int count = 0;
+        for ( int i = 0; i < CONCURRENTWEAKHASH_SHARDS; i++ )
+        {
+            QReadLocker lock( &m_shards[ i ].lock );
+            count += m_shards[ i ].hash.count();
+        }
+
+        return count;
+    }
+
+private:
+    Q_DISABLE_COPY( ConcurrentWeakHash )
+
+    struct Shard
+    {
+        Shard() : sweepAt( CONCURRENTWEAKHASH_MIN_SWEEP ) {}
+
+        mutable QReadWriteLock lock;
+        QHash< Key, QWeakPointer< T > > hash;
+        int sweepAt;
+    };
+
+    static void sweep( Shard& shard )
+    {
+        typename QHash< Key, QWeakPointer< T > >::iterator it = shard.hash.begin();
+        while ( it != shard.hash.end() )
+        {
+            if ( it.value().isNull() )
+                it = shard.hash.erase( it );
+            else
+                ++it;
+        }
+
+        shard.sweepAt = qMax( CONCURRENTWEAKHASH_MIN_SWEEP, shard.hash.count() * 2 );
+    }
+
+    Shard m_shards[ CONCURRENTWEAKHASH_SHARDS ];
+};
+
+
+/**
+ * A small set of mutexes shared by many objects. Each object locks the one its
+ * address maps to, so unrelated objects rarely contend without all of them
+ * carrying a QMutex of their own.
+ */
+class StripedMutex
+{
+public:
+    StripedMutex() {}
+
+    QMutex* mutex( const void* object )
+    {
+        return &m_mutexes[ ( (quintptr)object >> 4 ) & ( STRIPEDMUTEX_STRIPES - 1 ) ];
+    }
+
+private:
+    Q_DISABLE_COPY( StripedMutex )
+
+    QMutex m_mutexes[ STRIPEDMUTEX_STRIPES ];
+};
+
+} // namespace Utils
+
+} // namespace Tomahawk
+
+#endif // TOMAHAWK_CONCURRENTWEAKHASH_H
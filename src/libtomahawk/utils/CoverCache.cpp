@@ -0,0 +1,278 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CoverCache.h"
+
+#include "utils/Logger.h"
+#include "utils/ThumbnailCache.h"
+
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QMutexLocker>
+#include <QStringList>
+#include <qtconcurrentrun.h>
+
+// Enough for a couple thousand grid-sized covers
+#define DEFAULT_MAX_COST ( 64 * 1024 * 1024 )
+// Broken images are retried after that many seconds, in case they got fixed
+#define FAILED_RETRY_DELAY 600
+
+using namespace Tomahawk;
+
+namespace Tomahawk
+{
+    // Q_GLOBAL_STATIC can't call our private constructor
+    struct CoverCacheHolder
+    {
+        CoverCache cache;
+    };
+}
+
+Q_GLOBAL_STATIC( CoverCacheHolder, s_coverCache );
+
+
+CoverCache*
+CoverCache::instance()
+{
+    return &s_coverCache()->cache;
+}
+
+
+CoverCache::CoverCache()
+    : QObject( 0 )
+{
+    m_cache.setMaxCost( DEFAULT_MAX_COST );
+
+    // Make sure the thumbnail cache is set up before any worker accesses it
+    QtConcurrent::run( ThumbnailCache::instance(), &ThumbnailCache::prune );
+}
+
+
+CoverCache::~CoverCache()
+{
+}
+
+
+QString
+CoverCache::cacheKey( const QString& key, const QSize& size )
+{
+    return QString( "%1@%2x%3" ).arg( key ).arg( size.width() ).arg( size.height() );
+}
+
+
+int
+CoverCache::maxCost() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_cache.maxCost();
+}
+
+
+void
+CoverCache::setMaxCost( int bytes )
+{
+    QMutexLocker lock( &m_mutex );
+    m_cache.setMaxCost( bytes );
+}
+
+
+QPixmap
+CoverCache::pixmap( const QString& key, const QByteArray& imageData, const QSize& size, QObject* receiver, const char* member )
+{
+    if ( key.isEmpty() || imageData.isEmpty() )
+        return QPixmap();
+
+    const QSize cacheSize = size.isEmpty() ? QSize( 0, 0 ) : size;
+    const QString ck = cacheKey( key, cacheSize );
+
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( QPixmap* cached = m_cache.object( ck ) )
+            return *cached;
+
+        QHash< QString, QDateTime >::iterator failed = m_failed.find( ck );
+        if ( failed != m_failed.end() )
+        {
+            if ( failed.value().secsTo( QDateTime::currentDateTime() ) < FAILED_RETRY_DELAY )
+                return QPixmap();
+
+            m_failed.erase( failed );
+        }
+
+        if ( !cacheSize.isEmpty() )
+        {
+            // Views ask again on every repaint until the image is there
+            const bool scheduled = m_pending.contains( ck );
+            QList< Waiter >& waiters = m_pending[ ck ];
+            bool waiting = false;
+            foreach ( const Waiter& w, waiters )
+            {
+                if ( w.receiver.data() == receiver && w.member == member )
+                {
+                    waiting = true;
+                    break;
+                }
+            }
+
+            if ( !waiting )
+            {
+                Waiter waiter;
+                waiter.receiver = receiver;
+                waiter.member = member;
+                waiters << waiter;
+            }
+
+            if ( scheduled )
+                return QPixmap();
+
+            QFutureWatcher< QImage >* watcher = new QFutureWatcher< QImage >( this );
+            m_jobs.insert( watcher, ck );
+            connect( watcher, SIGNAL( finished() ), SLOT( onImageScaled() ), Qt::QueuedConnection );
+            watcher->setFuture( QtConcurrent::run( &CoverCache::scaledImage, imageData, cacheSize ) );
+
+            return QPixmap();
+        }
+    }
+
+    // Callers asking for the unscaled image need it right away
+    const QPixmap pixmap = QPixmap::fromImage( scaledImage( imageData, cacheSize ) );
+    if ( pixmap.isNull() )
+    {
+        QMutexLocker lock( &m_mutex );
+        m_failed.insert( ck, QDateTime::currentDateTime() );
+    }
+    insert( ck, pixmap );
+
+    return pixmap;
+}
+
+
+bool
+CoverCache::hasFailed( const QString& key, const QSize& size ) const
+{
+    const QString ck = cacheKey( key, size.isEmpty() ? QSize( 0, 0 ) : size );
+
+    QMutexLocker lock( &m_mutex );
+    QHash< QString, QDateTime >::const_iterator failed = m_failed.constFind( ck );
+    return failed != m_failed.constEnd() && failed.value().secsTo( QDateTime::currentDateTime() ) < FAILED_RETRY_DELAY;
+}
+
+
+void
+CoverCache::remove( const QString& key )
+{
+    QMutexLocker lock( &m_mutex );
+
+    const QString prefix = key + "@";
+    foreach ( const QString& ck, m_cache.keys() )
+    {
+        if ( ck.startsWith( prefix ) )
+            m_cache.remove( ck );
+    }
+    foreach ( const QString& ck, m_failed.keys() )
+    {
+        if ( ck.startsWith( prefix ) )
+            m_failed.remove( ck );
+    }
+}
+
+
+void
+CoverCache::insert( const QString& cacheKey, const QPixmap& pixmap )
+{
+    if ( pixmap.isNull() )
+        return;
+
+    QMutexLocker lock( &m_mutex );
+    const int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+    m_cache.insert( cacheKey, new QPixmap( pixmap ), cost );
+}
+
+
+/// This method is run by QtConcurrent:
+QImage
+CoverCache::scaledImage( const QByteArray& imageData, const QSize& size )
+{
+    QString sourceKey;
+    if ( !size.isEmpty() )
+    {
+        sourceKey = ThumbnailCache::sourceKey( imageData );
+
+        const QImage thumbnail = ThumbnailCache::instance()->load( sourceKey, size );
+        if ( !thumbnail.isNull() )
+            return thumbnail;
+    }
+
+    QImage image;
+    if ( !image.loadFromData( imageData ) )
+        return QImage();
+
+    if ( image.width() != image.height() )
+    {
+        const int sqwidth = qMin( image.width(), image.height() );
+        const int delta = qAbs( image.width() - image.height() );
+
+        if ( image.width() > image.height() )
+            image = image.copy( delta / 2, 0, sqwidth, sqwidth );
+        else
+            image = image.copy( 0, delta / 2, sqwidth, sqwidth );
+    }
+
+    if ( !size.isEmpty() )
+    {
+        image = image.scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
+        ThumbnailCache::instance()->store( sourceKey, size, image );
+    }
+
+    return image;
+}
+
+
+void
+CoverCache::onImageScaled()
+{
+    QFutureWatcher< QImage >* watcher = static_cast< QFutureWatcher< QImage >* >( sender() );
+    watcher->deleteLater();
+
+    QList< Waiter > waiters;
+    QString ck;
+    {
+        QMutexLocker lock( &m_mutex );
+        ck = m_jobs.take( watcher );
+        waiters = m_pending.take( ck );
+    }
+
+    const QImage image = watcher->result();
+    if ( image.isNull() )
+    {
+        tDebug() << Q_FUNC_INFO << "Could not decode image:" << ck;
+
+        // Still tell the waiters, they may have something else to show instead
+        QMutexLocker lock( &m_mutex );
+        m_failed.insert( ck, QDateTime::currentDateTime() );
+    }
+    else
+    {
+        // QPixmaps can only be created on the GUI thread, which is where we live
+        insert( ck, QPixmap::fromImage( image ) );
+    }
+
+    foreach ( const Waiter& waiter, waiters )
+    {
+        if ( !waiter.receiver.isNull() && !waiter.member.isEmpty() )
+            QMetaObject::invokeMethod( waiter.receiver.data(), waiter.member.constData(), Qt::QueuedConnection );
+    }
+}
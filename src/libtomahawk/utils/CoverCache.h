@@ -0,0 +1,109 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COVERCACHE_H
+#define COVERCACHE_H
+
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QPixmap>
+#include <QPointer>
+#include <QSize>
+
+#include "DllMacro.h"
+
+template <typename T> class QFutureWatcher;
+
+namespace Tomahawk
+{
+
+/**
+ * Central cache for album and artist images.
+ *
+ * Images are decoded and scaled on the global thread pool, the GUI thread only
+ * converts the finished QImage into a QPixmap. The resulting thumbnails are kept
+ * in a byte-bounded LRU, full-size originals are not retained by the owners
+ * anymore: they only keep the (much smaller) encoded image data around.
+ *
+ * Scaled images are also persisted in the ThumbnailCache, so after a restart
+ * they don't have to be decoded again.
+ */
+class DLLEXPORT CoverCache : public QObject
+{
+Q_OBJECT
+
+public:
+    virtual ~CoverCache();
+
+    static CoverCache* instance();
+
+    /**
+     * Returns the cached image for @p key scaled to @p size.
+     *
+     * If it isn't cached yet, a null pixmap is returned and decoding / scaling
+     * @p imageData is scheduled on a worker thread. Once the thumbnail is ready,
+     * @p member (a method name as accepted by QMetaObject::invokeMethod) gets
+     * invoked on @p receiver, also when the image failed to decode. Those are not
+     * retried for a while, see hasFailed().
+     *
+     * An empty @p size requests the unscaled image, which is decoded synchronously.
+     */
+    QPixmap pixmap( const QString& key, const QByteArray& imageData, const QSize& size,
+                    QObject* receiver = 0, const char* member = 0 );
+
+    /// Whether the image for @p key recently failed to decode at @p size.
+    bool hasFailed( const QString& key, const QSize& size ) const;
+
+    /// Drops all cached thumbnails for @p key, e.g. because its image changed.
+    void remove( const QString& key );
+
+    /// Upper bound of the memory used by cached thumbnails, in bytes.
+    int maxCost() const;
+    void setMaxCost( int bytes );
+
+    static QImage scaledImage( const QByteArray& imageData, const QSize& size );
+
+private slots:
+    void onImageScaled();
+
+private:
+    friend struct CoverCacheHolder;
+    CoverCache();
+
+    struct Waiter
+    {
+        QPointer< QObject > receiver;
+        QByteArray member;
+    };
+
+    static QString cacheKey( const QString& key, const QSize& size );
+    void insert( const QString& cacheKey, const QPixmap& pixmap );
+
+    mutable QMutex m_mutex;
+    QCache< QString, QPixmap > m_cache;
+    QHash< QString, QList< Waiter > > m_pending;
+    QHash< QFutureWatcher< QImage >*, QString > m_jobs;
+    // When decoding an image failed, by cache key
+    QHash< QString, QDateTime > m_failed;
+};
+
+}
+
+#endif // COVERCACHE_H
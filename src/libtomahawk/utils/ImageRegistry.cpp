@@ -23,13 +23,53 @@
 
 #include "utils/Logger.h"
 
-static QHash< QString, QHash< int, QHash< qint64, QPixmap > > > s_cache;
+namespace
+{
+    // Everything that makes a rendered pixmap unique
+    struct ImageCacheKey
+    {
+        ImageCacheKey( const QString& _image, TomahawkUtils::ImageMode _mode, const QSize& _size, float _opacity, const QColor& _tint )
+            : image( _image )
+            , mode( _mode )
+            , width( _size.width() )
+            , height( _size.height() )
+            , opacity( qRound( _opacity * 1000.0 ) )
+            , tint( _tint.rgba() )
+        {
+        }
+
+        QString image;
+        int mode;
+        int width;
+        int height;
+        int opacity;
+        QRgb tint;
+    };
+
+    inline bool
+    operator==( const ImageCacheKey& k1, const ImageCacheKey& k2 )
+    {
+        return k1.width == k2.width && k1.height == k2.height && k1.mode == k2.mode &&
+               k1.opacity == k2.opacity && k1.tint == k2.tint && k1.image == k2.image;
+    }
+
+    inline uint
+    qHash( const ImageCacheKey& key )
+    {
+        return ::qHash( key.image ) ^ ( key.mode << 28 ) ^ ( key.width << 16 ) ^ key.height ^ ( key.opacity << 8 ) ^ key.tint;
+    }
+}
+
+static QHash< ImageCacheKey, QPixmap > s_cache;
 ImageRegistry* ImageRegistry::s_instance = 0;
 
 
 ImageRegistry*
 ImageRegistry::instance()
 {
+    if ( !s_instance )
+        new ImageRegistry();
+
     return s_instance;
 }
 
@@ -47,13 +87,6 @@ ImageRegistry::icon( const QString& image, TomahawkUtils::ImageMode mode )
 }
 
 
-qint64
-ImageRegistry::cacheKey( const QSize& size, float opacity, QColor tint )
-{
-    return size.width() * 100 + size.height() * 10 + ( opacity * 100.0 ) + tint.value();
-}
-
-
 QPixmap
 ImageRegistry::pixmap( const QString& image, const QSize& size, TomahawkUtils::ImageMode mode, float opacity, QColor tint )
 {
@@ -63,28 +96,28 @@ ImageRegistry::pixmap( const QString& image, const QSize& size, TomahawkUtils::I
         return QPixmap();
     }
 
-    QHash< qint64, QPixmap > subsubcache;
-    QHash< int, QHash< qint64, QPixmap > > subcache;
+    const ImageCacheKey key( image, mode, size, opacity, tint );
+    QHash< ImageCacheKey, QPixmap >::const_iterator it = s_cache.constFind( key );
+    if ( it != s_cache.constEnd() )
+        return it.value();
 
-    if ( s_cache.contains( image ) )
+    // Image not found in cache. Let's load it.
+    const QPixmap pixmap = render( image, size, mode, opacity, tint );
+    if ( !pixmap.isNull() )
     {
-        subcache = s_cache.value( image );
+        tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Adding to image cache:" << image << size << mode;
+        s_cache.insert( key, pixmap );
+    }
 
-        if ( subcache.contains( mode ) )
-        {
-            subsubcache = subcache.value( mode );
+    return pixmap;
+}
 
-            const qint64 ck = cacheKey( size, opacity, tint );
-            if ( subsubcache.contains( ck ) )
-            {
-                return subsubcache.value( ck );
-            }
-        }
-    }
 
-    // Image not found in cache. Let's load it.
+QPixmap
+ImageRegistry::render( const QString& image, const QSize& size, TomahawkUtils::ImageMode mode, float opacity, const QColor& tint ) const
+{
     QPixmap pixmap;
-    if ( image.toLower().endsWith( ".svg" ) )
+    if ( image.endsWith( ".svg", Qt::CaseInsensitive ) )
     {
         QSvgRenderer svgRenderer( image );
         QPixmap p( size.isNull() ? svgRenderer.defaultSize() : size );
@@ -117,38 +150,7 @@ ImageRegistry::pixmap( const QString& image, const QSize& size, TomahawkUtils::I
 
         if ( !size.isNull() && pixmap.size() != size )
             pixmap = pixmap.scaled( size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
-
-        putInCache( image, size, mode, opacity, pixmap, tint );
     }
 
     return pixmap;
 }
-
-
-void
-ImageRegistry::putInCache( const QString& image, const QSize& size, TomahawkUtils::ImageMode mode, float opacity, const QPixmap& pixmap, QColor tint )
-{
-    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Adding to image cache:" << image << size << mode;
-
-    QHash< qint64, QPixmap > subsubcache;
-    QHash< int, QHash< qint64, QPixmap > > subcache;
-
-    if ( s_cache.contains( image ) )
-    {
-        subcache = s_cache.value( image );
-
-        if ( subcache.contains( mode ) )
-        {
-            subsubcache = subcache.value( mode );
-
-/*            if ( subsubcache.contains( size.width() * size.height() ) )
-            {
-                Q_ASSERT( false );
-            }*/
-        }
-    }
-
-    subsubcache.insert( cacheKey( size, opacity, tint ), pixmap );
-    subcache.insert( mode, subsubcache );
-    s_cache.insert( image, subcache );
-}
@@ -34,8 +34,7 @@ public:
     QPixmap pixmap( const QString& image, const QSize& size, TomahawkUtils::ImageMode mode = TomahawkUtils::Original, float opacity = 1.0, QColor tint = QColor( 0, 0, 0, 0 ) );
 
 private:
-    qint64 cacheKey( const QSize& size, float opacity, QColor tint );
-    void putInCache( const QString& image, const QSize& size, TomahawkUtils::ImageMode mode, float opacity, const QPixmap& pixmap, QColor tint );
+    QPixmap render( const QString& image, const QSize& size, TomahawkUtils::ImageMode mode, float opacity, const QColor& tint ) const;
 
     static ImageRegistry* s_instance;
 };
@@ -0,0 +1,252 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "InternedString.h"
+
+#include <QAtomicInt>
+#include <QMultiHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+// Must be a power of two
+#define INTERNEDSTRING_SHARDS 16
+#define INTERNEDSTRING_MIN_SWEEP 256
+
+using namespace Tomahawk;
+
+
+struct InternedString::Data
+{
+    Data( uint _hash, const QString& _str )
+        : ref( 1 )
+        , hash( _hash )
+        , str( _str )
+    {
+    }
+
+    QAtomicInt ref;
+    uint hash;
+    QString str;
+};
+
+
+namespace
+{
+
+struct Shard
+{
+    Shard() : sweepAt( INTERNEDSTRING_MIN_SWEEP ) {}
+
+    QMutex mutex;
+    QMultiHash< uint, InternedString::Data* > strings;
+    int sweepAt;
+};
+
+
+static int
+refCount( QAtomicInt& ref )
+{
+    return ref.fetchAndAddOrdered( 0 );
+}
+
+}
+
+static Shard s_shards[ INTERNEDSTRING_SHARDS ];
+static const QString s_empty;
+static QAtomicInt s_lookups;
+
+
+// Entries are only created, resurrected and deleted with their shard locked,
+// handles merely drop their reference. Whoever finds an entry at zero under
+// the lock can thus safely delete it, unless a Lookup may still compare it.
+static void
+sweepShard( Shard& shard )
+{
+    // Retried on the next insert
+    if ( refCount( s_lookups ) > 0 )
+        return;
+
+    QMultiHash< uint, InternedString::Data* >::iterator it = shard.strings.begin();
+    while ( it != shard.strings.end() )
+    {
+        if ( refCount( it.value()->ref ) == 0 )
+        {
+            delete it.value();
+            it = shard.strings.erase( it );
+        }
+        else
+            ++it;
+    }
+
+    shard.sweepAt = qMax( INTERNEDSTRING_MIN_SWEEP, shard.strings.count() * 2 );
+}
+
+
+InternedString::InternedString( const QString& str )
+    : d( 0 )
+{
+    if ( str.isEmpty() )
+        return;
+
+    const uint h = ::qHash( str );
+    Shard& shard = s_shards[ h & ( INTERNEDSTRING_SHARDS - 1 ) ];
+
+    QMutexLocker lock( &shard.mutex );
+    QMultiHash< uint, Data* >::const_iterator it = shard.strings.constFind( h );
+    while ( it != shard.strings.constEnd() && it.key() == h )
+    {
+        if ( it.value()->str == str )
+        {
+            d = it.value();
+            d->ref.ref();
+            return;
+        }
+        ++it;
+    }
+
+    if ( shard.strings.count() >= shard.sweepAt )
+        sweepShard( shard );
+
+    d = new Data( h, str );
+    shard.strings.insert( h, d );
+}
+
+
+InternedString::InternedString( const InternedString& other )
+    : d( other.d )
+{
+    if ( d && !isBorrowed() )
+        d->ref.ref();
+}
+
+
+InternedString::~InternedString()
+{
+    if ( d && !isBorrowed() )
+        d->ref.deref();
+}
+
+
+InternedString&
+InternedString::operator=( const InternedString& other )
+{
+    if ( other.d && !other.isBorrowed() )
+        other.d->ref.ref();
+    if ( d && !isBorrowed() )
+        d->ref.deref();
+
+    d = other.d;
+    return *this;
+}
+
+
+const QString&
+InternedString::toString() const
+{
+    return d ? data()->str : s_empty;
+}
+
+
+uint
+InternedString::hash() const
+{
+    return d ? data()->hash : 0;
+}
+
+
+bool
+InternedString::find( const QString& str, InternedString* result )
+{
+    Q_ASSERT( refCount( s_lookups ) > 0 );
+
+    *result = InternedString();
+    if ( str.isEmpty() )
+        return true;
+
+    const uint h = ::qHash( str );
+    Shard& shard = s_shards[ h & ( INTERNEDSTRING_SHARDS - 1 ) ];
+
+    QMutexLocker lock( &shard.mutex );
+    QMultiHash< uint, Data* >::const_iterator it = shard.strings.constFind( h );
+    while ( it != shard.strings.constEnd() && it.key() == h )
+    {
+        // Nothing can be keyed by an entry no handle refers to
+        if ( it.value()->str == str )
+        {
+            if ( refCount( it.value()->ref ) == 0 )
+                return false;
+
+            result->d = reinterpret_cast< Data* >( reinterpret_cast< quintptr >( it.value() ) | 1 );
+            return true;
+        }
+        ++it;
+    }
+
+    return false;
+}
+
+
+InternedString::Lookup::Lookup()
+{
+    s_lookups.fetchAndAddOrdered( 1 );
+}
+
+
+InternedString::Lookup::~Lookup()
+{
+    s_lookups.fetchAndAddOrdered( -1 );
+}
+
+
+void
+InternedString::sweep()
+{
+    for ( int i = 0; i < INTERNEDSTRING_SHARDS; i++ )
+    {
+        QMutexLocker lock( &s_shards[ i ].mutex );
+        sweepShard( s_shards[ i ] );
+    }
+}
+
+
+InternedString::Stats
+InternedString::stats()
+{
+    Stats stats;
+    stats.strings = 0;
+    stats.references = 0;
+    stats.bytes = 0;
+    stats.savedBytes = 0;
+
+    for ( int i = 0; i < INTERNEDSTRING_SHARDS; i++ )
+    {
+        QMutexLocker lock( &s_shards[ i ].mutex );
+        foreach ( Data* data, s_shards[ i ].strings )
+        {
+            const int refs = refCount( data->ref );
+            if ( refs == 0 )
+                continue;
+
+            const qint64 bytes = data->str.size() * sizeof( QChar );
+            stats.strings++;
+            stats.references += refs;
+            stats.bytes += bytes;
+            stats.savedBytes += ( refs - 1 ) * bytes;
+        }
+    }
+
+    return stats;
+}
@@ -0,0 +1,111 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_INTERNEDSTRING_H
+#define TOMAHAWK_INTERNEDSTRING_H
+
+#include <QString>
+
+#include "DllMacro.h"
+
+namespace Tomahawk
+{
+
+/**
+ * Handle to a string in the process-wide interning table.
+ *
+ * Equal strings share a single table entry, which also caches the string's hash.
+ * Copying, comparing and hashing a handle are pointer operations, so handles
+ * make cheap keys for the global Track, TrackData, Artist and Album caches.
+ *
+ * The table is split into shards with their own lock and may be used from any
+ * thread. Entries no handle refers to anymore get swept whenever a shard has
+ * doubled in size since its last sweep.
+ *
+ * Cache lookups shouldn't intern their keys: find() gives out handles to
+ * existing entries without creating or referencing any.
+ */
+class DLLEXPORT InternedString
+{
+public:
+    /// Entry in the interning table, opaque outside of it.
+    struct Data;
+
+    struct Stats
+    {
+        int strings;
+        qint64 references;
+        /// Payload of all distinct strings in the table.
+        qint64 bytes;
+        /// Payload references beyond the first would take if each held its own copy.
+        qint64 savedBytes;
+    };
+
+    /// Entries aren't swept while a Lookup exists, which keeps handles from find() valid.
+    class DLLEXPORT Lookup
+    {
+    public:
+        Lookup();
+        ~Lookup();
+
+    private:
+        Q_DISABLE_COPY( Lookup )
+    };
+
+    InternedString() : d( 0 ) {}
+    explicit InternedString( const QString& str );
+    InternedString( const InternedString& other );
+    ~InternedString();
+
+    InternedString& operator=( const InternedString& other );
+
+    const QString& toString() const;
+    bool isEmpty() const { return d == 0; }
+    uint hash() const;
+
+    bool operator==( const InternedString& other ) const { return data() == other.data(); }
+    bool operator!=( const InternedString& other ) const { return data() != other.data(); }
+
+    /**
+     * Looks up @p str without interning it. Returns false if it isn't interned,
+     * so nothing keyed by it can exist, otherwise sets @p result.
+     *
+     * The handle holds no reference: it is only valid while a Lookup exists and
+     * must not be stored, only used to probe hashes keyed by InternedStrings.
+     */
+    static bool find( const QString& str, InternedString* result );
+
+    /// Drops all entries no handle refers to anymore.
+    static void sweep();
+    static Stats stats();
+
+private:
+    // Handles from find() have the lowest bit of d set
+    Data* data() const { return reinterpret_cast< Data* >( reinterpret_cast< quintptr >( d ) & ~quintptr( 1 ) ); }
+    bool isBorrowed() const { return reinterpret_cast< quintptr >( d ) & 1; }
+
+    Data* d;
+};
+
+
+inline uint qHash( const InternedString& str )
+{
+    return str.hash();
+}
+
+}
+
+#endif // TOMAHAWK_INTERNEDSTRING_H
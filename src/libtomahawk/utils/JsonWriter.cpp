@@ -0,0 +1,290 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JsonWriter.h"
+
+#include <QStringList>
+#include <qnumeric.h>
+
+namespace TomahawkUtils
+{
+
+JsonWriter::JsonWriter( int reserve )
+{
+    if ( reserve > 0 )
+        m_data.reserve( reserve );
+}
+
+
+void
+JsonWriter::beginObject( const char* key )
+{
+    writeKey( key );
+    m_data += '{';
+    m_first.append( true );
+}
+
+
+void
+JsonWriter::endObject()
+{
+    Q_ASSERT( !m_first.isEmpty() );
+    m_first.pop_back();
+    m_data += '}';
+}
+
+
+void
+JsonWriter::beginArray( const char* key )
+{
+    writeKey( key );
+    m_data += '[';
+    m_first.append( true );
+}
+
+
+void
+JsonWriter::endArray()
+{
+    Q_ASSERT( !m_first.isEmpty() );
+    m_first.pop_back();
+    m_data += ']';
+}
+
+
+void
+JsonWriter::write( const char* key, const QString& value )
+{
+    writeKey( key );
+    writeString( value );
+}
+
+
+void
+JsonWriter::write( const char* key, const char* value )
+{
+    writeKey( key );
+    writeString( QString::fromUtf8( value ) );
+}
+
+
+void
+JsonWriter::write( const char* key, qint64 value )
+{
+    writeKey( key );
+    m_data += QByteArray::number( value );
+}
+
+
+void
+JsonWriter::write( const char* key, double value )
+{
+    writeKey( key );
+    writeDouble( value );
+}
+
+
+void
+JsonWriter::write( const char* key, bool value )
+{
+    writeKey( key );
+    m_data += value ? "true" : "false";
+}
+
+
+void
+JsonWriter::writeNull( const char* key )
+{
+    writeKey( key );
+    m_data += "null";
+}
+
+
+void
+JsonWriter::write( const char* key, const QVariant& value )
+{
+    writeKey( key );
+    writeVariant( value );
+}
+
+
+void
+JsonWriter::writeDouble( double value )
+{
+    if ( qIsFinite( value ) )
+        m_data += QByteArray::number( value, 'g', 15 );
+    else
+        m_data += "null";
+}
+
+
+void
+JsonWriter::writeVariant( const QVariant& value )
+{
+    switch ( value.type() )
+    {
+        case QVariant::Invalid:
+            m_data += "null";
+            break;
+
+        case QVariant::Bool:
+            m_data += value.toBool() ? "true" : "false";
+            break;
+
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+            m_data += QByteArray::number( value.toLongLong() );
+            break;
+
+        case QVariant::ULongLong:
+            m_data += QByteArray::number( value.toULongLong() );
+            break;
+
+        case QVariant::Double:
+            writeDouble( value.toDouble() );
+            break;
+
+        case QVariant::Map:
+        {
+            const QVariantMap map = value.toMap();
+            m_data += '{';
+            m_first.append( true );
+            for ( QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it )
+            {
+                writeKey( it.key() );
+                writeVariant( it.value() );
+            }
+            m_first.pop_back();
+            m_data += '}';
+            break;
+        }
+
+        case QVariant::Hash:
+        {
+            const QVariantHash hash = value.toHash();
+            m_data += '{';
+            m_first.append( true );
+            for ( QVariantHash::const_iterator it = hash.constBegin(); it != hash.constEnd(); ++it )
+            {
+                writeKey( it.key() );
+                writeVariant( it.value() );
+            }
+            m_first.pop_back();
+            m_data += '}';
+            break;
+        }
+
+        case QVariant::List:
+        case QVariant::StringList:
+        {
+            const QVariantList list = value.toList();
+            m_data += '[';
+            m_first.append( true );
+            foreach ( const QVariant& v, list )
+            {
+                writeKey( 0 );
+                writeVariant( v );
+            }
+            m_first.pop_back();
+            m_data += ']';
+            break;
+        }
+
+        default:
+            writeString( value.toString() );
+            break;
+    }
+}
+
+
+void
+JsonWriter::writeKey( const char* key )
+{
+    if ( m_first.isEmpty() )
+    {
+        Q_ASSERT( !key );
+        return;
+    }
+
+    if ( m_first.last() )
+        m_first.last() = false;
+    else
+        m_data += ',';
+
+    if ( key )
+    {
+        // Our own keys are plain ASCII, no need to escape them
+        m_data += '"';
+        m_data += key;
+        m_data += "\":";
+    }
+}
+
+
+void
+JsonWriter::writeKey( const QString& key )
+{
+    writeKey( 0 );
+    writeString( key );
+    m_data += ':';
+}
+
+
+void
+JsonWriter::writeString( const QString& value )
+{
+    static const char hex[] = "0123456789abcdef";
+
+    m_data += '"';
+
+    const QByteArray utf8 = value.toUtf8();
+    const char* begin = utf8.constData();
+    const char* end = begin + utf8.size();
+
+    // Copy everything that doesn't need escaping in one go
+    const char* run = begin;
+    for ( const char* c = begin; c != end; ++c )
+    {
+        const uchar ch = *c;
+        if ( ch >= 0x20 && ch != '"' && ch != '\\' )
+            continue;
+
+        m_data.append( run, c - run );
+        run = c + 1;
+
+        switch ( ch )
+        {
+            case '"':  m_data += "\\\""; break;
+            case '\\': m_data += "\\\\"; break;
+            case '\b': m_data += "\\b"; break;
+            case '\f': m_data += "\\f"; break;
+            case '\n': m_data += "\\n"; break;
+            case '\r': m_data += "\\r"; break;
+            case '\t': m_data += "\\t"; break;
+            default:
+                m_data += "\\u00";
+                m_data += hex[ ch >> 4 ];
+                m_data += hex[ ch & 0xf ];
+                break;
+        }
+    }
+    m_data.append( run, end - run );
+
+    m_data += '"';
+}
+
+}
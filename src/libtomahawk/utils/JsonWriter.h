@@ -0,0 +1,90 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef TOMAHAWKUTILS_JSONWRITER_H
+#define TOMAHAWKUTILS_JSONWRITER_H
+
+#include "DllMacro.h"
+
+#include <QByteArray>
+#include <QVariant>
+#include <QVector>
+
+namespace TomahawkUtils
+{
+
+/**
+ * Writes compact JSON straight into a QByteArray.
+ *
+ * Unlike toJson() this doesn't need the data as a QVariant tree first, so
+ * large documents (e.g. an AddFiles op with thousands of files) can be written
+ * field by field without building and copying intermediate maps and lists.
+ *
+ * Calls have to be balanced, keys are only valid inside objects:
+ *
+ *     JsonWriter w;
+ *     w.beginObject();
+ *     w.write( "command", "addfiles" );
+ *     w.beginArray( "files" );
+ *     ...
+ *     w.endArray();
+ *     w.endObject();
+ */
+class DLLEXPORT JsonWriter
+{
+public:
+    explicit JsonWriter( int reserve = 0 );
+
+    void beginObject( const char* key = 0 );
+    void endObject();
+    void beginArray( const char* key = 0 );
+    void endArray();
+
+    void write( const char* key, const QString& value );
+    void write( const char* key, const char* value );
+    void write( const char* key, qint64 value );
+    void write( const char* key, int value ) { write( key, (qint64)value ); }
+    void write( const char* key, uint value ) { write( key, (qint64)value ); }
+    void write( const char* key, double value );
+    void write( const char* key, bool value );
+    void writeNull( const char* key );
+    /// Fallback for values of unknown type, maps and lists are written recursively.
+    void write( const char* key, const QVariant& value );
+
+    /// Array elements
+    void append( const QString& value ) { write( 0, value ); }
+    void append( qint64 value ) { write( 0, value ); }
+    void append( const QVariant& value ) { write( 0, value ); }
+
+    const QByteArray& data() const { return m_data; }
+
+private:
+    void writeKey( const char* key );
+    void writeKey( const QString& key );
+    void writeString( const QString& value );
+    /// JSON has no nan or infinity, those are written as null.
+    void writeDouble( double value );
+    void writeVariant( const QVariant& value );
+
+    QByteArray m_data;
+    // Whether the current object / array still has no elements
+    QVector< bool > m_first;
+};
+
+}
+
+#endif // TOMAHAWKUTILS_JSONWRITER_H
@@ -22,11 +22,14 @@
 #include <fstream>
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
 #include <QMutex>
+#include <QThread>
 #include <QTime>
 #include <QVariant>
+#include <QWaitCondition>
 
 #include "utils/TomahawkUtils.h"
 
@@ -36,6 +39,11 @@
 #define DEBUG_LEVEL_THRESHOLD LOGEXTRA
 #define LOG_SQL_QUERIES 1
 
+// Number of messages the log buffer can hold, must be a power of two
+#define LOG_BUFFER_SIZE 8192
+// How long the writer sleeps when there is nothing to write, in ms
+#define LOG_WRITE_INTERVAL 50
+
 using namespace std;
 
 ofstream logfile;
@@ -46,6 +54,227 @@ bool shutdownInProgress = false;
 namespace Logger
 {
 
+/**
+ * A log message waiting in the buffer.
+ * sequence tells producers and the writer who owns the slot, see LogWriter.
+ */
+struct LogEntry
+{
+    QAtomicInt sequence;
+    qint64 timestamp;
+    unsigned int debugLevel;
+    bool toDisk;
+    bool toConsole;
+    QByteArray msg;
+};
+
+
+/**
+ * Writes log messages on its own thread.
+ *
+ * Producers claim slots of a bounded multi-producer ring buffer with atomic operations
+ * only, they never take a lock and never wait for disk or console I/O. If the buffer is
+ * full, the message is dropped and counted instead of blocking the caller.
+ * The writer thread drains the buffer in batches and flushes once per batch.
+ */
+class LogWriter : public QThread
+{
+public:
+    LogWriter();
+    virtual ~LogWriter();
+
+    bool enqueue( const char* msg, unsigned int debugLevel, bool toDisk, bool toConsole );
+    /// Stops the thread, what's still queued is left for drain().
+    void stop();
+    /// Writes out everything queued. Only call it from outside once the thread got stopped.
+    int drain();
+
+    static int load( QAtomicInt& i ) { return i.fetchAndAddOrdered( 0 ); }
+
+protected:
+    void run();
+
+private:
+    static int next( int pos, int offset = 1 ) { return (int)( (quint32)pos + offset ); }
+
+    void write( const LogEntry& entry );
+
+    LogEntry* m_entries;
+    QAtomicInt m_enqueuePos;
+    int m_dequeuePos;
+    QAtomicInt m_dropped;
+    QAtomicInt m_running;
+
+    QMutex m_waitMutex;
+    QWaitCondition m_waitCondition;
+
+    // Formatting dates is expensive, only do it once per second
+    qint64 m_lastSecond;
+    QByteArray m_date;
+    QByteArray m_time;
+};
+
+static LogWriter* s_writer = 0;
+static QAtomicInt s_writerRunning;
+// Producers between checking s_writerRunning and finishing their enqueue()
+static QAtomicInt s_enqueueing;
+
+
+LogWriter::LogWriter()
+    : m_entries( new LogEntry[ LOG_BUFFER_SIZE ] )
+    , m_dequeuePos( 0 )
+    , m_lastSecond( -1 )
+{
+    for ( int i = 0; i < LOG_BUFFER_SIZE; i++ )
+        m_entries[ i ].sequence.fetchAndStoreOrdered( i );
+
+    m_running.fetchAndStoreOrdered( 1 );
+}
+
+
+LogWriter::~LogWriter()
+{
+    delete[] m_entries;
+}
+
+
+bool
+LogWriter::enqueue( const char* msg, unsigned int debugLevel, bool toDisk, bool toConsole )
+{
+    LogEntry* entry;
+    int pos = load( m_enqueuePos );
+
+    forever
+    {
+        entry = &m_entries[ pos & ( LOG_BUFFER_SIZE - 1 ) ];
+        const qint32 diff = (qint32)( (quint32)load( entry->sequence ) - (quint32)pos );
+
+        if ( diff == 0 )
+        {
+            // The slot is free, try to claim it
+            if ( m_enqueuePos.testAndSetOrdered( pos, next( pos ) ) )
+                break;
+        }
+        else if ( diff < 0 )
+        {
+            // The writer hasn't caught up yet, the buffer is full
+            m_dropped.fetchAndAddOrdered( 1 );
+            return false;
+        }
+
+        pos = load( m_enqueuePos );
+    }
+
+    entry->timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry->debugLevel = debugLevel;
+    entry->toDisk = toDisk;
+    entry->toConsole = toConsole;
+    entry->msg = msg;
+
+    // Publish the slot to the writer
+    entry->sequence.fetchAndStoreOrdered( next( pos ) );
+
+    // Don't let errors sit in the buffer, in case we are about to crash
+    if ( debugLevel == 0 )
+        m_waitCondition.wakeOne();
+
+    return true;
+}
+
+
+void
+LogWriter::stop()
+{
+    if ( QThread::currentThread() == this )
+        return;
+
+    m_running.fetchAndStoreOrdered( 0 );
+    m_waitCondition.wakeOne();
+    wait();
+}
+
+
+void
+LogWriter::run()
+{
+    while ( load( m_running ) )
+    {
+        if ( !drain() )
+        {
+            QMutexLocker lock( &m_waitMutex );
+            m_waitCondition.wait( &m_waitMutex, LOG_WRITE_INTERVAL );
+        }
+    }
+}
+
+
+int
+LogWriter::drain()
+{
+    int written = 0;
+
+    forever
+    {
+        LogEntry& entry = m_entries[ m_dequeuePos & ( LOG_BUFFER_SIZE - 1 ) ];
+        if ( load( entry.sequence ) != next( m_dequeuePos ) )
+            break;
+
+        write( entry );
+        entry.msg = QByteArray();
+
+        // Hand the slot back to the producers, for their next round through the buffer
+        entry.sequence.fetchAndStoreOrdered( next( m_dequeuePos, LOG_BUFFER_SIZE ) );
+        m_dequeuePos = next( m_dequeuePos );
+        written++;
+    }
+
+    const int dropped = m_dropped.fetchAndStoreOrdered( 0 );
+    if ( dropped )
+    {
+        logfile << "[Logger] Log buffer full, dropped " << dropped << " messages" << endl;
+        written++;
+    }
+
+    if ( written )
+    {
+        logfile.flush();
+        cout.flush();
+    }
+
+    return written;
+}
+
+
+void
+LogWriter::write( const LogEntry& entry )
+{
+    const qint64 second = entry.timestamp / 1000;
+    if ( second != m_lastSecond )
+    {
+        const QDateTime dt = QDateTime::fromMSecsSinceEpoch( entry.timestamp );
+        m_date = dt.date().toString().toUtf8();
+        m_time = dt.time().toString().toUtf8();
+        m_lastSecond = second;
+    }
+
+    if ( entry.toDisk )
+    {
+        #ifdef LOG_SQL_QUERIES
+        if ( entry.debugLevel == LOGSQL )
+            logfile << "TSQLQUERY: ";
+        #endif
+
+        logfile << m_date.constData() << " - " << m_time.constData()
+                << " [" << entry.debugLevel << "]: " << entry.msg.constData() << "\n";
+    }
+
+    if ( entry.toConsole )
+    {
+        cout << m_time.constData() << " [" << entry.debugLevel << "]: " << entry.msg.constData() << "\n";
+    }
+}
+
+
 static void
 log( const char *msg, unsigned int debugLevel, bool toDisk = true )
 {
@@ -69,7 +298,23 @@ log( const char *msg, unsigned int debugLevel, bool toDisk = true )
         toDisk = true;
     #endif
 
-    if ( toDisk || (int)debugLevel <= s_threshold )
+    toDisk = toDisk || (int)debugLevel <= s_threshold;
+    const bool toConsole = debugLevel <= LOGEXTRA || (int)debugLevel <= s_threshold;
+    if ( !toDisk && !toConsole )
+        return;
+
+    s_enqueueing.fetchAndAddOrdered( 1 );
+    if ( s_writerRunning.fetchAndAddOrdered( 0 ) )
+    {
+        // Either queued or dropped (and counted), never block here
+        s_writer->enqueue( msg, debugLevel, toDisk, toConsole );
+        s_enqueueing.fetchAndAddOrdered( -1 );
+        return;
+    }
+    s_enqueueing.fetchAndAddOrdered( -1 );
+
+    // No writer thread (yet / anymore), write synchronously
+    if ( toDisk )
     {
         QMutexLocker lock( &s_mutex );
 
@@ -102,7 +347,7 @@ log( const char *msg, unsigned int debugLevel, bool toDisk = true )
         logfile.flush();
     }
 
-    if ( debugLevel <= LOGEXTRA || (int)debugLevel <= s_threshold )
+    if ( toConsole )
     {
         QMutexLocker lock( &s_mutex );
 
@@ -133,8 +378,6 @@ TomahawkLogHandler( QtMsgType type, const QMessageLogContext& context, const QSt
 TomahawkLogHandler( QtMsgType type, const char* msg )
 #endif
 {
-    static QMutex s_mutex;
-
 #if QT_VERSION >= QT_VERSION_CHECK( 5, 0, 0 )
     QByteArray ba = msg.toUtf8();
     const char* message = ba.constData();
@@ -142,7 +385,6 @@ TomahawkLogHandler( QtMsgType type, const char* msg )
     const char* message = msg;
 #endif
 
-    QMutexLocker locker( &s_mutex );
     switch( type )
     {
         case QtDebugMsg:
@@ -158,6 +400,8 @@ TomahawkLogHandler( QtMsgType type, const char* msg )
             break;
 
         case QtFatalMsg:
+            // We are about to abort, don't leave anything in the buffer
+            tLogNotifyShutdown();
             log( message, 0 );
             break;
     }
@@ -196,6 +440,14 @@ setupLogfile()
     }
 
     logfile.open( logFile().toUtf8().constData(), ios::app );
+
+    if ( !s_writer )
+    {
+        s_writer = new LogWriter();
+        s_writer->start( QThread::LowPriority );
+        s_writerRunning.fetchAndStoreOrdered( 1 );
+    }
+
 #if QT_VERSION >= QT_VERSION_CHECK( 5, 0, 0 )
     qInstallMessageHandler( TomahawkLogHandler );
 #else
@@ -223,6 +475,23 @@ TLog::~TLog()
 void
 tLogNotifyShutdown()
 {
+    // From now on we log synchronously again, after writing out what's still queued
+    if ( s_writerRunning.fetchAndStoreOrdered( 0 ) )
+    {
+        s_writer->stop();
+
+        // Producers that saw the writer still running may not be done enqueueing yet,
+        // anyone arriving from now on logs synchronously
+        while ( LogWriter::load( s_enqueueing ) )
+            QThread::yieldCurrentThread();
+
+        // Synchronous logging holds s_mutex as well
+        QMutexLocker locker( &s_mutex );
+        s_writer->drain();
+        shutdownInProgress = true;
+        return;
+    }
+
     QMutexLocker locker( &s_mutex );
     shutdownInProgress = true;
 }
@@ -0,0 +1,455 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Metrics.h"
+
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <string.h>
+
+#define METRICS_PREFIX "tomahawk_"
+
+using namespace Tomahawk;
+
+Q_GLOBAL_STATIC( Metrics, s_metrics );
+
+
+static QString
+escapeLabelValue( const QString& value )
+{
+    QString escaped = value;
+    escaped.replace( '\\', "\\\\" ).replace( '"', "\\\"" ).replace( '\n', "\\n" );
+    return escaped;
+}
+
+
+Metric::Metric( Type type, const QString& name, const QString& labelName, const QString& labelValue )
+    : m_type( type )
+    , m_name( name )
+    , m_labelName( labelName )
+    , m_labelValue( labelValue )
+{
+}
+
+
+QVariantMap
+Metric::toVariant() const
+{
+    static const char* types[] = { "counter", "gauge", "histogram" };
+
+    QVariantMap m;
+    m.insert( "name", m_name );
+    m.insert( "type", types[ m_type ] );
+    if ( !m_labelName.isEmpty() )
+    {
+        QVariantMap labels;
+        labels.insert( m_labelName, m_labelValue );
+        m.insert( "labels", labels );
+    }
+
+    return m;
+}
+
+
+QString
+Metric::labels( const QString& extraName, const QString& extraValue ) const
+{
+    QStringList pairs;
+    if ( !m_labelName.isEmpty() )
+        pairs << QString( "%1=\"%2\"" ).arg( m_labelName ).arg( escapeLabelValue( m_labelValue ) );
+    if ( !extraName.isEmpty() )
+        pairs << QString( "%1=\"%2\"" ).arg( extraName ).arg( extraValue );
+
+    if ( pairs.isEmpty() )
+        return QString();
+
+    return "{" + pairs.join( "," ) + "}";
+}
+
+
+Counter::Counter( const QString& name, const QString& labelName, const QString& labelValue )
+    : Metric( CounterType, name, labelName, labelValue )
+    , m_value( 0 )
+{
+}
+
+
+void
+Counter::add( qint64 n )
+{
+    QMutexLocker lock( &m_mutex );
+    m_value += n;
+}
+
+
+qint64
+Counter::value() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_value;
+}
+
+
+QVariantMap
+Counter::toVariant() const
+{
+    QVariantMap m = Metric::toVariant();
+    m.insert( "value", value() );
+    return m;
+}
+
+
+QString
+Counter::toString() const
+{
+    return QString( "%1%2 %3" ).arg( name() ).arg( labels() ).arg( value() );
+}
+
+
+QString
+Counter::toPrometheus( const QString& prefix ) const
+{
+    return QString( "%1%2%3 %4\n" ).arg( prefix ).arg( name() ).arg( labels() ).arg( value() );
+}
+
+
+Gauge::Gauge( const QString& name, const QString& labelName, const QString& labelValue )
+    : Metric( GaugeType, name, labelName, labelValue )
+    , m_value( 0 )
+{
+}
+
+
+void
+Gauge::set( qint64 value )
+{
+    QMutexLocker lock( &m_mutex );
+    m_value = value;
+}
+
+
+void
+Gauge::add( qint64 delta )
+{
+    QMutexLocker lock( &m_mutex );
+    m_value += delta;
+}
+
+
+qint64
+Gauge::value() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_value;
+}
+
+
+QVariantMap
+Gauge::toVariant() const
+{
+    QVariantMap m = Metric::toVariant();
+    m.insert( "value", value() );
+    return m;
+}
+
+
+QString
+Gauge::toString() const
+{
+    return QString( "%1%2 %3" ).arg( name() ).arg( labels() ).arg( value() );
+}
+
+
+QString
+Gauge::toPrometheus( const QString& prefix ) const
+{
+    return QString( "%1%2%3 %4\n" ).arg( prefix ).arg( name() ).arg( labels() ).arg( value() );
+}
+
+
+Histogram::Histogram( const QString& name, const QString& labelName, const QString& labelValue )
+    : Metric( HistogramType, name, labelName, labelValue )
+    , m_count( 0 )
+    , m_sum( 0 )
+    , m_max( 0 )
+{
+    memset( m_buckets, 0, sizeof( m_buckets ) );
+}
+
+
+int
+Histogram::bucketIndex( qint64 value )
+{
+    if ( value < HISTOGRAM_SUB_BUCKETS )
+        return (int)qMax( (qint64)0, value );
+
+    int msb = 3;
+    while ( msb < 63 && ( value >> ( msb + 1 ) ) )
+        msb++;
+
+    if ( msb >= HISTOGRAM_MAX_BITS )
+        return HISTOGRAM_BUCKETS - 1;
+
+    // The top three bits below the most significant one pick the sub-bucket
+    const int shift = msb - 3;
+    return ( shift + 1 ) * HISTOGRAM_SUB_BUCKETS + (int)( ( value >> shift ) & ( HISTOGRAM_SUB_BUCKETS - 1 ) );
+}
+
+
+qint64
+Histogram::bucketUpperBound( int index )
+{
+    if ( index < HISTOGRAM_SUB_BUCKETS )
+        return index;
+
+    const int shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    const qint64 subBucket = index % HISTOGRAM_SUB_BUCKETS;
+    return ( ( HISTOGRAM_SUB_BUCKETS + subBucket + 1 ) << shift ) - 1;
+}
+
+
+void
+Histogram::record( qint64 value )
+{
+    const int index = bucketIndex( value );
+
+    QMutexLocker lock( &m_mutex );
+    m_buckets[ index ]++;
+    m_count++;
+    m_sum += value;
+    if ( value > m_max )
+        m_max = value;
+}
+
+
+qint64
+Histogram::count() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_count;
+}
+
+
+qint64
+Histogram::sum() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_sum;
+}
+
+
+qint64
+Histogram::max() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_max;
+}
+
+
+qint64
+Histogram::percentile( double fraction ) const
+{
+    QMutexLocker lock( &m_mutex );
+    return percentileLocked( fraction );
+}
+
+
+qint64
+Histogram::percentileLocked( double fraction ) const
+{
+    if ( m_count == 0 )
+        return 0;
+
+    const qint64 rank = qMax( (qint64)1, (qint64)( fraction * m_count + 0.5 ) );
+    qint64 seen = 0;
+    for ( int i = 0; i < HISTOGRAM_BUCKETS; i++ )
+    {
+        seen += m_buckets[ i ];
+        if ( seen >= rank )
+            return qMin( bucketUpperBound( i ), m_max );
+    }
+
+    return m_max;
+}
+
+
+QVariantMap
+Histogram::toVariant() const
+{
+    QVariantMap m = Metric::toVariant();
+
+    QMutexLocker lock( &m_mutex );
+    m.insert( "count", m_count );
+    m.insert( "sum", m_sum );
+    m.insert( "max", m_max );
+    m.insert( "p50", percentileLocked( 0.5 ) );
+    m.insert( "p90", percentileLocked( 0.9 ) );
+    m.insert( "p99", percentileLocked( 0.99 ) );
+
+    return m;
+}
+
+
+QString
+Histogram::toString() const
+{
+    QMutexLocker lock( &m_mutex );
+    return QString( "%1%2 count=%3 p50=%4 p90=%5 p99=%6 max=%7" )
+              .arg( name() ).arg( labels() ).arg( m_count )
+              .arg( percentileLocked( 0.5 ) ).arg( percentileLocked( 0.9 ) ).arg( percentileLocked( 0.99 ) )
+              .arg( m_max );
+}
+
+
+QString
+Histogram::toPrometheus( const QString& prefix ) const
+{
+    static const char* quantiles[] = { "0.5", "0.9", "0.99", "1" };
+    static const double fractions[] = { 0.5, 0.9, 0.99, 1.0 };
+
+    const QString fullName = prefix + name();
+    QString out;
+
+    // Exported as a summary, the buckets are too fine-grained to be useful there
+    QMutexLocker lock( &m_mutex );
+    for ( int i = 0; i < 4; i++ )
+    {
+        out += QString( "%1%2 %3\n" ).arg( fullName ).arg( labels( "quantile", quantiles[ i ] ) ).arg( percentileLocked( fractions[ i ] ) );
+    }
+    out += QString( "%1_sum%2 %3\n" ).arg( fullName ).arg( labels() ).arg( m_sum );
+    out += QString( "%1_count%2 %3\n" ).arg( fullName ).arg( labels() ).arg( m_count );
+
+    return out;
+}
+
+
+Metrics*
+Metrics::instance()
+{
+    return s_metrics();
+}
+
+
+Metrics::Metrics()
+{
+}
+
+
+Counter*
+Metrics::counter( const QString& name, const QString& labelName, const QString& labelValue )
+{
+    return static_cast< Counter* >( metric( Metric::CounterType, name, labelName, labelValue ) );
+}
+
+
+Gauge*
+Metrics::gauge( const QString& name, const QString& labelName, const QString& labelValue )
+{
+    return static_cast< Gauge* >( metric( Metric::GaugeType, name, labelName, labelValue ) );
+}
+
+
+Histogram*
+Metrics::histogram( const QString& name, const QString& labelName, const QString& labelValue )
+{
+    return static_cast< Histogram* >( metric( Metric::HistogramType, name, labelName, labelValue ) );
+}
+
+
+Metric*
+Metrics::metric( Metric::Type type, const QString& name, const QString& labelName, const QString& labelValue )
+{
+    const QString key = QString( name ).append( QChar( 0 ) ).append( labelValue );
+
+    QMutexLocker lock( &m_mutex );
+    Metric* m = m_metrics.value( key );
+    if ( m )
+    {
+        Q_ASSERT( m->type() == type );
+        return m;
+    }
+
+    switch ( type )
+    {
+        case Metric::CounterType:
+            m = new Counter( name, labelName, labelValue );
+            break;
+        case Metric::GaugeType:
+            m = new Gauge( name, labelName, labelValue );
+            break;
+        case Metric::HistogramType:
+            m = new Histogram( name, labelName, labelValue );
+            break;
+    }
+
+    m_metrics.insert( key, m );
+    return m;
+}
+
+
+QList< Metric* >
+Metrics::metrics() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_metrics.values();
+}
+
+
+QVariantMap
+Metrics::toVariant() const
+{
+    QVariantList list;
+    foreach ( Metric* m, metrics() )
+        list << m->toVariant();
+
+    QVariantMap map;
+    map.insert( "metrics", list );
+    return map;
+}
+
+
+QString
+Metrics::toString() const
+{
+    QStringList lines;
+    foreach ( Metric* m, metrics() )
+        lines << m->toString();
+
+    return lines.join( "\n" );
+}
+
+
+QByteArray
+Metrics::toPrometheus() const
+{
+    static const char* types[] = { "counter", "gauge", "summary" };
+
+    QString out;
+    QString family;
+    foreach ( Metric* m, metrics() )
+    {
+        if ( m->name() != family )
+        {
+            family = m->name();
+            out += QString( "# TYPE " METRICS_PREFIX "%1 %2\n" ).arg( family ).arg( types[ m->type() ] );
+        }
+
+        out += m->toPrometheus( METRICS_PREFIX );
+    }
+
+    return out.toUtf8();
+}
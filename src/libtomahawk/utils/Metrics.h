@@ -0,0 +1,191 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_METRICS_H
+#define TOMAHAWK_METRICS_H
+
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVariant>
+
+#include "DllMacro.h"
+
+// Sub-buckets per power of two, i.e. histograms are accurate to 1/8th (12.5%)
+#define HISTOGRAM_SUB_BUCKETS 8
+// Values up to 2^40 can be told apart, larger ones land in the last bucket
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_BUCKETS ( ( HISTOGRAM_MAX_BITS - 2 ) * HISTOGRAM_SUB_BUCKETS )
+
+namespace Tomahawk
+{
+
+/**
+ * A single named value in the Metrics registry, with an optional label.
+ *
+ * Metrics are created on first use and never deleted, so callers on hot paths
+ * can look them up once and keep the pointer.
+ */
+class DLLEXPORT Metric
+{
+public:
+    enum Type
+    {
+        CounterType = 0,
+        GaugeType = 1,
+        HistogramType = 2
+    };
+
+    Metric( Type type, const QString& name, const QString& labelName, const QString& labelValue );
+    virtual ~Metric() {}
+
+    Type type() const { return m_type; }
+    QString name() const { return m_name; }
+    QString labelName() const { return m_labelName; }
+    QString labelValue() const { return m_labelValue; }
+
+    virtual QVariantMap toVariant() const;
+    virtual QString toString() const = 0;
+    virtual QString toPrometheus( const QString& prefix ) const = 0;
+
+protected:
+    /// Label set in the Prometheus text format, e.g. {command="Foo",quantile="0.5"}
+    QString labels( const QString& extraName = QString(), const QString& extraValue = QString() ) const;
+
+    mutable QMutex m_mutex;
+
+private:
+    Type m_type;
+    QString m_name;
+    QString m_labelName;
+    QString m_labelValue;
+};
+
+
+/// A value that only ever goes up, like the number of bytes sent.
+class DLLEXPORT Counter : public Metric
+{
+public:
+    Counter( const QString& name, const QString& labelName, const QString& labelValue );
+
+    void add( qint64 n = 1 );
+    qint64 value() const;
+
+    virtual QVariantMap toVariant() const;
+    virtual QString toString() const;
+    virtual QString toPrometheus( const QString& prefix ) const;
+
+private:
+    qint64 m_value;
+};
+
+
+/// A value that goes up and down, like the length of a queue.
+class DLLEXPORT Gauge : public Metric
+{
+public:
+    Gauge( const QString& name, const QString& labelName, const QString& labelValue );
+
+    void set( qint64 value );
+    void add( qint64 delta );
+    qint64 value() const;
+
+    virtual QVariantMap toVariant() const;
+    virtual QString toString() const;
+    virtual QString toPrometheus( const QString& prefix ) const;
+
+private:
+    qint64 m_value;
+};
+
+
+/**
+ * Distribution of recorded values, e.g. latencies.
+ *
+ * Values are counted in log-linear buckets: every power of two is split into
+ * HISTOGRAM_SUB_BUCKETS equally sized buckets. Recording is a couple of integer
+ * ops, percentiles are only computed when the histogram is read.
+ */
+class DLLEXPORT Histogram : public Metric
+{
+public:
+    Histogram( const QString& name, const QString& labelName, const QString& labelValue );
+
+    void record( qint64 value );
+
+    qint64 count() const;
+    qint64 sum() const;
+    qint64 max() const;
+    /// Upper bound of the values below @p fraction (0.0 - 1.0) of all recorded ones.
+    qint64 percentile( double fraction ) const;
+
+    virtual QVariantMap toVariant() const;
+    virtual QString toString() const;
+    virtual QString toPrometheus( const QString& prefix ) const;
+
+    static int bucketIndex( qint64 value );
+    /// Largest value counted in bucket @p index.
+    static qint64 bucketUpperBound( int index );
+
+private:
+    qint64 percentileLocked( double fraction ) const;
+
+    qint64 m_buckets[ HISTOGRAM_BUCKETS ];
+    qint64 m_count;
+    qint64 m_sum;
+    qint64 m_max;
+};
+
+
+/**
+ * Process-wide registry of counters, gauges and histograms.
+ *
+ * Recording a value takes an uncontended lock of just that metric, nothing
+ * gets formatted or aggregated until someone reads the registry: the Playdar
+ * API serves it at /api/1.5/metrics (JSON) and /api/1.5/metrics/prometheus,
+ * and the diagnostics dialog shows it.
+ *
+ * Names follow the Prometheus conventions (e.g. database_command_exec_ms),
+ * the "tomahawk_" prefix gets added when exporting.
+ */
+class DLLEXPORT Metrics
+{
+public:
+    /// Use instance(), separate registries only make sense in tests.
+    Metrics();
+
+    static Metrics* instance();
+
+    Counter* counter( const QString& name, const QString& labelName = QString(), const QString& labelValue = QString() );
+    Gauge* gauge( const QString& name, const QString& labelName = QString(), const QString& labelValue = QString() );
+    Histogram* histogram( const QString& name, const QString& labelName = QString(), const QString& labelValue = QString() );
+
+    QVariantMap toVariant() const;
+    QString toString() const;
+    QByteArray toPrometheus() const;
+
+private:
+    Metric* metric( Metric::Type type, const QString& name, const QString& labelName, const QString& labelValue );
+    QList< Metric* > metrics() const;
+
+    // Keyed by name and label value, so all metrics of a family are adjacent
+    QMap< QString, Metric* > m_metrics;
+    mutable QMutex m_mutex;
+};
+
+}
+
+#endif // TOMAHAWK_METRICS_H
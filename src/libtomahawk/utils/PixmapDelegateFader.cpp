@@ -146,12 +146,17 @@ PixmapDelegateFader::setSize( const QSize& size )
     }
     else
     {
+        QPixmap pixmap;
         if ( !m_album.isNull() )
-            m_currentReference = TomahawkUtils::createRoundedImage( m_album->cover( m_size ), QSize( 0, 0 ), m_mode == TomahawkUtils::Grid ? 0.00 : 0.20 );
+            pixmap = m_album->cover( m_size );
         else if ( !m_artist.isNull() )
-            m_currentReference = TomahawkUtils::createRoundedImage( m_artist->cover( m_size ), QSize( 0, 0 ), m_mode == TomahawkUtils::Grid ? 0.00 : 0.20 );
+            pixmap = m_artist->cover( m_size );
         else if ( !m_track.isNull() )
-            m_currentReference = TomahawkUtils::createRoundedImage( m_track->track()->cover( m_size ), QSize( 0, 0 ), m_mode == TomahawkUtils::Grid ? 0.00 : 0.20 );
+            pixmap = m_track->track()->cover( m_size );
+
+        // Keep showing the current image until the new size has been scaled, we get notified via coverChanged
+        if ( !pixmap.isNull() )
+            m_currentReference = TomahawkUtils::createRoundedImage( pixmap, QSize( 0, 0 ), m_mode == TomahawkUtils::Grid ? 0.00 : 0.20 );
     }
 
     emit repaintRequest();
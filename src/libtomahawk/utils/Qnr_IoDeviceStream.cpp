@@ -23,6 +23,7 @@
 #include "Qnr_IoDeviceStream.h"
 
 #include "utils/Logger.h"
+#include "utils/StreamCache.h"
 
 #include <QNetworkReply>
 #include <QTimer>
@@ -37,6 +38,7 @@ QNR_IODeviceStream::QNR_IODeviceStream( const QSharedPointer<QNetworkReply>& rep
     , m_networkReply( reply )
     , m_pos( 0 )
     , m_timer( new QTimer( this ) )
+    , m_cacheKey( reply->property( "streamCacheKey" ).toString() )
 {
     if ( !m_networkReply->isOpen() ) {
         m_networkReply->open(QIODevice::ReadOnly);
@@ -52,6 +54,7 @@ QNR_IODeviceStream::QNR_IODeviceStream( const QSharedPointer<QNetworkReply>& rep
         Q_ASSERT( m_networkReply->atEnd() );
         setStreamSeekable( true );
         setStreamSize( m_data.size() );
+        onFinished();
     }
     else
     {
@@ -64,6 +67,7 @@ QNR_IODeviceStream::QNR_IODeviceStream( const QSharedPointer<QNetworkReply>& rep
         // Just consume all data that is already available.
         m_data = m_networkReply->readAll();
         connect( m_networkReply.data(), SIGNAL( readyRead() ), SLOT( readyRead() ) );
+        connect( m_networkReply.data(), SIGNAL( finished() ), SLOT( onFinished() ) );
     }
 
     m_timer->setInterval( 0 );
@@ -128,4 +132,22 @@ QNR_IODeviceStream::readyRead()
 }
 
 
+void
+QNR_IODeviceStream::onFinished()
+{
+    if ( m_cacheKey.isEmpty() )
+        return;
+
+    m_data += m_networkReply->readAll();
+
+    const QVariant contentLength = m_networkReply->header( QNetworkRequest::ContentLengthHeader );
+    const bool complete = m_networkReply->error() == QNetworkReply::NoError &&
+                          ( !contentLength.isValid() || contentLength.toLongLong() == m_data.size() );
+
+    // We got all of it in memory anyway, keep it for the next time
+    StreamCache::instance()->store( m_cacheKey, m_data, complete );
+    m_cacheKey.clear();
+}
+
+
 // vim: sw=4 sts=4 et tw=100
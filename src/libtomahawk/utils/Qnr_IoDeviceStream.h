@@ -51,12 +51,14 @@ public:
 private slots:
     void moreData();
     void readyRead();
+    void onFinished();
 
 private:
     QByteArray m_data;
     QSharedPointer<QNetworkReply> m_networkReply;
     qint64 m_pos;
     QTimer* m_timer;
+    QString m_cacheKey;
 };
 
 } // namespace Tomahawk
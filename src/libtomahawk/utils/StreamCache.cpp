@@ -0,0 +1,432 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "StreamCache.h"
+
+#include "utils/Logger.h"
+
+#include "Result.h"
+#include "TomahawkSettings.h"
+#include "Track.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+#include <qtconcurrentrun.h>
+
+#define PARTIAL_SUFFIX ".part"
+// Not worth keeping less than a few seconds of audio around
+#define PARTIAL_MIN_SIZE ( 256 * 1024 )
+
+using namespace Tomahawk;
+
+namespace Tomahawk
+{
+
+/// A cached track being read, keeps its entry pinned until it got closed.
+class CachedStreamFile : public QFile
+{
+public:
+    CachedStreamFile( StreamCache* cache, const QString& fileName )
+        : QFile( cache->m_cacheDir + fileName )
+        , m_cache( cache )
+        , m_fileName( fileName )
+        , m_pinned( true )
+    {}
+
+    virtual ~CachedStreamFile()
+    {
+        release();
+    }
+
+    virtual void close()
+    {
+        QFile::close();
+        release();
+    }
+
+private:
+    void release()
+    {
+        if ( !m_pinned )
+            return;
+
+        m_pinned = false;
+        m_cache->unpin( m_fileName );
+    }
+
+    StreamCache* m_cache;
+    QString m_fileName;
+    bool m_pinned;
+};
+
+}
+
+Q_GLOBAL_STATIC( StreamCache, s_streamCache );
+
+
+StreamCache*
+StreamCache::instance()
+{
+    return s_streamCache();
+}
+
+
+StreamCache::StreamCache()
+    : m_cacheDir( TomahawkSettings::instance()->storageCacheLocation() + "/StreamCache/" )
+    , m_size( 0 )
+    , m_maxSize( TomahawkSettings::instance()->streamCacheSize() )
+    , m_policy( (EvictionPolicy)TomahawkSettings::instance()->streamCachePolicy() )
+{
+    load();
+}
+
+
+StreamCache::StreamCache( const QString& cacheDir, qint64 maxSize, EvictionPolicy policy )
+    : m_cacheDir( cacheDir + "/" )
+    , m_size( 0 )
+    , m_maxSize( maxSize )
+    , m_policy( policy )
+{
+    load();
+}
+
+
+void
+StreamCache::load()
+{
+    QDir dir( m_cacheDir );
+    if ( !dir.exists() && !dir.mkpath( m_cacheDir ) )
+        tLog() << "Failed to create stream cache dir:" << m_cacheDir;
+
+    // We don't keep an index, the files are all we need to know
+    const QFileInfoList fileList = dir.entryInfoList( QDir::Files | QDir::NoDotAndDotDot );
+    foreach ( const QFileInfo& file, fileList )
+    {
+        if ( file.suffix() == "tmp" )
+        {
+            QFile::remove( file.absoluteFilePath() );
+            continue;
+        }
+
+        Entry entry;
+        entry.size = file.size();
+        entry.created = file.lastModified();
+        entry.lastAccess = file.lastRead();
+        m_entries.insert( file.fileName(), entry );
+        m_size += entry.size;
+    }
+
+    tDebug() << Q_FUNC_INFO << "Stream cache holds" << m_entries.count() << "entries," << m_size << "bytes";
+    evict();
+}
+
+
+QString
+StreamCache::key( const Tomahawk::result_ptr& result, const QString& url )
+{
+    // Resolver urls often carry short-lived tokens in their query
+    QString identity = url.left( url.indexOf( '?' ) );
+    identity += QString( "\t%1\t%2" ).arg( result->size() ).arg( result->modificationTime() );
+    if ( result->track() )
+        identity += "\t" + result->track()->toString();
+
+    return QCryptographicHash::hash( identity.toUtf8(), QCryptographicHash::Md5 ).toHex();
+}
+
+
+bool
+StreamCache::isEnabled() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_maxSize > 0;
+}
+
+
+qint64
+StreamCache::maxSize() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_maxSize;
+}
+
+
+void
+StreamCache::setMaxSize( qint64 bytes )
+{
+    TomahawkSettings::instance()->setStreamCacheSize( bytes );
+
+    QMutexLocker lock( &m_mutex );
+    m_maxSize = bytes;
+    evict();
+}
+
+
+StreamCache::EvictionPolicy
+StreamCache::policy() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_policy;
+}
+
+
+void
+StreamCache::setPolicy( EvictionPolicy policy )
+{
+    TomahawkSettings::instance()->setStreamCachePolicy( policy );
+
+    QMutexLocker lock( &m_mutex );
+    m_policy = policy;
+}
+
+
+QSharedPointer< QIODevice >
+StreamCache::open( const QString& key )
+{
+    QMutexLocker lock( &m_mutex );
+
+    if ( !m_entries.contains( key ) )
+    {
+        m_stats.misses++;
+        return QSharedPointer< QIODevice >();
+    }
+
+    // Pinned before opening, the file must not go away while we hand it out
+    Entry& entry = m_entries[ key ];
+    entry.pins++;
+
+    CachedStreamFile* file = new CachedStreamFile( this, key );
+    if ( !file->open( QIODevice::ReadOnly ) )
+    {
+        tLog() << Q_FUNC_INFO << "Could not open cached stream:" << file->fileName();
+
+        // Deleting it unpins the entry
+        lock.unlock();
+        delete file;
+        lock.relock();
+
+        removeEntry( key );
+        m_stats.misses++;
+        return QSharedPointer< QIODevice >();
+    }
+
+    entry.lastAccess = QDateTime::currentDateTime();
+
+    m_stats.hits++;
+    m_stats.bytesServed += entry.size;
+
+    return QSharedPointer< QIODevice >( file );
+}
+
+
+QByteArray
+StreamCache::partial( const QString& key )
+{
+    const QString fileName = key + PARTIAL_SUFFIX;
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( !m_entries.contains( fileName ) )
+            return QByteArray();
+
+        m_entries[ fileName ].lastAccess = QDateTime::currentDateTime();
+    }
+
+    QFile file( m_cacheDir + fileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return QByteArray();
+
+    const QByteArray data = file.readAll();
+
+    QMutexLocker lock( &m_mutex );
+    m_stats.partialHits++;
+    m_stats.bytesServed += data.size();
+
+    return data;
+}
+
+
+void
+StreamCache::store( const QString& key, const QByteArray& data, bool complete )
+{
+    if ( !isEnabled() || data.isEmpty() )
+        return;
+    if ( !complete && data.size() < PARTIAL_MIN_SIZE )
+        return;
+
+    QtConcurrent::run( this, &StreamCache::write, key, data, complete );
+}
+
+
+/// This method is run by QtConcurrent:
+void
+StreamCache::write( const QString& key, const QByteArray& data, bool complete )
+{
+    const QString fileName = complete ? key : key + PARTIAL_SUFFIX;
+    {
+        // Never replace a longer partial transfer with a shorter one
+        QMutexLocker lock( &m_mutex );
+        if ( m_entries.contains( key ) ||
+             ( !complete && m_entries.value( fileName ).size >= data.size() ) )
+        {
+            return;
+        }
+    }
+
+    // Write to a temporary file first, so readers never see half a track
+    const QString target = m_cacheDir + fileName;
+    const QString tmp = QString( "%1.%2.tmp" ).arg( target ).arg( (quintptr)QThread::currentThreadId() );
+
+    QFile file( tmp );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) || file.write( data ) != data.size() )
+    {
+        tLog() << Q_FUNC_INFO << "Could not write stream cache entry:" << tmp << file.errorString();
+        file.remove();
+        return;
+    }
+    file.close();
+
+    QMutexLocker lock( &m_mutex );
+
+    if ( !removeEntry( fileName ) || !QFile::rename( tmp, target ) )
+    {
+        QFile::remove( tmp );
+        return;
+    }
+
+    Entry entry;
+    entry.size = data.size();
+    entry.created = QDateTime::currentDateTime();
+    entry.lastAccess = entry.created;
+    m_entries.insert( fileName, entry );
+    m_size += entry.size;
+    m_stats.bytesStored += entry.size;
+
+    // The complete track supersedes what we had of it before
+    if ( complete )
+        removeEntry( key + PARTIAL_SUFFIX );
+
+    evict();
+}
+
+
+bool
+StreamCache::removeEntry( const QString& fileName )
+{
+    if ( !m_entries.contains( fileName ) )
+        return true;
+
+    const QString path = m_cacheDir + fileName;
+    if ( !QFile::remove( path ) && QFile::exists( path ) )
+    {
+        tLog() << Q_FUNC_INFO << "Failed to remove cached stream" << fileName;
+        return false;
+    }
+
+    m_size -= m_entries.take( fileName ).size;
+    return true;
+}
+
+
+static bool
+olderThan( const QPair< QDateTime, QString >& a, const QPair< QDateTime, QString >& b )
+{
+    return a.first < b.first;
+}
+
+
+void
+StreamCache::evict()
+{
+    if ( m_size <= m_maxSize )
+        return;
+
+    // Entries that are being read stay, whatever the policy says
+    QList< QPair< QDateTime, QString > > candidates;
+    for ( QHash< QString, Entry >::const_iterator it = m_entries.constBegin(); it != m_entries.constEnd(); ++it )
+    {
+        if ( it.value().pins > 0 )
+            continue;
+
+        const QDateTime& age = ( m_policy == LeastRecentlyUsed ) ? it.value().lastAccess : it.value().created;
+        candidates << qMakePair( age, it.key() );
+    }
+    qSort( candidates.begin(), candidates.end(), olderThan );
+
+    for ( int i = 0; i < candidates.count() && m_size > m_maxSize; i++ )
+    {
+        const QString& fileName = candidates.at( i ).second;
+        tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Evicting" << fileName << m_entries.value( fileName ).size;
+        if ( removeEntry( fileName ) )
+            m_stats.evictions++;
+    }
+}
+
+
+void
+StreamCache::unpin( const QString& fileName )
+{
+    QMutexLocker lock( &m_mutex );
+
+    // It may have been replaced or cleared in the meantime
+    QHash< QString, Entry >::iterator it = m_entries.find( fileName );
+    if ( it == m_entries.end() || it.value().pins == 0 )
+        return;
+
+    it.value().pins--;
+    if ( it.value().pins == 0 )
+        evict();
+}
+
+
+StreamCache::Stats
+StreamCache::stats() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_stats;
+}
+
+
+void
+StreamCache::resetStats()
+{
+    QMutexLocker lock( &m_mutex );
+    m_stats = Stats();
+}
+
+
+qint64
+StreamCache::size() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_size;
+}
+
+
+void
+StreamCache::clear()
+{
+    QMutexLocker lock( &m_mutex );
+    foreach ( const QString& fileName, m_entries.keys() )
+    {
+        // Can't remove tracks that are being played
+        if ( m_entries.value( fileName ).pins == 0 )
+            removeEntry( fileName );
+    }
+}
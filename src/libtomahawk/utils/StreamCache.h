@@ -0,0 +1,135 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef STREAMCACHE_H
+#define STREAMCACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+#include "DllMacro.h"
+#include "Typedefs.h"
+
+class QIODevice;
+
+namespace Tomahawk
+{
+
+/**
+ * Size-bounded on-disk cache of tracks we streamed from peers or resolvers.
+ *
+ * Completed transfers are stored as plain files, so replaying a track from a
+ * friend's collection is a local file read. Transfers that got interrupted
+ * (e.g. because the user skipped) keep their leading bytes in a ".part" entry;
+ * the next transfer of the same track starts with those and only requests the
+ * rest from the peer.
+ *
+ * Entries are keyed by the result's identity, not its url, since resolver urls
+ * often carry short-lived tokens.
+ *
+ * All methods are thread-safe, writing happens on the global thread pool.
+ */
+class DLLEXPORT StreamCache
+{
+public:
+    enum EvictionPolicy
+    {
+        LeastRecentlyUsed = 0,
+        OldestFirst = 1
+    };
+
+    struct Stats
+    {
+        Stats() : hits( 0 ), partialHits( 0 ), misses( 0 ), bytesServed( 0 ), bytesStored( 0 ), evictions( 0 ) {}
+
+        qint64 hits;
+        qint64 partialHits;
+        qint64 misses; /// includes partial hits
+        qint64 bytesServed;
+        qint64 bytesStored;
+        qint64 evictions;
+    };
+
+    static StreamCache* instance();
+
+    /// Use instance(), separate caches only make sense in tests.
+    StreamCache();
+    StreamCache( const QString& cacheDir, qint64 maxSize, EvictionPolicy policy = LeastRecentlyUsed );
+
+    static QString key( const Tomahawk::result_ptr& result, const QString& url );
+
+    /// A maximum size of 0 disables the cache.
+    bool isEnabled() const;
+    qint64 maxSize() const;
+    void setMaxSize( qint64 bytes );
+
+    EvictionPolicy policy() const;
+    void setPolicy( EvictionPolicy policy );
+
+    /**
+     * Returns an opened device for a completely cached track, or a null pointer.
+     * The entry won't be evicted until the device got closed.
+     */
+    QSharedPointer< QIODevice > open( const QString& key );
+
+    /// The leading bytes of an interrupted transfer, if we have any.
+    QByteArray partial( const QString& key );
+
+    void store( const QString& key, const QByteArray& data, bool complete );
+
+    Stats stats() const;
+    void resetStats();
+
+    qint64 size() const;
+    void clear();
+
+private:
+    friend class CachedStreamFile;
+
+    struct Entry
+    {
+        Entry() : size( 0 ), pins( 0 ) {}
+
+        qint64 size;
+        QDateTime created;
+        QDateTime lastAccess;
+        /// Number of devices returned by open() that are still open
+        int pins;
+    };
+
+    void load();
+    void write( const QString& key, const QByteArray& data, bool complete );
+    bool removeEntry( const QString& fileName );
+    void evict();
+    void unpin( const QString& fileName );
+
+    QString m_cacheDir;
+
+    mutable QMutex m_mutex;
+    QHash< QString, Entry > m_entries;
+    qint64 m_size;
+    qint64 m_maxSize;
+    EvictionPolicy m_policy;
+    Stats m_stats;
+};
+
+}
+
+#endif // STREAMCACHE_H
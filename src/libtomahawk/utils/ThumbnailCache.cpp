@@ -0,0 +1,233 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThumbnailCache.h"
+
+#include "TomahawkSettings.h"
+#include "utils/Logger.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+
+// Same lifetime the info plugins use for cover art in the InfoSystemCache (4 weeks)
+#define THUMBNAIL_MAX_AGE Q_INT64_C( 2419200000 )
+// We only persist what views actually paint, not full-size images
+#define THUMBNAIL_MAX_DIMENSION 512
+// Oldest thumbnails get pruned beyond that, a 64x64 one takes 16 KiB
+#define THUMBNAIL_MAX_CACHE_SIZE Q_INT64_C( 67108864 )
+// Pruning from store() leaves some room, so we don't rescan the directory on every store
+#define THUMBNAIL_PRUNE_TARGET ( THUMBNAIL_MAX_CACHE_SIZE * 3 / 4 )
+
+#define THUMBNAIL_MAGIC 0x5448554d // "THUM"
+
+using namespace Tomahawk;
+
+namespace
+{
+    struct ThumbnailHeader
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 format;
+        quint32 width;
+        quint32 height;
+        quint32 bytesPerLine;
+    };
+}
+
+const quint32 ThumbnailCache::s_version = 1;
+
+Q_GLOBAL_STATIC( ThumbnailCache, s_thumbnailCache );
+
+
+ThumbnailCache*
+ThumbnailCache::instance()
+{
+    return s_thumbnailCache();
+}
+
+
+ThumbnailCache::ThumbnailCache()
+    : m_cacheDir( TomahawkSettings::instance()->storageCacheLocation() + "/ThumbnailCache/" )
+    , m_size( 0 )
+    , m_pruning( false )
+{
+    QDir dir( m_cacheDir );
+    if ( !dir.exists() && !dir.mkpath( m_cacheDir ) )
+        tLog() << "Failed to create thumbnail cache dir:" << m_cacheDir;
+}
+
+
+QString
+ThumbnailCache::sourceKey( const QByteArray& imageData )
+{
+    return QCryptographicHash::hash( imageData, QCryptographicHash::Md5 ).toHex();
+}
+
+
+QString
+ThumbnailCache::fileName( const QString& sourceKey, const QSize& size ) const
+{
+    return QString( "%1%2_%3x%4" ).arg( m_cacheDir ).arg( sourceKey ).arg( size.width() ).arg( size.height() );
+}
+
+
+QImage
+ThumbnailCache::load( const QString& sourceKey, const QSize& size ) const
+{
+    QFile file( fileName( sourceKey, size ) );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return QImage();
+
+    if ( file.size() < (qint64)sizeof( ThumbnailHeader ) )
+        return QImage();
+
+    uchar* data = file.map( 0, file.size() );
+    if ( !data )
+        return QImage();
+
+    QImage image;
+    const ThumbnailHeader* header = reinterpret_cast< const ThumbnailHeader* >( data );
+    // store() only writes premultiplied ARGB32, anything else is a corrupt file
+    if ( header->magic == THUMBNAIL_MAGIC && header->version == s_version &&
+         header->format == QImage::Format_ARGB32_Premultiplied &&
+         header->width > 0 && header->width <= THUMBNAIL_MAX_DIMENSION &&
+         header->height > 0 && header->height <= THUMBNAIL_MAX_DIMENSION &&
+         header->bytesPerLine >= header->width * 4 &&
+         file.size() >= (qint64)( sizeof( ThumbnailHeader ) + (qint64)header->bytesPerLine * header->height ) )
+    {
+        // Wrap the mapped pixels and detach, the mapping goes away with the file
+        image = QImage( data + sizeof( ThumbnailHeader ), header->width, header->height,
+                        header->bytesPerLine, (QImage::Format)header->format ).copy();
+    }
+    else
+    {
+        tDebug() << Q_FUNC_INFO << "Invalid thumbnail, removing:" << file.fileName();
+        file.unmap( data );
+        file.remove();
+        return QImage();
+    }
+
+    file.unmap( data );
+    return image;
+}
+
+
+void
+ThumbnailCache::store( const QString& sourceKey, const QSize& size, const QImage& source ) const
+{
+    if ( source.isNull() || size.width() > THUMBNAIL_MAX_DIMENSION || size.height() > THUMBNAIL_MAX_DIMENSION )
+        return;
+
+    const QImage image = source.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+
+    ThumbnailHeader header;
+    header.magic = THUMBNAIL_MAGIC;
+    header.version = s_version;
+    header.format = image.format();
+    header.width = image.width();
+    header.height = image.height();
+    header.bytesPerLine = image.bytesPerLine();
+
+    // Write to a temporary file first, so concurrent readers never see half a thumbnail
+    const QString target = fileName( sourceKey, size );
+    const QString tmp = QString( "%1.%2.tmp" ).arg( target ).arg( (quintptr)QThread::currentThreadId() );
+
+    QFile file( tmp );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        tDebug() << Q_FUNC_INFO << "Could not write thumbnail:" << tmp;
+        return;
+    }
+
+    file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+    file.write( reinterpret_cast< const char* >( image.constBits() ), image.byteCount() );
+    file.close();
+
+    QFile::remove( target );
+    if ( !QFile::rename( tmp, target ) )
+    {
+        QFile::remove( tmp );
+        return;
+    }
+
+    bool needsPrune = false;
+    {
+        QMutexLocker lock( &m_mutex );
+        m_size += sizeof( header ) + image.byteCount();
+        if ( m_size > THUMBNAIL_MAX_CACHE_SIZE && !m_pruning )
+        {
+            m_pruning = true;
+            needsPrune = true;
+        }
+    }
+
+    if ( needsPrune )
+        pruneTo( THUMBNAIL_PRUNE_TARGET );
+}
+
+
+void
+ThumbnailCache::prune() const
+{
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( m_pruning )
+            return;
+
+        m_pruning = true;
+    }
+
+    pruneTo( THUMBNAIL_MAX_CACHE_SIZE );
+}
+
+
+void
+ThumbnailCache::pruneTo( qint64 maxSize ) const
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDateTime expiry = now.addMSecs( -THUMBNAIL_MAX_AGE );
+
+    // Newest first, so whatever is left beyond the size limit is the oldest
+    const QFileInfoList fileList = QDir( m_cacheDir ).entryInfoList( QDir::Files | QDir::NoDotAndDotDot, QDir::Time );
+    qint64 size = 0;
+    foreach ( const QFileInfo& file, fileList )
+    {
+        if ( file.suffix() == "tmp" )
+        {
+            // Recent ones are a store() in progress on another thread, older ones left over from a crash
+            if ( file.lastModified() >= now.addSecs( -60 ) )
+                continue;
+        }
+        else if ( file.lastModified() >= expiry && size + file.size() <= maxSize )
+        {
+            size += file.size();
+            continue;
+        }
+
+        if ( !QFile::remove( file.absoluteFilePath() ) )
+            tLog() << "Failed to remove stale thumbnail" << file.absoluteFilePath();
+    }
+
+    QMutexLocker lock( &m_mutex );
+    m_size = size;
+    m_pruning = false;
+}
@@ -0,0 +1,82 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+
+#include "DllMacro.h"
+
+namespace Tomahawk
+{
+
+/**
+ * Persistent cache of pre-scaled album and artist images.
+ *
+ * Each thumbnail is stored in its own file as a small header followed by the raw
+ * ARGB32 pixel data, so loading one is a memory map and a copy instead of decoding
+ * the (often huge) JPEG the info plugins fetched.
+ *
+ * Entries are keyed by a hash of the source image data and the thumbnail size.
+ * They expire after the same time the InfoSystemCache keeps cover art for, so a
+ * thumbnail never outlives the image it was made from for long. Once the files
+ * we wrote push the cache past its size limit, the oldest ones get pruned.
+ *
+ * All methods are thread-safe and meant to be called from worker threads.
+ */
+class DLLEXPORT ThumbnailCache
+{
+public:
+    static ThumbnailCache* instance();
+
+    /// Use instance(), separate caches only make sense in tests.
+    ThumbnailCache();
+
+    /// Key for the given encoded source image.
+    static QString sourceKey( const QByteArray& imageData );
+
+    /// Returns the cached thumbnail or a null image.
+    QImage load( const QString& sourceKey, const QSize& size ) const;
+    void store( const QString& sourceKey, const QSize& size, const QImage& image ) const;
+
+    /// Removes all expired thumbnails, and the oldest ones beyond the size limit.
+    void prune() const;
+
+private:
+    void pruneTo( qint64 maxSize ) const;
+    QString fileName( const QString& sourceKey, const QSize& size ) const;
+
+    /**
+     * Version number of the on-disk format.
+     * If you change it, increase this number.
+     */
+    static const quint32 s_version;
+
+    QString m_cacheDir;
+
+    mutable QMutex m_mutex;
+    /// Bytes on disk as of the last prune, plus what we stored since
+    mutable qint64 m_size;
+    mutable bool m_pruning;
+};
+
+}
+
+#endif // THUMBNAILCACHE_H
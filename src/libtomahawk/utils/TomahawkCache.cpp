@@ -19,17 +19,28 @@
 #include "TomahawkCache.h"
 
 #include "TomahawkSettings.h"
-#include "Source.h"
 #include "utils/Logger.h"
 
+#include <QDataStream>
 #include <QDateTime>
-#include <QSettings>
+#include <QDir>
+#include <QFile>
 #include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <qtconcurrentrun.h>
+
+#define CACHE_MAGIC 0x54434348                  // "TCCH"
+#define HEADER_SIZE 8                           // magic and version
+#define MEMORY_CACHE_SIZE ( 4 * 1024 * 1024 )   // bytes of recently used entries kept in memory
+#define FLUSH_DELAY 2000                        // puts are written to disk in batches
+#define PRUNE_INTERVAL 300000
+#define COMPACT_MIN_SIZE ( 1024 * 1024 )        // don't bother compacting smaller files
 
 using namespace TomahawkUtils;
 
-Cache*Cache::s_instance = 0;
-const int Cache::s_cacheVersion = 1;
+Cache* Cache::s_instance = 0;
+const int Cache::s_cacheVersion = 2;
 
 
 Cache* Cache::instance()
@@ -44,133 +55,474 @@ Cache* Cache::instance()
 Cache::Cache()
     : QObject( 0 )
     , m_cacheBaseDir( TomahawkSettings::instance()->storageCacheLocation() + "/GenericCache/" )
-    , m_cacheManifest( m_cacheBaseDir + "cachemanifest.ini", QSettings::IniFormat )
+    , m_fileSize( 0 )
+    , m_liveBytes( 0 )
 {
     if ( TomahawkSettings::instance()->genericCacheVersion() < s_cacheVersion )
     {
+        // Also gets rid of the per-client INI files older versions used
         TomahawkUtils::removeDirectory( m_cacheBaseDir );
         TomahawkSettings::instance()->setGenericCacheVersion( s_cacheVersion );
     }
 
-    m_pruneTimer.setInterval( 300000 );
+    init();
+}
+
+
+Cache::Cache( const QString& cacheDir )
+    : QObject( 0 )
+    , m_cacheBaseDir( cacheDir + "/" )
+    , m_fileSize( 0 )
+    , m_liveBytes( 0 )
+{
+    init();
+}
+
+
+void
+Cache::init()
+{
+    QDir().mkpath( m_cacheBaseDir );
+    m_fileName = m_cacheBaseDir + "cache.dat";
+
+    m_memory.setMaxCost( MEMORY_CACHE_SIZE );
+    loadIndex();
+
+    m_pruneTimer.setInterval( PRUNE_INTERVAL );
     m_pruneTimer.setSingleShot( false );
     connect( &m_pruneTimer, SIGNAL( timeout() ), SLOT( pruneTimerFired() ) );
     m_pruneTimer.start();
+
+    m_flushTimer.setInterval( FLUSH_DELAY );
+    m_flushTimer.setSingleShot( true );
+    connect( &m_flushTimer, SIGNAL( timeout() ), SLOT( flushTimerFired() ) );
 }
 
 
 Cache::~Cache()
 {
+    m_pruneTimer.stop();
+    m_flushTimer.stop();
+
+    m_pruneFuture.waitForFinished();
+    m_flushFuture.waitForFinished();
+
+    flush();
+}
+
+
+QString
+Cache::entryKey( const QString& identifier, const QString& key )
+{
+    return QString( identifier ).append( QChar( 0 ) ).append( key );
+}
+
+
+QByteArray
+Cache::serialize( const QString& identifier, const QString& key, const CacheData& data )
+{
+    QByteArray payload;
+    {
+        QDataStream stream( &payload, QIODevice::WriteOnly );
+        stream.setVersion( QDataStream::Qt_4_7 );
+        stream << identifier << key << data.maxAge << data.data;
+    }
+
+    // Each record is prefixed with its length, so we can skip over it
+    QByteArray record;
+    {
+        QDataStream stream( &record, QIODevice::WriteOnly );
+        stream << (quint32)payload.size();
+    }
+    record.append( payload );
+
+    return record;
+}
+
+
+void
+Cache::loadIndex()
+{
+    QFile file( m_fileName );
+    if ( !file.open( QIODevice::ReadWrite ) )
+    {
+        tLog() << Q_FUNC_INFO << "Could not open cache file:" << m_fileName << file.errorString();
+        return;
+    }
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_7 );
+
+    quint32 magic = 0, version = 0;
+    if ( file.size() >= HEADER_SIZE )
+        stream >> magic >> version;
+
+    if ( magic != CACHE_MAGIC || version != (quint32)s_cacheVersion )
+    {
+        file.resize( 0 );
+        file.seek( 0 );
+        stream << (quint32)CACHE_MAGIC << (quint32)s_cacheVersion;
+        m_fileSize = HEADER_SIZE;
+        return;
+    }
+
+    // Later records for a key supersede the earlier ones
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 offset = HEADER_SIZE;
+    while ( offset + 4 <= file.size() )
+    {
+        file.seek( offset );
+
+        quint32 length = 0;
+        stream >> length;
+        const qint64 size = 4 + (qint64)length;
+        if ( length == 0 || offset + size > file.size() )
+            break;
+
+        QString identifier, key;
+        qint64 expires = 0;
+        stream >> identifier >> key >> expires;
+        if ( stream.status() != QDataStream::Ok )
+            break;
+
+        const QString k = entryKey( identifier, key );
+        if ( m_index.contains( k ) )
+            m_liveBytes -= m_index.value( k ).size;
+
+        if ( expires >= now )
+        {
+            IndexEntry entry;
+            entry.offset = offset;
+            entry.size = size;
+            entry.expires = expires;
+
+            m_index.insert( k, entry );
+            m_liveBytes += size;
+        }
+        else
+            m_index.remove( k );
+
+        offset += size;
+    }
+
+    if ( offset < file.size() )
+    {
+        // We crashed while appending, drop the incomplete record
+        tLog() << Q_FUNC_INFO << "Truncating damaged cache file at" << offset;
+        file.resize( offset );
+    }
+
+    m_fileSize = offset;
+    tDebug() << Q_FUNC_INFO << "Loaded" << m_index.count() << "cache entries," << m_fileSize << "bytes";
+}
+
+
+bool
+Cache::readRecord( const IndexEntry& entry, CacheData& data ) const
+{
+    QFile file( m_fileName );
+    if ( !file.open( QIODevice::ReadOnly ) || !file.seek( entry.offset + 4 ) )
+        return false;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_7 );
+
+    QString identifier, key;
+    stream >> identifier >> key >> data.maxAge >> data.data;
+
+    return stream.status() == QDataStream::Ok;
 }
 
 
 void
 Cache::pruneTimerFired()
 {
-    QMutexLocker mutex_locker( &m_mutex );
+    if ( m_pruneFuture.isRunning() )
+        return;
+
+    m_pruneFuture = QtConcurrent::run( this, &Cache::prune );
+}
 
-    qDebug() << Q_FUNC_INFO << "Pruning tomahawkcache";
-    qlonglong currentMSecsSinceEpoch = QDateTime::currentMSecsSinceEpoch();
 
-    QVariantList clients = m_cacheManifest.value( "clients" ).toList();
-    foreach ( const QVariant& client, clients )
+/// This method is run by QtConcurrent:
+void
+Cache::prune()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    int removed = 0;
+    bool needsCompaction = false;
     {
-        const QString client_identifier = client.toString();
-        const QString cache_dir = m_cacheBaseDir + client_identifier;
+        QMutexLocker lock( &m_mutex );
 
-        QSettings cached_settings( cache_dir, QSettings::IniFormat );
-        const QStringList keys = cached_settings.allKeys();
-        foreach ( const QString& key, keys )
+        QMutableHashIterator< QString, IndexEntry > it( m_index );
+        while ( it.hasNext() )
         {
-            CacheData data = cached_settings.value( key ).value<TomahawkUtils::CacheData>();
-            if ( data.maxAge < currentMSecsSinceEpoch )
+            it.next();
+            if ( it.value().expires < now )
             {
-                cached_settings.remove( key );
-                tLog() << Q_FUNC_INFO << "Removed stale entry:" << client_identifier << key;
+                m_liveBytes -= it.value().size;
+                m_memory.remove( it.key() );
+                it.remove();
+                removed++;
             }
         }
-        cached_settings.sync();
-        if ( cached_settings.allKeys().size() == 0 )
-            removeClient( client_identifier );
+
+        needsCompaction = ( m_fileSize > COMPACT_MIN_SIZE && m_fileSize > 2 * m_liveBytes );
     }
+
+    tDebug() << Q_FUNC_INFO << "Pruned" << removed << "stale entries from tomahawkcache";
+
+    if ( needsCompaction )
+        compact();
+}
+
+
+void
+Cache::compact()
+{
+    QMutexLocker writeLock( &m_writeMutex );
+    QWriteLocker fileLock( &m_fileLock );
+
+    // Nobody else changes the index while we hold the write mutex
+    QHash< QString, IndexEntry > index;
+    {
+        QMutexLocker lock( &m_mutex );
+        index = m_index;
+    }
+
+    QFile source( m_fileName );
+    QFile target( m_fileName + ".tmp" );
+    if ( !source.open( QIODevice::ReadOnly ) || !target.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        tLog() << Q_FUNC_INFO << "Could not compact cache file:" << target.errorString();
+        return;
+    }
+
+    {
+        QDataStream stream( &target );
+        stream << (quint32)CACHE_MAGIC << (quint32)s_cacheVersion;
+    }
+
+    QHash< QString, IndexEntry > compacted;
+    qint64 offset = HEADER_SIZE;
+
+    QHash< QString, IndexEntry >::const_iterator it = index.constBegin();
+    for ( ; it != index.constEnd(); ++it )
+    {
+        IndexEntry entry = it.value();
+        source.seek( entry.offset );
+        const QByteArray record = source.read( entry.size );
+        if ( record.size() != entry.size || target.write( record ) != entry.size )
+            continue;
+
+        entry.offset = offset;
+        compacted.insert( it.key(), entry );
+        offset += entry.size;
+    }
+
+    source.close();
+    target.close();
+
+    QFile::remove( m_fileName );
+    const bool renamed = target.rename( m_fileName );
+
+    QMutexLocker lock( &m_mutex );
+    if ( !renamed )
+    {
+        tLog() << Q_FUNC_INFO << "Could not replace cache file:" << target.errorString();
+        compacted.clear();
+        offset = 0;
+    }
+
+    tDebug() << Q_FUNC_INFO << "Compacted tomahawkcache from" << m_fileSize << "to" << offset << "bytes";
+    m_index = compacted;
+    m_fileSize = offset;
+    m_liveBytes = qMax( (qint64)0, offset - HEADER_SIZE );
 }
 
 
 QVariant
 Cache::getData( const QString& identifier, const QString& key )
 {
-    QMutexLocker mutex_locker( &m_mutex );
-
-    const QString cacheDir = m_cacheBaseDir + identifier;
-    QSettings cached_settings( cacheDir, QSettings::IniFormat );
+    const QString k = entryKey( identifier, key );
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
 
-    if ( cached_settings.contains( key ) )
     {
-        CacheData data = cached_settings.value( key ).value<TomahawkUtils::CacheData>();
+        QMutexLocker lock( &m_mutex );
+
+        CacheData data;
+        bool found = true;
+        if ( m_pending.contains( k ) )
+            data = m_pending.value( k ).data;
+        else if ( m_writing.contains( k ) )
+            data = m_writing.value( k ).data;
+        else if ( CacheData* cached = m_memory.object( k ) )
+            data = *cached;
+        else
+            found = false;
+
+        if ( found )
+        {
+            if ( data.maxAge < now )
+            {
+                tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Stale entry:" << identifier << key;
+                return QVariant();
+            }
+
+            return data.data;
+        }
 
-        if ( data.maxAge < QDateTime::currentMSecsSinceEpoch() )
+        if ( !m_index.contains( k ) )
         {
-            cached_settings.remove( key );
-            tLog() << Q_FUNC_INFO << "Removed stale entry:" << identifier << key;
+            tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "No such key" << identifier << key;
             return QVariant();
         }
-        tDebug() << Q_FUNC_INFO << "Fetched data for" << identifier << key;
-        return data.data;
+    }
+
+    // Not used recently, read it from disk
+    QReadLocker fileLock( &m_fileLock );
 
+    IndexEntry entry;
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( !m_index.contains( k ) )
+            return QVariant();
+
+        entry = m_index.value( k );
     }
-    tDebug() << Q_FUNC_INFO << "No such key" << key;
-    return QVariant();
+
+    if ( entry.expires < now )
+        return QVariant();
+
+    CacheData data;
+    if ( !readRecord( entry, data ) )
+    {
+        tLog() << Q_FUNC_INFO << "Could not read cache entry:" << identifier << key;
+        return QVariant();
+    }
+
+    QMutexLocker lock( &m_mutex );
+
+    // Don't let an older value shadow a put that raced us
+    if ( !m_pending.contains( k ) && !m_writing.contains( k ) && m_index.value( k ).offset == entry.offset )
+        m_memory.insert( k, new CacheData( data ), entry.size );
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Fetched data for" << identifier << key;
+    return data.data;
 }
 
 
 void
 Cache::putData( const QString& identifier, qint64 maxAge, const QString& key, const QVariant& value )
 {
-    QMutexLocker mutex_locker( &m_mutex );
+    PendingEntry pending;
+    pending.data = CacheData( QDateTime::currentMSecsSinceEpoch() + maxAge, value );
+    pending.record = serialize( identifier, key, pending.data );
+
+    const QString k = entryKey( identifier, key );
+    bool schedule = false;
+    {
+        QMutexLocker lock( &m_mutex );
+
+        schedule = m_pending.isEmpty();
+        m_pending.insert( k, pending );
+        m_memory.insert( k, new CacheData( pending.data ), pending.record.size() );
+    }
 
-    const QString cacheDir = m_cacheBaseDir + identifier;
-    addClient( identifier );
-    QSettings cached_settings( cacheDir, QSettings::IniFormat );
-    cached_settings.setValue( key, QVariant::fromValue( CacheData( QDateTime::currentMSecsSinceEpoch() + maxAge, value ) ) );
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Storing from client" << identifier << maxAge << key;
+
+    // Callers may live in any thread, our timer doesn't
+    if ( schedule )
+        QMetaObject::invokeMethod( this, "scheduleFlush", Qt::QueuedConnection );
 }
 
 
 void
-Cache::addClient( const QString& identifier )
+Cache::scheduleFlush()
 {
-    QVariantList clients = m_cacheManifest.value( "clients" ).toList();
-    foreach ( const QVariant& client, clients )
-    {
-        const QString client_identifier = client.toString();
-        if ( identifier == client_identifier )
-            return;
-    }
+    if ( !m_flushTimer.isActive() )
+        m_flushTimer.start();
+}
+
 
-    tLog() << Q_FUNC_INFO << "adding client" << identifier;
-    clients.append( identifier );
-    m_cacheManifest.setValue( "clients", clients );
-    m_cacheManifest.sync();
+void
+Cache::flushTimerFired()
+{
+    m_flushFuture = QtConcurrent::run( this, &Cache::flush );
 }
 
 
 void
-Cache::removeClient( const QString& identifier )
+Cache::flush()
 {
-    QVariantList clients = m_cacheManifest.value( "clients" ).toList();
-    QVariantList::iterator it = clients.begin();
-    while ( it != clients.end() )
+    QMutexLocker writeLock( &m_writeMutex );
+    QReadLocker fileLock( &m_fileLock );
+
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( m_pending.isEmpty() )
+            return;
+
+        // Readers keep finding them in m_writing until they are indexed
+        m_writing = m_pending;
+        m_pending.clear();
+    }
+
+    QFile file( m_fileName );
+    if ( !file.open( QIODevice::ReadWrite ) )
+    {
+        tLog() << Q_FUNC_INFO << "Could not open cache file:" << m_fileName << file.errorString();
+
+        QMutexLocker lock( &m_mutex );
+        m_writing.clear();
+        return;
+    }
+
+    qint64 offset = file.size();
+    if ( offset < HEADER_SIZE )
+    {
+        // The file went away underneath us
+        file.resize( 0 );
+        QDataStream stream( &file );
+        stream << (quint32)CACHE_MAGIC << (quint32)s_cacheVersion;
+        offset = HEADER_SIZE;
+    }
+    file.seek( offset );
+
+    QHash< QString, IndexEntry > written;
+    QHash< QString, PendingEntry >::const_iterator it = m_writing.constBegin();
+    for ( ; it != m_writing.constEnd(); ++it )
     {
-        const QString client_identifier = it->toString();
-        if ( identifier == client_identifier )
+        const QByteArray& record = it.value().record;
+        if ( file.write( record ) != record.size() )
         {
-            tLog() << Q_FUNC_INFO << "removing client" << identifier;
-            clients.erase( it );
+            tLog() << Q_FUNC_INFO << "Could not write cache entry:" << file.errorString();
+            file.resize( offset );
             break;
         }
-        ++it;
+
+        IndexEntry entry;
+        entry.offset = offset;
+        entry.size = record.size();
+        entry.expires = it.value().data.maxAge;
+
+        written.insert( it.key(), entry );
+        offset += entry.size;
     }
+    file.close();
+
+    QMutexLocker lock( &m_mutex );
+    for ( QHash< QString, IndexEntry >::const_iterator wit = written.constBegin(); wit != written.constEnd(); ++wit )
+    {
+        if ( m_index.contains( wit.key() ) )
+            m_liveBytes -= m_index.value( wit.key() ).size;
+
+        m_index.insert( wit.key(), wit.value() );
+        m_liveBytes += wit.value().size;
+    }
+
+    m_fileSize = offset;
+    m_writing.clear();
 
-    m_cacheManifest.setValue( "clients", clients );
-    m_cacheManifest.sync();
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Wrote" << written.count() << "cache entries";
 }
@@ -22,11 +22,14 @@
 #include "DllMacro.h"
 #include "utils/TomahawkUtils.h"
 
+#include <QCache>
+#include <QFuture>
+#include <QHash>
 #include <QMutex>
-#include <QSettings>
 #include <QObject>
+#include <QReadWriteLock>
 #include <QTimer>
-#include <QDir>
+#include <QVariant>
 
 namespace TomahawkUtils
 {
@@ -42,7 +45,7 @@ struct CacheData
     , data( dat )
     {}
 
-    qint64 maxAge; //!< milliseconds
+    qint64 maxAge; //!< expiry time, in milliseconds since the epoch
     QVariant data;
 };
 
@@ -54,6 +57,15 @@ struct CacheData
  *
  * Structure is a basic key-value store with associated max lifetime in
  * milliseconds.
+ *
+ * All entries live in a single file that only ever gets appended to: a put
+ * adds a new record, which supersedes older ones for the same key. We keep an
+ * index of record offsets and a byte-bounded LRU of recently used values in
+ * memory, so most gets never touch the disk. Puts are written in batches on a
+ * worker thread, expired and superseded records get compacted away when they
+ * make up most of the file.
+ *
+ * Thread-safe.
  */
 class DLLEXPORT Cache : public QObject
 {
@@ -61,6 +73,9 @@ Q_OBJECT
 
 public:
     static Cache* instance();
+
+    /// Use instance(), separate caches only make sense in tests.
+    explicit Cache( const QString& cacheDir );
     virtual ~Cache();
 
     /**
@@ -80,13 +95,34 @@ public:
      */
     QVariant getData( const QString& identifier, const QString& key );
 
+    /// Writes all pending puts to disk now, instead of with the next batch.
+    void flush();
+
+    /// Drops expired entries and compacts the file once they make up most of it. Runs periodically.
+    void prune();
+
 private slots:
     void pruneTimerFired();
+    void flushTimerFired();
+    void scheduleFlush();
 
 private:
     Cache();
     static Cache* s_instance;
 
+    struct IndexEntry
+    {
+        qint64 offset;
+        qint64 size;
+        qint64 expires;
+    };
+
+    struct PendingEntry
+    {
+        CacheData data;
+        QByteArray record;
+    };
+
     /**
      * Version number of the cache.
      * If you change existing cached data,
@@ -94,22 +130,36 @@ private:
      */
     static const int s_cacheVersion;
 
-    /**
-     * Adds a client to the manifest.
-     * Does not lock the mutex.
-     */
-    void addClient( const QString& identifier );
+    static QString entryKey( const QString& identifier, const QString& key );
+    static QByteArray serialize( const QString& identifier, const QString& key, const CacheData& data );
 
-    /**
-     * Removes a client to the manifest.
-     * Does not lock the mutex.
-     */
-    void removeClient( const QString& identifier );
+    void init();
+    void loadIndex();
+    bool readRecord( const IndexEntry& entry, CacheData& data ) const;
+    void compact();
 
     QString m_cacheBaseDir;
-    QSettings m_cacheManifest;
+    QString m_fileName;
     QTimer m_pruneTimer;
-    QMutex m_mutex;
+    QTimer m_flushTimer;
+    QFuture< void > m_flushFuture;
+    QFuture< void > m_pruneFuture;
+
+    // Lock order: m_writeMutex, m_fileLock, m_mutex
+
+    /// Serializes appending and compaction
+    QMutex m_writeMutex;
+    /// Held for writing while compaction replaces the file, for reading by everyone else
+    mutable QReadWriteLock m_fileLock;
+
+    /// Guards the in-memory state below
+    mutable QMutex m_mutex;
+    QCache< QString, CacheData > m_memory;
+    QHash< QString, IndexEntry > m_index;
+    QHash< QString, PendingEntry > m_pending;
+    QHash< QString, PendingEntry > m_writing;
+    qint64 m_fileSize;
+    qint64 m_liveBytes;
 };
 
 }
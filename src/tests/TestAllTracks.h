@@ -0,0 +1,159 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTALLTRACKS_H
+#define TOMAHAWK_TESTALLTRACKS_H
+
+#include <QtTest>
+
+#include "database/Database.h"
+#include "database/DatabaseCommand_AddFiles.h"
+#include "database/DatabaseCommand_AllTracks.h"
+#include "database/DatabaseImpl.h"
+#include "database/TomahawkSqlQuery.h"
+#include "Query.h"
+#include "Result.h"
+#include "Source.h"
+#include "SourceList.h"
+
+
+class PageCollector : public QObject
+{
+    Q_OBJECT
+
+public:
+    QStringList urls;
+    QVariantList nextPageStart;
+
+public slots:
+    void onPage( const QList< Tomahawk::query_ptr >& tracks, const QVariantList& next, const QVariant& data )
+    {
+        Q_UNUSED( data );
+        foreach ( const Tomahawk::query_ptr& query, tracks )
+            urls << query->results().first()->url();
+        nextPageStart = next;
+    }
+};
+
+
+class TestAllTracks : public QObject
+{
+    Q_OBJECT
+private:
+    Tomahawk::Database* m_db;
+    QString m_dbPath;
+
+    static Tomahawk::ScannedFile file( int i )
+    {
+        Tomahawk::ScannedFile file;
+        file.url = QString( "/music/%1.mp3" ).arg( i );
+        file.mtime = 1400000000 + i;
+        file.size = 4000000 + i;
+        file.mimetype = "audio/mpeg";
+        file.duration = 180;
+        file.bitrate = 320;
+        file.artist = "Artist";
+        // A handful of tracks share every album, so pages end inside albums
+        file.album = QString( "Album %1" ).arg( i / 4 );
+        file.track = QString( "Track %1" ).arg( i );
+        file.albumpos = i % 4 + 1;
+        file.discnumber = 1;
+        file.year = 2014;
+        return file;
+    }
+
+    QStringList loadAllPages( Tomahawk::DatabaseCommand_AllTracks::SortOrder order, unsigned int pageSize )
+    {
+        PageCollector collector;
+        QVariantList start;
+        int pages = 0;
+        do
+        {
+            Tomahawk::DatabaseCommand_AllTracks cmd;
+            cmd.setSortOrder( order );
+            cmd.setLimit( pageSize );
+            cmd.setPageStart( start );
+            connect( &cmd, SIGNAL( page( QList< Tomahawk::query_ptr >, QVariantList, QVariant ) ),
+                     &collector, SLOT( onPage( QList< Tomahawk::query_ptr >, QVariantList, QVariant ) ) );
+            cmd.exec( m_db->impl() );
+
+            start = collector.nextPageStart;
+        }
+        while ( !start.isEmpty() && ++pages < 100 );
+
+        return collector.urls;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QTemporaryFile tmp( QDir::tempPath() + "/tomahawk-test-XXXXXX.db" );
+        QVERIFY( tmp.open() );
+        m_dbPath = tmp.fileName();
+        tmp.close();
+        tmp.remove();
+
+        m_db = new Tomahawk::Database( m_dbPath );
+        QVERIFY( m_db->isReady() );
+
+        if ( SourceList::instance()->getLocal().isNull() )
+            SourceList::instance()->setLocal( Tomahawk::source_ptr( new Tomahawk::Source( 0, m_db->impl()->dbid() ) ) );
+
+        Tomahawk::ScannedFileBatch batch;
+        for ( int i = 0; i < 20; i++ )
+            batch.append( file( i ) );
+
+        Tomahawk::DatabaseImpl* dbi = m_db->impl();
+        dbi->database().transaction();
+        Tomahawk::DatabaseCommand_AddFiles cmd( batch, SourceList::instance()->getLocal() );
+        cmd._exec( dbi );
+        dbi->finishQueries();
+        QVERIFY( dbi->database().commit() );
+
+        // What databases migrated from before discnumber existed look like
+        TomahawkSqlQuery query = dbi->newquery();
+        QVERIFY( query.exec( "UPDATE file_join SET discnumber = NULL" ) );
+    }
+
+    void cleanupTestCase()
+    {
+        delete m_db;
+        QFile::remove( m_dbPath );
+        QFile::remove( m_dbPath + "-wal" );
+        QFile::remove( m_dbPath + "-shm" );
+    }
+
+    void testPagingWithNullDiscnumbers_data()
+    {
+        QTest::addColumn< int >( "order" );
+
+        QTest::newRow( "album" ) << (int)Tomahawk::DatabaseCommand_AllTracks::Album;
+        QTest::newRow( "albumpos" ) << (int)Tomahawk::DatabaseCommand_AllTracks::AlbumPosition;
+        QTest::newRow( "artist" ) << (int)Tomahawk::DatabaseCommand_AllTracks::Artist;
+        QTest::newRow( "composer" ) << (int)Tomahawk::DatabaseCommand_AllTracks::Composer;
+    }
+
+    void testPagingWithNullDiscnumbers()
+    {
+        QFETCH( int, order );
+
+        const QStringList urls = loadAllPages( (Tomahawk::DatabaseCommand_AllTracks::SortOrder)order, 3 );
+        QCOMPARE( urls.count(), 20 );
+        QCOMPARE( urls.toSet().count(), 20 );
+    }
+};
+
+#endif // TOMAHAWK_TESTALLTRACKS_H
@@ -0,0 +1,95 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TOMAHAWK_TESTBUFFERIODEVICE_H
+#define TOMAHAWK_TESTBUFFERIODEVICE_H
+
+#include <QtTest>
+
+#include "network/BufferIoDevice.h"
+
+
+class TestBufferIODevice : public QObject
+{
+    Q_OBJECT
+private:
+    static QByteArray block( int i, int size )
+    {
+        return QByteArray( size, 'a' + ( i % 26 ) );
+    }
+
+private slots:
+    void testOutOfOrder()
+    {
+        const int bs = BufferIODevice::blockSize();
+        // Three full blocks and a short one
+        BufferIODevice dev( 3 * bs + 100 );
+        dev.open( QIODevice::ReadOnly );
+        QCOMPARE( dev.maxBlocks(), 4 );
+        QCOMPARE( dev.nextEmptyBlock(), 0 );
+
+        dev.addData( 1, block( 1, bs ) );
+        dev.addData( 3, block( 3, 100 ) );
+        QCOMPARE( dev.nextEmptyBlock(), 0 );
+        QVERIFY( dev.isBlockEmpty( 0 ) );
+        QVERIFY( !dev.isBlockEmpty( 1 ) );
+
+        // Nothing to read before block 0 arrived
+        char buf[ 8192 ];
+        QCOMPARE( dev.read( buf, sizeof( buf ) ), (qint64)0 );
+
+        dev.addData( 0, block( 0, bs ) );
+        QCOMPARE( dev.nextEmptyBlock(), 2 );
+
+        // Reads stop at the gap
+        QCOMPARE( dev.read( buf, sizeof( buf ) ), (qint64)( 2 * bs ) );
+        QCOMPARE( buf[ 0 ], 'a' );
+        QCOMPARE( buf[ bs ], 'b' );
+        QCOMPARE( dev.read( buf, sizeof( buf ) ), (qint64)0 );
+
+        dev.addData( 2, block( 2, bs ) );
+        QCOMPARE( dev.nextEmptyBlock(), -1 );
+        QCOMPARE( dev.read( buf, sizeof( buf ) ), (qint64)( bs + 100 ) );
+        QCOMPARE( buf[ bs ], 'd' );
+        QVERIFY( dev.atEnd() );
+    }
+
+    void testSeek()
+    {
+        const int bs = BufferIODevice::blockSize();
+        BufferIODevice dev( 10 * bs );
+        dev.open( QIODevice::ReadOnly );
+        QSignalSpy spy( &dev, SIGNAL( blockRequest( int ) ) );
+
+        QVERIFY( dev.seek( 5 * bs + 10 ) );
+        QCOMPARE( spy.count(), 1 );
+        QCOMPARE( spy.first().first().toInt(), 5 );
+
+        dev.addData( 5, block( 5, bs ) );
+        char buf[ 16 ];
+        QCOMPARE( dev.read( buf, sizeof( buf ) ), (qint64)sizeof( buf ) );
+        QCOMPARE( buf[ 0 ], 'f' );
+
+        // Duplicates and blocks out of range are ignored
+        dev.addData( 5, block( 6, bs ) );
+        dev.addData( 42, block( 0, bs ) );
+        QCOMPARE( dev.nextEmptyBlock(), 0 );
+        QVERIFY( dev.isBlockEmpty( 42 ) );
+    }
+};
+
+#endif // TOMAHAWK_TESTBUFFERIODEVICE_H
@@ -0,0 +1,122 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTCOLLECTIONSNAPSHOT_H
+#define TOMAHAWK_TESTCOLLECTIONSNAPSHOT_H
+
+#include <QtTest>
+
+#include "database/CollectionSnapshot.h"
+#include "Album.h"
+#include "Artist.h"
+
+
+class TestCollectionSnapshot : public QObject
+{
+    Q_OBJECT
+private:
+    static Tomahawk::CollectionSnapshot::File file( unsigned int id, unsigned int artistId, const QString& artist,
+                                                   unsigned int albumId, const QString& album, unsigned int albumpos )
+    {
+        Tomahawk::CollectionSnapshot::File f;
+        f.id = id;
+        f.url = QString( "/music/%1.mp3" ).arg( id );
+        f.track = QString( "Track %1" ).arg( id );
+        f.trackId = id;
+        f.albumpos = albumpos;
+        f.artistId = artistId;
+        f.artist = artist;
+        f.artistSortname = artist.toLower();
+        f.albumId = albumId;
+        if ( albumId )
+        {
+            f.album = album;
+            f.albumSortname = album.toLower();
+            f.albumArtistId = artistId;
+            f.albumArtist = artist;
+            f.albumArtistSortname = artist.toLower();
+        }
+
+        return f;
+    }
+
+    static QStringList names( const QList< Tomahawk::artist_ptr >& artists )
+    {
+        QStringList l;
+        foreach ( const Tomahawk::artist_ptr& artist, artists )
+            l << artist->name();
+        return l;
+    }
+
+    static QStringList names( const QList< Tomahawk::album_ptr >& albums )
+    {
+        QStringList l;
+        foreach ( const Tomahawk::album_ptr& album, albums )
+            l << album->name();
+        return l;
+    }
+
+private slots:
+    void testBrowse()
+    {
+        Tomahawk::CollectionSnapshot snapshot;
+        snapshot.addFile( file( 1, 10, "Zebra", 100, "Stripes", 2 ) );
+        snapshot.addFile( file( 2, 11, "Aardvark", 101, "Burrow", 1 ) );
+        snapshot.addFile( file( 3, 10, "Zebra", 100, "Stripes", 1 ) );
+        snapshot.addFile( file( 4, 10, "Zebra", 0, QString(), 0 ) );
+        snapshot.addFile( file( 5, 10, "Zebra", 102, "Savanna", 1 ) );
+        snapshot.finalize();
+
+        QCOMPARE( snapshot.fileCount(), 5 );
+        QCOMPARE( names( snapshot.artists() ), QStringList() << "Aardvark" << "Zebra" );
+        QCOMPARE( names( snapshot.artists( "burr" ) ), QStringList() << "Aardvark" );
+        QCOMPARE( names( snapshot.artists( "zebra track 5" ) ), QStringList() << "Zebra" );
+        QVERIFY( snapshot.artists( "zebra burrow" ).isEmpty() );
+
+        Tomahawk::artist_ptr zebra = Tomahawk::Artist::get( 10, "Zebra" );
+        // Sorted by name, files without an album go last
+        QCOMPARE( names( snapshot.albums( zebra ) ), QStringList() << "Savanna" << "Stripes" << "Unknown" );
+        QCOMPARE( names( snapshot.albums( zebra, "stri" ) ), QStringList() << "Stripes" );
+        QCOMPARE( names( snapshot.albums( Tomahawk::artist_ptr() ) ), QStringList() << "Burrow" << "Savanna" << "Stripes" );
+    }
+
+    void testDeltas()
+    {
+        Tomahawk::CollectionSnapshot snapshot;
+        snapshot.addFile( file( 1, 10, "Zebra", 100, "Stripes", 1 ) );
+        snapshot.addFile( file( 2, 11, "Aardvark", 101, "Burrow", 1 ) );
+        snapshot.finalize();
+
+        Tomahawk::CollectionSnapshot delta;
+        delta.addFile( file( 2, 11, "Aardvark", 101, "Burrow", 1 ) );
+        delta.addFile( file( 3, 12, "Moose", 103, "Antlers", 1 ) );
+        delta.finalize();
+
+        snapshot.merge( delta );
+        snapshot.finalize();
+        QCOMPARE( snapshot.fileCount(), 3 );
+        QCOMPARE( names( snapshot.artists() ), QStringList() << "Aardvark" << "Moose" << "Zebra" );
+
+        snapshot.removeFiles( QList< unsigned int >() << 2 << 42 );
+        snapshot.finalize();
+        QCOMPARE( snapshot.fileCount(), 2 );
+        QVERIFY( !snapshot.contains( 2 ) );
+        QCOMPARE( names( snapshot.artists() ), QStringList() << "Moose" << "Zebra" );
+        QCOMPARE( names( snapshot.albums( Tomahawk::artist_ptr() ) ), QStringList() << "Antlers" << "Stripes" );
+    }
+};
+
+#endif // TOMAHAWK_TESTCOLLECTIONSNAPSHOT_H
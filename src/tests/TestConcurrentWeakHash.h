@@ -0,0 +1,167 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTCONCURRENTWEAKHASH_H
+#define TOMAHAWK_TESTCONCURRENTWEAKHASH_H
+
+#include <QtTest>
+
+#include "utils/ConcurrentWeakHash.h"
+
+using namespace Tomahawk::Utils;
+
+
+struct HashPayload
+{
+    explicit HashPayload( int _creator ) : creator( _creator ) {}
+    int creator;
+};
+
+
+/// Gets or creates the object for one key over and over, like Track::get() does.
+class HashHammerThread : public QThread
+{
+public:
+    HashHammerThread( ConcurrentWeakHash< QString, HashPayload >* hash, QAtomicInt* start, int id )
+        : m_hash( hash )
+        , m_start( start )
+        , m_id( id )
+        , m_mismatches( 0 )
+    {
+    }
+
+    QSharedPointer< HashPayload > result() const { return m_result; }
+    int mismatches() const { return m_mismatches; }
+
+protected:
+    void run()
+    {
+        // Start all at once, so they race for the first insert
+        while ( !m_start->fetchAndAddOrdered( 0 ) )
+            yieldCurrentThread();
+
+        for ( int i = 0; i < 10000; i++ )
+        {
+            QSharedPointer< HashPayload > object = m_hash->value( "key" );
+            if ( !object )
+                object = m_hash->insert( "key", QSharedPointer< HashPayload >( new HashPayload( m_id ) ) );
+
+            if ( !m_result )
+                m_result = object;
+            else if ( object != m_result )
+                m_mismatches++;
+        }
+    }
+
+private:
+    ConcurrentWeakHash< QString, HashPayload >* m_hash;
+    QAtomicInt* m_start;
+    int m_id;
+    QSharedPointer< HashPayload > m_result;
+    int m_mismatches;
+};
+
+
+class TestConcurrentWeakHash : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testInsert()
+    {
+        ConcurrentWeakHash< QString, QObject > hash;
+        QSharedPointer< QObject > first( new QObject );
+        QSharedPointer< QObject > second( new QObject );
+
+        QVERIFY( hash.insert( "a", first ) == first );
+        QVERIFY( hash.value( "a" ) == first );
+
+        // The live object wins over a newer one
+        QVERIFY( hash.insert( "a", second ) == first );
+        QVERIFY( hash.value( "a" ) == first );
+
+        // An expired one doesn't
+        first.clear();
+        QVERIFY( !hash.contains( "a" ) );
+        QVERIFY( hash.value( "a" ).isNull() );
+        QVERIFY( hash.insert( "a", second ) == second );
+        QVERIFY( hash.contains( "a" ) );
+    }
+
+    void testRemoveExpired()
+    {
+        ConcurrentWeakHash< unsigned int, QObject > hash;
+        QSharedPointer< QObject > object( new QObject );
+        hash.insert( 1, object );
+
+        hash.removeExpired( 1 );
+        QCOMPARE( hash.count(), 1 );
+
+        object.clear();
+        hash.removeExpired( 1 );
+        QCOMPARE( hash.count(), 0 );
+    }
+
+    void testSweep()
+    {
+        ConcurrentWeakHash< unsigned int, QObject > hash;
+        QList< QSharedPointer< QObject > > alive;
+        for ( unsigned int i = 0; i < 2000; i++ )
+        {
+            QSharedPointer< QObject > object( new QObject );
+            hash.insert( i, object );
+            if ( i % 2 )
+                alive << object;
+        }
+
+        // Dead entries only get swept as shards grow
+        QVERIFY( hash.count() < 2000 );
+
+        hash.sweep();
+        QCOMPARE( hash.count(), alive.count() );
+    }
+
+    void testConcurrentInsert()
+    {
+        ConcurrentWeakHash< QString, HashPayload > hash;
+        QAtomicInt start;
+
+        QList< HashHammerThread* > threads;
+        for ( int i = 0; i < 8; i++ )
+        {
+            threads << new HashHammerThread( &hash, &start, i );
+            threads.last()->start();
+        }
+        start.fetchAndStoreOrdered( 1 );
+
+        foreach ( HashHammerThread* thread, threads )
+            QVERIFY( thread->wait( 30000 ) );
+
+        // Whoever won the race, everyone got its object, every time
+        const QSharedPointer< HashPayload > winner = hash.value( "key" );
+        QVERIFY( winner );
+        foreach ( HashHammerThread* thread, threads )
+        {
+            QCOMPARE( thread->mismatches(), 0 );
+            QVERIFY( thread->result() == winner );
+        }
+        QCOMPARE( hash.count(), 1 );
+
+        qDeleteAll( threads );
+    }
+};
+
+#endif // TOMAHAWK_TESTCONCURRENTWEAKHASH_H
@@ -22,7 +22,13 @@
 #include <QtTest>
 
 #include "database/Database.h"
+#include "database/DatabaseCommand_AddFiles.h"
 #include "database/DatabaseCommand_LogPlayback.h"
+#include "database/DatabaseImpl.h"
+#include "database/DatabaseWorker.h"
+#include "database/ScannedFile.h"
+#include "utils/Json.h"
+#include "utils/JsonWriter.h"
 
 
 class TestDatabaseCommand : public Tomahawk::DatabaseCommand
@@ -31,12 +37,53 @@ Q_OBJECT
     virtual QString commandname() const { return "TestCommand"; }
 };
 
+class TestReadCommand : public Tomahawk::DatabaseCommand
+{
+Q_OBJECT
+public:
+    explicit TestReadCommand( Priority priority ) : m_priority( priority ) {}
+
+    virtual QString commandname() const { return "TestReadCommand"; }
+    virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return m_priority; }
+
+private:
+    Priority m_priority;
+};
+
 class TestDatabase : public QObject
 {
     Q_OBJECT
 private:
     Tomahawk::Database* db;
 
+    static QVariantList createFiles( int count )
+    {
+        QVariantList files;
+        for ( int i = 0; i < count; i++ )
+        {
+            QVariantMap m;
+            m[ "id" ] = i + 1;
+            m[ "url" ] = QString( "/music/Some Artist/Album %1/%2 - Some \"Track\".mp3" ).arg( i / 12 ).arg( i );
+            m[ "mtime" ] = 1400000000 + i;
+            m[ "size" ] = 4000000 + i * 1337;
+            m[ "hash" ] = QString();
+            m[ "mimetype" ] = "audio/mpeg";
+            m[ "duration" ] = 180 + i % 120;
+            m[ "bitrate" ] = 320;
+            m[ "artist" ] = QString( "Some Artist %1" ).arg( i / 100 );
+            m[ "album" ] = QString( "Album %1" ).arg( i / 12 );
+            m[ "track" ] = QString::fromUtf8( "Some Träck %1" ).arg( i );
+            m[ "albumpos" ] = i % 12 + 1;
+            m[ "composer" ] = QString();
+            m[ "discnumber" ] = 1;
+            m[ "year" ] = 2014;
+            files << m;
+        }
+
+        return files;
+    }
+
 private slots:
     void initTestCase()
     {
@@ -73,6 +120,151 @@ private slots:
         TestDatabaseCommand* tCmd = qobject_cast< TestDatabaseCommand* >( command.data() );
         QVERIFY( tCmd );
     }
+
+    void testWorkQueuePriorities()
+    {
+        using namespace Tomahawk;
+
+        DatabaseWorkQueue queue;
+        QVERIFY( queue.take( 0 ).isNull() );
+
+        dbcmd_ptr background1( new TestReadCommand( DatabaseCommand::BackgroundPriority ) );
+        dbcmd_ptr normal( new TestReadCommand( DatabaseCommand::NormalPriority ) );
+        dbcmd_ptr background2( new TestReadCommand( DatabaseCommand::BackgroundPriority ) );
+        dbcmd_ptr interactive( new TestReadCommand( DatabaseCommand::InteractivePriority ) );
+
+        queue.enqueue( background1 );
+        queue.enqueue( normal );
+        queue.enqueue( background2 );
+        queue.enqueue( interactive );
+        QCOMPARE( queue.count(), 4 );
+
+        // Interactive commands overtake everything, same priorities keep their order
+        QVERIFY( queue.take( 0 ) == interactive );
+        QVERIFY( queue.take( 0 ) == normal );
+        QVERIFY( queue.take( 0 ) == background1 );
+        QVERIFY( queue.take( 0 ) == background2 );
+        QVERIFY( queue.take( 0 ).isNull() );
+        QCOMPARE( queue.count(), 0 );
+    }
+
+    void testSerialization()
+    {
+        // The typed serializers have to produce the same ops as the Q_PROPERTY based one
+        Tomahawk::DatabaseCommand_AddFiles addFiles( createFiles( 10 ), Tomahawk::source_ptr() );
+        const QVariantMap legacyOp = TomahawkUtils::qobject2qvariant( &addFiles );
+        const QVariantMap op = TomahawkUtils::parseJson( addFiles.serialize() ).toMap();
+        QCOMPARE( op.value( "command" ).toString(), QString( "addfiles" ) );
+        QCOMPARE( op.value( "guid" ).toString(), addFiles.guid() );
+        QCOMPARE( TomahawkUtils::toJson( op.value( "files" ) ), TomahawkUtils::toJson( legacyOp.value( "files" ) ) );
+
+        Tomahawk::dbcmd_ptr command = db->createCommandInstance( op, Tomahawk::source_ptr() );
+        Tomahawk::DatabaseCommand_AddFiles* restored = qobject_cast< Tomahawk::DatabaseCommand_AddFiles* >( command.data() );
+        QVERIFY( restored );
+        QCOMPARE( restored->guid(), addFiles.guid() );
+        QCOMPARE( restored->files().count(), 10 );
+        QCOMPARE( restored->files().at( 3 ).toMap().value( "track" ).toString(), QString::fromUtf8( "Some Träck 3" ) );
+
+        Tomahawk::DatabaseCommand_LogPlayback logPlayback;
+        logPlayback.setArtist( "Artist" );
+        logPlayback.setTrack( "Track" );
+        logPlayback.setPlaytime( 1400000000 );
+        logPlayback.setSecsPlayed( 42 );
+        logPlayback.setTrackDuration( 180 );
+        logPlayback.setAction( Tomahawk::DatabaseCommand_LogPlayback::Finished );
+
+        // An older peer reads this through its properties
+        Tomahawk::DatabaseCommand_LogPlayback legacy;
+        TomahawkUtils::qvariant2qobject( TomahawkUtils::parseJson( logPlayback.serialize() ).toMap(), &legacy );
+        QCOMPARE( legacy.artist(), logPlayback.artist() );
+        QCOMPARE( legacy.track(), logPlayback.track() );
+        QCOMPARE( legacy.playtime(), logPlayback.playtime() );
+        QCOMPARE( legacy.secsPlayed(), logPlayback.secsPlayed() );
+        QCOMPARE( legacy.trackDuration(), logPlayback.trackDuration() );
+        QCOMPARE( legacy.action(), logPlayback.action() );
+
+        // Ops from a newer format version are ignored
+        QVariantMap future = op;
+        future[ "v" ] = Tomahawk::DatabaseCommandLoggable::FormatVersion + 1;
+        QVERIFY( db->createCommandInstance( future, Tomahawk::source_ptr() ).isNull() );
+    }
+
+    void testScannedFileBatch()
+    {
+        Tomahawk::ScannedFile file;
+        file.url = "file:///music/a.mp3";
+        file.mtime = 1400000000;
+        file.size = 4000000;
+        file.mimetype = "audio/mpeg";
+        file.duration = 180;
+        file.bitrate = 320;
+        file.artist = "Artist";
+        file.album = "Album";
+        file.track = "Track";
+        file.albumpos = 3;
+        file.discnumber = 1;
+        file.year = 2014;
+
+        Tomahawk::ScannedFileBatch batch;
+        batch.append( file );
+        batch.append( Tomahawk::ScannedFile() );
+        batch.ids[ 0 ] = 42;
+        QCOMPARE( batch.count(), 2 );
+
+        const Tomahawk::ScannedFileBatch restored = Tomahawk::ScannedFileBatch::fromVariantList( batch.toVariantList() );
+        QCOMPARE( restored.count(), 2 );
+        QCOMPARE( restored.ids.at( 0 ), 42u );
+        QCOMPARE( restored.at( 0 ).url, file.url );
+        QCOMPARE( restored.at( 0 ).track, file.track );
+        QCOMPARE( restored.at( 0 ).year, file.year );
+        QVERIFY( restored.at( 1 ).isNull() );
+
+        // What we send to peers never contains the file path
+        TomahawkUtils::JsonWriter writer;
+        batch.write( writer, 0 );
+        QCOMPARE( TomahawkUtils::toJson( TomahawkUtils::parseJson( writer.data() ) ), TomahawkUtils::toJson( batch.toVariantList( true ) ) );
+        QVERIFY( !writer.data().contains( "/music/" ) );
+    }
+
+    void testJsonWriterNonFinite()
+    {
+        TomahawkUtils::JsonWriter writer;
+        writer.beginObject();
+        writer.write( "nan", qQNaN() );
+        writer.write( "inf", qInf() );
+        writer.write( "list", QVariant( QVariantList() << -qInf() << 0.5 ) );
+        writer.endObject();
+
+        QCOMPARE( writer.data(), QByteArray( "{\"nan\":null,\"inf\":null,\"list\":[null,0.5]}" ) );
+        QVERIFY( TomahawkUtils::parseJson( writer.data() ).isValid() );
+    }
+
+    void testPreparedQueries()
+    {
+        Tomahawk::DatabaseImpl* dbi = db->impl();
+        QVERIFY( db->impl() == dbi );
+
+        TomahawkSqlQuery insert = dbi->newquery();
+        insert.exec( "INSERT INTO settings(k, v) VALUES ('prepared_a', 'a')" );
+        insert.exec( "INSERT INTO settings(k, v) VALUES ('prepared_b', 'b')" );
+
+        // Same statement, rebound every time and never read to the end
+        for ( int i = 0; i < 4; i++ )
+        {
+            TomahawkSqlQuery query = dbi->preparedQuery( "SELECT v FROM settings WHERE k = ?" );
+            query.addBindValue( i % 2 ? "prepared_b" : "prepared_a" );
+            QVERIFY( query.exec() );
+            QVERIFY( query.next() );
+            QCOMPARE( query.value( 0 ).toString(), QString( i % 2 ? "b" : "a" ) );
+        }
+        dbi->finishQueries();
+
+        insert.exec( "DELETE FROM settings WHERE k LIKE 'prepared_%'" );
+        TomahawkSqlQuery query = dbi->preparedQuery( "SELECT v FROM settings WHERE k = ?" );
+        query.addBindValue( "prepared_a" );
+        QVERIFY( query.exec() );
+        QVERIFY( !query.next() );
+    }
 };
 
 #endif // TOMAHAWK_TESTDATABASE_H
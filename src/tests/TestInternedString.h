@@ -0,0 +1,128 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTINTERNEDSTRING_H
+#define TOMAHAWK_TESTINTERNEDSTRING_H
+
+#include <QtTest>
+
+#include "utils/InternedString.h"
+
+using namespace Tomahawk;
+
+
+class TestInternedString : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testSharing()
+    {
+        // Built separately, so they don't share their data to begin with
+        const QString a = QString( "Neon " ) + "Ghost";
+        const QString b = QString( "Neon" ) + " Ghost";
+        QVERIFY( a.constData() != b.constData() );
+
+        const InternedString ia( a );
+        const InternedString ib( b );
+        QVERIFY( ia == ib );
+        QCOMPARE( ia.toString(), a );
+        QVERIFY( ia.toString().constData() == ib.toString().constData() );
+        QCOMPARE( ia.hash(), qHash( a ) );
+
+        const InternedString other( QString( "neon ghost" ) );
+        QVERIFY( ia != other );
+    }
+
+    void testEmpty()
+    {
+        const InternedString null;
+        const InternedString empty( QString( "" ) );
+
+        QVERIFY( null.isEmpty() );
+        QVERIFY( null == empty );
+        QVERIFY( empty.toString().isEmpty() );
+    }
+
+    void testSweep()
+    {
+        InternedString::sweep();
+        const InternedString::Stats before = InternedString::stats();
+
+        {
+            QList< InternedString > names;
+            for ( int i = 0; i < 1000; i++ )
+            {
+                names << InternedString( QString( "artist %1" ).arg( i ) );
+                names << InternedString( QString( "artist %1" ).arg( i ) );
+            }
+
+            const InternedString::Stats stats = InternedString::stats();
+            QCOMPARE( stats.strings, before.strings + 1000 );
+            QCOMPARE( stats.references, before.references + 2000 );
+            QVERIFY( stats.savedBytes > before.savedBytes );
+        }
+
+        InternedString::sweep();
+        const InternedString::Stats after = InternedString::stats();
+        QCOMPARE( after.strings, before.strings );
+        QCOMPARE( after.bytes, before.bytes );
+    }
+
+    void testFind()
+    {
+        InternedString::sweep();
+        const InternedString::Stats before = InternedString::stats();
+
+        const InternedString owned( QString( "Trentemoller" ) );
+
+        InternedString::Lookup lookup;
+        InternedString found;
+        QVERIFY( InternedString::find( QString( "Trentemoller" ), &found ) );
+        QVERIFY( found == owned );
+        QCOMPARE( found.hash(), owned.hash() );
+        QCOMPARE( found.toString(), owned.toString() );
+
+        const InternedString copy = found;
+        QVERIFY( copy == owned );
+
+        QVERIFY( InternedString::find( QString(), &found ) );
+        QVERIFY( found.isEmpty() );
+        QVERIFY( !InternedString::find( QString( "trentemoller" ), &found ) );
+
+        // Nothing got created or referenced
+        const InternedString::Stats stats = InternedString::stats();
+        QCOMPARE( stats.strings, before.strings + 1 );
+        QCOMPARE( stats.references, before.references + 1 );
+    }
+
+    void testNoSweepDuringLookup()
+    {
+        InternedString::Lookup lookup;
+        InternedString found;
+        {
+            const InternedString owned( QString( "Kiasmos" ) );
+            QVERIFY( InternedString::find( QString( "Kiasmos" ), &found ) );
+        }
+
+        // The entry is unreferenced now, but must stay while we may compare it
+        InternedString::sweep();
+        QCOMPARE( found.toString(), QString( "Kiasmos" ) );
+        QVERIFY( found == InternedString( QString( "Kiasmos" ) ) );
+    }
+};
+
+#endif // TOMAHAWK_TESTINTERNEDSTRING_H
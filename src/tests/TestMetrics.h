@@ -0,0 +1,82 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTMETRICS_H
+#define TOMAHAWK_TESTMETRICS_H
+
+#include <QtTest>
+
+#include "utils/Metrics.h"
+
+
+class TestMetrics : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testBuckets()
+    {
+        // Buckets must be contiguous and cover every value
+        for ( int i = 1; i < HISTOGRAM_BUCKETS; i++ )
+        {
+            const qint64 lower = Tomahawk::Histogram::bucketUpperBound( i - 1 ) + 1;
+            QCOMPARE( Tomahawk::Histogram::bucketIndex( lower ), i );
+            QCOMPARE( Tomahawk::Histogram::bucketIndex( Tomahawk::Histogram::bucketUpperBound( i ) ), i );
+        }
+
+        QCOMPARE( Tomahawk::Histogram::bucketIndex( -5 ), 0 );
+        QCOMPARE( Tomahawk::Histogram::bucketIndex( Q_INT64_C( 1 ) << 50 ), HISTOGRAM_BUCKETS - 1 );
+    }
+
+    void testPercentiles()
+    {
+        Tomahawk::Histogram* h = Tomahawk::Metrics::instance()->histogram( "test_latency_ms" );
+        for ( int i = 1; i <= 1000; i++ )
+            h->record( i );
+
+        QCOMPARE( h->count(), (qint64)1000 );
+        QCOMPARE( h->sum(), (qint64)500500 );
+        QCOMPARE( h->max(), (qint64)1000 );
+
+        // Within the 12.5% accuracy of a bucket
+        QVERIFY( h->percentile( 0.5 ) >= 500 && h->percentile( 0.5 ) <= 563 );
+        QVERIFY( h->percentile( 0.99 ) >= 990 && h->percentile( 0.99 ) <= 1000 );
+        QCOMPARE( h->percentile( 1.0 ), (qint64)1000 );
+    }
+
+    void testRegistry()
+    {
+        Tomahawk::Metrics* metrics = Tomahawk::Metrics::instance();
+
+        Tomahawk::Counter* c = metrics->counter( "test_total", "kind", "a\"b" );
+        QVERIFY( c == metrics->counter( "test_total", "kind", "a\"b" ) );
+        QVERIFY( c != metrics->counter( "test_total", "kind", "c" ) );
+        c->add( 3 );
+
+        metrics->gauge( "test_depth" )->set( 42 );
+
+        const QString text = QString::fromUtf8( metrics->toPrometheus() );
+        QVERIFY( text.contains( "# TYPE tomahawk_test_total counter\n" ) );
+        QVERIFY( text.contains( "tomahawk_test_total{kind=\"a\\\"b\"} 3\n" ) );
+        QVERIFY( text.contains( "tomahawk_test_depth 42\n" ) );
+        QVERIFY( text.contains( "tomahawk_test_latency_ms{quantile=\"1\"} 1000\n" ) );
+        QCOMPARE( text.count( "# TYPE tomahawk_test_total " ), 1 );
+
+        const QVariantList list = metrics->toVariant().value( "metrics" ).toList();
+        QVERIFY( !list.isEmpty() );
+    }
+};
+
+#endif // TOMAHAWK_TESTMETRICS_H
@@ -0,0 +1,91 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_TESTMSGPROCESSOR_H
+#define TOMAHAWK_TESTMSGPROCESSOR_H
+
+#include <QtTest>
+
+#include "network/Msg.h"
+#include "network/MsgProcessor.h"
+
+
+class MsgCollector : public QObject
+{
+Q_OBJECT
+
+public:
+    QList< msg_ptr > msgs;
+
+public slots:
+    void onReady( msg_ptr msg )
+    {
+        msgs << msg;
+    }
+};
+
+
+class TestMsgProcessor : public QObject
+{
+    Q_OBJECT
+private:
+    static QByteArray dbop( int i, int padding )
+    {
+        return QString( "{\"command\":\"logplayback\",\"seq\":%1,\"guid\":\"%2\"}" )
+                .arg( i ).arg( QString( padding, 'x' ) ).toLatin1();
+    }
+
+    static void processAll( const QList< msg_ptr >& msgs, MsgCollector* collector )
+    {
+        MsgProcessor processor( MsgProcessor::UNCOMPRESS_ALL | MsgProcessor::PARSE_JSON );
+        QObject::connect( &processor, SIGNAL( ready( msg_ptr ) ), collector, SLOT( onReady( msg_ptr ) ) );
+
+        foreach ( const msg_ptr& msg, msgs )
+            processor.append( msg );
+
+        while ( collector->msgs.count() < msgs.count() )
+            QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents );
+    }
+
+private slots:
+    void testOrder()
+    {
+        // Interleave inline, batched and compressed msgs
+        QList< msg_ptr > msgs;
+        for ( int i = 0; i < 1000; i++ )
+        {
+            if ( i % 3 == 0 )
+                msgs << Msg::factory( dbop( i, 0 ), Msg::JSON | Msg::DBOP );
+            else if ( i % 3 == 1 )
+                msgs << Msg::factory( dbop( i, 1024 ), Msg::JSON | Msg::DBOP );
+            else
+                msgs << Msg::factory( qCompress( dbop( i, 1024 ), 9 ), Msg::JSON | Msg::DBOP | Msg::COMPRESSED );
+        }
+
+        MsgCollector collector;
+        processAll( msgs, &collector );
+
+        QCOMPARE( collector.msgs.count(), msgs.count() );
+        for ( int i = 0; i < collector.msgs.count(); i++ )
+        {
+            QVERIFY( collector.msgs.at( i ) == msgs.at( i ) );
+            QVERIFY( !collector.msgs.at( i )->is( Msg::COMPRESSED ) );
+            QCOMPARE( collector.msgs.at( i )->json().toMap().value( "seq" ).toInt(), i );
+        }
+    }
+};
+
+#endif // TOMAHAWK_TESTMSGPROCESSOR_H
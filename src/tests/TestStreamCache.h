@@ -0,0 +1,188 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TOMAHAWK_TESTSTREAMCACHE_H
+#define TOMAHAWK_TESTSTREAMCACHE_H
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QThreadPool>
+
+#include "network/BufferIoDevice.h"
+#include "utils/StreamCache.h"
+
+
+class TestStreamCache : public QObject
+{
+    Q_OBJECT
+private:
+    static QByteArray track( int blocks )
+    {
+        QByteArray data;
+        for ( int i = 0; i < blocks; i++ )
+            data += block( i );
+
+        return data;
+    }
+
+    static QByteArray block( int i )
+    {
+        return QByteArray( BufferIODevice::blockSize(), 'a' + ( i % 26 ) );
+    }
+
+    static void waitForWrites()
+    {
+        // Entries are written on the global thread pool
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+private slots:
+    void testStoreOpen()
+    {
+        QTemporaryDir dir;
+        Tomahawk::StreamCache cache( dir.path(), 16 * 1024 * 1024 );
+        const QByteArray data = track( 10 );
+
+        QVERIFY( cache.open( "track" ).isNull() );
+
+        cache.store( "track", data, true );
+        waitForWrites();
+        QCOMPARE( cache.size(), (qint64)data.size() );
+
+        QSharedPointer< QIODevice > dev = cache.open( "track" );
+        QVERIFY( !dev.isNull() );
+        QCOMPARE( dev->readAll(), data );
+
+        QCOMPARE( cache.stats().hits, (qint64)1 );
+        QCOMPARE( cache.stats().misses, (qint64)1 );
+    }
+
+    void testPartial()
+    {
+        QTemporaryDir dir;
+        Tomahawk::StreamCache cache( dir.path(), 16 * 1024 * 1024 );
+        const QByteArray data = track( 100 );
+
+        cache.store( "track", data.left( 80 * BufferIODevice::blockSize() ), false );
+        waitForWrites();
+        QVERIFY( cache.open( "track" ).isNull() );
+        QCOMPARE( cache.partial( "track" ), data.left( 80 * BufferIODevice::blockSize() ) );
+
+        // A shorter transfer doesn't replace what we had
+        cache.store( "track", data.left( 70 * BufferIODevice::blockSize() ), false );
+        waitForWrites();
+        QCOMPARE( cache.partial( "track" ).size(), 80 * (int)BufferIODevice::blockSize() );
+
+        // The complete track supersedes it
+        cache.store( "track", data, true );
+        waitForWrites();
+        QVERIFY( cache.partial( "track" ).isEmpty() );
+        QVERIFY( !cache.open( "track" ).isNull() );
+        QCOMPARE( cache.size(), (qint64)data.size() );
+    }
+
+    void testCompleteTransfer()
+    {
+        QTemporaryDir dir;
+        Tomahawk::StreamCache cache( dir.path(), 16 * 1024 * 1024 );
+        const QByteArray data = track( 100 );
+
+        {
+            BufferIODevice dev( data.size() );
+            dev.open( QIODevice::ReadOnly );
+            dev.setCacheKey( "track", &cache );
+
+            for ( int i = 0; i < 100; i++ )
+                dev.addData( i, block( i ) );
+            dev.inputComplete();
+        }
+        waitForWrites();
+
+        QSharedPointer< QIODevice > cached = cache.open( "track" );
+        QVERIFY( !cached.isNull() );
+        QCOMPARE( cached->readAll(), data );
+        QVERIFY( cache.partial( "track" ).isEmpty() );
+    }
+
+    void testInterruptedTransfer()
+    {
+        QTemporaryDir dir;
+        Tomahawk::StreamCache cache( dir.path(), 16 * 1024 * 1024 );
+        const QByteArray data = track( 100 );
+
+        {
+            // The peer went away after 80 blocks and a block from further ahead
+            BufferIODevice dev( data.size() );
+            dev.open( QIODevice::ReadOnly );
+            dev.setCacheKey( "track", &cache );
+
+            for ( int i = 0; i < 80; i++ )
+                dev.addData( i, block( i ) );
+            dev.addData( 90, block( 90 ) );
+            dev.inputComplete( "Peer went away" );
+        }
+        waitForWrites();
+
+        QVERIFY( cache.open( "track" ).isNull() );
+        QCOMPARE( cache.partial( "track" ), data.left( 80 * BufferIODevice::blockSize() ) );
+    }
+
+    void testShortTransferWithoutError()
+    {
+        QTemporaryDir dir;
+        Tomahawk::StreamCache cache( dir.path(), 16 * 1024 * 1024 );
+        const QByteArray data = track( 100 );
+
+        {
+            // Finished without an error, but the sender announced more than it sent
+            BufferIODevice dev( data.size() );
+            dev.open( QIODevice::ReadOnly );
+            dev.setCacheKey( "track", &cache );
+
+            for ( int i = 0; i < 80; i++ )
+                dev.addData( i, block( i ) );
+            dev.inputComplete();
+            QCOMPARE( dev.size(), (qint64)( 80 * BufferIODevice::blockSize() ) );
+        }
+        waitForWrites();
+
+        QVERIFY( cache.open( "track" ).isNull() );
+        QCOMPARE( cache.partial( "track" ).size(), 80 * (int)BufferIODevice::blockSize() );
+    }
+
+    void testDestroyedMidTransfer()
+    {
+        QTemporaryDir dir;
+        Tomahawk::StreamCache cache( dir.path(), 16 * 1024 * 1024 );
+        const QByteArray data = track( 100 );
+
+        {
+            BufferIODevice dev( data.size() );
+            dev.open( QIODevice::ReadOnly );
+            dev.setCacheKey( "track", &cache );
+
+            for ( int i = 0; i < 80; i++ )
+                dev.addData( i, block( i ) );
+        }
+        waitForWrites();
+
+        QVERIFY( cache.open( "track" ).isNull() );
+        QCOMPARE( cache.partial( "track" ), data.left( 80 * BufferIODevice::blockSize() ) );
+    }
+};
+
+#endif // TOMAHAWK_TESTSTREAMCACHE_H
@@ -0,0 +1,373 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TOMAHAWK_TESTSTREAMMULTIPLEXER_H
+#define TOMAHAWK_TESTSTREAMMULTIPLEXER_H
+
+#include <QtTest>
+#include <QBuffer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include "network/BufferIoDevice.h"
+#include "network/Msg.h"
+#include "network/StreamMultiplexer.h"
+#include "utils/Json.h"
+#include "Result.h"
+
+
+/**
+ * A file that is still arriving: only the first @p available bytes can be read
+ * until release() is called.
+ */
+class SourceBuffer : public QBuffer
+{
+public:
+    SourceBuffer( const QByteArray& data, qint64 available )
+        : m_available( available < 0 ? data.size() : available )
+    {
+        setData( data );
+        open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+    }
+
+    void release()
+    {
+        m_available = size();
+        emit readyRead();
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return qMax( (qint64)0, m_available - pos() );
+    }
+
+protected:
+    qint64 readData( char* data, qint64 maxSize )
+    {
+        return QBuffer::readData( data, qMin( maxSize, bytesAvailable() ) );
+    }
+
+private:
+    qint64 m_available;
+};
+
+
+/**
+ * A StreamMultiplexer talking to its peer over a plain socket instead of a
+ * ControlConnection, serving files from memory instead of the database.
+ */
+class SocketMultiplexer : public StreamMultiplexer
+{
+    Q_OBJECT
+public:
+    explicit SocketMultiplexer( QTcpSocket* socket )
+        : StreamMultiplexer( 0 )
+        , available( -1 )
+        , m_socket( socket )
+    {
+        setPeerFeatures( features() );
+        connect( socket, SIGNAL( readyRead() ), SLOT( onSocketReadyRead() ) );
+    }
+
+    void sendControlMsg( const QVariantMap& m )
+    {
+        sendMsg( Msg::factory( TomahawkUtils::toJson( m ), Msg::JSON ) );
+    }
+
+    void releaseSources()
+    {
+        foreach ( const QPointer< SourceBuffer >& source, m_sources )
+        {
+            if ( source )
+                source.data()->release();
+        }
+    }
+
+    // fid -> file contents
+    QHash< QString, QByteArray > files;
+    // Bytes of each file that can be sent before releaseSources(), -1 for all of them
+    qint64 available;
+    // Stream id of every data msg we sent, in order
+    QList< int > sentData;
+    // Every control msg we received
+    QList< QVariantMap > receivedControl;
+
+    bool hasReceived( const QString& method, int id ) const
+    {
+        foreach ( const QVariantMap& m, receivedControl )
+        {
+            if ( m.value( "method" ).toString() == method && m.value( "id" ).toInt() == id )
+                return true;
+        }
+
+        return false;
+    }
+
+protected:
+    void sendMsg( const msg_ptr& msg )
+    {
+        if ( msg->is( Msg::RAW ) )
+            sentData << qFromBigEndian< quint32 >( reinterpret_cast< const uchar* >( msg->payload().constData() ) );
+
+        msg->write( m_socket );
+    }
+
+    void loadFile( int id, const QString& fid )
+    {
+        if ( !files.contains( fid ) )
+        {
+            startSending( id, QSharedPointer< QIODevice >() );
+            return;
+        }
+
+        SourceBuffer* source = new SourceBuffer( files.value( fid ), available );
+        m_sources << source;
+        startSending( id, QSharedPointer< QIODevice >( source ) );
+    }
+
+private slots:
+    void onSocketReadyRead()
+    {
+        forever
+        {
+            if ( m_pending.isNull() )
+            {
+                if ( m_socket->bytesAvailable() < Msg::headerSize() )
+                    return;
+
+                QByteArray header = m_socket->read( Msg::headerSize() );
+                m_pending = Msg::begin( header.data() );
+            }
+
+            if ( m_socket->bytesAvailable() < m_pending->length() )
+                return;
+
+            msg_ptr msg = m_pending;
+            m_pending.clear();
+            msg->fill( m_socket->read( msg->length() ) );
+
+            if ( msg->is( Msg::RAW ) )
+            {
+                handleData( msg );
+            }
+            else
+            {
+                receivedControl << msg->json().toMap();
+                handleControlMsg( msg->json().toMap() );
+            }
+        }
+    }
+
+private:
+    QTcpSocket* m_socket;
+    msg_ptr m_pending;
+    QList< QPointer< SourceBuffer > > m_sources;
+};
+
+
+class TestStreamMultiplexer : public QObject
+{
+    Q_OBJECT
+private:
+    static QByteArray file( int size, char c )
+    {
+        QByteArray data( size, c );
+        for ( int i = 0; i < size; i += 97 )
+            data[ i ] = (char)( i / 97 );
+
+        return data;
+    }
+
+    static Tomahawk::result_ptr result( const QString& url, int size )
+    {
+        Tomahawk::result_ptr r = Tomahawk::Result::get( url );
+        r->setSize( size );
+        return r;
+    }
+
+    static bool isComplete( const QSharedPointer< QIODevice >& dev )
+    {
+        return qobject_cast< BufferIODevice* >( dev.data() )->nextEmptyBlock() < 0;
+    }
+
+    static QByteArray contents( const QSharedPointer< QIODevice >& dev )
+    {
+        dev->seek( 0 );
+        return dev->read( dev->size() );
+    }
+
+    QTcpServer* m_server;
+    QTcpSocket* m_receiverSocket;
+    QTcpSocket* m_senderSocket;
+    SocketMultiplexer* m_receiver;
+    SocketMultiplexer* m_sender;
+
+private slots:
+    void init()
+    {
+        m_server = new QTcpServer();
+        QVERIFY( m_server->listen( QHostAddress::LocalHost ) );
+
+        m_receiverSocket = new QTcpSocket();
+        m_receiverSocket->connectToHost( QHostAddress::LocalHost, m_server->serverPort() );
+        QVERIFY( m_server->waitForNewConnection( 5000 ) );
+        m_senderSocket = m_server->nextPendingConnection();
+        QVERIFY( m_receiverSocket->waitForConnected( 5000 ) );
+
+        m_receiver = new SocketMultiplexer( m_receiverSocket );
+        m_sender = new SocketMultiplexer( m_senderSocket );
+    }
+
+    void cleanup()
+    {
+        delete m_receiver;
+        delete m_sender;
+        delete m_receiverSocket;
+        delete m_server;
+    }
+
+    void testOpen()
+    {
+        // Not a multiple of the block size, the last block is short
+        const QByteArray data = file( 100 * BufferIODevice::blockSize() + 123, 'a' );
+        m_sender->files.insert( "1", data );
+
+        QSharedPointer< QIODevice > dev = m_receiver->openStream( result( "mux://1", data.size() ), "1" );
+        QVERIFY( !dev.isNull() );
+        QCOMPARE( dev->size(), (qint64)data.size() );
+
+        QTRY_VERIFY( isComplete( dev ) );
+        QCOMPARE( contents( dev ), data );
+
+        // The receiver tells the sender it can forget about the stream
+        QTRY_VERIFY( m_sender->hasReceived( "stream-close", 1 ) );
+        QCOMPARE( m_sender->sentData.count(), 101 );
+    }
+
+    void testUnknownFile()
+    {
+        QSharedPointer< QIODevice > dev = m_receiver->openStream( result( "mux://2", 1000 ), "2" );
+
+        QTRY_VERIFY( m_receiver->hasReceived( "stream-error", 1 ) );
+        QVERIFY( m_sender->sentData.isEmpty() );
+    }
+
+    void testInterleave()
+    {
+        // Bigger than the credit window, so every stream has to wait for credit
+        const int size = 300 * BufferIODevice::blockSize();
+        m_sender->files.insert( "1", file( size, 'a' ) );
+        m_sender->files.insert( "2", file( size, 'b' ) );
+        m_sender->files.insert( "3", file( size / 2, 'c' ) );
+
+        QSharedPointer< QIODevice > dev1 = m_receiver->openStream( result( "mux://1", size ), "1" );
+        QSharedPointer< QIODevice > dev2 = m_receiver->openStream( result( "mux://2", size ), "2" );
+        QSharedPointer< QIODevice > dev3 = m_receiver->openStream( result( "mux://3", size / 2 ), "3" );
+
+        QTRY_VERIFY( isComplete( dev1 ) && isComplete( dev2 ) && isComplete( dev3 ) );
+
+        // Every block ended up in the stream it belongs to
+        QCOMPARE( contents( dev1 ), m_sender->files.value( "1" ) );
+        QCOMPARE( contents( dev2 ), m_sender->files.value( "2" ) );
+        QCOMPARE( contents( dev3 ), m_sender->files.value( "3" ) );
+
+        QCOMPARE( m_sender->sentData.count( 1 ), 300 );
+        QCOMPARE( m_sender->sentData.count( 2 ), 300 );
+        QCOMPARE( m_sender->sentData.count( 3 ), 150 );
+    }
+
+    void testClose()
+    {
+        const int size = 2000 * BufferIODevice::blockSize();
+        m_sender->files.insert( "1", file( size, 'a' ) );
+        m_sender->available = 10 * BufferIODevice::blockSize();
+
+        QSharedPointer< QIODevice > dev = m_receiver->openStream( result( "mux://1", size ), "1" );
+        QTRY_COMPARE( m_sender->sentData.count(), 10 );
+
+        // The player skipped to the next track
+        dev->close();
+        QTRY_VERIFY( m_sender->hasReceived( "stream-close", 1 ) );
+
+        // The rest of the file never goes out
+        m_sender->releaseSources();
+        QTest::qWait( 200 );
+        QCOMPARE( m_sender->sentData.count(), 10 );
+    }
+
+    void testSeek()
+    {
+        const int size = 2000 * BufferIODevice::blockSize();
+        m_sender->files.insert( "1", file( size, 'a' ) );
+        m_sender->available = 10 * BufferIODevice::blockSize();
+
+        QSharedPointer< QIODevice > dev = m_receiver->openStream( result( "mux://1", size ), "1" );
+        QTRY_COMPARE( m_sender->sentData.count(), 10 );
+
+        // Jumping ahead to the last block is fine
+        QVariantMap m;
+        m.insert( "method", "stream-seek" );
+        m.insert( "id", 1 );
+        m.insert( "block", 1999 );
+        m_receiver->sendControlMsg( m );
+        QTRY_VERIFY( m_sender->hasReceived( "stream-seek", 1 ) );
+
+        m_sender->releaseSources();
+        BufferIODevice* buffer = qobject_cast< BufferIODevice* >( dev.data() );
+        QTRY_VERIFY( !buffer->isBlockEmpty( 1999 ) );
+        QVERIFY( buffer->isBlockEmpty( 10 ) );
+        QVERIFY( !m_receiver->hasReceived( "stream-error", 1 ) );
+    }
+
+    void testSeekOutOfRange_data()
+    {
+        QTest::addColumn< int >( "block" );
+
+        QTest::newRow( "negative" ) << -1;
+        QTest::newRow( "end" ) << 2000;
+        QTest::newRow( "far" ) << 0x7fffffff;
+    }
+
+    void testSeekOutOfRange()
+    {
+        QFETCH( int, block );
+
+        const int size = 2000 * BufferIODevice::blockSize();
+        m_sender->files.insert( "1", file( size, 'a' ) );
+        m_sender->available = 10 * BufferIODevice::blockSize();
+
+        QSharedPointer< QIODevice > dev = m_receiver->openStream( result( "mux://1", size ), "1" );
+        QTRY_COMPARE( m_sender->sentData.count(), 10 );
+
+        // A peer asking for blocks outside the file gets the stream closed on it
+        QVariantMap m;
+        m.insert( "method", "stream-seek" );
+        m.insert( "id", 1 );
+        m.insert( "block", block );
+        m_receiver->sendControlMsg( m );
+        QTRY_VERIFY( m_receiver->hasReceived( "stream-error", 1 ) );
+
+        m_sender->releaseSources();
+        QTest::qWait( 200 );
+        QCOMPARE( m_sender->sentData.count(), 10 );
+        QVERIFY( !qobject_cast< BufferIODevice* >( dev.data() )->isBlockEmpty( 9 ) );
+        QVERIFY( qobject_cast< BufferIODevice* >( dev.data() )->isBlockEmpty( 10 ) );
+    }
+};
+
+#endif // TOMAHAWK_TESTSTREAMMULTIPLEXER_H
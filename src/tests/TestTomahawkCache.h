@@ -0,0 +1,203 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TOMAHAWK_TESTTOMAHAWKCACHE_H
+#define TOMAHAWK_TESTTOMAHAWKCACHE_H
+
+#include <QtTest>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "utils/TomahawkCache.h"
+
+#define HOUR 3600000
+
+
+class TestTomahawkCache : public QObject
+{
+    Q_OBJECT
+private:
+    static QString fileName( const QTemporaryDir& dir )
+    {
+        return dir.path() + "/cache.dat";
+    }
+
+    static qint64 fileSize( const QTemporaryDir& dir )
+    {
+        return QFileInfo( fileName( dir ) ).size();
+    }
+
+    /// Writes a, b and c as three records, in that order
+    static void writeThree( const QTemporaryDir& dir )
+    {
+        TomahawkUtils::Cache cache( dir.path() );
+        cache.putData( "test", HOUR, "a", QString( "first" ) );
+        cache.flush();
+        cache.putData( "test", HOUR, "b", QString( "second" ) );
+        cache.flush();
+        cache.putData( "test", HOUR, "c", QString( "third" ) );
+        cache.flush();
+    }
+
+private slots:
+    void testRoundTrip()
+    {
+        QTemporaryDir dir;
+
+        QVariantMap map;
+        map.insert( "artist", "Artist" );
+        map.insert( "plays", 42 );
+        const QByteArray bytes( 10000, 'x' );
+
+        {
+            TomahawkUtils::Cache cache( dir.path() );
+            cache.putData( "test", HOUR, "string", QString( "value" ) );
+            cache.putData( "test", HOUR, "map", map );
+            cache.putData( "other", HOUR, "string", QString( "other value" ) );
+            cache.putData( "test", HOUR, "bytes", bytes );
+
+            // Pending puts are visible right away
+            QCOMPARE( cache.getData( "test", "string" ), QVariant( QString( "value" ) ) );
+            QVERIFY( !cache.getData( "test", "missing" ).isValid() );
+
+            cache.flush();
+            QCOMPARE( cache.getData( "test", "map" ), QVariant( map ) );
+
+            // A later put replaces the earlier one
+            cache.putData( "test", HOUR, "string", QString( "new value" ) );
+        }
+
+        // Everything comes back from disk, including what only the destructor flushed
+        TomahawkUtils::Cache cache( dir.path() );
+        QCOMPARE( cache.getData( "test", "string" ), QVariant( QString( "new value" ) ) );
+        QCOMPARE( cache.getData( "test", "map" ), QVariant( map ) );
+        QCOMPARE( cache.getData( "test", "bytes" ), QVariant( bytes ) );
+        QCOMPARE( cache.getData( "other", "string" ), QVariant( QString( "other value" ) ) );
+        QVERIFY( !cache.getData( "other", "map" ).isValid() );
+    }
+
+    void testTruncateTornRecord()
+    {
+        QTemporaryDir dir;
+        writeThree( dir );
+        const qint64 size = fileSize( dir );
+
+        // We crashed halfway through writing the last record
+        {
+            QFile file( fileName( dir ) );
+            QVERIFY( file.resize( size - 5 ) );
+        }
+
+        {
+            TomahawkUtils::Cache cache( dir.path() );
+            QCOMPARE( cache.getData( "test", "a" ), QVariant( QString( "first" ) ) );
+            QCOMPARE( cache.getData( "test", "b" ), QVariant( QString( "second" ) ) );
+            QVERIFY( !cache.getData( "test", "c" ).isValid() );
+
+            // The torn record is gone, new ones get appended after the last good one
+            QVERIFY( fileSize( dir ) < size - 5 );
+            cache.putData( "test", HOUR, "d", QString( "fourth" ) );
+        }
+
+        TomahawkUtils::Cache cache( dir.path() );
+        QCOMPARE( cache.getData( "test", "b" ), QVariant( QString( "second" ) ) );
+        QCOMPARE( cache.getData( "test", "d" ), QVariant( QString( "fourth" ) ) );
+    }
+
+    void testTruncateTornLength()
+    {
+        QTemporaryDir dir;
+        writeThree( dir );
+        const qint64 size = fileSize( dir );
+
+        // A length prefix promising more than what made it to disk
+        {
+            QFile file( fileName( dir ) );
+            QVERIFY( file.open( QIODevice::Append ) );
+            QDataStream stream( &file );
+            stream << (quint32)1000;
+            file.write( QByteArray( 10, 'x' ) );
+        }
+
+        TomahawkUtils::Cache cache( dir.path() );
+        QCOMPARE( fileSize( dir ), size );
+        QCOMPARE( cache.getData( "test", "a" ), QVariant( QString( "first" ) ) );
+        QCOMPARE( cache.getData( "test", "c" ), QVariant( QString( "third" ) ) );
+    }
+
+    void testCompaction()
+    {
+        QTemporaryDir dir;
+
+        {
+            TomahawkUtils::Cache cache( dir.path() );
+            cache.putData( "test", HOUR, "kept", QString( "kept" ) );
+
+            // Every flush appends a record superseding the previous one
+            for ( int i = 0; i < 1000; i++ )
+            {
+                cache.putData( "test", HOUR, "key", QByteArray( 2048, (char)( 'a' + i % 26 ) ) );
+                cache.flush();
+            }
+
+            const qint64 size = fileSize( dir );
+            QVERIFY( size > 1000 * 2048 );
+
+            cache.prune();
+            QVERIFY( fileSize( dir ) < 8192 );
+            QCOMPARE( cache.getData( "test", "key" ), QVariant( QByteArray( 2048, (char)( 'a' + 999 % 26 ) ) ) );
+            QCOMPARE( cache.getData( "test", "kept" ), QVariant( QString( "kept" ) ) );
+
+            // Appending carries on at the end of the compacted file
+            cache.putData( "test", HOUR, "new", QString( "new" ) );
+        }
+
+        TomahawkUtils::Cache cache( dir.path() );
+        QCOMPARE( cache.getData( "test", "key" ), QVariant( QByteArray( 2048, (char)( 'a' + 999 % 26 ) ) ) );
+        QCOMPARE( cache.getData( "test", "kept" ), QVariant( QString( "kept" ) ) );
+        QCOMPARE( cache.getData( "test", "new" ), QVariant( QString( "new" ) ) );
+    }
+
+    void testExpiry()
+    {
+        QTemporaryDir dir;
+
+        {
+            TomahawkUtils::Cache cache( dir.path() );
+            cache.putData( "test", 1, "short", QString( "short" ) );
+            cache.putData( "test", HOUR, "long", QString( "long" ) );
+            cache.flush();
+
+            QTest::qSleep( 50 );
+            QVERIFY( !cache.getData( "test", "short" ).isValid() );
+            QCOMPARE( cache.getData( "test", "long" ), QVariant( QString( "long" ) ) );
+
+            cache.prune();
+            QVERIFY( !cache.getData( "test", "short" ).isValid() );
+            QCOMPARE( cache.getData( "test", "long" ), QVariant( QString( "long" ) ) );
+        }
+
+        // Expired records don't come back from disk either
+        TomahawkUtils::Cache cache( dir.path() );
+        QVERIFY( !cache.getData( "test", "short" ).isValid() );
+        QCOMPARE( cache.getData( "test", "long" ), QVariant( QString( "long" ) ) );
+    }
+};
+
+#endif // TOMAHAWK_TESTTOMAHAWKCACHE_H
@@ -0,0 +1,111 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_BENCHMARKCACHE_H
+#define TOMAHAWK_BENCHMARKCACHE_H
+
+#include <QtTest>
+
+#include "BenchmarkUtils.h"
+
+#include "Result.h"
+#include "Track.h"
+
+#define BENCHMARK_CACHE_THREADS 16
+#define BENCHMARK_CACHE_TRACKS 10000
+
+
+/// Gets @p count tracks starting at @p first, like a DB worker loading a collection.
+class TrackGetter : public QThread
+{
+public:
+    TrackGetter( const QList< Tomahawk::ScannedFile >& files, int first, int count )
+        : m_files( files )
+        , m_first( first )
+        , m_count( count )
+    {}
+
+protected:
+    void run()
+    {
+        // Keep them alive until the end, so repeated names are cache hits
+        QList< Tomahawk::track_ptr > tracks;
+        QList< Tomahawk::result_ptr > results;
+        tracks.reserve( m_count );
+        results.reserve( m_count );
+
+        for ( int i = m_first; i < m_first + m_count; i++ )
+        {
+            const Tomahawk::ScannedFile& file = m_files.at( i % m_files.count() );
+            tracks << Tomahawk::Track::get( i % m_files.count() + 1, file.artist, file.track, file.album, file.duration, QString(), file.albumpos, file.discnumber );
+            results << Tomahawk::Result::get( file.url );
+        }
+    }
+
+private:
+    const QList< Tomahawk::ScannedFile >& m_files;
+    int m_first;
+    int m_count;
+};
+
+
+/// Contention on the global Track / TrackData / Result caches, independent of the collection size.
+class BenchmarkCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase()
+    {
+        for ( int i = 0; i < BENCHMARK_CACHE_TRACKS * BENCHMARK_CACHE_THREADS; i++ )
+            m_files << Benchmark::scannedFile( i );
+    }
+
+    void benchmarkConcurrentGet_data()
+    {
+        QTest::addColumn< bool >( "shared" );
+
+        // All threads asking for the same tracks, e.g. resolving one playlist
+        QTest::newRow( "shared" ) << true;
+        // Every thread on a different part of the collection
+        QTest::newRow( "distinct" ) << false;
+    }
+
+    void benchmarkConcurrentGet()
+    {
+        QFETCH( bool, shared );
+
+        QBENCHMARK
+        {
+            QList< TrackGetter* > threads;
+            for ( int i = 0; i < BENCHMARK_CACHE_THREADS; i++ )
+                threads << new TrackGetter( m_files, shared ? 0 : i * BENCHMARK_CACHE_TRACKS, BENCHMARK_CACHE_TRACKS );
+
+            foreach ( TrackGetter* thread, threads )
+                thread->start();
+            foreach ( TrackGetter* thread, threads )
+                thread->wait();
+
+            qDeleteAll( threads );
+        }
+
+        BenchmarkReport::setItems( (qint64)BENCHMARK_CACHE_THREADS * BENCHMARK_CACHE_TRACKS * 2 );
+    }
+
+private:
+    QList< Tomahawk::ScannedFile > m_files;
+};
+
+#endif // TOMAHAWK_BENCHMARKCACHE_H
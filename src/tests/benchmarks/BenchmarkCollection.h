@@ -0,0 +1,430 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_BENCHMARKCOLLECTION_H
+#define TOMAHAWK_BENCHMARKCOLLECTION_H
+
+#include <QtTest>
+
+#include "BenchmarkUtils.h"
+
+#include "database/Database.h"
+#include "database/DatabaseCommand_AddFiles.h"
+#include "database/DatabaseCommand_LoadOps.h"
+#include "database/DatabaseCommand_Resolve.h"
+#include "database/DatabaseCommand_UpdateSearchIndex.h"
+#include "database/DatabaseImpl.h"
+#include "database/Op.h"
+#include "database/TomahawkSqlQuery.h"
+#include "network/Msg.h"
+#include "utils/Json.h"
+#include "Query.h"
+#include "Source.h"
+#include "SourceList.h"
+
+#define BENCHMARK_BATCH_SIZE 1000
+#define BENCHMARK_PEER_ID 1
+
+
+/// Hammers the database from its own connection, either writing or reading.
+class DatabaseLoadThread : public QThread
+{
+public:
+    DatabaseLoadThread( Tomahawk::Database* db, bool writer )
+        : m_db( db ), m_writer( writer ), m_ops( 0 )
+    {}
+
+    void stop() { m_stop.fetchAndStoreOrdered( 1 ); }
+    int ops() const { return m_ops; }
+
+protected:
+    void run()
+    {
+        Tomahawk::DatabaseImpl* dbi = m_db->impl();
+        TomahawkSqlQuery query = dbi->newquery();
+
+        if ( m_writer )
+        {
+            // Long write transactions, like a big AddFiles
+            for ( int batch = 0; batch < 20; batch++ )
+            {
+                dbi->database().transaction();
+                query.prepare( "INSERT INTO settings(k, v) VALUES (?, ?)" );
+                for ( int i = 0; i < 1000; i++ )
+                {
+                    query.bindValue( 0, QString( "benchmark_%1_%2" ).arg( batch ).arg( i ) );
+                    query.bindValue( 1, QString( 200, 'x' ) );
+                    query.exec();
+                    m_ops++;
+                }
+                dbi->database().commit();
+            }
+
+            query.exec( "DELETE FROM settings WHERE k LIKE 'benchmark_%'" );
+            return;
+        }
+
+        while ( !m_stop.testAndSetOrdered( 1, 1 ) )
+        {
+            query.exec( "SELECT COUNT(*), MAX(k) FROM settings" );
+            query.next();
+            m_ops++;
+        }
+    }
+
+private:
+    Tomahawk::Database* m_db;
+    bool m_writer;
+    QAtomicInt m_stop;
+    int m_ops;
+};
+
+
+/**
+ * Scan, resolve and sync of a synthetic collection of the given size.
+ *
+ * Every suite instance works on a fresh database, the test functions build on
+ * each other: ingest -> index -> search / resolve -> oplog export -> replay.
+ */
+class BenchmarkCollection : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BenchmarkCollection( int tracks )
+        : m_tracks( tracks )
+        , m_db( 0 )
+    {}
+
+public slots:
+    void onOpsLoaded( const QString& sinceguid, const QString& lastguid, const QList< dbop_ptr >& ops )
+    {
+        Q_UNUSED( sinceguid );
+        Q_UNUSED( lastguid );
+        m_ops = ops;
+    }
+
+private:
+    /// Applies @p cmd the way DatabaseWorker does, including the oplog entry for local commands.
+    void execLogged( Tomahawk::DatabaseCommandLoggable* cmd, bool log )
+    {
+        Tomahawk::DatabaseImpl* dbi = m_db->impl();
+        dbi->database().transaction();
+        cmd->_exec( dbi );
+
+        if ( log )
+        {
+            QByteArray ba = cmd->serialize();
+            const bool compressed = ba.length() >= 512;
+            if ( compressed )
+                ba = Msg::compress( ba, Msg::COMPRESSED );
+
+            TomahawkSqlQuery query = dbi->preparedQuery( "INSERT INTO oplog(source, guid, command, singleton, compressed, json) "
+                                                         "VALUES(?, ?, ?, ?, ?, ?)" );
+            query.addBindValue( QVariant( QVariant::Int ) );
+            query.addBindValue( cmd->guid() );
+            query.addBindValue( cmd->commandname() );
+            query.addBindValue( cmd->singletonCmd() ? "true" : "false" );
+            query.addBindValue( compressed ? "true" : "false" );
+            query.addBindValue( ba );
+            QVERIFY( query.exec() );
+        }
+
+        dbi->finishQueries();
+        QVERIFY( dbi->database().commit() );
+    }
+
+    int countFiles( const QString& where )
+    {
+        TomahawkSqlQuery query = m_db->impl()->newquery();
+        query.exec( "SELECT count(*) FROM file WHERE " + where );
+        return query.next() ? query.value( 0 ).toInt() : -1;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QTemporaryFile file( QDir::tempPath() + "/tomahawk-benchmark-XXXXXX.db" );
+        QVERIFY( file.open() );
+        m_dbPath = file.fileName();
+        file.close();
+        file.remove();
+
+        m_db = new Tomahawk::Database( m_dbPath );
+        m_db->loadIndex();
+        QVERIFY( m_db->isReady() );
+
+        // The local source lives as long as the process, later suites reuse it
+        if ( SourceList::instance()->getLocal().isNull() )
+            SourceList::instance()->setLocal( Tomahawk::source_ptr( new Tomahawk::Source( 0, m_db->impl()->dbid() ) ) );
+        m_local = SourceList::instance()->getLocal();
+        m_peer = Tomahawk::source_ptr( new Tomahawk::Source( BENCHMARK_PEER_ID, "benchmark-peer" ) );
+
+        TomahawkSqlQuery query = m_db->impl()->newquery();
+        query.prepare( "INSERT INTO source(id, name, friendlyname, isonline) VALUES(?, ?, ?, 'false')" );
+        query.addBindValue( BENCHMARK_PEER_ID );
+        query.addBindValue( m_peer->nodeId() );
+        query.addBindValue( "Benchmark Peer" );
+        QVERIFY( query.exec() );
+    }
+
+    void cleanupTestCase()
+    {
+        m_ops.clear();
+        m_peer.clear();
+        m_local.clear();
+
+        delete m_db;
+        m_db = 0;
+
+        QFile::remove( m_dbPath );
+        QFile::remove( m_dbPath + "-wal" );
+        QFile::remove( m_dbPath + "-shm" );
+    }
+
+    void benchmarkAddFiles()
+    {
+        QBENCHMARK_ONCE
+        {
+            for ( int offset = 0; offset < m_tracks; offset += BENCHMARK_BATCH_SIZE )
+            {
+                Tomahawk::DatabaseCommand_AddFiles cmd( Benchmark::createBatch( offset, qMin( BENCHMARK_BATCH_SIZE, m_tracks - offset ) ), m_local );
+                execLogged( &cmd, true );
+            }
+        }
+
+        QCOMPARE( countFiles( "source IS NULL" ), m_tracks );
+        BenchmarkReport::setItems( m_tracks );
+    }
+
+    void benchmarkArtistId()
+    {
+        // The artists benchmarkAddFiles created, every lookup goes through the prepared statement cache
+        const int artists = qMax( 1, m_tracks / ( BENCHMARK_TRACKS_PER_ALBUM * BENCHMARK_ALBUMS_PER_ARTIST ) );
+        QStringList names;
+        for ( int i = 0; i < qMin( artists, 100 ); i++ )
+            names << Benchmark::artistName( i );
+
+        const int lookups = 10000;
+        Tomahawk::DatabaseImpl* dbi = m_db->impl();
+        QBENCHMARK
+        {
+            // Alternate names, so the last-artist shortcut never hits
+            for ( int i = 0; i < lookups; i++ )
+                QVERIFY( dbi->artistId( names.at( i % names.count() ), false ) > 0 );
+        }
+
+        BenchmarkReport::setItems( lookups );
+    }
+
+    void benchmarkIndexBuild()
+    {
+        QBENCHMARK_ONCE
+        {
+            Tomahawk::DatabaseCommand_UpdateSearchIndex cmd;
+            cmd._exec( m_db->impl() );
+        }
+
+        BenchmarkReport::setItems( m_tracks );
+    }
+
+    void benchmarkSearch()
+    {
+        const QList< QPair< QString, QString > > samples = Benchmark::sampleQueries( m_tracks, 1000 );
+        QList< Tomahawk::query_ptr > queries;
+        for ( int i = 0; i < samples.count(); i++ )
+            queries << Tomahawk::Query::get( samples.at( i ).first, samples.at( i ).second, QString(), QString(), false );
+
+        int found = 0;
+        QBENCHMARK
+        {
+            found = 0;
+            foreach ( const Tomahawk::query_ptr& query, queries )
+            {
+                if ( !m_db->impl()->search( query, 10 ).isEmpty() )
+                    found++;
+            }
+        }
+
+        // Half of the samples have a typo, the exact ones have to turn up
+        QVERIFY( found >= queries.count() / 2 );
+        BenchmarkReport::setItems( queries.count() );
+    }
+
+    void benchmarkResolve()
+    {
+        const QList< QPair< QString, QString > > samples = Benchmark::sampleQueries( m_tracks, 1000 );
+        QList< Tomahawk::query_ptr > queries;
+        for ( int i = 0; i < samples.count(); i++ )
+            queries << Tomahawk::Query::get( samples.at( i ).first, samples.at( i ).second, QString(), QString(), false );
+
+        // Results are cached by url, so only the first iteration creates them
+        QBENCHMARK
+        {
+            foreach ( const Tomahawk::query_ptr& query, queries )
+            {
+                Tomahawk::DatabaseCommand_Resolve cmd( query );
+                cmd._exec( m_db->impl() );
+                m_db->impl()->finishQueries();
+            }
+        }
+
+        BenchmarkReport::setItems( queries.count() );
+    }
+
+    void benchmarkOplogExport()
+    {
+        QBENCHMARK
+        {
+            Tomahawk::DatabaseCommand_loadOps cmd( m_local, QString() );
+            connect( &cmd, SIGNAL( done( QString, QString, QList< dbop_ptr > ) ),
+                     SLOT( onOpsLoaded( QString, QString, QList< dbop_ptr > ) ) );
+            cmd._exec( m_db->impl() );
+        }
+
+        QCOMPARE( m_ops.count(), ( m_tracks + BENCHMARK_BATCH_SIZE - 1 ) / BENCHMARK_BATCH_SIZE );
+        BenchmarkReport::setItems( m_tracks );
+    }
+
+    void benchmarkOplogReplay()
+    {
+        QVERIFY( !m_ops.isEmpty() );
+
+        // What a peer does with our ops, after the MsgProcessor uncompressed and parsed them
+        QBENCHMARK_ONCE
+        {
+            foreach ( const dbop_ptr& op, m_ops )
+            {
+                const QByteArray json = op->compressed ? Msg::uncompress( op->payload, Msg::COMPRESSED ) : op->payload;
+                Tomahawk::dbcmd_ptr cmd = m_db->createCommandInstance( TomahawkUtils::parseJson( json ), m_peer );
+                QVERIFY( !cmd.isNull() );
+
+                execLogged( static_cast< Tomahawk::DatabaseCommandLoggable* >( cmd.data() ), false );
+            }
+        }
+
+        QCOMPARE( countFiles( QString( "source = %1" ).arg( BENCHMARK_PEER_ID ) ), m_tracks );
+        BenchmarkReport::setItems( m_tracks );
+    }
+
+    void benchmarkConcurrentAccess()
+    {
+        // One writer running long transactions while readers keep querying.
+        // Readers must not stall while the writer is busy.
+        const int readerCount = 4;
+
+        int reads = 0;
+        int writes = 0;
+        qint64 elapsed = 0;
+        QBENCHMARK_ONCE
+        {
+            QList< DatabaseLoadThread* > readers;
+            for ( int i = 0; i < readerCount; i++ )
+            {
+                readers << new DatabaseLoadThread( m_db, false );
+                readers.last()->start();
+            }
+
+            QElapsedTimer timer;
+            timer.start();
+
+            DatabaseLoadThread writer( m_db, true );
+            writer.start();
+            QVERIFY( writer.wait( 120000 ) );
+            elapsed = qMax( (qint64)1, timer.elapsed() );
+            writes = writer.ops();
+
+            foreach ( DatabaseLoadThread* reader, readers )
+            {
+                reader->stop();
+                reader->wait();
+                reads += reader->ops();
+            }
+            qDeleteAll( readers );
+        }
+
+        QVERIFY( reads > 0 );
+        BenchmarkReport::setItems( writes );
+        BenchmarkReport::setStat( "readsPerSecond", reads * 1000 / elapsed );
+    }
+
+    void benchmarkSerializeAddFiles_data()
+    {
+        QTest::addColumn< bool >( "typed" );
+
+        QTest::newRow( "reflection" ) << false;
+        QTest::newRow( "typed" ) << true;
+    }
+
+    void benchmarkSerializeAddFiles()
+    {
+        QFETCH( bool, typed );
+
+        // One op as big as a whole collection, like the first sync with an old peer
+        Tomahawk::DatabaseCommand_AddFiles command( Benchmark::createBatch( 0, m_tracks ), m_local );
+        QByteArray ba;
+
+        QBENCHMARK
+        {
+            if ( typed )
+                ba = command.serialize();
+            else
+                ba = TomahawkUtils::toJson( TomahawkUtils::qobject2qvariant( &command ) );
+        }
+
+        BenchmarkReport::setItems( m_tracks );
+        BenchmarkReport::setStat( "opBytes", ba.size() );
+    }
+
+    void benchmarkDeserializeAddFiles_data()
+    {
+        QTest::addColumn< bool >( "typed" );
+
+        QTest::newRow( "reflection" ) << false;
+        QTest::newRow( "typed" ) << true;
+    }
+
+    void benchmarkDeserializeAddFiles()
+    {
+        QFETCH( bool, typed );
+
+        Tomahawk::DatabaseCommand_AddFiles command( Benchmark::createBatch( 0, m_tracks ), m_local );
+        const QVariantMap op = TomahawkUtils::parseJson( command.serialize() ).toMap();
+
+        QBENCHMARK
+        {
+            Tomahawk::DatabaseCommand_AddFiles restored;
+            if ( typed )
+                restored.deserialize( op );
+            else
+                TomahawkUtils::qvariant2qobject( op, &restored );
+
+            QCOMPARE( restored.files().count(), m_tracks );
+        }
+
+        BenchmarkReport::setItems( m_tracks );
+    }
+
+private:
+    int m_tracks;
+    QString m_dbPath;
+
+    Tomahawk::Database* m_db;
+    Tomahawk::source_ptr m_local;
+    Tomahawk::source_ptr m_peer;
+    QList< dbop_ptr > m_ops;
+};
+
+#endif // TOMAHAWK_BENCHMARKCOLLECTION_H
@@ -0,0 +1,240 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_BENCHMARKNETWORK_H
+#define TOMAHAWK_BENCHMARKNETWORK_H
+
+#include <QtTest>
+
+#include "BenchmarkUtils.h"
+
+#include "database/DatabaseCommand_AddFiles.h"
+#include "network/BufferIoDevice.h"
+#include "network/Msg.h"
+#include "network/MsgProcessor.h"
+
+
+class MsgCollector : public QObject
+{
+Q_OBJECT
+
+public:
+    QList< msg_ptr > msgs;
+
+public slots:
+    void onReady( msg_ptr msg )
+    {
+        msgs << msg;
+    }
+};
+
+
+/// Wire framing, op compression and the streaming buffer, independent of the collection size.
+class BenchmarkNetwork : public QObject
+{
+    Q_OBJECT
+private:
+    /// A serialized AddFiles op for @p count tracks, what dbsync sends most of the time
+    static QByteArray addFilesOp( int count )
+    {
+        Tomahawk::DatabaseCommand_AddFiles cmd( Benchmark::createBatch( 0, count ), Tomahawk::source_ptr() );
+        return cmd.serialize();
+    }
+
+    static QByteArray dbop( int i, int padding )
+    {
+        return QString( "{\"command\":\"logplayback\",\"seq\":%1,\"guid\":\"%2\"}" )
+                .arg( i ).arg( QString( padding, 'x' ) ).toLatin1();
+    }
+
+private slots:
+    void benchmarkMsgFraming_data()
+    {
+        QTest::addColumn< int >( "payloadSize" );
+
+        QTest::newRow( "control" ) << 64;
+        QTest::newRow( "dbop" ) << 2048;
+        QTest::newRow( "stream-block" ) << 4096 * 4;
+    }
+
+    void benchmarkMsgFraming()
+    {
+        QFETCH( int, payloadSize );
+
+        const int count = 10000;
+        const QByteArray payload( payloadSize, 'x' );
+
+        QBENCHMARK
+        {
+            QBuffer wire;
+            wire.open( QIODevice::ReadWrite );
+            for ( int i = 0; i < count; i++ )
+                Msg::factory( payload, Msg::RAW )->write( &wire );
+
+            // Parse it back like Connection::readyRead does
+            wire.seek( 0 );
+            int parsed = 0;
+            char header[ 5 ];
+            while ( wire.read( header, Msg::headerSize() ) == Msg::headerSize() )
+            {
+                msg_ptr msg = Msg::begin( header );
+                msg->fill( wire.read( msg->length() ) );
+                parsed++;
+            }
+
+            QCOMPARE( parsed, count );
+        }
+
+        BenchmarkReport::setItems( count );
+    }
+
+    void benchmarkMsgProcessor_data()
+    {
+        QTest::addColumn< int >( "padding" );
+        QTest::addColumn< bool >( "compressed" );
+
+        QTest::newRow( "small" ) << 0 << false;
+        QTest::newRow( "medium" ) << 512 << false;
+        QTest::newRow( "compressed" ) << 4096 << true;
+    }
+
+    void benchmarkMsgProcessor()
+    {
+        QFETCH( int, padding );
+        QFETCH( bool, compressed );
+
+        const int count = 20000;
+
+        QBENCHMARK
+        {
+            // Msgs get modified in place, so every run needs fresh ones
+            QList< msg_ptr > msgs;
+            for ( int i = 0; i < count; i++ )
+            {
+                if ( compressed )
+                    msgs << Msg::factory( qCompress( dbop( i, padding ), 9 ), Msg::JSON | Msg::DBOP | Msg::COMPRESSED );
+                else
+                    msgs << Msg::factory( dbop( i, padding ), Msg::JSON | Msg::DBOP );
+            }
+
+            MsgCollector collector;
+            MsgProcessor processor( MsgProcessor::UNCOMPRESS_ALL | MsgProcessor::PARSE_JSON );
+            connect( &processor, SIGNAL( ready( msg_ptr ) ), &collector, SLOT( onReady( msg_ptr ) ) );
+
+            foreach ( const msg_ptr& msg, msgs )
+                processor.append( msg );
+
+            while ( collector.msgs.count() < count )
+                QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents );
+        }
+
+        BenchmarkReport::setItems( count );
+    }
+
+    void benchmarkCompression_data()
+    {
+        QTest::addColumn< QString >( "codec" );
+        QTest::addColumn< int >( "tracks" );
+
+        // What every op was compressed with before the codec got negotiated
+        QTest::newRow( "zlib-9/10" ) << "zlib-9" << 10;
+        QTest::newRow( "zlib-9/1000" ) << "zlib-9" << 1000;
+        QTest::newRow( "zlib/10" ) << "zlib" << 10;
+        QTest::newRow( "zlib/1000" ) << "zlib" << 1000;
+        if ( Msg::supportedCodecs().contains( "lz4" ) )
+        {
+            QTest::newRow( "lz4/10" ) << "lz4" << 10;
+            QTest::newRow( "lz4/1000" ) << "lz4" << 1000;
+        }
+    }
+
+    void benchmarkCompression()
+    {
+        QFETCH( QString, codec );
+        QFETCH( int, tracks );
+
+        const QByteArray op = addFilesOp( tracks );
+        const char flags = ( codec == "lz4" ) ? ( Msg::COMPRESSED | Msg::LZ4 ) : Msg::COMPRESSED;
+        QByteArray compressed;
+
+        QBENCHMARK
+        {
+            if ( codec == "zlib-9" )
+                compressed = qCompress( op, 9 );
+            else
+                compressed = Msg::compress( op, flags );
+
+            QCOMPARE( Msg::uncompress( compressed, flags ).size(), op.size() );
+        }
+
+        BenchmarkReport::setItems( op.size() );
+        BenchmarkReport::setStat( "compressedBytes", compressed.size() );
+    }
+
+    void benchmarkBufferIODevice()
+    {
+        const int bs = BufferIODevice::blockSize();
+        const int blocks = 2048;
+        const QByteArray data( bs, 'b' );
+        char buf[ 16384 ];
+
+        QBENCHMARK
+        {
+            BufferIODevice dev( (unsigned int)blocks * bs );
+            dev.open( QIODevice::ReadOnly );
+
+            // The player reads while the blocks come in
+            qint64 read = 0;
+            for ( int i = 0; i < blocks; i++ )
+            {
+                dev.addData( i, data );
+                qint64 n;
+                while ( ( n = dev.read( buf, sizeof( buf ) ) ) > 0 )
+                    read += n;
+            }
+
+            QCOMPARE( read, (qint64)blocks * bs );
+        }
+
+        BenchmarkReport::setItems( (qint64)blocks * bs );
+    }
+
+    void benchmarkBufferIODeviceReceive()
+    {
+        // A ~60MB FLAC, in order, checking for gaps after each block like StreamConnection does
+        const int bs = BufferIODevice::blockSize();
+        const int blocks = 15000;
+        const QByteArray data( bs, 'b' );
+
+        QBENCHMARK
+        {
+            BufferIODevice dev( (unsigned int)blocks * bs );
+            dev.open( QIODevice::ReadOnly );
+
+            for ( int i = 0; i < blocks; i++ )
+            {
+                dev.addData( i, data );
+                dev.nextEmptyBlock();
+            }
+
+            QCOMPARE( dev.nextEmptyBlock(), -1 );
+        }
+
+        BenchmarkReport::setItems( blocks );
+    }
+};
+
+#endif // TOMAHAWK_BENCHMARKNETWORK_H
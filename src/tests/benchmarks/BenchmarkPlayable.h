@@ -0,0 +1,204 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_BENCHMARKPLAYABLE_H
+#define TOMAHAWK_BENCHMARKPLAYABLE_H
+
+#include <QtTest>
+
+#include "BenchmarkUtils.h"
+
+#include "playlist/PlayableModel.h"
+#include "playlist/PlayableProxyModel.h"
+#include "Query.h"
+#include "Result.h"
+#include "Track.h"
+#include "utils/InternedString.h"
+
+#define BENCHMARK_CANDIDATES 10
+
+
+/// Result scoring and the views' filtering and sorting over a synthetic collection of the given size.
+class BenchmarkPlayable : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BenchmarkPlayable( int tracks )
+        : m_tracks( tracks )
+        , m_model( 0 )
+        , m_heapBytes( -1 )
+    {}
+
+private:
+    static Tomahawk::track_ptr track( int i )
+    {
+        const Tomahawk::ScannedFile file = Benchmark::scannedFile( i );
+        return Tomahawk::Track::get( file.artist, file.track, file.album, file.duration, QString(), file.albumpos, file.discnumber );
+    }
+
+private slots:
+    void initTestCase()
+    {
+        const qint64 heapBefore = Benchmark::heapBytes();
+
+        QList< Tomahawk::query_ptr > queries;
+        queries.reserve( m_tracks );
+        for ( int i = 0; i < m_tracks; i++ )
+            queries << Tomahawk::Query::get( track( i ) );
+
+        m_model = new PlayableModel( this, false );
+        m_model->appendQueries( queries );
+        QCOMPARE( m_model->rowCount( QModelIndex() ), m_tracks );
+
+        // What the loaded collection keeps on the heap: tracks, their names, the caches and the model
+        queries.clear();
+        if ( heapBefore >= 0 )
+            m_heapBytes = Benchmark::heapBytes() - heapBefore;
+    }
+
+    void cleanupTestCase()
+    {
+        delete m_model;
+        m_model = 0;
+    }
+
+    void benchmarkHowSimilar()
+    {
+        // What resolving does: every query gets scored against a handful of candidates
+        const QList< QPair< QString, QString > > samples = Benchmark::sampleQueries( m_tracks, 1000 );
+        QList< Tomahawk::query_ptr > queries;
+        QList< QList< Tomahawk::result_ptr > > candidates;
+        for ( int i = 0; i < samples.count(); i++ )
+        {
+            queries << Tomahawk::Query::get( samples.at( i ).first, samples.at( i ).second, QString(), QString(), false );
+
+            const int first = (int)( (qint64)i * m_tracks / samples.count() );
+            QList< Tomahawk::result_ptr > results;
+            for ( int j = first; j < qMin( first + BENCHMARK_CANDIDATES, m_tracks ); j++ )
+            {
+                Tomahawk::result_ptr result = Tomahawk::Result::get( Benchmark::scannedFile( j ).url );
+                result->setTrack( track( j ) );
+                results << result;
+            }
+            candidates << results;
+        }
+
+        qint64 scored = 0;
+        float score = 0.0;
+        QBENCHMARK
+        {
+            scored = 0;
+            for ( int i = 0; i < queries.count(); i++ )
+            {
+                foreach ( const Tomahawk::result_ptr& result, candidates.at( i ) )
+                {
+                    score += queries.at( i )->howSimilar( result );
+                    scored++;
+                }
+            }
+        }
+
+        QVERIFY( score > 0.0 );
+        BenchmarkReport::setItems( scored );
+    }
+
+    void benchmarkTrackCache()
+    {
+        // Every collection load and resolve looks up tracks that mostly exist already
+        QList< Tomahawk::ScannedFile > files;
+        files.reserve( m_tracks );
+        for ( int i = 0; i < m_tracks; i++ )
+            files << Benchmark::scannedFile( i );
+
+        QBENCHMARK
+        {
+            foreach ( const Tomahawk::ScannedFile& file, files )
+                Tomahawk::Track::get( file.artist, file.track, file.album, file.duration, QString(), file.albumpos, file.discnumber );
+        }
+
+        // The string payloads alone, next to the whole heap the collection took in initTestCase
+        Tomahawk::InternedString::sweep();
+        const Tomahawk::InternedString::Stats stats = Tomahawk::InternedString::stats();
+
+        BenchmarkReport::setItems( m_tracks );
+        BenchmarkReport::setStat( "internedStrings", stats.strings );
+        BenchmarkReport::setStat( "internedBytes", stats.bytes );
+        BenchmarkReport::setStat( "internedSavedBytes", stats.savedBytes );
+        if ( m_heapBytes >= 0 )
+        {
+            BenchmarkReport::setStat( "collectionHeapBytes", m_heapBytes );
+            BenchmarkReport::setStat( "heapBytesPerTrack", m_heapBytes / m_tracks );
+        }
+    }
+
+    void benchmarkFilter_data()
+    {
+        QTest::addColumn< QStringList >( "patterns" );
+
+        // Typing a search term letter by letter, then clearing it
+        QTest::newRow( "typing" ) << ( QStringList() << "n" << "ne" << "neo" << "neon" << "neon g" << "neon gh" << "neon gho" << "" );
+        QTest::newRow( "no-match" ) << ( QStringList() << "zzz" << "" );
+    }
+
+    void benchmarkFilter()
+    {
+        QFETCH( QStringList, patterns );
+
+        PlayableProxyModel proxy;
+        proxy.setSourcePlayableModel( m_model );
+
+        QBENCHMARK
+        {
+            foreach ( const QString& pattern, patterns )
+                proxy.setFilter( pattern );
+        }
+
+        QCOMPARE( proxy.rowCount( QModelIndex() ), m_tracks );
+        BenchmarkReport::setItems( (qint64)m_tracks * patterns.count() );
+    }
+
+    void benchmarkSort_data()
+    {
+        QTest::addColumn< int >( "column" );
+
+        QTest::newRow( "artist" ) << (int)PlayableModel::Artist;
+        QTest::newRow( "track" ) << (int)PlayableModel::Track;
+        QTest::newRow( "duration" ) << (int)PlayableModel::Duration;
+    }
+
+    void benchmarkSort()
+    {
+        QFETCH( int, column );
+
+        PlayableProxyModel proxy;
+        proxy.setSourcePlayableModel( m_model );
+
+        QBENCHMARK
+        {
+            proxy.sort( column, Qt::AscendingOrder );
+            proxy.sort( column, Qt::DescendingOrder );
+        }
+
+        BenchmarkReport::setItems( (qint64)m_tracks * 2 );
+    }
+
+private:
+    int m_tracks;
+    PlayableModel* m_model;
+    qint64 m_heapBytes;
+};
+
+#endif // TOMAHAWK_BENCHMARKPLAYABLE_H
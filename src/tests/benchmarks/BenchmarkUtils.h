@@ -0,0 +1,206 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOMAHAWK_BENCHMARKUTILS_H
+#define TOMAHAWK_BENCHMARKUTILS_H
+
+#include <QtTest>
+
+#include "database/ScannedFile.h"
+
+#ifdef __GLIBC__
+    #include <malloc.h>
+#endif
+
+#define BENCHMARK_TRACKS_PER_ALBUM 12
+#define BENCHMARK_ALBUMS_PER_ARTIST 8
+
+
+/**
+ * Items processed per benchmark, recorded next to the timings so the runner can
+ * report throughput (items per second) and not just time per iteration. Other
+ * numbers worth tracking, like memory use, can be attached as stats.
+ */
+class BenchmarkReport
+{
+public:
+    static void setItems( qint64 items )
+    {
+        s_items.insert( key( QTest::currentTestFunction(), QTest::currentDataTag() ), items );
+    }
+
+    static qint64 items( const QString& function, const QString& tag )
+    {
+        return s_items.value( key( function, tag ), 0 );
+    }
+
+    static void setStat( const QString& name, qint64 value )
+    {
+        s_stats[ key( QTest::currentTestFunction(), QTest::currentDataTag() ) ].insert( name, value );
+    }
+
+    static QVariantMap stats( const QString& function, const QString& tag )
+    {
+        return s_stats.value( key( function, tag ) );
+    }
+
+    static QString suite;
+
+private:
+    static QString key( const QString& function, const QString& tag )
+    {
+        return suite + "::" + function + "/" + tag;
+    }
+
+    static QHash< QString, qint64 > s_items;
+    static QHash< QString, QVariantMap > s_stats;
+};
+
+
+namespace Benchmark
+{
+
+/// e.g. 10k, 100k or 1M
+inline QString
+sizeLabel( int tracks )
+{
+    if ( tracks >= 1000000 && tracks % 1000000 == 0 )
+        return QString( "%1M" ).arg( tracks / 1000000 );
+    if ( tracks >= 1000 && tracks % 1000 == 0 )
+        return QString( "%1k" ).arg( tracks / 1000 );
+
+    return QString::number( tracks );
+}
+
+
+/// Deterministic, so runs on different machines and builds are comparable
+inline QString
+word( int i )
+{
+    static const char* words[] = { "black", "velvet", "summer", "echo", "river", "neon", "silent", "golden",
+                                   "broken", "electric", "midnight", "paper", "crystal", "wild", "lonely", "northern",
+                                   "fire", "ghost", "ocean", "machine", "garden", "static", "hollow", "crimson",
+                                   "dream", "thunder", "glass", "winter", "shadow", "radio", "desert", "heart" };
+    return words[ i % 32 ];
+}
+
+
+inline QString
+artistName( int artist )
+{
+    return QString( "%1 %2 %3" ).arg( word( artist ) ).arg( word( artist / 32 + 7 ) ).arg( artist );
+}
+
+
+inline QString
+albumName( int album )
+{
+    return QString( "%1 %2 %3" ).arg( word( album * 7 + 3 ) ).arg( word( album / 32 + 11 ) ).arg( album );
+}
+
+
+inline QString
+trackName( int track )
+{
+    return QString( "%1 %2 %3" ).arg( word( track * 13 + 5 ) ).arg( word( track / 32 + 17 ) ).arg( track );
+}
+
+
+/// Track @p i of the synthetic collection, as the MusicScanner would report it.
+inline Tomahawk::ScannedFile
+scannedFile( int i )
+{
+    const int album = i / BENCHMARK_TRACKS_PER_ALBUM;
+    const int artist = album / BENCHMARK_ALBUMS_PER_ARTIST;
+
+    Tomahawk::ScannedFile file;
+    file.url = QString( "file:///music/%1/%2/%3.mp3" ).arg( artist ).arg( album ).arg( i );
+    file.mtime = 1400000000 + i;
+    file.size = 4000000 + ( i * 1337 ) % 6000000;
+    file.mimetype = "audio/mpeg";
+    file.duration = 120 + i % 240;
+    file.bitrate = 320;
+    file.artist = artistName( artist );
+    file.album = albumName( album );
+    file.track = trackName( i );
+    file.albumpos = i % BENCHMARK_TRACKS_PER_ALBUM + 1;
+    file.discnumber = 1;
+    file.year = 1970 + artist % 45;
+
+    return file;
+}
+
+
+/// Bytes currently allocated from the heap, or -1 where the allocator can't tell us.
+inline qint64
+heapBytes()
+{
+#if defined( __GLIBC__ ) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+    const struct mallinfo2 info = mallinfo2();
+    return (qint64)info.uordblks + (qint64)info.hblkhd;
+#elif defined( __GLIBC__ )
+    const struct mallinfo info = mallinfo();
+    return (qint64)(unsigned int)info.uordblks + (qint64)(unsigned int)info.hblkhd;
+#else
+    return -1;
+#endif
+}
+
+
+inline Tomahawk::ScannedFileBatch
+createBatch( int offset, int count )
+{
+    Tomahawk::ScannedFileBatch batch;
+    batch.reserve( count );
+    for ( int i = offset; i < offset + count; i++ )
+        batch.append( scannedFile( i ) );
+
+    return batch;
+}
+
+
+/**
+ * Artist / track pairs to look up in a collection of @p tracks tracks: exact
+ * matches and ones with a typo, spread evenly over the collection.
+ */
+inline QList< QPair< QString, QString > >
+sampleQueries( int tracks, int count )
+{
+    QList< QPair< QString, QString > > queries;
+    for ( int i = 0; i < count; i++ )
+    {
+        const int track = (int)( (qint64)i * tracks / count );
+        const int artist = track / BENCHMARK_TRACKS_PER_ALBUM / BENCHMARK_ALBUMS_PER_ARTIST;
+
+        QString artistStr = artistName( artist );
+        QString trackStr = trackName( track );
+        if ( i % 2 )
+        {
+            // Swap two letters, like a user typing too fast
+            const QChar c = trackStr.at( 1 );
+            trackStr[ 1 ] = trackStr.at( 2 );
+            trackStr[ 2 ] = c;
+        }
+
+        queries << qMakePair( artistStr, trackStr );
+    }
+
+    return queries;
+}
+
+}
+
+#endif // TOMAHAWK_BENCHMARKUTILS_H
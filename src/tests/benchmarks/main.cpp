@@ -0,0 +1,235 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <QtCore>
+#include <QApplication>
+
+#include "BenchmarkUtils.h"
+#include "BenchmarkCache.h"
+#include "BenchmarkCollection.h"
+#include "BenchmarkNetwork.h"
+#include "BenchmarkPlayable.h"
+#include "moc_BenchmarkCache.cpp"
+#include "moc_BenchmarkCollection.cpp"
+#include "moc_BenchmarkNetwork.cpp"
+#include "moc_BenchmarkPlayable.cpp"
+
+#include "utils/Json.h"
+#include "Pipeline.h"
+
+#include <iostream>
+
+QString BenchmarkReport::suite;
+QHash< QString, qint64 > BenchmarkReport::s_items;
+QHash< QString, QVariantMap > BenchmarkReport::s_stats;
+
+static const int s_sizes[] = { 10000, 100000, 1000000 };
+
+
+static void
+usage()
+{
+    std::cerr << "Usage: tomahawk_benchmarks [options] [benchmark functions]" << std::endl
+              << "  --json <file>       write the results to file instead of stdout" << std::endl
+              << "  --max-tracks <n>    largest synthetic collection to run (default: 100000)" << std::endl
+              << "  --suite <name>      only run suites starting with name (Network, Cache, Collection, Playable)" << std::endl
+              << "Benchmark functions (e.g. benchmarkResolve) are handed to QtTest." << std::endl;
+}
+
+
+/**
+ * Runs @p suite through QtTest and converts its XML log into one JSON entry per
+ * benchmark (and data row). Returns the number of failed checks.
+ */
+static int
+runSuite( QObject* suite, const QString& name, const QString& size, const QStringList& functions, QVariantList& results )
+{
+    QTemporaryFile log( QDir::tempPath() + "/tomahawk-benchmark-XXXXXX.xml" );
+    log.open();
+    log.close();
+
+    QStringList args;
+    args << qApp->applicationFilePath() << "-xml" << "-o" << log.fileName() << functions;
+
+    BenchmarkReport::suite = name;
+    QTest::qExec( suite, args );
+
+    QFile file( log.fileName() );
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+        std::cerr << "Could not read the results of " << qPrintable( name ) << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    QString function;
+    QXmlStreamReader xml( &file );
+    while ( !xml.atEnd() )
+    {
+        if ( xml.readNext() != QXmlStreamReader::StartElement )
+            continue;
+
+        const QXmlStreamAttributes attrs = xml.attributes();
+        if ( xml.name() == "TestFunction" )
+        {
+            function = attrs.value( "name" ).toString();
+        }
+        else if ( xml.name() == "Incident" && attrs.value( "type" ).toString().contains( "fail" ) )
+        {
+            std::cerr << qPrintable( name ) << "::" << qPrintable( function ) << " failed" << std::endl;
+            failures++;
+        }
+        else if ( xml.name() == "BenchmarkResult" )
+        {
+            const QString tag = attrs.value( "tag" ).toString();
+            const QString metric = attrs.value( "metric" ).toString();
+            const int iterations = qMax( 1, attrs.value( "iterations" ).toString().toInt() );
+            double value = attrs.value( "value" ).toString().toDouble();
+#if QT_VERSION < QT_VERSION_CHECK( 5, 0, 0 )
+            // Qt 4 logs the total of all iterations
+            value /= iterations;
+#endif
+            const qint64 items = BenchmarkReport::items( function, tag );
+            const QVariantMap stats = BenchmarkReport::stats( function, tag );
+
+            QVariantMap m;
+            m.insert( "suite", name );
+            if ( !size.isEmpty() )
+                m.insert( "size", size );
+            m.insert( "benchmark", function );
+            if ( !tag.isEmpty() )
+                m.insert( "tag", tag );
+            m.insert( "metric", metric );
+            m.insert( "value", value );
+            m.insert( "iterations", iterations );
+            if ( items > 0 )
+            {
+                m.insert( "items", items );
+                // "walltime" on Qt 4
+                if ( metric.startsWith( "walltime", Qt::CaseInsensitive ) && value > 0 )
+                    m.insert( "perSecond", (qint64)( items * 1000.0 / value ) );
+            }
+
+            if ( !stats.isEmpty() )
+                m.insert( "stats", stats );
+
+            results << m;
+        }
+    }
+
+    return failures;
+}
+
+
+int
+main( int argc, char** argv )
+{
+    QApplication app( argc, argv );
+    // Keeps the fuzzy index and everything else away from a real profile
+    QCoreApplication::setOrganizationName( "TomahawkBenchmarks" );
+    QCoreApplication::setApplicationName( "TomahawkBenchmarks" );
+
+    QString jsonFile;
+    QString suiteFilter;
+    int maxTracks = 100000;
+    QStringList functions;
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+    while ( !args.isEmpty() )
+    {
+        const QString arg = args.takeFirst();
+        if ( arg == "--json" && !args.isEmpty() )
+            jsonFile = args.takeFirst();
+        else if ( arg == "--max-tracks" && !args.isEmpty() )
+            maxTracks = args.takeFirst().toInt();
+        else if ( arg == "--suite" && !args.isEmpty() )
+            suiteFilter = args.takeFirst();
+        else if ( arg.startsWith( "-" ) )
+        {
+            usage();
+            return 1;
+        }
+        else
+            functions << arg;
+    }
+
+    // DatabaseCommand_Resolve expects a running pipeline
+    Tomahawk::Pipeline* pipeline = new Tomahawk::Pipeline( &app );
+    pipeline->start();
+
+    QVariantList results;
+    int failures = 0;
+
+    if ( QString( "Network" ).startsWith( suiteFilter ) )
+    {
+        BenchmarkNetwork network;
+        failures += runSuite( &network, "Network", QString(), functions, results );
+    }
+
+    if ( QString( "Cache" ).startsWith( suiteFilter ) )
+    {
+        BenchmarkCache cache;
+        failures += runSuite( &cache, "Cache", QString(), functions, results );
+    }
+
+    for ( unsigned int i = 0; i < sizeof( s_sizes ) / sizeof( s_sizes[ 0 ] ) && s_sizes[ i ] <= maxTracks; i++ )
+    {
+        const QString size = Benchmark::sizeLabel( s_sizes[ i ] );
+
+        if ( QString( "Collection" ).startsWith( suiteFilter ) )
+        {
+            BenchmarkCollection collection( s_sizes[ i ] );
+            failures += runSuite( &collection, "Collection", size, functions, results );
+        }
+
+        if ( QString( "Playable" ).startsWith( suiteFilter ) )
+        {
+            BenchmarkPlayable playable( s_sizes[ i ] );
+            failures += runSuite( &playable, "Playable", size, functions, results );
+        }
+
+        // Deferred deletes of queries, results and commands
+        QCoreApplication::sendPostedEvents( 0, QEvent::DeferredDelete );
+    }
+
+    QVariantMap report;
+    report.insert( "timestamp", QDateTime::currentDateTime().toUTC().toString( Qt::ISODate ) );
+    report.insert( "qtVersion", QString( qVersion() ) );
+    report.insert( "idealThreadCount", QThread::idealThreadCount() );
+    report.insert( "maxTracks", maxTracks );
+    report.insert( "failures", failures );
+    report.insert( "results", results );
+
+    const QByteArray json = TomahawkUtils::toJson( report );
+    if ( jsonFile.isEmpty() )
+    {
+        std::cout << json.constData() << std::endl;
+    }
+    else
+    {
+        QFile out( jsonFile );
+        if ( !out.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        {
+            std::cerr << "Could not write " << qPrintable( jsonFile ) << std::endl;
+            return 1;
+        }
+        out.write( json );
+    }
+
+    return failures > 0 ? 1 : 0;
+}
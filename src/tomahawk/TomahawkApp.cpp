@@ -37,6 +37,7 @@
 #include "playlist/XspfUpdater.h"
 #include "network/Servent.h"
 #include "network/DbSyncConnection.h"
+#include "network/StreamConnection.h"
 #include "SourceList.h"
 #include "ViewManager.h"
 #include "ShortcutHandler.h"
@@ -216,7 +217,8 @@ TomahawkApp::init()
     // init pipeline and resolver factories
     new Pipeline();
 
-    m_servent = QPointer<Servent>( new Servent( this ) );
+    // The Servent moves itself onto its own network thread, so it must not have a parent
+    m_servent = QPointer<Servent>( new Servent() );
     connect( m_servent.data(), SIGNAL( ready() ), SLOT( initSIP() ) );
 
     tDebug() << "Init Database.";
@@ -373,6 +375,7 @@ TomahawkApp::registerMetaTypes()
     qRegisterMetaType< QList<QString> >("QList<QString>");
     qRegisterMetaType< QList<uint> >("QList<uint>");
     qRegisterMetaType< Connection* >("Connection*");
+    qRegisterMetaType< StreamConnection* >("StreamConnection*");
     qRegisterMetaType< QAbstractSocket::SocketError >("QAbstractSocket::SocketError");
     qRegisterMetaType< QTcpSocket* >("QTcpSocket*");
     qRegisterMetaType< QSharedPointer<QIODevice> >("QSharedPointer<QIODevice>");
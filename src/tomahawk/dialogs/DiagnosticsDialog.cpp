@@ -37,6 +37,7 @@
 #include "sip/SipPlugin.h"
 #include "utils/TomahawkUtilsGui.h"
 #include "utils/Logger.h"
+#include "utils/Metrics.h"
 
 #include <QApplication>
 #include <QClipboard>
@@ -123,6 +124,10 @@ DiagnosticsDialog::updateLogView()
         log.append( accountLog( account ) + "\n" );
     }
 
+    log.append( "\nMETRICS:\n" );
+    foreach ( const QString& line, Tomahawk::Metrics::instance()->toString().split( '\n', QString::SkipEmptyParts ) )
+        log.append( "      " + line + "\n" );
+
     ui->text->setText( log );
 }
 